@@ -45,4 +45,17 @@ enum AKM_DEVICES {
 #define CONFIG_SLOT2  AKM_DEVICE_NONE
 #define CONFIG_SLOT3  AKM_DEVICE_NONE
 
+/* Device table which is passed to AKS_ConfigDevices(). Each entry is
+ * { device, I2C 8-bit address or SPI CS index }. For example, two
+ * AK09940A with different CAD pin setting:
+ *   { AKM_MAGNETOMETER_AK09940A, 0x18 }, { AKM_MAGNETOMETER_AK09940A, 0x1A } */
+#define CONFIG_DEVICES \
+    { CONFIG_SLOT1, AKH_ADDRESS_DEFAULT }, \
+    { CONFIG_SLOT2, AKH_ADDRESS_DEFAULT }, \
+    { CONFIG_SLOT3, AKH_ADDRESS_DEFAULT }
+
+/* Define this to detect sensors on the bus at start up instead of using
+ * CONFIG_DEVICES. See AKS_ConfigDetect(). */
+//#define CONFIG_AUTO_DETECT
+
 #endif /* INCLUDE_AKM_CONFIG_H */
@@ -41,6 +41,16 @@
 #define AKM_CUSTOM_ACC_FREQ  50
 #define AKM_CUSTOM_GYR_FREQ  100
 
+/*! The number of magnetometer samples averaged into one output.
+ * 1 passes every sample through. This can be changed by "dec" command. */
+#define AKM_CUSTOM_MAG_DECIMATION  1
+
+/*! The rate of the common time grid in Hz. When more than one type of
+ * sensor feeds the library, samples are interpolated to this grid so that
+ * fusion takes vectors of the same time. 0 feeds samples as they are
+ * read. This can be changed by "sync" command. */
+#define AKM_CUSTOM_FUSION_FREQ  AKM_CUSTOM_MAG_FREQ
+
 /*! \defgroup CSPEC_AXIS The axis conversion
  * Axis conversion parameters.
  @{*/
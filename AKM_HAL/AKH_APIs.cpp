@@ -6,6 +6,13 @@
 #else
 #include "akh_i2c.h"
 #endif
+#include "akh_profile.h"
+#include "akh_cache.h"
+#include "akh_log.h"
+#include "akh_timebase.h"
+#include "akh_nvstore.h"
+#include "akh_power.h"
+#include "akh_trace.h"
 
 /* UART 정의 및 입력 처리 관련 변수 */
 #ifdef ACSP_DEFINE
@@ -16,57 +23,8 @@ BufferedSerial uart(PA_2, PA_3, 921600);
 BufferedSerial uart(USBTX, USBRX, 115200);
 #endif
 
-char inputBuffer[128]; // 입력 버퍼
-volatile bool inputReady = false; // 입력이 완료되었음을 나타내는 플래그
-volatile bool paused = false; // 프로그램이 일시 정지 상태인지 나타내는 플래그
-
 /* Reset pin definition */
 //DigitalOut rstn(PB_0);
-void readInput() {
-    char c;
-    static int index = 0;
-
-    while (uart.readable() && uart.read(&c, 1)) {
-        if (c == '\n' || c == '\r') {
-            inputBuffer[index] = '\0'; 
-            inputReady = true; 
-            index = 0; 
-        } else {
-            inputBuffer[index++] = c;
-            if (index >= sizeof(inputBuffer) - 1) {
-                index = sizeof(inputBuffer) - 1; 
-            }
-        }
-    }
-}
-
-
-void processInput() {
-    if (inputReady) {
-        inputReady = false;
-
-        if (strcmp(inputBuffer, "q") == 0) {
-            paused = true;
-            uart.write("Program paused. Press 'r' to resume.\n", 36);
-            while (paused) {
-                readInput();
-                inputReady = false;
-                if (strcmp(inputBuffer, "r") == 0 && paused)
-                {
-                    paused = false;
-                    uart.write("Program resumed.\n", 18);
-                    break;
-                }
-            }
-        } 
-        else if (strcmp(inputBuffer, "z") == 0) {
-            AKH_Print("Exiting program...\n");
-            exit(EXIT_SUCCESS);  
-        }
-
-        memset(inputBuffer, 0, sizeof(inputBuffer)); 
-    }
-}
 
 /* user event interface */
 #ifndef ACSP_DEFINE
@@ -85,11 +43,55 @@ InterruptIn acc_int(D5);
 InterruptIn gyr_int(D3);
 #endif
 
-/* get timestamp */
-Timer ts;
+/* Events which wake up the measurement loop */
+static EventFlags   g_events;
+static IRQ_CALLBACK g_mag_cb;
+static IRQ_CALLBACK g_acc_cb;
+static IRQ_CALLBACK g_gyr_cb;
+static IRQ_CALLBACK g_uart_cb;
+
+/* DRDY trampolines. Sensor driver's handler takes timestamp first,
+ * then the loop is woken up. */
+static void mag_drdy(void)
+{
+    AKH_Trace_IRQ(IRQ_MAG_1);
+
+    if (g_mag_cb != NULL) {
+        g_mag_cb();
+    }
+
+    g_events.set(AKH_EVENT_MAG);
+}
+
+static void acc_drdy(void)
+{
+    AKH_Trace_IRQ(IRQ_ACC_1);
+
+    if (g_acc_cb != NULL) {
+        g_acc_cb();
+    }
+
+    g_events.set(AKH_EVENT_ACC);
+}
+
+static void gyr_drdy(void)
+{
+    AKH_Trace_IRQ(IRQ_GYR_1);
+
+    if (g_gyr_cb != NULL) {
+        g_gyr_cb();
+    }
+
+    g_events.set(AKH_EVENT_GYR);
+}
+
 
-/* Heart beat LED */
+/* Heart beat LED. Low power ticker does not hold deep sleep. */
+#if DEVICE_LPTICKER
+LowPowerTicker tk;
+#else
 Ticker tk;
+#endif
 #ifdef ACSP_DEFINE
 DigitalOut led1(PA_0);
 #else
@@ -100,13 +102,50 @@ void pressed()
 {
 #ifndef ACSP_DEFINE
     user_int = true;
+    g_events.set(AKH_EVENT_USER);
 #endif
 }
 
+/* This is called in interrupt context */
+static void uart_rx(void)
+{
+    if (g_uart_cb != NULL) {
+        g_uart_cb();
+    }
+
+    g_events.set(AKH_EVENT_UART);
+}
+
 void heart_beat() {
     led1 = !led1;
 }
 
+#ifdef AKH_USE_TRACE
+/* Asynchronous read which is in flight. */
+static struct {
+    volatile bool     busy;
+    AKH_HANDLE        dev;
+    uint8_t           address;
+    uint8_t           *data;
+    uint16_t          len;
+    AKH_XFER_CALLBACK callback;
+    void              *arg;
+} g_trace_rx;
+
+/* This is called in thread context. */
+static void trace_rx_done(const int16_t result, void *unused)
+{
+    AKH_Trace_Xfer(
+        AKH_TRACE_RX, g_trace_rx.dev, g_trace_rx.address, g_trace_rx.data,
+        g_trace_rx.len, result);
+    g_trace_rx.busy = false;
+
+    if (g_trace_rx.callback != NULL) {
+        g_trace_rx.callback(result, g_trace_rx.arg);
+    }
+}
+#endif
+
 /******************************************************************************/
 /***** AKH public APIs ********************************************************/
 void AKH_Init(void)
@@ -136,8 +175,23 @@ void AKH_Init(void)
     /* USART configuration */
     uart.write("Hello ACSP!!!\n", 14);
 
-    /* start timer */
-    ts.start();
+    /* start deferred logger */
+    AKH_LogInit();
+
+    /* find the latest parameter record in advance */
+    AKH_NV_Init();
+
+    /* start timebase */
+    AKH_TimebaseInit();
+
+#ifdef AKH_USE_TRACE
+    /* record from boot, so that the session can be replayed */
+    AKH_TraceStart();
+#endif
+
+    /* start idle statistics, and wake up on UART input */
+    AKH_PowerInit();
+    uart.sigio(uart_rx);
 
     /* start heart beat */
     tk.attach(&heart_beat, 500ms);  // Updated to use chrono duration
@@ -147,28 +201,180 @@ void AKH_Init(void)
 }
 
 int16_t AKH_TxData(
-    const AKM_SENSOR_TYPE stype,
+    const AKH_HANDLE dev,
     const uint8_t address,
     const uint8_t *data,
     const uint16_t numberOfBytesToWrite)
 {
+    int16_t fret;
+
 #ifdef AKH_USE_SPI
-    return AKH_SPI_TxData(stype, address, data, numberOfBytesToWrite);
+    fret = AKH_SPI_TxData(dev, address, data, numberOfBytesToWrite);
 #else
-    return AKH_I2C_TxData(stype, address, data, numberOfBytesToWrite);
+    fret = AKH_I2C_TxData(dev, address, data, numberOfBytesToWrite);
 #endif
+
+    AKH_Trace_Xfer(
+        AKH_TRACE_TX, dev, address, data, numberOfBytesToWrite, fret);
+
+    /* keep register shadow up to date */
+    if (fret == AKM_SUCCESS) {
+        AKH_Cache_Store(dev, address, data, numberOfBytesToWrite);
+    } else {
+        AKH_Cache_Drop(dev, address, numberOfBytesToWrite);
+    }
+
+    return fret;
 }
 
 int16_t AKH_RxData(
-    const AKM_SENSOR_TYPE stype,
+    const AKH_HANDLE dev,
+    const uint8_t address,
+    uint8_t *data,
+    const uint16_t numberOfBytesToRead)
+{
+    int16_t fret;
+
+#ifdef AKH_USE_SPI
+    fret = AKH_SPI_RxData(dev, address, data, numberOfBytesToRead);
+#else
+    fret = AKH_I2C_RxData(dev, address, data, numberOfBytesToRead);
+#endif
+
+    AKH_Trace_Xfer(
+        AKH_TRACE_RX, dev, address, data, numberOfBytesToRead, fret);
+
+    return fret;
+}
+
+int16_t AKH_ProbeData(
+    const AKH_HANDLE dev,
     const uint8_t address,
     uint8_t *data,
     const uint16_t numberOfBytesToRead)
+{
+    int16_t fret;
+
+#ifdef AKH_USE_SPI
+    /* SPI has no acknowledge, the caller checks the data. */
+    fret = AKH_SPI_RxData(dev, address, data, numberOfBytesToRead);
+#else
+    fret = AKH_I2C_ProbeData(dev, address, data, numberOfBytesToRead);
+#endif
+
+    AKH_Trace_Xfer(
+        AKH_TRACE_RX, dev, address, data, numberOfBytesToRead, fret);
+
+    return fret;
+}
+
+int16_t AKH_TxDataAsync(
+    const AKH_HANDLE dev,
+    const uint8_t address,
+    const uint8_t *data,
+    const uint16_t numberOfBytesToWrite,
+    const AKH_XFER_CALLBACK callback,
+    void *arg)
+{
+    int16_t fret;
+
+    /* the result is not known here, so forget the shadow */
+    AKH_Cache_Drop(dev, address, numberOfBytesToWrite);
+
+#ifdef AKH_USE_SPI
+    fret = AKH_SPI_TxDataAsync(
+            dev, address, data, numberOfBytesToWrite, callback, arg);
+#else
+    fret = AKH_I2C_TxDataAsync(
+            dev, address, data, numberOfBytesToWrite, callback, arg);
+#endif
+
+    /* data is released after return, so it is recorded at start */
+    if (fret != AKM_ERR_BUSY) {
+        AKH_Trace_Xfer(
+            AKH_TRACE_TX, dev, address, data, numberOfBytesToWrite, fret);
+    }
+
+    return fret;
+}
+
+int16_t AKH_RxDataAsync(
+    const AKH_HANDLE dev,
+    const uint8_t address,
+    uint8_t *data,
+    const uint16_t numberOfBytesToRead,
+    const AKH_XFER_CALLBACK callback,
+    void *arg)
+{
+    int16_t fret;
+
+#ifdef AKH_USE_TRACE
+    /* The context is set before start, because the callback may run
+     * before the driver returns. */
+    if (g_trace_rx.busy) {
+        return AKM_ERR_BUSY;
+    }
+
+    g_trace_rx.busy = true;
+    g_trace_rx.dev = dev;
+    g_trace_rx.address = address;
+    g_trace_rx.data = data;
+    g_trace_rx.len = numberOfBytesToRead;
+    g_trace_rx.callback = callback;
+    g_trace_rx.arg = arg;
+#ifdef AKH_USE_SPI
+    fret = AKH_SPI_RxDataAsync(
+            dev, address, data, numberOfBytesToRead, trace_rx_done, NULL);
+#else
+    fret = AKH_I2C_RxDataAsync(
+            dev, address, data, numberOfBytesToRead, trace_rx_done, NULL);
+#endif
+
+    if (fret != AKM_SUCCESS) {
+        g_trace_rx.busy = false;
+    }
+#else
+#ifdef AKH_USE_SPI
+    fret = AKH_SPI_RxDataAsync(
+            dev, address, data, numberOfBytesToRead, callback, arg);
+#else
+    fret = AKH_I2C_RxDataAsync(
+            dev, address, data, numberOfBytesToRead, callback, arg);
+#endif
+#endif
+
+    return fret;
+}
+
+int16_t AKH_GetBusThroughput(struct AKH_BUS_THROUGHPUT *tp)
+{
+#ifdef AKH_USE_SPI
+    return AKH_SPI_GetThroughput(tp);
+#else
+    return AKH_I2C_GetThroughput(tp);
+#endif
+}
+
+int16_t AKH_GetBusClock(
+    const AKH_HANDLE dev,
+    uint32_t         *hz)
+{
+#ifdef AKH_USE_SPI
+    *hz = AKH_Profile_SPIClock(dev);
+#else
+    *hz = AKH_Profile_I2CClock(dev);
+#endif
+    return AKM_SUCCESS;
+}
+
+int16_t AKH_GetBusErrors(
+    const AKH_HANDLE      dev,
+    struct AKH_BUS_ERRORS *errors)
 {
 #ifdef AKH_USE_SPI
-    return AKH_SPI_RxData(stype, address, data, numberOfBytesToRead);
+    return AKM_ERR_NOT_SUPPORT;
 #else
-    return AKH_I2C_RxData(stype, address, data, numberOfBytesToRead);
+    return AKH_I2C_GetErrors(dev, errors);
 #endif
 }
 
@@ -178,8 +384,8 @@ int16_t AKH_Reset(const AKM_SENSOR_TYPE stype)
     //wait_us(100);
     //rstn = 1;
 
-    /* reset timer */
-    ts.reset();
+    /* Timebase is never reset during a run, so that timestamps of
+     * each measurement session stay comparable. */
 
     return AKM_SUCCESS;
 }
@@ -203,8 +409,10 @@ int16_t AKH_SetIRQHandler(
     case IRQ_MAG_1:
         if (func == NULL) {
             mag_int.disable_irq();
+            g_mag_cb = NULL;
         } else {
-            mag_int.rise(func);
+            g_mag_cb = func;
+            mag_int.rise(mag_drdy);
             mag_int.enable_irq();
         }
         break;
@@ -212,8 +420,10 @@ int16_t AKH_SetIRQHandler(
     case IRQ_ACC_1:
         if (func == NULL) {
             acc_int.disable_irq();
+            g_acc_cb = NULL;
         } else {
-            acc_int.rise(func);
+            g_acc_cb = func;
+            acc_int.rise(acc_drdy);
             acc_int.enable_irq();
         }
         break;
@@ -221,26 +431,72 @@ int16_t AKH_SetIRQHandler(
     case IRQ_GYR_1:
         if (func == NULL) {
             gyr_int.disable_irq();
+            g_gyr_cb = NULL;
         } else {
-            gyr_int.rise(func);
+            g_gyr_cb = func;
+            gyr_int.rise(gyr_drdy);
             gyr_int.enable_irq();
         }
         break;
 
+    case IRQ_UART:
+        g_uart_cb = func;
+        break;
+
     default:
         return AKM_ERR_NOT_SUPPORT;
     }
+#else
+
+    if (stype == IRQ_UART) {
+        g_uart_cb = func;
+    }
 #endif
 
     return AKM_SUCCESS;
 }
 
+void AKH_SignalEvent(const uint32_t events)
+{
+    g_events.set(events & AKH_EVENT_ALL);
+}
+
+int16_t AKH_WaitEvent(
+    const uint32_t mask,
+    const uint32_t timeout_us,
+    uint32_t       *events)
+{
+    uint32_t flags;
+
+    /* Round up, so that the caller never wakes before its deadline */
+    flags = g_events.wait_any_for(
+                mask & AKH_EVENT_ALL,
+                std::chrono::milliseconds((timeout_us + 999U) / 1000U));
+
+    if ((flags & osFlagsError) != 0U) {
+        if (events != NULL) {
+            *events = 0U;
+        }
+
+        return AKM_ERR_TIMEOUT;
+    }
+
+    if (events != NULL) {
+        *events = flags & mask;
+    }
+
+    return AKM_SUCCESS;
+}
+
 AKM_TIMESTAMP AKH_GetTimestamp(void)
 {
 #ifdef AKM_TIMESTAMP_NANOSECOND
-    return (AKM_TIMESTAMP)((unsigned int)ts.elapsed_time().count() * (AKM_TIMESTAMP)1000);  // Updated to use chrono elapsed_time
+    return (AKM_TIMESTAMP)AKH_GetTimeNs();
 #else
-    return (AKM_TIMESTAMP)(0x7FFFFFFF & ts.elapsed_time().count());  // Updated to use chrono elapsed_time
+    /* 32-bit micro seconds wraps around every 71 minutes. The lower word is
+     * kept as it is, so that the difference of two timestamps is correct
+     * across the wrap when it is calculated in 32-bit. */
+    return (AKM_TIMESTAMP)(uint32_t)(AKH_GetTimeNs() / 1000);
 #endif
 }
 
@@ -248,14 +504,14 @@ int16_t AKH_SaveParameter(
     const uint8_t *param,
     const uint16_t nBytes)
 {
-    return AKM_ERR_NOT_SUPPORT;
+    return AKH_NV_Save(param, nBytes);
 }
 
 int16_t AKH_LoadParameter(
     uint8_t *param,
     const uint16_t nBytes)
 {
-    return AKM_ERR_NOT_SUPPORT;
+    return AKH_NV_Load(param, nBytes);
 }
 
 void AKH_Print(
@@ -272,6 +528,43 @@ void AKH_Print(
     uart.write(buf, strlen(buf));  // BufferedSerial write 사용
 }
 
+int16_t AKH_Write(
+    const uint8_t  *data,
+    const uint16_t len)
+{
+    if (uart.write(data, len) != (ssize_t)len) {
+        return AKM_ERR_IO;
+    }
+
+    return AKM_SUCCESS;
+}
+
+int16_t AKH_Read(
+    uint8_t        *data,
+    const uint16_t size,
+    uint16_t       *len)
+{
+    ssize_t ret;
+
+    *len = 0;
+
+    /* read() blocks when nothing is buffered */
+    if (!uart.readable()) {
+        return AKM_ERR_TIMEOUT;
+    }
+
+    ret = uart.read(data, size);
+
+    if (ret < 0) {
+        return AKM_ERR_IO;
+    }
+
+    *len = (uint16_t)ret;
+    AKH_Trace_Input(data, *len);
+
+    return AKM_SUCCESS;
+}
+
 int16_t AKH_CheckUserInput(uint32_t *code)
 {
 #ifdef ACSP_DEFINE
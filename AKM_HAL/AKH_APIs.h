@@ -30,14 +30,10 @@
 
 #include "mbed.h"
 
+#ifndef AKM_HOST_BUILD
 // UART 설정 (디버그 정보 출력)
 extern BufferedSerial uart;
-
-void processInput();
-
-void readInput();
-
-void processSensorData();
+#endif
 
 #endif // UART_COMMUNICATION_H
 
@@ -52,13 +48,184 @@ typedef enum _AKH_IRQ {
     IRQ_ACC_1,
     IRQ_ACC_2,
     IRQ_GYR_1,
-    IRQ_GYR_2
+    IRQ_GYR_2,
+    IRQ_UART
 } AKH_IRQ;
 
 typedef void (*IRQ_CALLBACK)(
     void
 );
 
+/** The maximum number of devices in the device table. */
+#define AKH_MAX_DEVICES  8
+
+/** Handle of a device in the device table. */
+typedef uint8_t AKH_HANDLE;
+
+/** Handle which does not refer to any device. */
+#define AKH_HANDLE_INVALID  0xFF
+
+/** Address which selects the default address of the part. It is neither
+ * an 8-bit I2C address (R/W bit is set) nor an SPI chip select index. */
+#define AKH_ADDRESS_DEFAULT  0xFF
+
+/**
+ * An entry of the device table.
+ */
+struct AKH_DEVICE_DESC {
+    /*! The part. The bus profile (clock, burst size) is selected by this. */
+    AKM_DEVICES device;
+    /*! I2C slave address in 8-bit form (R/W bit is 0), or the index of
+     * the SPI chip select pin when the HAL is built with AKH_USE_SPI.
+     * #AKH_ADDRESS_DEFAULT selects the default of the part. */
+    uint8_t     address;
+};
+
+/**
+ * Completion callback of asynchronous transfer.
+ * \param result #AKM_SUCCESS when the transfer has completed, otherwise
+ * negative value.
+ * \param arg The user argument which was given to the asynchronous API.
+ */
+typedef void (*AKH_XFER_CALLBACK)(
+    const int16_t result,
+    void          *arg
+);
+
+/**
+ * Writer of the deferred log. It is called in the thread of the logger.
+ * \param text A formatted message, terminated by '\0'.
+ * \param len The length of the message.
+ */
+typedef void (*AKH_LOG_WRITER)(
+    const char     *text,
+    const uint16_t len
+);
+
+/**
+ * Statistics of serial bus transfer.
+ */
+struct AKH_BUS_THROUGHPUT {
+    /*! The number of data bytes which were transferred. */
+    uint32_t bytes;
+    /*! Total time in micro seconds while the bus was busy. */
+    uint32_t busy_us;
+    /*! Effective throughput in bytes per second. */
+    uint32_t bytes_per_sec;
+};
+
+/**
+ * Error statistics of serial bus. Counted for each device.
+ */
+struct AKH_BUS_ERRORS {
+    /*! The number of transfers which were not acknowledged. */
+    uint32_t nacks;
+    /*! The number of transfers which did not complete in time. */
+    uint32_t timeouts;
+    /*! The number of retries after failure. */
+    uint32_t retries;
+    /*! The number of bus recoveries. */
+    uint32_t recoveries;
+};
+
+/**
+ * Statistics of register shadow cache.
+ */
+struct AKH_CACHE_STATS {
+    /*! The number of lookups which were served from the cache. */
+    uint32_t hits;
+    /*! The number of lookups which required bus access. */
+    uint32_t misses;
+    /*! The number of writes which were omitted because the value was
+     * not changed. */
+    uint32_t skipped_writes;
+};
+
+/**
+ * Statistics of low-power idle. Each value is calculated over the
+ * duration since the previous call of AKH_GetPowerStats().
+ */
+struct AKH_POWER_STATS {
+    /*! The number of wakeups from idle per second. */
+    uint32_t wakeups_per_sec;
+    /*! Average active time per wakeup in micro seconds. */
+    uint32_t avg_active_us;
+    /*! Ratio of active time in per mille. */
+    uint32_t active_permille;
+    /*! Ratio of deep sleep time in per mille. */
+    uint32_t deep_sleep_permille;
+};
+
+/**
+ * Statistics of deferred logger.
+ */
+struct AKH_LOG_STATS {
+    /*! The number of messages which were queued. */
+    uint32_t logged;
+    /*! The number of messages which were lost because the queue was full. */
+    uint32_t dropped;
+};
+
+/**
+ * Statistics of bus transaction trace.
+ */
+struct AKH_TRACE_STATS {
+    /*! The number of records in the trace. */
+    uint32_t records;
+    /*! The size of the trace in bytes, including the header. */
+    uint32_t bytes;
+    /*! The number of records which were lost because the buffer was
+     * full. */
+    uint32_t dropped;
+};
+
+/** The maximum number of steps in one #AKH_TRANSACTION. */
+#define AKH_TRANSACTION_MAX_STEPS  16
+
+/**
+ * Operation of each transaction step.
+ */
+typedef enum _AKH_TRANSACTION_OP {
+    /*! Write one byte. */
+    AKH_TR_WRITE = 0,
+    /*! Read bytes into the user buffer. */
+    AKH_TR_READ,
+    /*! Read one byte, then write back the masked bits. */
+    AKH_TR_UPDATE,
+    /*! Wait for the specified time. */
+    AKH_TR_DELAY
+} AKH_TRANSACTION_OP;
+
+struct AKH_TRANSACTION_STEP {
+    AKH_TRANSACTION_OP op;
+    uint8_t            address;
+    uint8_t            value;
+    uint8_t            mask;
+    uint8_t            *data;
+    uint16_t           len;
+    uint32_t           delay_us;
+};
+
+/**
+ * A list of register accesses which is executed as one sequence.
+ * The list is built with AKH_Transaction* functions and executed with
+ * AKH_TransactionRun() or AKH_TransactionRunAsync().
+ */
+struct AKH_TRANSACTION {
+    AKH_HANDLE                  dev;
+    uint8_t                     num_of_steps;
+    /*! The first error which happened while building the list. */
+    int16_t                     status;
+    struct AKH_TRANSACTION_STEP steps[AKH_TRANSACTION_MAX_STEPS];
+    /* Context of asynchronous execution. */
+    uint8_t                     cursor;
+    uint8_t                     rmw;
+    uint8_t                     buf;
+    uint8_t                     retries;
+    AKH_XFER_CALLBACK           callback;
+    void                        *arg;
+};
+
 /******************************************************************************
  * API decleration.
  ******************************************************************************/
@@ -72,6 +239,63 @@ void AKH_Init(
     void
 );
 
+/*!
+ * Add a device to the device table. Devices on the bus are addressed by
+ * the returned handle, so several parts of the same type can be used at
+ * the same time, e.g. four AK09940A on different CAD pin settings.
+ * \retval #AKM_SUCCESS When operation is succeeded.
+ * \retval #AKM_ERR_BUSY When the table is full.
+ * \retval #AKM_ERR_INVALID_ARG When the address is not valid on the bus.
+ * \param desc A pointer to the description of the device.
+ * \param dev The handle of the device is stored.
+ */
+int16_t AKH_AddDevice(
+    const struct AKH_DEVICE_DESC *desc,
+    AKH_HANDLE                   *dev
+);
+
+/*!
+ * Remove the device which was added last, e.g. when its driver could not
+ * be configured. Handles of the other devices do not change.
+ * \retval #AKM_SUCCESS When operation is succeeded.
+ * \retval #AKM_ERR_INVALID_ARG When the device is not the last one.
+ * \param dev Handle of the device.
+ */
+int16_t AKH_RemoveDevice(
+    const AKH_HANDLE dev
+);
+
+/*!
+ * Remove all devices from the device table. A handle which is returned
+ * by AKH_AddDevice() later may be the same as a removed one.
+ * \return No return value is reserved.
+ */
+void AKH_ClearDevices(
+    void
+);
+
+/*!
+ * Get the description of a device. The default address is resolved to
+ * the actual address.
+ * \retval #AKM_SUCCESS When operation is succeeded.
+ * \retval #AKM_ERR_INVALID_ARG When the handle is not valid.
+ * \param dev Handle of the device.
+ * \param desc A pointer to the description to be stored.
+ */
+int16_t AKH_GetDeviceDesc(
+    const AKH_HANDLE       dev,
+    struct AKH_DEVICE_DESC *desc
+);
+
+/*!
+ * Get the number of devices in the device table. Valid handles are from
+ * 0 to the number minus one.
+ * \return The number of devices.
+ */
+uint8_t AKH_GetNumberOfDevices(
+    void
+);
+
 
 /*!
  * Write data to a device via serial interface. When more than one byte of
@@ -79,13 +303,13 @@ void AKH_Init(
  * at an address specified in address.
  * \retval #AKM_SUCCESS When operation is succeeded.
  * \retval negative-value When operation failed.
- * \param stype Specify sensor type.
+ * \param dev Handle of the device.
  * \param address Register address to write.
  * \param data A pointer to a data buffer to be written.
  * \param numberOfBytesToWrite The number of byte to be written.
  */
 int16_t AKH_TxData(
-    const AKM_SENSOR_TYPE stype,
+    const AKH_HANDLE      dev,
     const uint8_t         address,
     const uint8_t         *data,
     const uint16_t        numberOfBytesToWrite
@@ -96,18 +320,266 @@ int16_t AKH_TxData(
  * Acquire data from the device via serial interface.
  * \retval #AKM_SUCCESS When operation is succeeded.
  * \retval negative-value When operation failed.
- * \param stype Specify sensor type.
+ * \param dev Handle of the device.
  * \param address Register address to read.
  * \param data a Pointer to the data to be read.
  * \param numberOfBytesToRead The number of byte to be read.
  */
 int16_t AKH_RxData(
-    const AKM_SENSOR_TYPE stype,
+    const AKH_HANDLE      dev,
+    const uint8_t         address,
+    uint8_t               *data,
+    const uint16_t        numberOfBytesToRead
+);
+
+/*!
+ * Read data from the device only once, to find out whether the device
+ * is present. Unlike AKH_RxData(), a failure is not retried and it does
+ * not count as a bus error, so an empty address costs only one transfer.
+ * \retval #AKM_SUCCESS When the device responded.
+ * \retval negative-value When the device did not respond.
+ * \param dev Handle of the device.
+ * \param address Register address to read.
+ * \param data a Pointer to the data to be read.
+ * \param numberOfBytesToRead The number of byte to be read.
+ */
+int16_t AKH_ProbeData(
+    const AKH_HANDLE      dev,
     const uint8_t         address,
     uint8_t               *data,
     const uint16_t        numberOfBytesToRead
 );
 
+/*!
+ * Start writing data to a device without waiting for the completion.
+ * The data is copied to the internal buffer, so \c data can be released
+ * as soon as this function returns. Only one asynchronous transfer can be
+ * in flight at a time. The callback is executed in thread context (not in
+ * interrupt context), so it is allowed to issue another transfer from it.
+ * \retval #AKM_SUCCESS When the transfer is started.
+ * \retval #AKM_ERR_BUSY When other transfer is in progress.
+ * \retval #AKM_ERR_NOT_SUPPORT When this platform does not support
+ * asynchronous transfer.
+ * \retval negative-value When operation failed.
+ * \param dev Handle of the device.
+ * \param address Register address to write.
+ * \param data A pointer to a data buffer to be written.
+ * \param numberOfBytesToWrite The number of byte to be written.
+ * \param callback A function which is called when the transfer is done.
+ * \param arg An argument which is passed to \c callback.
+ */
+int16_t AKH_TxDataAsync(
+    const AKH_HANDLE        dev,
+    const uint8_t           address,
+    const uint8_t           *data,
+    const uint16_t          numberOfBytesToWrite,
+    const AKH_XFER_CALLBACK callback,
+    void                    *arg
+);
+
+
+/*!
+ * Start acquiring data from the device without waiting for the completion.
+ * The buffer pointed by \c data must be kept valid until \c callback is
+ * called. Only one asynchronous transfer can be in flight at a time.
+ * The callback is executed in thread context (not in interrupt context).
+ * \retval #AKM_SUCCESS When the transfer is started.
+ * \retval #AKM_ERR_BUSY When other transfer is in progress.
+ * \retval #AKM_ERR_NOT_SUPPORT When this platform does not support
+ * asynchronous transfer.
+ * \retval negative-value When operation failed.
+ * \param dev Handle of the device.
+ * \param address Register address to read.
+ * \param data a Pointer to the data to be read.
+ * \param numberOfBytesToRead The number of byte to be read.
+ * \param callback A function which is called when the transfer is done.
+ * \param arg An argument which is passed to \c callback.
+ */
+int16_t AKH_RxDataAsync(
+    const AKH_HANDLE        dev,
+    const uint8_t           address,
+    uint8_t                 *data,
+    const uint16_t          numberOfBytesToRead,
+    const AKH_XFER_CALLBACK callback,
+    void                    *arg
+);
+
+/*!
+ * Modify bits of a configuration register. The current value is taken from
+ * the register shadow cache when it is available, so the read-modify-write
+ * usually requires only one write. The write is omitted when the bits
+ * already have the value.
+ * Use this function only for registers which are not changed by the device
+ * itself.
+ * \retval #AKM_SUCCESS When operation is succeeded.
+ * \retval negative-value When operation failed.
+ * \param dev Handle of the device.
+ * \param address Register address to update.
+ * \param mask Bits to be modified.
+ * \param value The new value of the masked bits.
+ */
+int16_t AKH_UpdateBits(
+    const AKH_HANDLE      dev,
+    const uint8_t         address,
+    const uint8_t         mask,
+    const uint8_t         value
+);
+
+/*!
+ * Discard the register shadow cache of the device. This function must be
+ * called when the registers are changed without AKH_TxData(), e.g. by
+ * soft reset.
+ * \return No return value is reserved.
+ * \param dev Handle of the device.
+ */
+void AKH_InvalidateCache(
+    const AKH_HANDLE      dev
+);
+
+/*!
+ * Get the statistics of the register shadow cache.
+ * \retval #AKM_SUCCESS When operation is succeeded.
+ * \param stats A pointer to #AKH_CACHE_STATS struct.
+ */
+int16_t AKH_GetCacheStats(
+    struct AKH_CACHE_STATS *stats
+);
+
+/*!
+ * Clear the transaction list.
+ * \return No return value is reserved.
+ * \param tr A pointer to #AKH_TRANSACTION struct.
+ * \param dev Handle of the device which all steps are issued to.
+ */
+void AKH_TransactionInit(
+    struct AKH_TRANSACTION *tr,
+    const AKH_HANDLE       dev
+);
+
+/*!
+ * Append a step which writes one byte to the register.
+ * If the list is full, the error is recorded and reported by the run
+ * function, so the caller does not need to check each step.
+ * \return No return value is reserved.
+ * \param tr A pointer to #AKH_TRANSACTION struct.
+ * \param address Register address to write.
+ * \param value The value to be written.
+ */
+void AKH_TransactionWrite(
+    struct AKH_TRANSACTION *tr,
+    const uint8_t          address,
+    const uint8_t          value
+);
+
+/*!
+ * Append a step which reads data from the register.
+ * \return No return value is reserved.
+ * \param tr A pointer to #AKH_TRANSACTION struct.
+ * \param address Register address to read.
+ * \param data A pointer to the data to be read. The buffer must be kept
+ * valid until the transaction is completed.
+ * \param numberOfBytesToRead The number of byte to be read.
+ */
+void AKH_TransactionRead(
+    struct AKH_TRANSACTION *tr,
+    const uint8_t          address,
+    uint8_t                *data,
+    const uint16_t         numberOfBytesToRead
+);
+
+/*!
+ * Append a read-modify-write step. The bits specified by \c mask are
+ * replaced with \c value. The write is skipped when the register already
+ * has the value.
+ * \return No return value is reserved.
+ * \param tr A pointer to #AKH_TRANSACTION struct.
+ * \param address Register address to update.
+ * \param mask Bits to be modified.
+ * \param value The new value of the masked bits.
+ */
+void AKH_TransactionUpdate(
+    struct AKH_TRANSACTION *tr,
+    const uint8_t          address,
+    const uint8_t          mask,
+    const uint8_t          value
+);
+
+/*!
+ * Append a delay step.
+ * \return No return value is reserved.
+ * \param tr A pointer to #AKH_TRANSACTION struct.
+ * \param us Duration time in micro-seconds unit.
+ */
+void AKH_TransactionDelay(
+    struct AKH_TRANSACTION *tr,
+    const uint32_t         us
+);
+
+/*!
+ * Execute all steps back-to-back. The execution stops at the first error.
+ * \retval #AKM_SUCCESS When all steps are succeeded.
+ * \retval negative-value When operation failed.
+ * \param tr A pointer to #AKH_TRANSACTION struct.
+ */
+int16_t AKH_TransactionRun(
+    struct AKH_TRANSACTION *tr
+);
+
+/*!
+ * Start executing all steps without waiting for the completion. Each step
+ * is chained from the completion of the previous one, and \c callback is
+ * called only once when the whole sequence is done or failed.
+ * A step which finds the bus busy is tried again a little later. When the
+ * bus has blocking access only, the steps are run with it.
+ * \c tr must be kept valid until \c callback is called.
+ * \retval #AKM_SUCCESS When the sequence is started.
+ * \retval negative-value When operation failed.
+ * \param tr A pointer to #AKH_TRANSACTION struct.
+ * \param callback A function which is called when the sequence is done.
+ * \param arg An argument which is passed to \c callback.
+ */
+int16_t AKH_TransactionRunAsync(
+    struct AKH_TRANSACTION  *tr,
+    const AKH_XFER_CALLBACK callback,
+    void                    *arg
+);
+
+/*!
+ * Get the effective throughput of the serial bus.
+ * \retval #AKM_SUCCESS When operation is succeeded.
+ * \retval #AKM_ERR_NOT_SUPPORT When the bus does not measure throughput.
+ * \param tp A pointer to #AKH_BUS_THROUGHPUT struct.
+ */
+int16_t AKH_GetBusThroughput(
+    struct AKH_BUS_THROUGHPUT *tp
+);
+
+/*!
+ * Get the bus clock which is used for the device. The clock is taken from
+ * the device profile, and it is lowered when the device repeats I/O error.
+ * \retval #AKM_SUCCESS When operation is succeeded.
+ * \param dev Handle of the device.
+ * \param hz A pointer to the clock in Hz.
+ */
+int16_t AKH_GetBusClock(
+    const AKH_HANDLE      dev,
+    uint32_t              *hz
+);
+
+/*!
+ * Get the error statistics of the serial bus. A failed transfer is retried
+ * a few times with backoff, and a stuck bus is released by clocking out
+ * the slave before retry.
+ * \retval #AKM_SUCCESS When operation is succeeded.
+ * \retval #AKM_ERR_NOT_SUPPORT When the bus does not count errors.
+ * \param dev Handle of the device.
+ * \param errors A pointer to #AKH_BUS_ERRORS struct.
+ */
+int16_t AKH_GetBusErrors(
+    const AKH_HANDLE      dev,
+    struct AKH_BUS_ERRORS *errors
+);
+
 /*!
  * Reset device. This function resets the devicy physically. Sometimes it is
  * called as 'hard reset'. If the device does not support hard rest operation
@@ -151,16 +623,103 @@ int16_t AKH_SetIRQHandler(
     IRQ_CALLBACK  func
 );
 
+/*!
+ * Event bits which are signaled to the measurement loop.
+ * Each bit is set by the HAL when the corresponding IRQ fires.
+ */
+#define AKH_EVENT_MAG   0x0001U
+#define AKH_EVENT_ACC   0x0002U
+#define AKH_EVENT_GYR   0x0004U
+#define AKH_EVENT_USER  0x0008U
+#define AKH_EVENT_UART  0x0010U
+/*! Reserved for application. HAL never sets this bit. */
+#define AKH_EVENT_APP   0x0020U
+#define AKH_EVENT_ALL   0x003FU
+
+/*!
+ * Signal events. This function can be called from interrupt context.
+ * \return No return value is reserved.
+ * \param events Bitwise OR of AKH_EVENT_XXX.
+ */
+void AKH_SignalEvent(
+    const uint32_t events
+);
+
+/*!
+ * Block until one of the events is signaled or timeout expires.
+ * The signaled events are cleared when this function returns.
+ * \retval AKM_SUCCESS At least one of the events in the mask is signaled.
+ * \retval AKM_ERR_TIMEOUT No event is signaled within the time.
+ * \param mask Bitwise OR of AKH_EVENT_XXX to wait for.
+ * \param timeout_us Timeout in micro-seconds unit. It is rounded up to
+ * the tick of OS.
+ * \param events Signaled events are stored. This parameter can be NULL.
+ */
+int16_t AKH_WaitEvent(
+    const uint32_t mask,
+    const uint32_t timeout_us,
+    uint32_t       *events
+);
+
+/*!
+ * Enter low-power idle until one of the events is signaled or the
+ * deadline comes. The core sleeps, and enters deep sleep when no bus
+ * transfer is in flight and no driver holds deep sleep.
+ * \retval AKM_SUCCESS At least one of the events in the mask is signaled.
+ * \retval AKM_ERR_TIMEOUT The deadline has come.
+ * \param mask Bitwise OR of AKH_EVENT_XXX to wait for.
+ * \param deadline_ns Absolute time of AKH_GetTimeNs() to wake up.
+ * \param events Signaled events are stored. This parameter can be NULL.
+ */
+int16_t AKH_Idle(
+    const uint32_t mask,
+    const uint64_t deadline_ns,
+    uint32_t       *events
+);
+
+/*!
+ * Get the statistics of low-power idle, then start new measurement window.
+ * \retval #AKM_SUCCESS When operation is succeeded.
+ * \retval #AKM_ERR_INVALID_ARG When stats is NULL.
+ * \param stats A pointer to #AKH_POWER_STATS struct.
+ */
+int16_t AKH_GetPowerStats(
+    struct AKH_POWER_STATS *stats
+);
+
 /*!
  * Get timestamp
- * \return Current time. The unit depends on definition.
+ * \return Current time. The unit depends on definition. Without
+ * AKM_TIMESTAMP_NANOSECOND, it is the lower 32 bits of the time in micro
+ * seconds, which wraps around every 71 minutes and has the sign bit set
+ * in its second half. Add and subtract timestamps in unsigned arithmetic.
  */
 AKM_TIMESTAMP AKH_GetTimestamp(
     void
 );
 
 /*!
- * Save data to non-volatile storage.
+ * Get monotonic time. The time starts at AKH_Init() and is never reset,
+ * and it does not wrap around in practical duration.
+ * \return Current time in nano seconds unit.
+ */
+uint64_t AKH_GetTimeNs(
+    void
+);
+
+/*!
+ * Get the resolution of AKH_GetTimeNs().
+ * \return The period of one count in nano seconds unit.
+ */
+uint32_t AKH_GetTimebaseResolution(
+    void
+);
+
+/*!
+ * Save data to non-volatile storage. The data is appended to a record log
+ * in internal flash with CRC and sequence number. Writing the same data
+ * as the latest record is skipped. When a flash sector is full, the other
+ * sector is erased, and it may take a few seconds.
  * \retval #AKM_SUCCESS When operation is succeeded.
  * \retval #AKM_ERR_NOT_SUPPORT When this platform does not support non-volatile
  * storage.
@@ -173,7 +732,8 @@ int16_t AKH_SaveParameter(
 );
 
 /*!
- * Load data from non-volatile storage.
+ * Load data from non-volatile storage. The latest valid record is loaded.
+ * If its size is different from \c nBytes, the record is ignored.
  * \retval #AKM_SUCCESS When operation is succeeded.
  * \retval #AKM_ERR_NOT_SUPPORT When this platform does not support non-volatile
  * storage.
@@ -195,6 +755,127 @@ void AKH_Print(
     ...
 );
 
+/*!
+ * Write raw bytes to the output stream which AKH_Print() uses.
+ * \retval #AKM_SUCCESS When operation is succeeded.
+ * \retval #AKM_ERR_IO When the data could not be written.
+ * \param data A pointer to a data buffer to be written.
+ * \param len The number of byte to be written.
+ */
+int16_t AKH_Write(
+    const uint8_t  *data,
+    const uint16_t len
+);
+
+/*!
+ * Read bytes which are received on the input stream.
+ * This function does not block. #IRQ_UART handler is called when new data
+ * is received, then the data can be read by this function.
+ * \retval #AKM_SUCCESS When at least one byte is read.
+ * \retval #AKM_ERR_TIMEOUT When no data is available.
+ * \retval #AKM_ERR_IO When the data could not be read.
+ * \param data A pointer to a data buffer to be stored.
+ * \param size The size of the data buffer.
+ * \param len The number of read bytes is stored.
+ */
+int16_t AKH_Read(
+    uint8_t        *data,
+    const uint16_t size,
+    uint16_t       *len
+);
+
+/*!
+ * Deferred print function. Unlike AKH_Print(), this function does not
+ * format the message. It stores the format pointer and the raw arguments
+ * to a lock-free queue, and a low priority thread formats and sends them
+ * later. So it is safe to be called in time critical path, and even in
+ * interrupt context. When the queue is full, the message is dropped.
+ * The format string, and the string passed for "%s", must be kept valid
+ * after the call (e.g. string literal). Up to 6 arguments are captured,
+ * and '*' width is not supported.
+ * \return No return value is reserved yet.
+ * \param format A pointer to a format string.
+ */
+void AKH_Log(
+    const char *format,
+    ...
+);
+
+/*!
+ * Set the writer of the deferred logger. By default, the messages of
+ * AKH_Log() are written to the console as they are. An application which
+ * frames its console output sets a writer which frames them too.
+ * \retval #AKM_SUCCESS When operation is succeeded.
+ * \param writer A writer, or NULL to write to the console as it is.
+ */
+int16_t AKH_SetLogWriter(
+    AKH_LOG_WRITER writer
+);
+
+/*!
+ * Get the statistics of the deferred logger.
+ * \retval #AKM_SUCCESS When operation is succeeded.
+ * \param stats A pointer to #AKH_LOG_STATS struct.
+ */
+int16_t AKH_GetLogStats(
+    struct AKH_LOG_STATS *stats
+);
+
+/*!
+ * Start recording bus transactions. Every AKH_TxData(), AKH_RxData() and
+ * asynchronous transfer is recorded with its data and time, together with
+ * data ready interrupts and console input, to a buffer in RAM. The
+ * previous trace is discarded. The trace can be replayed by the host
+ * build (host/), which serves the recorded reads in order with the
+ * original timing. Recording stops when the buffer is full.
+ * When the HAL is built with AKH_USE_TRACE, recording is started by
+ * AKH_Init(), and only such a trace from boot can be replayed.
+ * \retval #AKM_SUCCESS When operation is succeeded.
+ * \retval #AKM_ERR_NOT_SUPPORT When the HAL is built without
+ * AKH_USE_TRACE.
+ */
+int16_t AKH_TraceStart(
+    void
+);
+
+/*!
+ * Stop recording bus transactions.
+ * \retval #AKM_SUCCESS When operation is succeeded.
+ * \retval #AKM_ERR_NOT_SUPPORT When the HAL is built without
+ * AKH_USE_TRACE.
+ */
+int16_t AKH_TraceStop(
+    void
+);
+
+/*!
+ * Get the recorded trace. The trace starts with a header, so it can be
+ * found in a capture of the output stream. It is valid until the next
+ * AKH_TraceStart().
+ * \retval #AKM_SUCCESS When operation is succeeded.
+ * \retval #AKM_ERR_BUSY When recording is in progress.
+ * \retval #AKM_ERROR When nothing has been recorded.
+ * \retval #AKM_ERR_NOT_SUPPORT When the HAL is built without
+ * AKH_USE_TRACE.
+ * \param data A pointer to the trace is stored.
+ * \param len The size of the trace in bytes is stored.
+ */
+int16_t AKH_TraceGet(
+    const uint8_t **data,
+    uint32_t      *len
+);
+
+/*!
+ * Get the statistics of bus transaction trace.
+ * \retval #AKM_SUCCESS When operation is succeeded.
+ * \retval #AKM_ERR_NOT_SUPPORT When the HAL is built without
+ * AKH_USE_TRACE.
+ * \param stats A pointer to #AKH_TRACE_STATS struct.
+ */
+int16_t AKH_GetTraceStats(
+    struct AKH_TRACE_STATS *stats
+);
+
 /*!
  * Check whether user input (or any staus changed signal) is occured.
  * This function does not block current process (or thread).
@@ -0,0 +1,163 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+#include "AKH_APIs.h"
+#include "akh_cache.h"
+
+#define NUMBER_OF_REGS  256
+
+/* Shadow of the last written value of each register.
+ * The cache is write-through. The bus is always written, and the value
+ * is remembered only after the write succeeded. */
+struct akh_reg_cache {
+    uint8_t  value[NUMBER_OF_REGS];
+    uint32_t valid[NUMBER_OF_REGS / 32];
+};
+
+static struct akh_reg_cache g_cache[AKH_MAX_DEVICES];
+static uint32_t             g_hits;
+static uint32_t             g_misses;
+static uint32_t             g_skipped;
+
+static struct akh_reg_cache *handle_to_cache(const AKH_HANDLE dev)
+{
+    if (dev >= AKH_MAX_DEVICES) {
+        return NULL;
+    }
+
+    return &g_cache[dev];
+}
+
+void AKH_Cache_Store(
+    const AKH_HANDLE      dev,
+    const uint8_t         address,
+    const uint8_t         *data,
+    const uint16_t        numberOfBytes)
+{
+    struct akh_reg_cache *c = handle_to_cache(dev);
+    uint16_t             reg;
+    uint16_t             i;
+
+    if (c == NULL) {
+        return;
+    }
+
+    /* multiple bytes are written to contiguous registers */
+    for (i = 0; i < numberOfBytes; i++) {
+        reg = address + i;
+
+        if (reg >= NUMBER_OF_REGS) {
+            break;
+        }
+
+        c->value[reg] = data[i];
+        c->valid[reg / 32] |= (1U << (reg % 32));
+    }
+}
+
+void AKH_Cache_Drop(
+    const AKH_HANDLE      dev,
+    const uint8_t         address,
+    const uint16_t        numberOfBytes)
+{
+    struct akh_reg_cache *c = handle_to_cache(dev);
+    uint16_t             reg;
+    uint16_t             i;
+
+    if (c == NULL) {
+        return;
+    }
+
+    for (i = 0; i < numberOfBytes; i++) {
+        reg = address + i;
+
+        if (reg >= NUMBER_OF_REGS) {
+            break;
+        }
+
+        c->valid[reg / 32] &= ~(1U << (reg % 32));
+    }
+}
+
+bool AKH_Cache_Lookup(
+    const AKH_HANDLE      dev,
+    const uint8_t         address,
+    uint8_t               *value)
+{
+    struct akh_reg_cache *c = handle_to_cache(dev);
+
+    if ((c == NULL) ||
+        ((c->valid[address / 32] & (1U << (address % 32))) == 0)) {
+        g_misses++;
+        return false;
+    }
+
+    *value = c->value[address];
+    g_hits++;
+    return true;
+}
+
+int16_t AKH_UpdateBits(
+    const AKH_HANDLE      dev,
+    const uint8_t         address,
+    const uint8_t         mask,
+    const uint8_t         value)
+{
+    uint8_t reg;
+    int16_t fret;
+
+    if (!AKH_Cache_Lookup(dev, address, &reg)) {
+        fret = AKH_RxData(dev, address, &reg, 1);
+
+        if (fret != AKM_SUCCESS) {
+            return fret;
+        }
+    }
+
+    /* write back only when any bit is changed */
+    if ((reg & mask) == (value & mask)) {
+        g_skipped++;
+        AKH_Cache_Store(dev, address, &reg, 1);
+        return AKM_SUCCESS;
+    }
+
+    reg = (reg & ~mask) | (value & mask);
+    return AKH_TxData(dev, address, &reg, 1);
+}
+
+void AKH_InvalidateCache(const AKH_HANDLE dev)
+{
+    struct akh_reg_cache *c = handle_to_cache(dev);
+    uint8_t              i;
+
+    if (c == NULL) {
+        return;
+    }
+
+    for (i = 0; i < (NUMBER_OF_REGS / 32); i++) {
+        c->valid[i] = 0;
+    }
+}
+
+int16_t AKH_GetCacheStats(struct AKH_CACHE_STATS *stats)
+{
+    stats->hits = g_hits;
+    stats->misses = g_misses;
+    stats->skipped_writes = g_skipped;
+    return AKM_SUCCESS;
+}
@@ -0,0 +1,104 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+#include "AKH_APIs.h"
+#include "akh_device.h"
+#include "akh_cache.h"
+#include "akh_profile.h"
+
+/* Device table. Handle is the index. */
+static struct AKH_DEVICE_DESC g_devices[AKH_MAX_DEVICES];
+static uint8_t                g_num_of_devices;
+
+const struct AKH_DEVICE_DESC *AKH_Device_Get(const AKH_HANDLE dev)
+{
+    if (dev >= g_num_of_devices) {
+        return NULL;
+    }
+
+    return &g_devices[dev];
+}
+
+int16_t AKH_AddDevice(
+    const struct AKH_DEVICE_DESC *desc,
+    AKH_HANDLE                   *dev)
+{
+    struct AKH_DEVICE_DESC *d;
+
+    if (g_num_of_devices >= AKH_MAX_DEVICES) {
+        return AKM_ERR_BUSY;
+    }
+
+    d = &g_devices[g_num_of_devices];
+    d->device = desc->device;
+    d->address = desc->address;
+
+    if (d->address == AKH_ADDRESS_DEFAULT) {
+        d->address = AKH_Profile_DefaultAddress(desc->device);
+    }
+
+#ifndef AKH_USE_SPI
+    /* 8-bit form, R/W bit must be 0 */
+    if ((d->address & 0x01U) != 0U) {
+        return AKM_ERR_INVALID_ARG;
+    }
+#endif
+
+    *dev = g_num_of_devices++;
+
+    /* the handle may have been used by a removed device */
+    AKH_InvalidateCache(*dev);
+    AKH_Profile_Reset(*dev);
+
+    return AKM_SUCCESS;
+}
+
+int16_t AKH_RemoveDevice(const AKH_HANDLE dev)
+{
+    /* handle is the index, so only the last one can go */
+    if ((g_num_of_devices == 0) || (dev != g_num_of_devices - 1)) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    g_num_of_devices--;
+    return AKM_SUCCESS;
+}
+
+void AKH_ClearDevices(void)
+{
+    g_num_of_devices = 0;
+}
+
+int16_t AKH_GetDeviceDesc(
+    const AKH_HANDLE       dev,
+    struct AKH_DEVICE_DESC *desc)
+{
+    const struct AKH_DEVICE_DESC *d = AKH_Device_Get(dev);
+
+    if (d == NULL) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    *desc = *d;
+    return AKM_SUCCESS;
+}
+
+uint8_t AKH_GetNumberOfDevices(void)
+{
+    return g_num_of_devices;
+}
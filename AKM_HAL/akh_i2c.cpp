@@ -18,134 +18,533 @@
  ******************************************************************************/
 #include "AKM_Config.h"
 #include "akh_i2c.h"
+#include "akh_device.h"
+#include "akh_profile.h"
+#include "akh_power.h"
+
+#include <new>
  
- /* For error handling */
+/* For error handling */
 #define INVALID_SLAVE_ADDR  0x00
 
-/*** Device Slave addresses. **************************************************/
-/* Slave address is defined as 8-bit address. */
-/* It means that R/W bit 0 is added at LSB. */
-
-/* AKM 3D Mag devices. */
-#define MAGNETOMETER_SLAVE_ADDR          0x18
-#define MAGNETOMETER_SLAVE_ADDR_AK09919  0x1C   //AK09919
-
-/* AKM IR devices. */
-#define INFRARED_SLAVE_ADDR  0xC8
+/* The maximum length of data for asynchronous write. */
+#define AKH_I2C_ASYNC_TX_SIZE  32
+/* The longest time a blocking access waits for asynchronous transfer. */
+#define AKH_I2C_ASYNC_WAIT_US  10000
 
-/* Accelerometer */
-#define ADXL34X_SLAVE_ADDR  0xA6
-#define BMI160_SLAVE_ADDR   0xD0  // or 0xD2
 
-/* Gyroscope */
-#define L3G4200D_SLAVE_ADDR 0xD0
-#define L3GD20_SLAVE_ADDR   0xD4
+/* Retry and recovery parameters. */
+#define AKH_I2C_RETRY_MAX       3
+#define AKH_I2C_BACKOFF_US      200
+/* SCL pulses to release a slave which holds SDA low. */
+#define AKH_I2C_RECOVERY_CLOCKS 9
+#define AKH_I2C_RECOVERY_HALF_US 5
 
-
-/* I2C instance for communication of sensors */
 #ifdef ACSP_DEFINE
 // For ACSP Board
-I2C i2c(PB_7, PB_6);
+#define AKH_I2C_SDA  PB_7
+#define AKH_I2C_SCL  PB_6
 #else
 // For Arduino Sensor Board
-I2C i2c(I2C_SDA, I2C_SCL);
+#define AKH_I2C_SDA  I2C_SDA
+#define AKH_I2C_SCL  I2C_SCL
 #endif
 
-static uint8_t type_to_slave(const AKM_SENSOR_TYPE stype)
+/* I2C instance for communication of sensors.
+ * The instance is re-created in place after bus recovery, because the pins
+ * have to be released to GPIO to clock out the stuck slave. */
+alignas(I2C) static char g_i2c_storage[sizeof(I2C)];
+static I2C *g_i2c = new (g_i2c_storage) I2C(AKH_I2C_SDA, AKH_I2C_SCL);
+
+/* Error statistics of each device. */
+static struct AKH_BUS_ERRORS g_errors[AKH_MAX_DEVICES];
+
+/* The clock which is currently set to the bus. */
+static uint32_t g_cur_hz = 0;
+
+/* Transfer statistics for throughput report. */
+static uint32_t g_stat_bytes;
+static uint32_t g_stat_busy_us;
+
+static void i2c_stat_add(const uint16_t bytes, const uint32_t start_us)
 {
-    switch (stype) {
-    case AKM_ST_MAG:
-        if (CONFIG_SLOT1 == AKM_MAGNETOMETER_AK09919) {
-            return MAGNETOMETER_SLAVE_ADDR_AK09919;
-        } else {
-            return MAGNETOMETER_SLAVE_ADDR;
-        }
+    g_stat_bytes += bytes;
+    g_stat_busy_us += (us_ticker_read() - start_us);
+}
 
-    case AKM_ST_ACC:
-        if (CONFIG_SLOT2 == AKM_ACCELEROMETER_ADXL345) {
-            return ADXL34X_SLAVE_ADDR;
-        } else if (CONFIG_SLOT2 == AKM_ACCELEROMETER_ADXL346) {
-            return ADXL34X_SLAVE_ADDR;
-        } else if (CONFIG_SLOT2 == AKM_ACCELEROMETER_BMI160) {
-            return BMI160_SLAVE_ADDR;
-        } else {
-            return INVALID_SLAVE_ADDR;
-        }
+#if DEVICE_I2C_ASYNCH
+/* Asynchronous transfer context. Only one transfer can be in flight. */
+static volatile bool     g_async_busy = false;
+static char              g_async_tx[AKH_I2C_ASYNC_TX_SIZE + 1];
+static AKH_XFER_CALLBACK g_async_cb;
+static void              *g_async_arg;
+static AKH_HANDLE        g_async_dev;
+static uint16_t          g_async_len;
+static uint32_t          g_async_start_us;
 
-    case AKM_ST_GYR:
-        if (CONFIG_SLOT3 == AKM_GYROSCOPE_L3G4200D) {
-            return L3G4200D_SLAVE_ADDR;
-        } else if (CONFIG_SLOT3 == AKM_GYROSCOPE_L3GD20) {
-            return L3GD20_SLAVE_ADDR;
-        } else if (CONFIG_SLOT3 == AKM_GYROSCOPE_BMI160) {
-            return BMI160_SLAVE_ADDR;
-        } else {
-            return INVALID_SLAVE_ADDR;
-        }
+/* This function is called in interrupt context. */
+static void i2c_async_done(int event)
+{
+    AKH_XFER_CALLBACK cb = g_async_cb;
+    void              *arg = g_async_arg;
+    int16_t           result;
+
+    if (event & I2C_EVENT_TRANSFER_COMPLETE) {
+        i2c_stat_add(g_async_len, g_async_start_us);
+        result = AKM_SUCCESS;
+    } else {
+        result = AKM_ERR_IO;
+    }
+
+    AKH_Profile_Report(g_async_dev, result);
+    g_async_busy = false;
+    AKH_PowerBusEnd();
+
+    /* defer user callback to thread context */
+    if (cb != NULL) {
+        mbed_highprio_event_queue()->call(cb, result, arg);
+    }
+}
 
-    default:
+static int16_t i2c_async_start(
+    const AKH_HANDLE      dev,
+    const int             slave,
+    const char            *tx,
+    const int             tx_len,
+    char                  *rx,
+    const int             rx_len,
+    AKH_XFER_CALLBACK     callback,
+    void                  *arg)
+{
+    int err;
+
+    g_async_cb = callback;
+    g_async_arg = arg;
+    g_async_dev = dev;
+    /* data bytes, without the register address */
+    g_async_len = (uint16_t)((rx_len > 0) ? rx_len : (tx_len - 1));
+    g_async_start_us = us_ticker_read();
+
+    AKH_PowerBusBegin();
+    err = g_i2c->transfer(
+            slave, tx, tx_len, rx, rx_len,
+            event_callback_t(i2c_async_done),
+            I2C_EVENT_ALL, false);
+
+    if (err != 0) {
+        g_async_busy = false;
+        AKH_PowerBusEnd();
+        return AKM_ERR_BUSY;
+    }
+
+    return AKM_SUCCESS;
+}
+#endif
+
+/* Slave address is defined as 8-bit address.
+ * It means that R/W bit 0 is added at LSB. */
+static uint8_t handle_to_slave(const AKH_HANDLE dev)
+{
+    const struct AKH_DEVICE_DESC *desc = AKH_Device_Get(dev);
+
+    if (desc == NULL) {
         return INVALID_SLAVE_ADDR;
     }
+
+    return desc->address;
+}
+
+static struct AKH_BUS_ERRORS *handle_to_errors(const AKH_HANDLE dev)
+{
+    if (dev >= AKH_MAX_DEVICES) {
+        return NULL;
+    }
+
+    return &g_errors[dev];
+}
+
+/* Release the bus which is held by a slave. A slave which was interrupted
+ * in the middle of a read keeps SDA low until it has sent the remaining
+ * bits, so toggle SCL until SDA goes high, then issue STOP condition. */
+static void bus_recover(void)
+{
+    int i;
+
+    g_i2c->~I2C();
+
+    {
+        DigitalInOut sda(AKH_I2C_SDA, PIN_INPUT, PullUp, 1);
+        DigitalInOut scl(AKH_I2C_SCL, PIN_OUTPUT, OpenDrainNoPull, 1);
+
+        for (i = 0; i < AKH_I2C_RECOVERY_CLOCKS; i++) {
+            if (sda.read() != 0) {
+                break;
+            }
+
+            scl = 0;
+            wait_us(AKH_I2C_RECOVERY_HALF_US);
+            scl = 1;
+            wait_us(AKH_I2C_RECOVERY_HALF_US);
+        }
+
+        /* STOP: SDA rises while SCL is high */
+        scl = 0;
+        sda.output();
+        sda.mode(OpenDrainNoPull);
+        sda = 0;
+        wait_us(AKH_I2C_RECOVERY_HALF_US);
+        scl = 1;
+        wait_us(AKH_I2C_RECOVERY_HALF_US);
+        sda = 1;
+        wait_us(AKH_I2C_RECOVERY_HALF_US);
+    }
+
+    g_i2c = new (g_i2c_storage) I2C(AKH_I2C_SDA, AKH_I2C_SCL);
+    /* new instance has default clock */
+    g_cur_hz = 0;
+}
+
+/* Set the clock of the device profile. The bus is shared among devices,
+ * so it is checked on each transaction and changed only when it differs. */
+static void apply_profile(const AKH_HANDLE dev)
+{
+    uint32_t hz = AKH_Profile_I2CClock(dev);
+
+    if (hz != g_cur_hz) {
+        g_i2c->frequency(hz);
+        g_cur_hz = hz;
+    }
+}
+
+/* Take the bus for a blocking access. The lock keeps other threads from
+ * starting a transfer, and the asynchronous transfer which is in flight
+ * is waited for, because it ends in interrupt context. */
+static int16_t bus_lock(void)
+{
+    g_i2c->lock();
+
+#if DEVICE_I2C_ASYNCH
+    uint32_t start_us = us_ticker_read();
+
+    while (g_async_busy) {
+        if ((us_ticker_read() - start_us) > AKH_I2C_ASYNC_WAIT_US) {
+            g_i2c->unlock();
+            return AKM_ERR_BUSY;
+        }
+    }
+#endif
+
+    return AKM_SUCCESS;
+}
+
+/* The mutex is shared by all instances, so this is fine after
+ * bus_recover() has re-created the instance. */
+static void bus_unlock(void)
+{
+    g_i2c->unlock();
 }
 
 int16_t AKH_I2C_Init(void)
 {
+    AKH_Profile_Init();
+    g_cur_hz = 0;
+    memset(g_errors, 0, sizeof(g_errors));
+    g_stat_bytes = 0;
+    g_stat_busy_us = 0;
+
+#if DEVICE_I2C_ASYNCH
+    /* The shared queue is created on first use, which must not happen in
+     * interrupt context. So create it here. */
+    mbed_highprio_event_queue();
+#endif
     return AKM_SUCCESS;
 }
 
 
+/* Run one register access with retry. NACK and timeout cannot be told
+ * apart from the return value of mbed I2C API, so a failure which took
+ * much longer than the transfer itself is treated as timeout. */
+static int16_t i2c_xfer(
+    const AKH_HANDLE      dev,
+    const int             slave,
+    const uint8_t         address,
+    uint8_t               *data,
+    const uint16_t        len,
+    const bool            is_read)
+{
+    struct AKH_BUS_ERRORS *errors = handle_to_errors(dev);
+    int                   attempt;
+    int                   err;
+    int16_t               result;
+    char                  write_addr[1];
+    uint32_t              start_us;
+    uint32_t              limit_us;
+
+    write_addr[0] = address;
+
+    for (attempt = 0; ; attempt++) {
+        apply_profile(dev);
+
+        /* 9 clocks per byte, plus address phases */
+        limit_us = 2 * (((uint32_t)len + 3) * 9 * 1000U) / (g_cur_hz / 1000U)
+                   + 500;
+        start_us = us_ticker_read();
+
+        /* set register address once, then transfer data to the device. */
+        err = g_i2c->write(slave, write_addr, 1, true);
+
+        if (err == 0) {
+            if (is_read) {
+                err = g_i2c->read(slave, (char *)data, len, false);
+            } else {
+                err = g_i2c->write(slave, (char *)data, len, false);
+            }
+        }
+
+        result = (err == 0) ? AKM_SUCCESS : AKM_ERR_IO;
+        AKH_Profile_Report(dev, result);
+
+        if (result == AKM_SUCCESS) {
+            i2c_stat_add(len, start_us);
+            return AKM_SUCCESS;
+        }
+
+        if ((us_ticker_read() - start_us) > limit_us) {
+            /* the bus is stuck. release it before retry */
+            errors->timeouts++;
+            bus_recover();
+            errors->recoveries++;
+        } else {
+            errors->nacks++;
+        }
+
+        if (attempt >= AKH_I2C_RETRY_MAX) {
+            return AKM_ERR_IO;
+        }
+
+        errors->retries++;
+        wait_us(AKH_I2C_BACKOFF_US << attempt);
+    }
+}
+
 int16_t AKH_I2C_TxData(
-    const AKM_SENSOR_TYPE stype,
+    const AKH_HANDLE      dev,
     const uint8_t         address,
     const uint8_t         *data,
     const uint16_t        numberOfBytesToWrite)
 {
-    int  slave = type_to_slave(stype);
-    int  err;
-    char write_addr[1];
+    int     slave = handle_to_slave(dev);
+    int16_t fret;
 
     if (slave == INVALID_SLAVE_ADDR) {
         return AKM_ERROR;
     }
 
-    /* set register address once, then transfer data to the device. */
-    write_addr[0] = address;
-    err = i2c.write(slave, write_addr, 1, true);
-    if (err != 0) {
-        return AKM_ERR_IO;
+    if (numberOfBytesToWrite > AKH_Profile_MaxBurst(dev)) {
+        return AKM_ERR_INVALID_ARG;
     }
-    err = i2c.write(slave, (char *)data, numberOfBytesToWrite, false);
-    if (err != 0) {
-        return AKM_ERR_IO;
+
+    fret = bus_lock();
+
+    if (fret != AKM_SUCCESS) {
+        return fret;
     }
 
-    return AKM_SUCCESS;
+    fret = i2c_xfer(
+            dev, slave, address, (uint8_t *)data, numberOfBytesToWrite,
+            false);
+    bus_unlock();
+
+    return fret;
 }
 
 int16_t AKH_I2C_RxData(
-    const AKM_SENSOR_TYPE stype,
+    const AKH_HANDLE      dev,
+    const uint8_t         address,
+    uint8_t               *data,
+    const uint16_t        numberOfBytesToRead)
+{
+    int     slave = handle_to_slave(dev);
+    int16_t fret;
+
+    if (slave == INVALID_SLAVE_ADDR) {
+        return AKM_ERROR;
+    }
+
+    if (numberOfBytesToRead > AKH_Profile_MaxBurst(dev)) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    fret = bus_lock();
+
+    if (fret != AKM_SUCCESS) {
+        return fret;
+    }
+
+    fret = i2c_xfer(
+            dev, slave, address, data, numberOfBytesToRead, true);
+    bus_unlock();
+
+    return fret;
+}
+
+/* No retry, no recovery and no report to the profile. An empty address
+ * simply does not acknowledge, which is not an error of the bus. */
+int16_t AKH_I2C_ProbeData(
+    const AKH_HANDLE      dev,
     const uint8_t         address,
     uint8_t               *data,
     const uint16_t        numberOfBytesToRead)
 {
-    int  slave = type_to_slave(stype);
-    int  err;
-    char write_addr[1];
+    int     slave = handle_to_slave(dev);
+    int     err;
+    int16_t fret;
+    char    write_addr[1];
 
     if (slave == INVALID_SLAVE_ADDR) {
         return AKM_ERROR;
     }
 
-    /* set register address once, then transfer data to the device. */
+    if (numberOfBytesToRead > AKH_Profile_MaxBurst(dev)) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    fret = bus_lock();
+
+    if (fret != AKM_SUCCESS) {
+        return fret;
+    }
+
+    apply_profile(dev);
     write_addr[0] = address;
-    err = i2c.write(slave, write_addr, 1, true);
-    if (err != 0) {
-        return AKM_ERR_IO;
+    err = g_i2c->write(slave, write_addr, 1, true);
+
+    if (err == 0) {
+        err = g_i2c->read(slave, (char *)data, numberOfBytesToRead, false);
     }
-    err = i2c.read(slave, (char *)data, numberOfBytesToRead, false);
-    if (err != 0) {
-        return AKM_ERR_IO;
+
+    bus_unlock();
+
+    return (err == 0) ? AKM_SUCCESS : AKM_ERR_IO;
+}
+
+int16_t AKH_I2C_TxDataAsync(
+    const AKH_HANDLE        dev,
+    const uint8_t           address,
+    const uint8_t           *data,
+    const uint16_t          numberOfBytesToWrite,
+    const AKH_XFER_CALLBACK callback,
+    void                    *arg)
+{
+#if DEVICE_I2C_ASYNCH
+    int     slave = handle_to_slave(dev);
+    int16_t fret;
+
+    if (slave == INVALID_SLAVE_ADDR) {
+        return AKM_ERROR;
+    }
+
+    if ((numberOfBytesToWrite > AKH_I2C_ASYNC_TX_SIZE) ||
+        (numberOfBytesToWrite > AKH_Profile_MaxBurst(dev))) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    /* A blocking access of other thread may be on the bus */
+    g_i2c->lock();
+
+    if (g_async_busy) {
+        g_i2c->unlock();
+        return AKM_ERR_BUSY;
+    }
+
+    g_async_busy = true;
+    apply_profile(dev);
+
+    /* register address and data are sent in one write phase. */
+    g_async_tx[0] = address;
+    memcpy(&g_async_tx[1], data, numberOfBytesToWrite);
+
+    fret = i2c_async_start(
+            dev, slave, g_async_tx, numberOfBytesToWrite + 1, NULL, 0,
+            callback, arg);
+    g_i2c->unlock();
+
+    return fret;
+#else
+    return AKM_ERR_NOT_SUPPORT;
+#endif
+}
+
+int16_t AKH_I2C_RxDataAsync(
+    const AKH_HANDLE        dev,
+    const uint8_t           address,
+    uint8_t                 *data,
+    const uint16_t          numberOfBytesToRead,
+    const AKH_XFER_CALLBACK callback,
+    void                    *arg)
+{
+#if DEVICE_I2C_ASYNCH
+    int     slave = handle_to_slave(dev);
+    int16_t fret;
+
+    if (slave == INVALID_SLAVE_ADDR) {
+        return AKM_ERROR;
+    }
+
+    if (numberOfBytesToRead > AKH_Profile_MaxBurst(dev)) {
+        return AKM_ERR_INVALID_ARG;
     }
 
+    /* A blocking access of other thread may be on the bus */
+    g_i2c->lock();
+
+    if (g_async_busy) {
+        g_i2c->unlock();
+        return AKM_ERR_BUSY;
+    }
+
+    g_async_busy = true;
+    apply_profile(dev);
+
+    /* write register address, then read with repeated start. */
+    g_async_tx[0] = address;
+
+    fret = i2c_async_start(
+            dev, slave, g_async_tx, 1, (char *)data, numberOfBytesToRead,
+            callback, arg);
+    g_i2c->unlock();
+
+    return fret;
+#else
+    return AKM_ERR_NOT_SUPPORT;
+#endif
+}
+
+int16_t AKH_I2C_GetErrors(
+    const AKH_HANDLE      dev,
+    struct AKH_BUS_ERRORS *errors)
+{
+    struct AKH_BUS_ERRORS *e = handle_to_errors(dev);
+
+    if (e == NULL) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    *errors = *e;
     return AKM_SUCCESS;
-}
\ No newline at end of file
+}
+
+int16_t AKH_I2C_GetThroughput(struct AKH_BUS_THROUGHPUT *tp)
+{
+    tp->bytes = g_stat_bytes;
+    tp->busy_us = g_stat_busy_us;
+
+    if (g_stat_busy_us == 0) {
+        tp->bytes_per_sec = 0;
+    } else {
+        tp->bytes_per_sec = (uint32_t)(
+                ((uint64_t)g_stat_bytes * 1000000U) / g_stat_busy_us);
+    }
+
+    return AKM_SUCCESS;
+}
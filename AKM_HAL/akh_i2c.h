@@ -17,22 +17,54 @@
  *
  ******************************************************************************/
 #include "AKM_Common.h"
-
-
-
+#include "AKH_APIs.h"
 
 int16_t AKH_I2C_Init(void);
 
 int16_t AKH_I2C_TxData(
-    const AKM_SENSOR_TYPE stype,
+    const AKH_HANDLE      dev,
     const uint8_t         address,
     const uint8_t         *data,
     const uint16_t        numberOfBytesToWrite
 );
 
 int16_t AKH_I2C_RxData(
-    const AKM_SENSOR_TYPE stype,
+    const AKH_HANDLE      dev,
+    const uint8_t         address,
+    uint8_t               *data,
+    const uint16_t        numberOfBytesToRead
+);
+
+int16_t AKH_I2C_ProbeData(
+    const AKH_HANDLE      dev,
     const uint8_t         address,
     uint8_t               *data,
     const uint16_t        numberOfBytesToRead
+);
+
+int16_t AKH_I2C_GetErrors(
+    const AKH_HANDLE      dev,
+    struct AKH_BUS_ERRORS *errors
+);
+
+int16_t AKH_I2C_GetThroughput(
+    struct AKH_BUS_THROUGHPUT *tp
+);
+
+int16_t AKH_I2C_TxDataAsync(
+    const AKH_HANDLE        dev,
+    const uint8_t           address,
+    const uint8_t           *data,
+    const uint16_t          numberOfBytesToWrite,
+    const AKH_XFER_CALLBACK callback,
+    void                    *arg
+);
+
+int16_t AKH_I2C_RxDataAsync(
+    const AKH_HANDLE        dev,
+    const uint8_t           address,
+    uint8_t                 *data,
+    const uint16_t          numberOfBytesToRead,
+    const AKH_XFER_CALLBACK callback,
+    void                    *arg
 );
\ No newline at end of file
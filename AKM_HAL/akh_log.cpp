@@ -0,0 +1,328 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+#include "mbed.h"
+#include "AKH_APIs.h"
+#include "akh_log.h"
+
+/* The number of entries in the ring. Must be power of 2. */
+#define AKH_LOG_RING_SIZE   64
+#define AKH_LOG_MAX_ARGS    6
+#define AKH_LOG_LINE_SIZE   160
+#define AKH_LOG_STACK_SIZE  2048
+
+#define LOG_FLAG_PENDING    (1UL << 0)
+
+/* Argument is stored as raw value. The format string tells which member
+ * is valid, same as va_arg. */
+union akh_log_arg {
+    unsigned int       u32;
+    unsigned long long u64;
+    double             f64;
+    const void         *ptr;
+};
+
+struct akh_log_entry {
+    /* Set by producer after all members are filled. */
+    volatile uint8_t  ready;
+    uint8_t           num_of_args;
+    const char        *format;
+    union akh_log_arg args[AKH_LOG_MAX_ARGS];
+};
+
+/* Kind of argument which is consumed by one conversion. */
+enum akh_log_kind {
+    LOG_ARG_NONE = 0,
+    LOG_ARG_U32,
+    LOG_ARG_U64,
+    LOG_ARG_F64,
+    LOG_ARG_PTR,
+    LOG_ARG_INVALID
+};
+
+static struct akh_log_entry g_ring[AKH_LOG_RING_SIZE];
+/* Producers reserve an entry by advancing head with CAS.
+ * Only the logger thread advances tail. */
+static uint32_t             g_head;
+static uint32_t             g_tail;
+static uint32_t             g_logged;
+static uint32_t             g_dropped;
+static volatile AKH_LOG_WRITER g_writer;
+
+static EventFlags           g_log_flags;
+static Thread               g_log_thread(
+    osPriorityLow, AKH_LOG_STACK_SIZE, NULL, "akh_log");
+
+/* Parse one conversion specification which starts after '%'.
+ * Returns the pointer to the conversion character, and the kind of
+ * argument which is consumed. '*' width/precision is not supported. */
+static const char *parse_spec(const char *p, enum akh_log_kind *kind)
+{
+    int num_of_l = 0;
+
+    /* flags, width and precision */
+    while ((*p != '\0') && (strchr("-+ #0123456789.", *p) != NULL)) {
+        p++;
+    }
+
+    /* length modifier */
+    while ((*p != '\0') && (strchr("hlLqjzt", *p) != NULL)) {
+        if ((*p == 'l') || (*p == 'q') || (*p == 'j')) {
+            num_of_l++;
+        }
+
+        p++;
+    }
+
+    switch (*p) {
+    case 'd':
+    case 'i':
+    case 'u':
+    case 'x':
+    case 'X':
+    case 'o':
+    case 'c':
+        *kind = ((num_of_l >= 2) || (sizeof(long) == 8 && num_of_l == 1)) ?
+                LOG_ARG_U64 : LOG_ARG_U32;
+        break;
+
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+        *kind = LOG_ARG_F64;
+        break;
+
+    case 's':
+    case 'p':
+        *kind = LOG_ARG_PTR;
+        break;
+
+    case '%':
+        *kind = LOG_ARG_NONE;
+        break;
+
+    default:
+        *kind = LOG_ARG_INVALID;
+        break;
+    }
+
+    return p;
+}
+
+static void format_entry(
+    const struct akh_log_entry *e,
+    char                       *out,
+    const size_t               size)
+{
+    const char        *p = e->format;
+    const char        *conv;
+    enum akh_log_kind kind;
+    size_t            len = 0;
+    uint8_t           n = 0;
+    char              spec[16];
+    size_t            spec_len;
+    int               ret;
+
+    while ((*p != '\0') && (len + 1 < size)) {
+        if (*p != '%') {
+            out[len++] = *p++;
+            continue;
+        }
+
+        conv = parse_spec(p + 1, &kind);
+        spec_len = (size_t)(conv - p) + 1;
+
+        if ((kind == LOG_ARG_INVALID) || (spec_len >= sizeof(spec)) ||
+            ((kind != LOG_ARG_NONE) && (n >= e->num_of_args))) {
+            /* print as it is */
+            break;
+        }
+
+        memcpy(spec, p, spec_len);
+        spec[spec_len] = '\0';
+
+        switch (kind) {
+        case LOG_ARG_U32:
+            ret = snprintf(&out[len], size - len, spec, e->args[n++].u32);
+            break;
+
+        case LOG_ARG_U64:
+            ret = snprintf(&out[len], size - len, spec, e->args[n++].u64);
+            break;
+
+        case LOG_ARG_F64:
+            ret = snprintf(&out[len], size - len, spec, e->args[n++].f64);
+            break;
+
+        case LOG_ARG_PTR:
+            ret = snprintf(&out[len], size - len, spec, e->args[n++].ptr);
+            break;
+
+        default:
+            ret = snprintf(&out[len], size - len, "%%");
+            break;
+        }
+
+        if (ret > 0) {
+            len += (size_t)ret;
+
+            if (len >= size) {
+                len = size - 1;
+            }
+        }
+
+        p = conv + 1;
+    }
+
+    out[len] = '\0';
+}
+
+static void log_thread_main(void)
+{
+    struct akh_log_entry *e;
+    AKH_LOG_WRITER       writer;
+    char                 line[AKH_LOG_LINE_SIZE];
+
+    while (true) {
+        g_log_flags.wait_any(LOG_FLAG_PENDING);
+
+        while (g_tail != core_util_atomic_load_u32(&g_head)) {
+            e = &g_ring[g_tail & (AKH_LOG_RING_SIZE - 1)];
+
+            /* reserved but not filled yet */
+            if (core_util_atomic_load_u8(&e->ready) == 0) {
+                ThisThread::yield();
+                continue;
+            }
+
+            format_entry(e, line, sizeof(line));
+            writer = g_writer;
+
+            if (writer != NULL) {
+                writer(line, (uint16_t)strlen(line));
+            } else {
+                uart.write(line, strlen(line));
+            }
+
+            core_util_atomic_store_u8(&e->ready, 0);
+            core_util_atomic_store_u32(&g_tail, g_tail + 1);
+        }
+    }
+}
+
+void AKH_LogInit(void)
+{
+    g_head = 0;
+    g_tail = 0;
+    g_logged = 0;
+    g_dropped = 0;
+    g_log_thread.start(callback(log_thread_main));
+}
+
+void AKH_Log(
+    const char *format,
+    ...)
+{
+    struct akh_log_entry *e;
+    enum akh_log_kind    kind;
+    const char           *p;
+    uint32_t             head;
+    va_list              va;
+    uint8_t              n = 0;
+
+    /* reserve an entry */
+    head = core_util_atomic_load_u32(&g_head);
+
+    do {
+        if ((head - core_util_atomic_load_u32(&g_tail)) >=
+            AKH_LOG_RING_SIZE) {
+            core_util_atomic_incr_u32(&g_dropped, 1);
+            return;
+        }
+    } while (!core_util_atomic_cas_u32(&g_head, &head, head + 1));
+
+    e = &g_ring[head & (AKH_LOG_RING_SIZE - 1)];
+    e->format = format;
+
+    /* capture arguments as raw value */
+    va_start(va, format);
+
+    for (p = format; *p != '\0'; p++) {
+        if (*p != '%') {
+            continue;
+        }
+
+        p = parse_spec(p + 1, &kind);
+
+        if ((kind == LOG_ARG_INVALID) || (n >= AKH_LOG_MAX_ARGS)) {
+            break;
+        }
+
+        switch (kind) {
+        case LOG_ARG_U32:
+            e->args[n++].u32 = va_arg(va, unsigned int);
+            break;
+
+        case LOG_ARG_U64:
+            e->args[n++].u64 = va_arg(va, unsigned long long);
+            break;
+
+        case LOG_ARG_F64:
+            e->args[n++].f64 = va_arg(va, double);
+            break;
+
+        case LOG_ARG_PTR:
+            e->args[n++].ptr = va_arg(va, const void *);
+            break;
+
+        default:
+            break;
+        }
+
+        if (*p == '\0') {
+            break;
+        }
+    }
+
+    va_end(va);
+
+    e->num_of_args = n;
+    core_util_atomic_incr_u32(&g_logged, 1);
+
+    /* publish. atomic store orders the writes above */
+    core_util_atomic_store_u8(&e->ready, 1);
+    g_log_flags.set(LOG_FLAG_PENDING);
+}
+
+int16_t AKH_SetLogWriter(AKH_LOG_WRITER writer)
+{
+    g_writer = writer;
+    return AKM_SUCCESS;
+}
+
+int16_t AKH_GetLogStats(struct AKH_LOG_STATS *stats)
+{
+    stats->logged = core_util_atomic_load_u32(&g_logged);
+    stats->dropped = core_util_atomic_load_u32(&g_dropped);
+    return AKM_SUCCESS;
+}
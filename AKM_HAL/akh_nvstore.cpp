@@ -0,0 +1,422 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+#include "mbed.h"
+#include "AKH_APIs.h"
+#include "akh_nvstore.h"
+
+#if DEVICE_FLASH
+
+/* Log structured record store on the last two sectors of internal flash.
+ * Records are appended to the active sector. When the sector is full,
+ * the other sector is erased and the new record is written there, so the
+ * previous record survives until the new one is completely written.
+ * The application image must not overlap these sectors, so mbed_app.json
+ * limits the ROM size of the image. */
+
+#define NV_MAGIC         0x564E4B41UL  /* "AKNV" */
+/* Increment when the meaning of the payload is changed. */
+#define NV_VERSION       1
+#define NV_NUM_SECTORS   2
+/* Staging buffer for padding to program page. */
+#define NV_CHUNK_SIZE    32
+
+struct nv_record_header {
+    uint32_t magic;
+    uint32_t seq;
+    uint16_t version;
+    uint16_t length;
+    /* CRC-32 of seq, version, length and payload */
+    uint32_t crc;
+};
+
+struct nv_sector {
+    uint32_t addr;
+    uint32_t size;
+    /* offset of the first free byte */
+    uint32_t write_offset;
+    /* the free area may not be erased (e.g. torn write) */
+    bool     dirty;
+};
+
+static FlashIAP         g_flash;
+static bool             g_nv_ready = false;
+static struct nv_sector g_sectors[NV_NUM_SECTORS];
+static uint32_t         g_page_size;
+static uint8_t          g_erase_value;
+/* the latest valid record */
+static int8_t           g_last_sector = -1;
+static uint32_t         g_last_addr;
+static uint32_t         g_last_seq;
+static uint16_t         g_last_length;
+
+static uint32_t nv_crc32(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+    uint32_t i;
+    uint8_t  bit;
+
+    crc = ~crc;
+
+    for (i = 0; i < len; i++) {
+        crc ^= buf[i];
+
+        for (bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+        }
+    }
+
+    return ~crc;
+}
+
+static uint32_t nv_align(const uint32_t size)
+{
+    return ((size + g_page_size - 1) / g_page_size) * g_page_size;
+}
+
+static uint32_t nv_record_size(const uint16_t length)
+{
+    return nv_align(sizeof(struct nv_record_header)) + nv_align(length);
+}
+
+static uint32_t nv_header_crc(const struct nv_record_header *hdr)
+{
+    uint32_t crc = 0;
+
+    crc = nv_crc32(crc, (const uint8_t *)&hdr->seq, sizeof(hdr->seq));
+    crc = nv_crc32(crc, (const uint8_t *)&hdr->version, sizeof(hdr->version));
+    crc = nv_crc32(crc, (const uint8_t *)&hdr->length, sizeof(hdr->length));
+    return crc;
+}
+
+/* Calculate CRC of the payload in flash. */
+static int16_t nv_payload_crc(
+    const uint32_t addr,
+    const uint16_t length,
+    uint32_t       *crc)
+{
+    uint8_t  buf[NV_CHUNK_SIZE];
+    uint32_t done;
+    uint32_t n;
+
+    for (done = 0; done < length; done += n) {
+        n = length - done;
+
+        if (n > sizeof(buf)) {
+            n = sizeof(buf);
+        }
+
+        if (g_flash.read(buf, addr + done, n) != 0) {
+            return AKM_ERR_IO;
+        }
+
+        *crc = nv_crc32(*crc, buf, n);
+    }
+
+    return AKM_SUCCESS;
+}
+
+static bool nv_is_erased(const struct nv_record_header *hdr)
+{
+    const uint8_t *p = (const uint8_t *)hdr;
+    uint32_t      i;
+
+    for (i = 0; i < sizeof(*hdr); i++) {
+        if (p[i] != g_erase_value) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* Walk the record chain of a sector. Only headers and payload CRC are
+ * read, and it stops at the first erased header. */
+static void nv_scan_sector(const int8_t index)
+{
+    struct nv_sector        *sec = &g_sectors[index];
+    struct nv_record_header hdr;
+    uint32_t                offset = 0;
+    uint32_t                crc;
+
+    sec->dirty = false;
+
+    while (offset + sizeof(hdr) <= sec->size) {
+        if (g_flash.read(&hdr, sec->addr + offset, sizeof(hdr)) != 0) {
+            sec->dirty = true;
+            break;
+        }
+
+        if (nv_is_erased(&hdr)) {
+            break;
+        }
+
+        if ((hdr.magic != NV_MAGIC) ||
+            (offset + nv_record_size(hdr.length) > sec->size)) {
+            /* unknown data. the rest of the sector cannot be trusted */
+            sec->dirty = true;
+            break;
+        }
+
+        crc = nv_header_crc(&hdr);
+
+        if (nv_payload_crc(
+                sec->addr + offset + nv_align(sizeof(hdr)),
+                hdr.length, &crc) != AKM_SUCCESS) {
+            sec->dirty = true;
+            break;
+        }
+
+        /* A torn record still has correct length in its header, so the
+         * chain can be followed. Just skip it. */
+        if ((crc == hdr.crc) && (hdr.version == NV_VERSION) &&
+            ((g_last_sector < 0) || ((int32_t)(hdr.seq - g_last_seq) > 0))) {
+            g_last_sector = index;
+            g_last_addr = sec->addr + offset;
+            g_last_seq = hdr.seq;
+            g_last_length = hdr.length;
+        }
+
+        offset += nv_record_size(hdr.length);
+    }
+
+    sec->write_offset = offset;
+}
+
+static int16_t nv_program(
+    const uint32_t addr,
+    const uint8_t  *data,
+    const uint32_t len)
+{
+    uint8_t  buf[NV_CHUNK_SIZE];
+    uint32_t done;
+    uint32_t n;
+
+    /* pad the last page with erase value */
+    for (done = 0; done < len; done += n) {
+        n = len - done;
+
+        if (n > sizeof(buf)) {
+            n = sizeof(buf);
+        }
+
+        memset(buf, g_erase_value, sizeof(buf));
+        memcpy(buf, &data[done], n);
+
+        if (g_flash.program(buf, addr + done, nv_align(n)) != 0) {
+            return AKM_ERR_IO;
+        }
+    }
+
+    return AKM_SUCCESS;
+}
+
+int16_t AKH_NV_Init(void)
+{
+    uint32_t end;
+    int8_t   i;
+
+    if (g_nv_ready) {
+        return AKM_SUCCESS;
+    }
+
+    if (g_flash.init() != 0) {
+        return AKM_ERR_IO;
+    }
+
+    g_page_size = g_flash.get_page_size();
+    g_erase_value = g_flash.get_erase_value();
+
+    if ((g_page_size == 0) || (g_page_size > NV_CHUNK_SIZE) ||
+        ((NV_CHUNK_SIZE % g_page_size) != 0)) {
+        return AKM_ERR_NOT_SUPPORT;
+    }
+
+    /* last two sectors. sector size may differ for each sector */
+    end = g_flash.get_flash_start() + g_flash.get_flash_size();
+
+    for (i = NV_NUM_SECTORS - 1; i >= 0; i--) {
+        g_sectors[i].size = g_flash.get_sector_size(end - 1);
+        g_sectors[i].addr = end - g_sectors[i].size;
+        end = g_sectors[i].addr;
+    }
+
+#if defined(MBED_ROM_START) && defined(MBED_ROM_SIZE)
+    /* erasing a sector would destroy the image */
+    if (g_sectors[0].addr < (uint32_t)(MBED_ROM_START + MBED_ROM_SIZE)) {
+        return AKM_ERR_NOT_SUPPORT;
+    }
+#endif
+
+    g_last_sector = -1;
+
+    for (i = 0; i < NV_NUM_SECTORS; i++) {
+        nv_scan_sector(i);
+    }
+
+    g_nv_ready = true;
+    return AKM_SUCCESS;
+}
+
+int16_t AKH_NV_Load(
+    uint8_t        *data,
+    const uint16_t len)
+{
+    struct nv_record_header hdr;
+    int16_t                 fret;
+
+    fret = AKH_NV_Init();
+
+    if (fret != AKM_SUCCESS) {
+        return fret;
+    }
+
+    if (g_last_sector < 0) {
+        return AKM_ERROR;
+    }
+
+    /* layout of the payload was changed */
+    if (g_last_length != len) {
+        return AKM_ERR_NOT_SUPPORT;
+    }
+
+    if ((g_flash.read(&hdr, g_last_addr, sizeof(hdr)) != 0) ||
+        (g_flash.read(data, g_last_addr + nv_align(sizeof(hdr)), len) != 0)) {
+        return AKM_ERR_IO;
+    }
+
+    /* verify again, flash might be changed after scan */
+    if (nv_crc32(nv_header_crc(&hdr), data, len) != hdr.crc) {
+        return AKM_ERROR;
+    }
+
+    return AKM_SUCCESS;
+}
+
+int16_t AKH_NV_Save(
+    const uint8_t  *data,
+    const uint16_t len)
+{
+    struct nv_record_header hdr;
+    struct nv_sector        *sec;
+    int8_t                  index;
+    uint32_t                addr;
+    int16_t                 fret;
+
+    fret = AKH_NV_Init();
+
+    if (fret != AKM_SUCCESS) {
+        return fret;
+    }
+
+    /* skip the write when nothing is changed, to save flash endurance */
+    if ((g_last_sector >= 0) && (g_last_length == len)) {
+        uint8_t  buf[NV_CHUNK_SIZE];
+        uint32_t done;
+        uint32_t n;
+        bool     same = true;
+
+        for (done = 0; (done < len) && same; done += n) {
+            n = len - done;
+
+            if (n > sizeof(buf)) {
+                n = sizeof(buf);
+            }
+
+            if (g_flash.read(
+                    buf, g_last_addr + nv_align(sizeof(hdr)) + done, n) != 0) {
+                same = false;
+                break;
+            }
+
+            same = (memcmp(buf, &data[done], n) == 0);
+        }
+
+        if (same) {
+            return AKM_SUCCESS;
+        }
+    }
+
+    index = (g_last_sector < 0) ? 0 : g_last_sector;
+    sec = &g_sectors[index];
+
+    if (nv_record_size(len) > sec->size) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    /* sector is full, or its free area is not clean. move to the other */
+    if (sec->dirty || (sec->write_offset + nv_record_size(len) > sec->size)) {
+        index = (index + 1) % NV_NUM_SECTORS;
+        sec = &g_sectors[index];
+
+        if (g_flash.erase(sec->addr, sec->size) != 0) {
+            return AKM_ERR_IO;
+        }
+
+        sec->write_offset = 0;
+        sec->dirty = false;
+    }
+
+    hdr.magic = NV_MAGIC;
+    hdr.seq = (g_last_sector < 0) ? 0 : g_last_seq + 1;
+    hdr.version = NV_VERSION;
+    hdr.length = len;
+    hdr.crc = nv_crc32(nv_header_crc(&hdr), data, len);
+
+    addr = sec->addr + sec->write_offset;
+    /* whatever happens from here, the area is no longer erased */
+    sec->write_offset += nv_record_size(len);
+
+    fret = nv_program(addr, (const uint8_t *)&hdr, sizeof(hdr));
+
+    if (fret == AKM_SUCCESS) {
+        fret = nv_program(addr + nv_align(sizeof(hdr)), data, len);
+    }
+
+    if (fret != AKM_SUCCESS) {
+        return fret;
+    }
+
+    g_last_sector = index;
+    g_last_addr = addr;
+    g_last_seq = hdr.seq;
+    g_last_length = len;
+    return AKM_SUCCESS;
+}
+
+#else
+
+int16_t AKH_NV_Init(void)
+{
+    return AKM_ERR_NOT_SUPPORT;
+}
+
+int16_t AKH_NV_Load(
+    uint8_t        *data,
+    const uint16_t len)
+{
+    return AKM_ERR_NOT_SUPPORT;
+}
+
+int16_t AKH_NV_Save(
+    const uint8_t  *data,
+    const uint16_t len)
+{
+    return AKM_ERR_NOT_SUPPORT;
+}
+
+#endif /* DEVICE_FLASH */
@@ -0,0 +1,115 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+#include "mbed.h"
+#include "AKH_APIs.h"
+#include "akh_power.h"
+#include "akh_timebase.h"
+
+/* Statistics of the current window. They are updated in thread context
+ * only, by AKH_Idle() and AKH_GetPowerStats(). */
+static uint64_t g_window_ns;
+static uint64_t g_wake_ns;
+static uint64_t g_active_ns;
+static uint64_t g_deep_ns;
+static uint32_t g_wakeups;
+
+void AKH_PowerInit(void)
+{
+    g_window_ns = AKH_GetTimeNs();
+    g_wake_ns = g_window_ns;
+    g_active_ns = 0;
+    g_deep_ns = 0;
+    g_wakeups = 0;
+}
+
+void AKH_PowerBusBegin(void)
+{
+    /* DMA and bus peripheral clocks are stopped in deep sleep */
+    sleep_manager_lock_deep_sleep();
+}
+
+void AKH_PowerBusEnd(void)
+{
+    sleep_manager_unlock_deep_sleep();
+}
+
+int16_t AKH_Idle(
+    const uint32_t mask,
+    const uint64_t deadline_ns,
+    uint32_t       *events)
+{
+    uint64_t now;
+    uint32_t timeout_us;
+    int16_t  fret;
+
+    now = AKH_GetTimeNs();
+    g_active_ns += now - g_wake_ns;
+
+    if (deadline_ns > now) {
+        timeout_us = (uint32_t)((deadline_ns - now + 999U) / 1000U);
+    } else {
+        /* Only collect pending events */
+        timeout_us = 0;
+    }
+
+    /* Idle thread puts the core to sleep, or to deep sleep when no one
+     * holds the lock. Timebase is stopped in deep sleep. */
+    AKH_TimebaseSuspend();
+    fret = AKH_WaitEvent(mask, timeout_us, events);
+    g_deep_ns += AKH_TimebaseResume();
+
+    g_wake_ns = AKH_GetTimeNs();
+    g_wakeups++;
+
+    return fret;
+}
+
+int16_t AKH_GetPowerStats(struct AKH_POWER_STATS *stats)
+{
+    uint64_t now;
+    uint64_t window;
+    uint64_t active;
+
+    if (stats == NULL) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    now = AKH_GetTimeNs();
+    window = now - g_window_ns;
+    active = g_active_ns + (now - g_wake_ns);
+
+    if (window == 0) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    stats->wakeups_per_sec = (uint32_t)((g_wakeups * 1000000000ULL) / window);
+    stats->avg_active_us = (g_wakeups != 0U) ?
+                           (uint32_t)(active / g_wakeups / 1000U) : 0U;
+    stats->active_permille = (uint32_t)((active * 1000U) / window);
+    stats->deep_sleep_permille = (uint32_t)((g_deep_ns * 1000U) / window);
+
+    /* start new window */
+    g_window_ns = now;
+    g_wake_ns = now;
+    g_active_ns = 0;
+    g_deep_ns = 0;
+    g_wakeups = 0;
+
+    return AKM_SUCCESS;
+}
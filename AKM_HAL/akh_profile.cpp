@@ -0,0 +1,219 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+#include "AKM_Config.h"
+#include "AKH_APIs.h"
+#include "akh_device.h"
+#include "akh_profile.h"
+
+/* The fastest I2C clock of the host controller.
+ * STM32F4 I2C peripheral supports standard and fast mode only. */
+#if defined(TARGET_STM32F4)
+#define AKH_I2C_HOST_MAX_HZ  400000
+#else
+#define AKH_I2C_HOST_MAX_HZ  1000000
+#endif
+
+#define I2C_100K   100000
+#define I2C_400K   400000
+#define I2C_1M     1000000
+#define SPI_1M     1000000
+#define SPI_5M     5000000
+#define SPI_10M    10000000
+
+/* The slowest clock which fallback can reach. */
+#define I2C_MIN_HZ  I2C_100K
+#define SPI_MIN_HZ  500000
+
+struct akh_bus_profile {
+    AKM_DEVICES dev;
+    /* default I2C slave address in 8-bit form */
+    uint8_t     i2c_addr;
+    /* default SPI chip select index */
+    uint8_t     spi_cs;
+    /* I2C clock in Hz */
+    uint32_t    i2c_hz;
+    /* SPI clock in Hz */
+    uint32_t    spi_hz;
+    /* SPI mode (CPOL/CPHA) */
+    uint8_t     spi_mode;
+    /* The maximum number of bytes in one transaction */
+    uint16_t    max_burst;
+};
+
+/* Bus profile of each device. The clock is the maximum clock of the data
+ * sheet. Lower the value when the board wiring does not allow it.
+ * The address is used when the device table does not specify one. Other
+ * addresses selected by CAD or SDO pin (e.g. BMI160 0xD2) have to be set
+ * in the device table. */
+static const struct akh_bus_profile g_profiles[] = {
+    { AKM_MAGNETOMETER_AK8963,   0x18, 0, I2C_400K, SPI_1M,  3, 19 },
+    { AKM_MAGNETOMETER_AK09911,  0x18, 0, I2C_400K, SPI_1M,  3, 9 },
+    { AKM_MAGNETOMETER_AK09912,  0x18, 0, I2C_400K, SPI_5M,  3, 9 },
+    { AKM_MAGNETOMETER_AK09913,  0x18, 0, I2C_400K, SPI_1M,  3, 9 },
+    { AKM_MAGNETOMETER_AK09915,  0x18, 0, I2C_400K, SPI_5M,  3, 9 * 32 },
+    { AKM_MAGNETOMETER_AK09915D, 0x18, 0, I2C_400K, SPI_5M,  3, 9 * 32 },
+    { AKM_MAGNETOMETER_AK09916C, 0x18, 0, I2C_400K, SPI_1M,  3, 9 },
+    { AKM_MAGNETOMETER_AK09916D, 0x18, 0, I2C_400K, SPI_1M,  3, 9 },
+    { AKM_MAGNETOMETER_AK09917D, 0x18, 0, I2C_400K, SPI_5M,  3, 9 * 32 },
+    { AKM_MAGNETOMETER_AK09918,  0x18, 0, I2C_400K, SPI_1M,  3, 9 },
+    { AKM_MAGNETOMETER_AK09919,  0x1C, 0, I2C_1M,   SPI_1M,  3, 9 * 16 },
+    { AKM_MAGNETOMETER_AK09940A, 0x18, 0, I2C_1M,   SPI_10M, 3, 320 },
+    { AKM_ACCELEROMETER_ADXL345, 0xA6, 1, I2C_400K, SPI_5M,  3, 32 },
+    { AKM_ACCELEROMETER_ADXL346, 0xA6, 1, I2C_400K, SPI_5M,  3, 32 },
+    { AKM_GYROSCOPE_L3G4200D,    0xD0, 2, I2C_400K, SPI_10M, 3, 32 },
+    { AKM_GYROSCOPE_L3GD20,      0xD4, 2, I2C_400K, SPI_10M, 3, 32 },
+    { AKM_ACCELEROMETER_BMI160,  0xD0, 1, I2C_1M,   SPI_10M, 3, 320 },
+    { AKM_GYROSCOPE_BMI160,      0xD0, 1, I2C_1M,   SPI_10M, 3, 320 },
+};
+
+/* Used when the device is not listed in the table. */
+static const struct akh_bus_profile g_default_profile = {
+    AKM_DEVICE_NONE, 0x18, 0, I2C_100K, SPI_1M, 3, 32
+};
+
+/* Fallback state of each device. */
+static uint8_t g_num_of_errors[AKH_MAX_DEVICES];
+static uint8_t g_fallback_level[AKH_MAX_DEVICES];
+
+static const struct akh_bus_profile *device_to_profile(
+    const AKM_DEVICES device)
+{
+    uint8_t i;
+
+    for (i = 0; i < sizeof(g_profiles) / sizeof(g_profiles[0]); i++) {
+        if (g_profiles[i].dev == device) {
+            return &g_profiles[i];
+        }
+    }
+
+    return &g_default_profile;
+}
+
+static const struct akh_bus_profile *handle_to_profile(
+    const AKH_HANDLE dev)
+{
+    const struct AKH_DEVICE_DESC *desc = AKH_Device_Get(dev);
+
+    if (desc == NULL) {
+        return &g_default_profile;
+    }
+
+    return device_to_profile(desc->device);
+}
+
+/* Each fallback level halves the clock. */
+static uint32_t apply_fallback(
+    const AKH_HANDLE dev,
+    uint32_t         hz,
+    const uint32_t   min_hz)
+{
+    if (dev < AKH_MAX_DEVICES) {
+        hz >>= g_fallback_level[dev];
+    }
+
+    if (hz < min_hz) {
+        hz = min_hz;
+    }
+
+    return hz;
+}
+
+void AKH_Profile_Init(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < AKH_MAX_DEVICES; i++) {
+        AKH_Profile_Reset(i);
+    }
+}
+
+void AKH_Profile_Reset(const AKH_HANDLE dev)
+{
+    if (dev >= AKH_MAX_DEVICES) {
+        return;
+    }
+
+    g_num_of_errors[dev] = 0;
+    g_fallback_level[dev] = 0;
+}
+
+uint8_t AKH_Profile_DefaultAddress(const AKM_DEVICES device)
+{
+#ifdef AKH_USE_SPI
+    return device_to_profile(device)->spi_cs;
+#else
+    return device_to_profile(device)->i2c_addr;
+#endif
+}
+
+uint32_t AKH_Profile_I2CClock(const AKH_HANDLE dev)
+{
+    uint32_t hz = handle_to_profile(dev)->i2c_hz;
+
+    if (hz > AKH_I2C_HOST_MAX_HZ) {
+        hz = AKH_I2C_HOST_MAX_HZ;
+    }
+
+    return apply_fallback(dev, hz, I2C_MIN_HZ);
+}
+
+uint32_t AKH_Profile_SPIClock(const AKH_HANDLE dev)
+{
+    return apply_fallback(dev, handle_to_profile(dev)->spi_hz, SPI_MIN_HZ);
+}
+
+uint8_t AKH_Profile_SPIMode(const AKH_HANDLE dev)
+{
+    return handle_to_profile(dev)->spi_mode;
+}
+
+uint16_t AKH_Profile_MaxBurst(const AKH_HANDLE dev)
+{
+    return handle_to_profile(dev)->max_burst;
+}
+
+void AKH_Profile_Report(
+    const AKH_HANDLE dev,
+    const int16_t    result)
+{
+    uint8_t idx = dev;
+
+    if (idx >= AKH_MAX_DEVICES) {
+        return;
+    }
+
+    if (result == AKM_SUCCESS) {
+        g_num_of_errors[idx] = 0;
+        return;
+    }
+
+    /* Only I/O errors indicate signal integrity problem. */
+    if (result != AKM_ERR_IO) {
+        return;
+    }
+
+    if (++g_num_of_errors[idx] >= AKH_PROFILE_FALLBACK_ERRORS) {
+        g_num_of_errors[idx] = 0;
+
+        /* 1/16 of the profile clock is enough slow for any board. */
+        if (g_fallback_level[idx] < 4) {
+            g_fallback_level[idx]++;
+        }
+    }
+}
@@ -0,0 +1,61 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+#ifndef INCLUDE_AKH_PROFILE_H
+#define INCLUDE_AKH_PROFILE_H
+
+#include "AKM_Common.h"
+#include "AKH_APIs.h"
+
+/* The number of consecutive errors which triggers clock fallback. */
+#define AKH_PROFILE_FALLBACK_ERRORS  3
+
+void AKH_Profile_Init(void);
+
+/* Clear the fallback state of the device. */
+void AKH_Profile_Reset(
+    const AKH_HANDLE dev
+);
+
+/* I2C slave address or SPI chip select index, depending on the bus. */
+uint8_t AKH_Profile_DefaultAddress(
+    const AKM_DEVICES device
+);
+
+uint32_t AKH_Profile_I2CClock(
+    const AKH_HANDLE dev
+);
+
+uint32_t AKH_Profile_SPIClock(
+    const AKH_HANDLE dev
+);
+
+uint8_t AKH_Profile_SPIMode(
+    const AKH_HANDLE dev
+);
+
+uint16_t AKH_Profile_MaxBurst(
+    const AKH_HANDLE dev
+);
+
+void AKH_Profile_Report(
+    const AKH_HANDLE dev,
+    const int16_t    result
+);
+
+#endif /* INCLUDE_AKH_PROFILE_H */
@@ -18,6 +18,9 @@
  ******************************************************************************/
 #include "AKM_Config.h"
 #include "akh_spi.h"
+#include "akh_device.h"
+#include "akh_profile.h"
+#include "akh_power.h"
 
 #include "AKH_APIs.h"
 
@@ -25,6 +28,13 @@
 #define AKS_SPI_BITS  8
 #define AKS_SPI_MODE  3
 
+/* The maximum length of one burst transfer (command byte + data).
+ * This is large enough for 32 frames of AK099xx FIFO data. */
+#define AKH_SPI_BURST_SIZE  (1 + 320)
+
+/* The longest time a blocking access waits for asynchronous transfer. */
+#define AKH_SPI_ASYNC_WAIT_US  10000
+
 /* SPI instance for communication of sensors */
 #ifdef ACSP_DEFINE
 // For ACSP Board
@@ -42,79 +52,396 @@ DigitalOut cs_acc(D9);
 DigitalOut cs_gyr(D8);
 #endif
 
-static DigitalOut *type_to_cspin(const AKM_SENSOR_TYPE stype)
+/* Chip select pins. The address of the device table is the index. */
+static DigitalOut *const g_cs_pins[] = { &cs_mag, &cs_acc, &cs_gyr };
+
+#define NUMBER_OF_CS  (sizeof(g_cs_pins) / sizeof(g_cs_pins[0]))
+
+/* Burst buffers. The first byte is command (address and RW bit). */
+static char g_burst_tx[AKH_SPI_BURST_SIZE];
+static char g_burst_rx[AKH_SPI_BURST_SIZE];
+
+/* The clock and mode which are currently set to the bus. */
+static uint32_t g_cur_hz;
+static int      g_cur_mode;
+
+/* Transfer statistics for throughput report. */
+static uint32_t g_stat_bytes;
+static uint32_t g_stat_busy_us;
+
+#if DEVICE_SPI_ASYNCH
+/* Asynchronous transfer context. Only one transfer can be in flight. */
+static volatile bool     g_async_busy = false;
+static DigitalOut        *g_async_cs;
+static uint8_t           *g_async_data;
+static uint16_t          g_async_len;
+static uint32_t          g_async_start_us;
+static AKH_XFER_CALLBACK g_async_cb;
+static void              *g_async_arg;
+static AKH_HANDLE        g_async_dev;
+#endif
+
+static DigitalOut *handle_to_cspin(const AKH_HANDLE dev)
 {
-    switch (stype) {
-    case AKM_ST_MAG:
-        return &cs_mag;
-
-    case AKM_ST_ACC:
-        return &cs_acc;
-
-    case AKM_ST_GYR:
-        if (CONFIG_SLOT3 == AKM_GYROSCOPE_BMI160) {
-            return &cs_acc;
-        } else {
-            return &cs_gyr;
-        }
+    const struct AKH_DEVICE_DESC *desc = AKH_Device_Get(dev);
 
-    default:
+    if ((desc == NULL) || (desc->address >= NUMBER_OF_CS)) {
         return NULL;
     }
+
+    return g_cs_pins[desc->address];
+}
+
+/* Set the clock and mode of the device profile. The bus is shared among
+ * devices, so it is checked on each transaction and changed only when it
+ * differs. */
+static void apply_profile(const AKH_HANDLE dev)
+{
+    uint32_t hz = AKH_Profile_SPIClock(dev);
+    int      mode = AKH_Profile_SPIMode(dev);
+
+    if (mode != g_cur_mode) {
+        spi.format(AKS_SPI_BITS, mode);
+        g_cur_mode = mode;
+    }
+
+    if (hz != g_cur_hz) {
+        spi.frequency(hz);
+        g_cur_hz = hz;
+    }
+}
+
+static void spi_stat_add(const uint16_t bytes, const uint32_t start_us)
+{
+    g_stat_bytes += bytes;
+    g_stat_busy_us += (us_ticker_read() - start_us);
+}
+
+/* Move a whole frame in one transfer. SPI has no acknowledge, so only a
+ * transfer which the driver could not complete is an error. It is
+ * reported to the profile, same as I2C. */
+static int16_t spi_burst(
+    const AKH_HANDLE dev,
+    DigitalOut       *cs,
+    const uint16_t   tx_len,
+    const uint16_t   rx_len)
+{
+    uint32_t start_us = us_ticker_read();
+    uint16_t len = (tx_len > rx_len) ? tx_len : rx_len;
+    int16_t  result;
+    int      done;
+
+    cs->write(0);
+    done = spi.write(g_burst_tx, tx_len, g_burst_rx, rx_len);
+    cs->write(1);
+
+    if (done == (int)len) {
+        spi_stat_add(len - 1, start_us);
+        result = AKM_SUCCESS;
+    } else {
+        result = AKM_ERR_IO;
+    }
+
+    AKH_Profile_Report(dev, result);
+
+    return result;
+}
+
+#if DEVICE_SPI_ASYNCH
+/* This function is called in interrupt context. */
+static void spi_async_done(int event)
+{
+    AKH_XFER_CALLBACK cb = g_async_cb;
+    void              *arg = g_async_arg;
+    int16_t           result;
+
+    g_async_cs->write(1);
+
+    if (event & SPI_EVENT_COMPLETE) {
+        if (g_async_data != NULL) {
+            memcpy(g_async_data, &g_burst_rx[1], g_async_len);
+        }
+
+        spi_stat_add(g_async_len, g_async_start_us);
+        result = AKM_SUCCESS;
+    } else {
+        result = AKM_ERR_IO;
+    }
+
+    AKH_Profile_Report(g_async_dev, result);
+    g_async_busy = false;
+    AKH_PowerBusEnd();
+
+    /* defer user callback to thread context */
+    if (cb != NULL) {
+        mbed_highprio_event_queue()->call(cb, result, arg);
+    }
+}
+
+static int16_t spi_async_start(
+    const AKH_HANDLE  dev,
+    DigitalOut        *cs,
+    uint8_t           *data,
+    const uint16_t    len,
+    AKH_XFER_CALLBACK callback,
+    void              *arg)
+{
+    int err;
+
+    apply_profile(dev);
+
+    g_async_cs = cs;
+    g_async_data = data;
+    g_async_len = len;
+    g_async_cb = callback;
+    g_async_arg = arg;
+    g_async_dev = dev;
+    g_async_start_us = us_ticker_read();
+
+    AKH_PowerBusBegin();
+    cs->write(0);
+    err = spi.transfer(
+            g_burst_tx, len + 1, g_burst_rx, len + 1,
+            event_callback_t(spi_async_done),
+            SPI_EVENT_COMPLETE | SPI_EVENT_ERROR);
+
+    if (err != 0) {
+        cs->write(1);
+        g_async_busy = false;
+        AKH_PowerBusEnd();
+        return AKM_ERR_BUSY;
+    }
+
+    return AKM_SUCCESS;
+}
+#endif
+
+/* Take the bus for a blocking access. The lock keeps other threads from
+ * starting a transfer, and the asynchronous transfer which is in flight
+ * is waited for, because it ends in interrupt context. The burst buffers
+ * belong to that transfer until then. */
+static int16_t bus_lock(void)
+{
+    spi.lock();
+
+#if DEVICE_SPI_ASYNCH
+    uint32_t start_us = us_ticker_read();
+
+    while (g_async_busy) {
+        if ((us_ticker_read() - start_us) > AKH_SPI_ASYNC_WAIT_US) {
+            spi.unlock();
+            return AKM_ERR_BUSY;
+        }
+    }
+#endif
+
+    return AKM_SUCCESS;
 }
 
 int16_t AKH_SPI_Init(void)
 {
+    uint8_t i;
+
     /* set spi format */
     spi.format(AKS_SPI_BITS, AKS_SPI_MODE);
     /* set to 1Mhz */
     spi.frequency(AKS_SPI_SPEED);
+    g_cur_mode = AKS_SPI_MODE;
+    g_cur_hz = AKS_SPI_SPEED;
+    AKH_Profile_Init();
+    /* dummy byte which is sent while reading */
+    spi.set_default_write_value(0x00);
     /* set all CS pin to high */
-    cs_mag = 1;
-    cs_acc = 1;
+    for (i = 0; i < NUMBER_OF_CS; i++) {
+        g_cs_pins[i]->write(1);
+    }
+
+#if DEVICE_SPI_ASYNCH
+    /* The shared queue is created on first use, which must not happen in
+     * interrupt context. So create it here. */
+    mbed_highprio_event_queue();
+#endif
+
+    g_stat_bytes = 0;
+    g_stat_busy_us = 0;
 
     return AKM_SUCCESS;
 }
 
 
 int16_t AKH_SPI_TxData(
-    const AKM_SENSOR_TYPE stype,
+    const AKH_HANDLE      dev,
     const uint8_t         address,
     const uint8_t         *data,
     const uint16_t        numberOfBytesToWrite)
 {
-    DigitalOut *cs = type_to_cspin(stype);
-    int i;
-    
-    cs->write(0);
-    /* set RW bit to write(=0) */
-    spi.write(address & 0x7F);
-    /* write subsequent data */
-    for(i = 0 ; i < numberOfBytesToWrite ; i++ ) {
-        spi.write(data[i]);
+    DigitalOut *cs = handle_to_cspin(dev);
+    int16_t    fret;
+
+    if (cs == NULL) {
+        return AKM_ERROR;
     }
-    cs->write(1);
 
-    return AKM_SUCCESS;
+    if ((numberOfBytesToWrite >= AKH_SPI_BURST_SIZE) ||
+        (numberOfBytesToWrite > AKH_Profile_MaxBurst(dev))) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    fret = bus_lock();
+
+    if (fret != AKM_SUCCESS) {
+        return fret;
+    }
+
+    /* set RW bit to write(=0), followed by subsequent data */
+    g_burst_tx[0] = address & 0x7F;
+    memcpy(&g_burst_tx[1], data, numberOfBytesToWrite);
+
+    apply_profile(dev);
+    fret = spi_burst(dev, cs, numberOfBytesToWrite + 1, 0);
+    spi.unlock();
+
+    return fret;
 }
 
 int16_t AKH_SPI_RxData(
-    const AKM_SENSOR_TYPE stype,
+    const AKH_HANDLE      dev,
     const uint8_t         address,
     uint8_t               *data,
     const uint16_t        numberOfBytesToRead)
 {
-    DigitalOut *cs = type_to_cspin(stype);
-    int i;
+    DigitalOut *cs = handle_to_cspin(dev);
+    int16_t    fret;
 
-    cs->write(0);
-    /* set RW bit to read(=1) */
-    spi.write(address | 0x80);
-    /* read subsequent data */
-    for(i = 0 ; i < numberOfBytesToRead ; i++ ) {
-        data[i] = spi.write(0x00);
+    if (cs == NULL) {
+        return AKM_ERROR;
+    }
+
+    if ((numberOfBytesToRead >= AKH_SPI_BURST_SIZE) ||
+        (numberOfBytesToRead > AKH_Profile_MaxBurst(dev))) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    fret = bus_lock();
+
+    if (fret != AKM_SUCCESS) {
+        return fret;
+    }
+
+    /* set RW bit to read(=1), then read subsequent data */
+    g_burst_tx[0] = address | 0x80;
+    apply_profile(dev);
+    fret = spi_burst(dev, cs, 1, numberOfBytesToRead + 1);
+
+    /* the first byte was received while sending the command */
+    if (fret == AKM_SUCCESS) {
+        memcpy(data, &g_burst_rx[1], numberOfBytesToRead);
+    }
+
+    spi.unlock();
+
+    return fret;
+}
+
+int16_t AKH_SPI_TxDataAsync(
+    const AKH_HANDLE        dev,
+    const uint8_t           address,
+    const uint8_t           *data,
+    const uint16_t          numberOfBytesToWrite,
+    const AKH_XFER_CALLBACK callback,
+    void                    *arg)
+{
+#if DEVICE_SPI_ASYNCH
+    DigitalOut *cs = handle_to_cspin(dev);
+    int16_t    fret;
+
+    if (cs == NULL) {
+        return AKM_ERROR;
+    }
+
+    if ((numberOfBytesToWrite >= AKH_SPI_BURST_SIZE) ||
+        (numberOfBytesToWrite > AKH_Profile_MaxBurst(dev))) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    /* A blocking access of other thread may be on the bus */
+    spi.lock();
+
+    if (g_async_busy) {
+        spi.unlock();
+        return AKM_ERR_BUSY;
+    }
+
+    g_async_busy = true;
+
+    g_burst_tx[0] = address & 0x7F;
+    memcpy(&g_burst_tx[1], data, numberOfBytesToWrite);
+
+    fret = spi_async_start(
+            dev, cs, NULL, numberOfBytesToWrite, callback, arg);
+    spi.unlock();
+
+    return fret;
+#else
+    return AKM_ERR_NOT_SUPPORT;
+#endif
+}
+
+int16_t AKH_SPI_RxDataAsync(
+    const AKH_HANDLE        dev,
+    const uint8_t           address,
+    uint8_t                 *data,
+    const uint16_t          numberOfBytesToRead,
+    const AKH_XFER_CALLBACK callback,
+    void                    *arg)
+{
+#if DEVICE_SPI_ASYNCH
+    DigitalOut *cs = handle_to_cspin(dev);
+    int16_t    fret;
+
+    if (cs == NULL) {
+        return AKM_ERROR;
+    }
+
+    if ((numberOfBytesToRead >= AKH_SPI_BURST_SIZE) ||
+        (numberOfBytesToRead > AKH_Profile_MaxBurst(dev))) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    /* A blocking access of other thread may be on the bus */
+    spi.lock();
+
+    if (g_async_busy) {
+        spi.unlock();
+        return AKM_ERR_BUSY;
+    }
+
+    g_async_busy = true;
+
+    g_burst_tx[0] = address | 0x80;
+    memset(&g_burst_tx[1], 0x00, numberOfBytesToRead);
+
+    fret = spi_async_start(
+            dev, cs, data, numberOfBytesToRead, callback, arg);
+    spi.unlock();
+
+    return fret;
+#else
+    return AKM_ERR_NOT_SUPPORT;
+#endif
+}
+
+int16_t AKH_SPI_GetThroughput(struct AKH_BUS_THROUGHPUT *tp)
+{
+    tp->bytes = g_stat_bytes;
+    tp->busy_us = g_stat_busy_us;
+
+    if (g_stat_busy_us == 0) {
+        tp->bytes_per_sec = 0;
+    } else {
+        tp->bytes_per_sec = (uint32_t)(
+                ((uint64_t)g_stat_bytes * 1000000U) / g_stat_busy_us);
     }
-    cs->write(1);
 
     return AKM_SUCCESS;
 }
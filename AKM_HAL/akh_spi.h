@@ -17,19 +17,42 @@
  *
  ******************************************************************************/
 #include "AKM_Common.h"
+#include "AKH_APIs.h"
 
 int16_t AKH_SPI_Init(void);
 
 int16_t AKH_SPI_TxData(
-    const AKM_SENSOR_TYPE stype,
+    const AKH_HANDLE      dev,
     const uint8_t         address,
     const uint8_t         *data,
     const uint16_t        numberOfBytesToWrite
 );
 
 int16_t AKH_SPI_RxData(
-    const AKM_SENSOR_TYPE stype,
+    const AKH_HANDLE      dev,
     const uint8_t         address,
     uint8_t               *data,
     const uint16_t        numberOfBytesToRead
 );
+
+int16_t AKH_SPI_TxDataAsync(
+    const AKH_HANDLE        dev,
+    const uint8_t           address,
+    const uint8_t           *data,
+    const uint16_t          numberOfBytesToWrite,
+    const AKH_XFER_CALLBACK callback,
+    void                    *arg
+);
+
+int16_t AKH_SPI_RxDataAsync(
+    const AKH_HANDLE        dev,
+    const uint8_t           address,
+    uint8_t                 *data,
+    const uint16_t          numberOfBytesToRead,
+    const AKH_XFER_CALLBACK callback,
+    void                    *arg
+);
+
+int16_t AKH_SPI_GetThroughput(
+    struct AKH_BUS_THROUGHPUT *tp
+);
@@ -0,0 +1,217 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+#include "mbed.h"
+#include "AKH_APIs.h"
+#include "akh_timebase.h"
+
+/* STM32F4 has 32-bit general purpose timer TIM2, which is not used by
+ * mbed (us_ticker uses TIM5). It runs at APB1 timer clock, and keeps
+ * counting in sleep mode. DWT cycle counter is not used, because it
+ * stops while the core is halted by WFI. */
+#if defined(TARGET_STM32F4)
+#define AKH_TIMEBASE_USE_TIM2
+#endif
+
+/* The counter must be read at least once in every wrap around period
+ * (about 47 sec at 90 MHz), so that the upper word is counted. */
+#define AKH_TIMEBASE_KEEPALIVE  10s
+
+#define NSEC_PER_SEC  1000000000ULL
+
+/* Low power ticker is coarse (about 30 us on STM32F4 RTC). Smaller gap
+ * than this is regarded as measurement error. */
+#define AKH_TIMEBASE_LP_TOLERANCE_NS  200000ULL
+
+#ifdef AKH_TIMEBASE_USE_TIM2
+static uint32_t g_tb_hz;
+/* nano seconds per 2^32 counts */
+static uint64_t g_tb_ns_per_wrap;
+static uint32_t g_tb_last;
+static uint32_t g_tb_high;
+#endif
+
+#if DEVICE_LPTICKER
+/* Keep alive must not hold deep sleep lock, as Ticker does. */
+static LowPowerTicker g_tb_keepalive;
+static us_timestamp_t g_tb_lp_mark;
+static uint64_t       g_tb_ns_mark;
+/* Time lost so far in the current idle. It only grows, so that time
+ * read by interrupts while suspended never goes backwards. */
+static uint64_t       g_tb_lost_ns;
+static bool           g_tb_suspended;
+#else
+static Ticker   g_tb_keepalive;
+#endif
+/* Time lost in deep sleep. Accessed in critical section. */
+static uint64_t g_tb_offset_ns;
+static bool     g_tb_started = false;
+
+#ifdef AKH_TIMEBASE_USE_TIM2
+static void tim2_start(void)
+{
+    uint32_t pclk1;
+
+    __HAL_RCC_TIM2_CLK_ENABLE();
+
+    TIM2->CR1 = 0;
+    TIM2->PSC = 0;
+    TIM2->ARR = 0xFFFFFFFF;
+    /* load prescaler */
+    TIM2->EGR = TIM_EGR_UG;
+    TIM2->CNT = 0;
+    TIM2->CR1 = TIM_CR1_CEN;
+
+    /* Timer clock is doubled when APB1 is divided. */
+    pclk1 = HAL_RCC_GetPCLK1Freq();
+
+    if ((RCC->CFGR & RCC_CFGR_PPRE1) == RCC_CFGR_PPRE1_DIV1) {
+        g_tb_hz = pclk1;
+    } else {
+        g_tb_hz = pclk1 * 2;
+    }
+
+    g_tb_ns_per_wrap = (((uint64_t)1 << 32) * NSEC_PER_SEC) / g_tb_hz;
+    g_tb_last = 0;
+    g_tb_high = 0;
+}
+#endif
+
+static void timebase_keepalive(void)
+{
+    (void)AKH_GetTimeNs();
+}
+
+void AKH_TimebaseInit(void)
+{
+    if (g_tb_started) {
+        return;
+    }
+
+#ifdef AKH_TIMEBASE_USE_TIM2
+    tim2_start();
+    g_tb_keepalive.attach(&timebase_keepalive, AKH_TIMEBASE_KEEPALIVE);
+#endif
+    g_tb_started = true;
+}
+
+static uint64_t timebase_raw_ns(void)
+{
+#ifdef AKH_TIMEBASE_USE_TIM2
+    uint32_t now;
+    uint32_t high;
+
+    /* extend 32-bit counter to 64-bit */
+    core_util_critical_section_enter();
+    now = TIM2->CNT;
+
+    if (now < g_tb_last) {
+        g_tb_high++;
+    }
+
+    g_tb_last = now;
+    high = g_tb_high;
+    core_util_critical_section_exit();
+
+    return ((uint64_t)high * g_tb_ns_per_wrap) +
+           (((uint64_t)now * NSEC_PER_SEC) / g_tb_hz);
+#else
+    /* mbed extends us_ticker to 64-bit in software */
+    return ticker_read_us(get_us_ticker_data()) * 1000ULL;
+#endif
+}
+
+#if DEVICE_LPTICKER
+/* Must be called in critical section. */
+static uint64_t timebase_lost_ns(const uint64_t raw_ns)
+{
+    uint64_t lp_ns;
+    uint64_t tb_ns;
+
+    lp_ns = (ticker_read_us(get_lp_ticker_data()) - g_tb_lp_mark) * 1000ULL;
+    tb_ns = raw_ns - g_tb_ns_mark;
+
+    if ((lp_ns > tb_ns + AKH_TIMEBASE_LP_TOLERANCE_NS) &&
+        (lp_ns - tb_ns > g_tb_lost_ns)) {
+        g_tb_lost_ns = lp_ns - tb_ns;
+    }
+
+    return g_tb_lost_ns;
+}
+#endif
+
+void AKH_TimebaseSuspend(void)
+{
+#if DEVICE_LPTICKER
+    core_util_critical_section_enter();
+    g_tb_lp_mark = ticker_read_us(get_lp_ticker_data());
+    g_tb_ns_mark = timebase_raw_ns();
+    g_tb_lost_ns = 0;
+    g_tb_suspended = true;
+    core_util_critical_section_exit();
+#endif
+}
+
+uint64_t AKH_TimebaseResume(void)
+{
+#if DEVICE_LPTICKER
+    uint64_t lost;
+
+    core_util_critical_section_enter();
+    lost = timebase_lost_ns(timebase_raw_ns());
+    g_tb_offset_ns += lost;
+    g_tb_lost_ns = 0;
+    g_tb_suspended = false;
+    core_util_critical_section_exit();
+
+    return lost;
+#else
+    return 0;
+#endif
+}
+
+uint64_t AKH_GetTimeNs(void)
+{
+    uint64_t raw;
+    uint64_t offset;
+
+    /* 64-bit load is not atomic on Cortex-M4 */
+    core_util_critical_section_enter();
+    raw = timebase_raw_ns();
+    offset = g_tb_offset_ns;
+#if DEVICE_LPTICKER
+    /* DRDY interrupt wakes the core from deep sleep before the thread
+     * resumes the timebase. Low power ticker covers the lost time. */
+    if (g_tb_suspended) {
+        offset += timebase_lost_ns(raw);
+    }
+#endif
+    core_util_critical_section_exit();
+
+    return raw + offset;
+}
+
+uint32_t AKH_GetTimebaseResolution(void)
+{
+#ifdef AKH_TIMEBASE_USE_TIM2
+    /* round up to 1 ns */
+    return (uint32_t)((NSEC_PER_SEC + g_tb_hz - 1) / g_tb_hz);
+#else
+    return 1000;
+#endif
+}
@@ -0,0 +1,32 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+#ifndef INCLUDE_AKH_TIMEBASE_H
+#define INCLUDE_AKH_TIMEBASE_H
+
+void AKH_TimebaseInit(void);
+
+/* Mark the time before idle, then compensate the time which was lost
+ * while the timebase was stopped in deep sleep. Between the two calls
+ * AKH_GetTimeNs() compensates with low power ticker, so interrupts
+ * which woke the core get monotonic time. Resume returns the
+ * compensated time in nano seconds. */
+void AKH_TimebaseSuspend(void);
+uint64_t AKH_TimebaseResume(void);
+
+#endif /* INCLUDE_AKH_TIMEBASE_H */
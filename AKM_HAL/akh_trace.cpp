@@ -0,0 +1,387 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+#include "mbed.h"
+#include "akh_trace.h"
+
+#ifdef AKH_USE_TRACE
+#ifndef AKH_TRACE_BUF_SIZE
+#define AKH_TRACE_BUF_SIZE  16384
+#endif
+
+/* The largest record: tag, time, type, address, length, data */
+#define AKH_TRACE_REC_OVERHEAD  (1 + 10 + 1 + 1 + 3)
+
+static uint8_t          g_buf[AKH_TRACE_BUF_SIZE];
+static uint32_t         g_len;
+static uint64_t         g_last_ns;
+static volatile uint8_t g_active;
+static uint32_t         g_records;
+static uint32_t         g_dropped;
+
+static uint32_t put_leb128(uint8_t *p, uint64_t v)
+{
+    uint32_t n = 0;
+
+    while (v >= 0x80U) {
+        p[n++] = (uint8_t)(v | 0x80U);
+        v >>= 7;
+    }
+
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static void put_le32(uint8_t *p, const uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+/* Reserve space of a record and write its tag and time. This must be
+ * called in critical section. Returns NULL when the buffer is full. */
+static uint8_t *rec_begin(const uint8_t tag, const uint32_t body)
+{
+    uint64_t now = AKH_GetTimeNs();
+    uint8_t  *p;
+
+    if (g_len + AKH_TRACE_REC_OVERHEAD + body > AKH_TRACE_BUF_SIZE) {
+        g_dropped++;
+        return NULL;
+    }
+
+    /* keep the delta unsigned even if the timebase was adjusted */
+    if (now < g_last_ns) {
+        now = g_last_ns;
+    }
+
+    p = &g_buf[g_len];
+    *p++ = tag;
+    p += put_leb128(p, now - g_last_ns);
+    g_last_ns = now;
+    g_records++;
+
+    return p;
+}
+
+static void rec_end(const uint8_t *p)
+{
+    g_len = (uint32_t)(p - g_buf);
+}
+#endif
+
+void AKH_Trace_Xfer(
+    const uint8_t         kind,
+    const AKH_HANDLE      dev,
+    const uint8_t         address,
+    const uint8_t         *data,
+    const uint16_t        len,
+    const int16_t         result)
+{
+#ifdef AKH_USE_TRACE
+    uint8_t *p;
+
+    if (g_active == 0U) {
+        return;
+    }
+
+    core_util_critical_section_enter();
+
+    if (result == AKM_SUCCESS) {
+        p = rec_begin(kind, len);
+    } else {
+        p = rec_begin(kind | AKH_TRACE_FAILED, 1);
+    }
+
+    if (p != NULL) {
+        *p++ = (uint8_t)dev;
+        *p++ = address;
+        p += put_leb128(p, len);
+
+        if (result == AKM_SUCCESS) {
+            memcpy(p, data, len);
+            p += len;
+        } else {
+            *p++ = (uint8_t)(int8_t)result;
+        }
+
+        rec_end(p);
+    }
+
+    core_util_critical_section_exit();
+#endif
+}
+
+void AKH_Trace_IRQ(const AKH_IRQ irq)
+{
+#ifdef AKH_USE_TRACE
+    uint8_t *p;
+
+    if (g_active == 0U) {
+        return;
+    }
+
+    core_util_critical_section_enter();
+    p = rec_begin(AKH_TRACE_IRQ, 0);
+
+    if (p != NULL) {
+        *p++ = (uint8_t)irq;
+        rec_end(p);
+    }
+
+    core_util_critical_section_exit();
+#endif
+}
+
+void AKH_Trace_Input(
+    const uint8_t  *data,
+    const uint16_t len)
+{
+#ifdef AKH_USE_TRACE
+    uint8_t *p;
+
+    if (g_active == 0U) {
+        return;
+    }
+
+    core_util_critical_section_enter();
+    p = rec_begin(AKH_TRACE_INPUT, len);
+
+    if (p != NULL) {
+        p += put_leb128(p, len);
+        memcpy(p, data, len);
+        p += len;
+        rec_end(p);
+    }
+
+    core_util_critical_section_exit();
+#endif
+}
+
+static int16_t get_leb128(
+    const uint8_t  *buf,
+    const uint32_t end,
+    uint32_t       *pos,
+    uint64_t       *value)
+{
+    uint64_t v = 0;
+    uint8_t  shift = 0;
+    uint8_t  b;
+
+    do {
+        if ((*pos >= end) || (shift > 63)) {
+            return AKM_ERROR;
+        }
+
+        b = buf[(*pos)++];
+        v |= (uint64_t)(b & 0x7FU) << shift;
+        shift += 7;
+    } while ((b & 0x80U) != 0U);
+
+    *value = v;
+    return AKM_SUCCESS;
+}
+
+int16_t AKH_Trace_Find(
+    const uint8_t  *buf,
+    const uint32_t size,
+    uint32_t       *offset,
+    uint32_t       *length)
+{
+    uint32_t i;
+    uint32_t len;
+
+    for (i = 0; i + AKH_TRACE_HEADER_SIZE <= size; i++) {
+        if ((memcmp(&buf[i], AKH_TRACE_MAGIC, 4) != 0) ||
+            (buf[i + 4] != AKH_TRACE_VERSION)) {
+            continue;
+        }
+
+        len = (uint32_t)buf[i + 6] | ((uint32_t)buf[i + 7] << 8) |
+              ((uint32_t)buf[i + 8] << 16) | ((uint32_t)buf[i + 9] << 24);
+
+        if (len > size - i - AKH_TRACE_HEADER_SIZE) {
+            /* the capture was cut off */
+            len = size - i - AKH_TRACE_HEADER_SIZE;
+        }
+
+        *offset = i + AKH_TRACE_HEADER_SIZE;
+        *length = len;
+        return AKM_SUCCESS;
+    }
+
+    return AKM_ERROR;
+}
+
+int16_t AKH_Trace_Next(
+    const uint8_t        *buf,
+    const uint32_t       end,
+    uint32_t             *pos,
+    struct akh_trace_rec *rec)
+{
+    uint32_t p = *pos;
+    uint64_t v;
+    uint8_t  tag;
+
+    if (p >= end) {
+        return AKM_ERROR;
+    }
+
+    tag = buf[p++];
+
+    if (get_leb128(buf, end, &p, &v) != AKM_SUCCESS) {
+        return AKM_ERROR;
+    }
+
+    rec->kind = tag & AKH_TRACE_KIND_MASK;
+    rec->time_ns += v;
+    rec->result = AKM_SUCCESS;
+    rec->len = 0;
+    rec->data = NULL;
+
+    switch (rec->kind) {
+    case AKH_TRACE_TX:
+    case AKH_TRACE_RX:
+        if (p + 2 > end) {
+            return AKM_ERROR;
+        }
+
+        rec->dev = buf[p++];
+        rec->address = buf[p++];
+
+        if ((get_leb128(buf, end, &p, &v) != AKM_SUCCESS) || (v > 0xFFFFU)) {
+            return AKM_ERROR;
+        }
+
+        rec->len = (uint16_t)v;
+
+        if ((tag & AKH_TRACE_FAILED) != 0U) {
+            if (p + 1 > end) {
+                return AKM_ERROR;
+            }
+
+            rec->result = (int8_t)buf[p++];
+        } else {
+            if (p + rec->len > end) {
+                return AKM_ERROR;
+            }
+
+            rec->data = &buf[p];
+            p += rec->len;
+        }
+        break;
+
+    case AKH_TRACE_IRQ:
+        if (p + 1 > end) {
+            return AKM_ERROR;
+        }
+
+        rec->irq = buf[p++];
+        break;
+
+    case AKH_TRACE_INPUT:
+        if ((get_leb128(buf, end, &p, &v) != AKM_SUCCESS) ||
+            (v > 0xFFFFU) || (p + v > end)) {
+            return AKM_ERROR;
+        }
+
+        rec->len = (uint16_t)v;
+        rec->data = &buf[p];
+        p += rec->len;
+        break;
+
+    default:
+        return AKM_ERROR;
+    }
+
+    *pos = p;
+    return AKM_SUCCESS;
+}
+
+/******************************************************************************/
+/***** AKH public APIs ********************************************************/
+int16_t AKH_TraceStart(void)
+{
+#ifdef AKH_USE_TRACE
+    g_active = 0U;
+
+    core_util_critical_section_enter();
+    memcpy(g_buf, AKH_TRACE_MAGIC, 4);
+    g_buf[4] = AKH_TRACE_VERSION;
+    g_buf[5] = 0;
+    put_le32(&g_buf[6], 0);
+    g_len = AKH_TRACE_HEADER_SIZE;
+    g_last_ns = AKH_GetTimeNs();
+    g_records = 0;
+    g_dropped = 0;
+    core_util_critical_section_exit();
+
+    g_active = 1U;
+    return AKM_SUCCESS;
+#else
+    return AKM_ERR_NOT_SUPPORT;
+#endif
+}
+
+int16_t AKH_TraceStop(void)
+{
+#ifdef AKH_USE_TRACE
+    g_active = 0U;
+    return AKM_SUCCESS;
+#else
+    return AKM_ERR_NOT_SUPPORT;
+#endif
+}
+
+int16_t AKH_TraceGet(
+    const uint8_t **data,
+    uint32_t      *len)
+{
+#ifdef AKH_USE_TRACE
+    if (g_active != 0U) {
+        return AKM_ERR_BUSY;
+    }
+
+    if (g_len == 0U) {
+        return AKM_ERROR;
+    }
+
+    put_le32(&g_buf[6], g_len - AKH_TRACE_HEADER_SIZE);
+    *data = g_buf;
+    *len = g_len;
+    return AKM_SUCCESS;
+#else
+    return AKM_ERR_NOT_SUPPORT;
+#endif
+}
+
+int16_t AKH_GetTraceStats(struct AKH_TRACE_STATS *stats)
+{
+#ifdef AKH_USE_TRACE
+    core_util_critical_section_enter();
+    stats->records = g_records;
+    stats->bytes = g_len;
+    stats->dropped = g_dropped;
+    core_util_critical_section_exit();
+    return AKM_SUCCESS;
+#else
+    return AKM_ERR_NOT_SUPPORT;
+#endif
+}
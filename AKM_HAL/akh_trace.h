@@ -0,0 +1,101 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+#ifndef INCLUDE_AKH_TRACE_H
+#define INCLUDE_AKH_TRACE_H
+
+#include "AKM_Common.h"
+#include "AKH_APIs.h"
+
+/* Trace format (all multi-byte fields are little endian):
+ *
+ *   header : "AKTR", version (1 byte), reserved (1 byte),
+ *            length of records in bytes (4 bytes)
+ *   record : tag (1 byte), time since previous record in nano seconds
+ *            (unsigned LEB128), then body of each kind.
+ *
+ *   TX, RX : device handle (1 byte), register address (1 byte),
+ *            length (LEB128), then the data bytes. When the transfer
+ *            failed, AKH_TRACE_FAILED is set to the tag and the result
+ *            code (1 byte, signed) is stored instead of the data.
+ *   IRQ    : AKH_IRQ (1 byte)
+ *   INPUT  : length (LEB128), then console input bytes
+ *
+ * Time of a transfer is the time when it completed. Records are in order
+ * of time, so that data ready interrupts which came in the middle of a
+ * transfer are recorded before the transfer. */
+#define AKH_TRACE_MAGIC        "AKTR"
+#define AKH_TRACE_VERSION      2
+#define AKH_TRACE_HEADER_SIZE  10
+
+#define AKH_TRACE_TX           0x01
+#define AKH_TRACE_RX           0x02
+#define AKH_TRACE_IRQ          0x03
+#define AKH_TRACE_INPUT        0x04
+#define AKH_TRACE_KIND_MASK    0x0F
+#define AKH_TRACE_FAILED       0x80
+
+/* One decoded record. data points into the trace buffer. */
+struct akh_trace_rec {
+    uint8_t        kind;
+    uint8_t        dev;
+    uint8_t        address;
+    uint8_t        irq;
+    int16_t        result;
+    uint16_t       len;
+    uint64_t       time_ns;
+    const uint8_t  *data;
+};
+
+void AKH_Trace_Xfer(
+    const uint8_t         kind,
+    const AKH_HANDLE      dev,
+    const uint8_t         address,
+    const uint8_t         *data,
+    const uint16_t        len,
+    const int16_t         result
+);
+
+void AKH_Trace_IRQ(
+    const AKH_IRQ irq
+);
+
+void AKH_Trace_Input(
+    const uint8_t  *data,
+    const uint16_t len
+);
+
+/* Find the header in buf (e.g. a capture of UART output), and return the
+ * offset of the first record and the length of the records. */
+int16_t AKH_Trace_Find(
+    const uint8_t  *buf,
+    const uint32_t size,
+    uint32_t       *offset,
+    uint32_t       *length
+);
+
+/* Decode the record at *pos and move *pos to the next one. time_ns is
+ * accumulated to rec->time_ns, so keep rec between the calls. */
+int16_t AKH_Trace_Next(
+    const uint8_t        *buf,
+    const uint32_t       end,
+    uint32_t             *pos,
+    struct akh_trace_rec *rec
+);
+
+#endif /* INCLUDE_AKH_TRACE_H */
@@ -0,0 +1,355 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+#include "mbed.h"
+#include "AKH_APIs.h"
+#include "akh_cache.h"
+
+/* Phase of read-modify-write step. */
+#define RMW_IDLE   0
+#define RMW_READ   1
+#define RMW_WRITE  2
+
+/* A step which finds the bus busy is tried again after this time. */
+#define BUSY_RETRY_MS   1
+#define BUSY_RETRY_MAX  10
+
+static struct AKH_TRANSACTION_STEP *append_step(
+    struct AKH_TRANSACTION   *tr,
+    const AKH_TRANSACTION_OP op)
+{
+    struct AKH_TRANSACTION_STEP *step;
+
+    if (tr->num_of_steps >= AKH_TRANSACTION_MAX_STEPS) {
+        tr->status = AKM_ERR_INVALID_ARG;
+        return NULL;
+    }
+
+    step = &tr->steps[tr->num_of_steps++];
+    step->op = op;
+    step->address = 0;
+    step->value = 0;
+    step->mask = 0;
+    step->data = NULL;
+    step->len = 0;
+    step->delay_us = 0;
+    return step;
+}
+
+static void delay_us(const uint32_t us)
+{
+    if (us >= 1000) {
+        AKH_DelayMilli((uint16_t)(us / 1000));
+    }
+
+    if ((us % 1000) != 0) {
+        AKH_DelayMicro((uint16_t)(us % 1000));
+    }
+}
+
+void AKH_TransactionInit(
+    struct AKH_TRANSACTION *tr,
+    const AKH_HANDLE       dev)
+{
+    tr->dev = dev;
+    tr->num_of_steps = 0;
+    tr->status = AKM_SUCCESS;
+    tr->cursor = 0;
+    tr->rmw = RMW_IDLE;
+    tr->retries = 0;
+    tr->callback = NULL;
+    tr->arg = NULL;
+}
+
+void AKH_TransactionWrite(
+    struct AKH_TRANSACTION *tr,
+    const uint8_t          address,
+    const uint8_t          value)
+{
+    struct AKH_TRANSACTION_STEP *step = append_step(tr, AKH_TR_WRITE);
+
+    if (step != NULL) {
+        step->address = address;
+        step->value = value;
+        step->len = 1;
+    }
+}
+
+void AKH_TransactionRead(
+    struct AKH_TRANSACTION *tr,
+    const uint8_t          address,
+    uint8_t                *data,
+    const uint16_t         numberOfBytesToRead)
+{
+    struct AKH_TRANSACTION_STEP *step = append_step(tr, AKH_TR_READ);
+
+    if (step != NULL) {
+        step->address = address;
+        step->data = data;
+        step->len = numberOfBytesToRead;
+    }
+}
+
+void AKH_TransactionUpdate(
+    struct AKH_TRANSACTION *tr,
+    const uint8_t          address,
+    const uint8_t          mask,
+    const uint8_t          value)
+{
+    struct AKH_TRANSACTION_STEP *step = append_step(tr, AKH_TR_UPDATE);
+
+    if (step != NULL) {
+        step->address = address;
+        step->mask = mask;
+        step->value = value & mask;
+        step->len = 1;
+    }
+}
+
+void AKH_TransactionDelay(
+    struct AKH_TRANSACTION *tr,
+    const uint32_t         us)
+{
+    struct AKH_TRANSACTION_STEP *step = append_step(tr, AKH_TR_DELAY);
+
+    if (step != NULL) {
+        step->delay_us = us;
+    }
+}
+
+/* Execute steps from 'first' with blocking access. */
+static int16_t run_steps(
+    struct AKH_TRANSACTION *tr,
+    const uint8_t          first)
+{
+    struct AKH_TRANSACTION_STEP *step;
+    uint8_t                     i;
+    int16_t                     fret;
+
+    for (i = first; i < tr->num_of_steps; i++) {
+        step = &tr->steps[i];
+        fret = AKM_SUCCESS;
+
+        switch (step->op) {
+        case AKH_TR_WRITE:
+            fret = AKH_TxData(tr->dev, step->address, &step->value, 1);
+            break;
+
+        case AKH_TR_READ:
+            fret = AKH_RxData(tr->dev, step->address, step->data, step->len);
+            break;
+
+        case AKH_TR_UPDATE:
+            fret = AKH_UpdateBits(
+                    tr->dev, step->address, step->mask, step->value);
+            break;
+
+        case AKH_TR_DELAY:
+            delay_us(step->delay_us);
+            break;
+
+        default:
+            fret = AKM_ERR_INVALID_ARG;
+            break;
+        }
+
+        if (fret != AKM_SUCCESS) {
+            return fret;
+        }
+    }
+
+    return AKM_SUCCESS;
+}
+
+int16_t AKH_TransactionRun(struct AKH_TRANSACTION *tr)
+{
+    if (tr->status != AKM_SUCCESS) {
+        return tr->status;
+    }
+
+    return run_steps(tr, 0);
+}
+
+/***** asynchronous execution *************************************************/
+static void run_next(struct AKH_TRANSACTION *tr);
+
+static void finish(
+    struct AKH_TRANSACTION *tr,
+    const int16_t          result)
+{
+    AKH_XFER_CALLBACK cb = tr->callback;
+
+    tr->callback = NULL;
+
+    if (cb != NULL) {
+        cb(result, tr->arg);
+    }
+}
+
+/* Completion of each bus transfer. This is called in thread context. */
+static void step_done(const int16_t result, void *arg)
+{
+    struct AKH_TRANSACTION      *tr = (struct AKH_TRANSACTION *)arg;
+    struct AKH_TRANSACTION_STEP *step = &tr->steps[tr->cursor];
+
+    if (result != AKM_SUCCESS) {
+        finish(tr, result);
+        return;
+    }
+
+    /* asynchronous write is not cached by the HAL, so store it here */
+    if (step->op == AKH_TR_WRITE) {
+        AKH_Cache_Store(tr->dev, step->address, &step->value, 1);
+    } else if ((step->op == AKH_TR_UPDATE) && (tr->rmw == RMW_WRITE)) {
+        AKH_Cache_Store(tr->dev, step->address, &tr->buf, 1);
+    }
+
+    if ((step->op == AKH_TR_UPDATE) && (tr->rmw == RMW_READ)) {
+        /* write back only when any bit is changed */
+        if ((tr->buf & step->mask) != step->value) {
+            tr->buf = (tr->buf & ~step->mask) | step->value;
+            tr->rmw = RMW_WRITE;
+            run_next(tr);
+            return;
+        }
+    }
+
+    tr->rmw = RMW_IDLE;
+    tr->retries = 0;
+    tr->cursor++;
+    run_next(tr);
+}
+
+static void run_next(struct AKH_TRANSACTION *tr)
+{
+    struct AKH_TRANSACTION_STEP *step;
+    int16_t                     fret;
+    uint32_t                    ms;
+
+    if (tr->cursor >= tr->num_of_steps) {
+        finish(tr, AKM_SUCCESS);
+        return;
+    }
+
+    step = &tr->steps[tr->cursor];
+
+    switch (step->op) {
+    case AKH_TR_WRITE:
+        fret = AKH_TxDataAsync(
+                tr->dev, step->address, &step->value, 1, step_done, tr);
+        break;
+
+    case AKH_TR_READ:
+        fret = AKH_RxDataAsync(
+                tr->dev, step->address, step->data, step->len,
+                step_done, tr);
+        break;
+
+    case AKH_TR_UPDATE:
+        if (tr->rmw == RMW_IDLE) {
+            tr->rmw = RMW_READ;
+
+            /* shadow cache saves the read */
+            if (AKH_Cache_Lookup(tr->dev, step->address, &tr->buf)) {
+                step_done(AKM_SUCCESS, tr);
+                return;
+            }
+
+            fret = AKH_RxDataAsync(
+                    tr->dev, step->address, &tr->buf, 1, step_done, tr);
+        } else {
+            fret = AKH_TxDataAsync(
+                    tr->dev, step->address, &tr->buf, 1, step_done, tr);
+        }
+
+        break;
+
+    case AKH_TR_DELAY:
+        /* event queue has milli-second resolution, so round up */
+        ms = (step->delay_us + 999) / 1000;
+        tr->cursor++;
+
+        if (mbed_highprio_event_queue()->call_in(
+                std::chrono::milliseconds(ms), run_next, tr) == 0) {
+            fret = AKM_ERR_BUSY;
+        } else {
+            fret = AKM_SUCCESS;
+        }
+
+        break;
+
+    default:
+        fret = AKM_ERR_INVALID_ARG;
+        break;
+    }
+
+    if ((fret == AKM_ERR_BUSY) && (step->op != AKH_TR_DELAY) &&
+        (tr->retries < BUSY_RETRY_MAX)) {
+        /* other transfer is in flight, so start the step again later */
+        tr->retries++;
+
+        if (tr->rmw == RMW_READ) {
+            tr->rmw = RMW_IDLE;
+        }
+
+        if (mbed_highprio_event_queue()->call_in(
+                std::chrono::milliseconds(BUSY_RETRY_MS), run_next, tr) != 0) {
+            return;
+        }
+    }
+
+    if (fret == AKM_ERR_NOT_SUPPORT) {
+        /* the bus has blocking access only */
+        fret = run_steps(tr, tr->cursor);
+        finish(tr, fret);
+        return;
+    }
+
+    if (fret != AKM_SUCCESS) {
+        finish(tr, fret);
+    }
+}
+
+int16_t AKH_TransactionRunAsync(
+    struct AKH_TRANSACTION  *tr,
+    const AKH_XFER_CALLBACK callback,
+    void                    *arg)
+{
+    if (tr->status != AKM_SUCCESS) {
+        return tr->status;
+    }
+
+    if (tr->callback != NULL) {
+        return AKM_ERR_BUSY;
+    }
+
+    tr->cursor = 0;
+    tr->rmw = RMW_IDLE;
+    tr->retries = 0;
+    tr->callback = callback;
+    tr->arg = arg;
+
+    /* start from thread context, so that the callback is never called
+     * before this function returns. */
+    if (mbed_highprio_event_queue()->call(run_next, tr) == 0) {
+        tr->callback = NULL;
+        return AKM_ERR_BUSY;
+    }
+
+    return AKM_SUCCESS;
+}
@@ -221,7 +221,9 @@ int16_t akl_getv_quat(
 uint32_t AKL_GetParameterSize(const uint8_t max_form)
 {
     /* form is not used */
-    return byte_allign(sizeof(struct AKL_SCL_PRMS));
+    /* NV parameter is placed right after the struct (see AKL_Init). */
+    return byte_allign(sizeof(struct AKL_SCL_PRMS)) +
+           byte_allign(sizeof(struct AKL_NV_PRMS));
 }
 
 /*****************************************************************************/
@@ -353,7 +355,7 @@ int16_t AKL_SetVector(
         }
 
         if (ret != AKM_SUCCESS) {
-             AKH_Print("AKL_SetVector: Error in setting vector at index %d\n", i);
+             AKH_Log("AKL_SetVector: Error in setting vector at index %d\n", i);
             return ret;
         }
     }
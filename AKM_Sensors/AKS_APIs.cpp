@@ -26,61 +26,80 @@
 #include "aks_mag_ak0994x.h"
 #include "aks_mag_ak099xx.h"
 #include "aks_mag_ak8963.h"
+#include "ak0994x_register.h"
+#include "ak099xx_register.h"
+#include "ak8963_register.h"
 #include <stdint.h>
+#include <string.h>
 
-#define MEASUREMENT_SIZE 10 // 평균을 낼 데이터 개수
+#define NUMBER_OF_SLOT  AKH_MAX_DEVICES
 
-// 평균 계산을 위한 변수
-static int32_t sum_x = 0;
-static int32_t sum_y = 0;
-static int32_t sum_z = 0;
-static uint8_t measurement_index = 0; // 평균을 계산할 데이터 개수
+/* ID register which is read by auto-detection. */
+#define DETECT_NO_REG   0xFFU
+#define DETECT_ID_SIZE  2U
 
-
-
-#define NUMBER_OF_SLOT  3
+typedef int16_t (*aks_config_func)(
+    const AKH_HANDLE     handle,
+    struct aks_context   **ctx,
+    struct aks_interface **interface
+);
 
 struct aks_sensor_slot {
     AKM_SENSOR_TYPE      type;
-    AKM_DEVICES          dev;
+    struct aks_context   *ctx;
     struct aks_interface *interface;
+    /* parameters of the last AKS_Init and AKS_Start, used to reset the
+     * sensor alone. interval_us is 0 when the sensor is stopped. */
+    uint8_t              axis_order[3];
+    uint8_t              axis_sign[3];
+    int32_t              interval_us;
 };
 
 static int16_t no_device_init(
-    const uint8_t axis_order[3],
-    const uint8_t axis_sign[3])
+    struct aks_context *ctx,
+    const uint8_t      axis_order[3],
+    const uint8_t      axis_sign[3])
 {
     return AKM_ERR_NOT_SUPPORT;
 }
 
-static int16_t no_device_get_info(struct AKS_DEVICE_INFO *info)
+static int16_t no_device_get_info(
+    struct aks_context     *ctx,
+    struct AKS_DEVICE_INFO *info)
 {
     return AKM_ERR_NOT_SUPPORT;
 }
 
-static int16_t no_device_start(const int32_t interval_us)
+static int16_t no_device_start(
+    struct aks_context *ctx,
+    const int32_t      interval_us)
 {
     return AKM_ERR_NOT_SUPPORT;
 }
 
-static int16_t no_device_stop(void)
+static int16_t no_device_stop(struct aks_context *ctx)
 {
     return AKM_ERR_NOT_SUPPORT;
 }
 
-static int16_t no_device_check_rdy(const int32_t timeout_us)
+static int16_t no_device_check_rdy(
+    struct aks_context *ctx,
+    const int32_t      timeout_us)
 {
     return AKM_ERR_NOT_SUPPORT;
 }
 
 static int16_t no_device_get_data(
+    struct aks_context     *ctx,
     struct AKM_SENSOR_DATA *data,
     uint8_t                *num)
 {
     return AKM_ERR_NOT_SUPPORT;
 }
 
-static int16_t no_device_self_test(int32_t *result)
+static int16_t no_device_self_test(
+    struct aks_context *ctx,
+    int32_t            *result)
 {
     return AKM_ERR_NOT_SUPPORT;
 }
@@ -96,32 +115,105 @@ static struct aks_interface no_device_interface = {
     .aks_self_test = no_device_self_test
 };
 
+/* Signature of a part. The ID register is read in DETECT_ID_SIZE bytes,
+ * and the first len bytes of it are compared with value (the first byte
+ * at LSB). */
+struct aks_signature {
+    AKM_DEVICES device;
+    uint8_t     reg;
+    uint8_t     len;
+    uint16_t    value;
+};
+
+/* Entries of the same register are put together, so that each address is
+ * read at most once per register. AK8963 has no WIA2, so it comes after
+ * the other AKM parts which share WIA1. AK09915D is told from AK09915 by
+ * the driver. */
+static const struct aks_signature g_signatures[] = {
+    { AKM_MAGNETOMETER_AK09940A, AK0994X_REG_WIA1, 2, AK09940A_WIA_VAL },
+    { AKM_MAGNETOMETER_AK09911,  AK099XX_REG_WIA1, 2, AK09911_WIA_VAL },
+    { AKM_MAGNETOMETER_AK09912,  AK099XX_REG_WIA1, 2, AK09912_WIA_VAL },
+    { AKM_MAGNETOMETER_AK09913,  AK099XX_REG_WIA1, 2, AK09913_WIA_VAL },
+    { AKM_MAGNETOMETER_AK09915,  AK099XX_REG_WIA1, 2, AK09915_WIA_VAL },
+    { AKM_MAGNETOMETER_AK09916C, AK099XX_REG_WIA1, 2, AK09916C_WIA_VAL },
+    { AKM_MAGNETOMETER_AK09916D, AK099XX_REG_WIA1, 2, AK09916D_WIA_VAL },
+    { AKM_MAGNETOMETER_AK09917D, AK099XX_REG_WIA1, 2, AK09917D_WIA_VAL },
+    { AKM_MAGNETOMETER_AK09918,  AK099XX_REG_WIA1, 2, AK09918_WIA_VAL },
+    { AKM_MAGNETOMETER_AK09919,  AK099XX_REG_WIA1, 2, AK09919_WIA_VAL },
+    { AKM_MAGNETOMETER_AK8963,   AK8963_REG_WIA,   1, AK8963_WIA_VAL },
+    { AKM_ACCELEROMETER_ADXL345, ADXL34X_REG_DEVID,     1,
+      ADXL34X_VAL_DEVID_ADXL345 },
+    { AKM_ACCELEROMETER_ADXL346, ADXL34X_REG_DEVID,     1,
+      ADXL34X_VAL_DEVID_ADXL346 },
+    { AKM_ACCELEROMETER_BMI160,  BMI160_REG_CHIPID,     1,
+      BMI160_VAL_CHIPID },
+    { AKM_GYROSCOPE_L3G4200D,    L3G4200D_REG_WHO_AM_I, 1,
+      WHOAMI_VAL_L3G4200D },
+    { AKM_GYROSCOPE_L3GD20,      L3G4200D_REG_WHO_AM_I, 1,
+      WHOAMI_VAL_L3GD20 },
+};
+
+/* Addresses which are scanned by auto-detection. */
+#ifdef AKH_USE_SPI
+/* Chip select index. Each one is wired to a sensor type. */
+static const uint8_t g_detect_addr[] = { 0, 1, 2 };
+#else
+/* 8-bit form. AKM magnetometers (CAD pins), ADXL34x (ALT ADDRESS pin),
+ * BMI160 and L3G4200D (SDO pin), L3GD20 (SA0 pin). */
+static const uint8_t g_detect_addr[] = {
+    0x18, 0x1A, 0x1C, 0x1E, 0xA6, 0x3A, 0xD0, 0xD2, 0xD4, 0xD6
+};
+#endif
+
 /* sensor slots */
 static struct aks_sensor_slot g_slots[NUMBER_OF_SLOT];
 static uint8_t                g_num_of_device = 0;
 
+/* Phase of the restart which runs in the background. */
+#define RESTART_IDLE      0U
+#define RESTART_INIT      1U
+#define RESTART_START     2U
+#define RESTART_SIBLINGS  3U
+
+static struct {
+    uint8_t                phase;
+    uint8_t                sensor;
+    /* The slot from which the next sibling is searched. */
+    uint8_t                next;
+    int32_t                interval_us;
+    AKH_XFER_CALLBACK      callback;
+    void                   *arg;
+    /* Empty. It moves the first phase to thread context. */
+    struct AKH_TRANSACTION tr;
+} g_restart;
+
 static void aks_slot_init(struct aks_sensor_slot *slots)
 {
     uint8_t i;
 
     for (i = 0; i < NUMBER_OF_SLOT; i++) {
         slots->type = AKM_ST_NONE;
-        slots->dev = AKM_DEVICE_NONE;
+        slots->ctx = NULL;
         slots->interface = &no_device_interface;
+        slots->interval_us = 0;
         slots++;
     }
 
     g_num_of_device = 0;
+    AKH_ClearDevices();
 }
 
-int16_t AKS_Config(
-    const uint8_t     num,
-    const AKM_DEVICES dev[])
+int16_t AKS_ConfigDevices(
+    const uint8_t                num,
+    const struct AKH_DEVICE_DESC desc[])
 {
     uint8_t                i;
     uint8_t                slot_id;
     int16_t                ret;
     struct aks_sensor_slot *slot;
+    aks_config_func        config;
+    AKM_SENSOR_TYPE        type;
+    AKH_HANDLE             handle;
 
     AKH_Print("AKS_Config: Start\n");
     /* initialize slots */
@@ -130,18 +222,18 @@ int16_t AKS_Config(
     slot_id = 0;
 
     for (i = 0; i < num; i++) {
+        /* if slot is already full, exit */
+        if (slot_id >= NUMBER_OF_SLOT) {
+            break;
+        }
+
         slot = &g_slots[slot_id];
 
-        switch (dev[i]) {
+        switch (desc[i].device) {
         case AKM_MAGNETOMETER_AK8963:
             AKH_Print("AKS_Config: Configuring AKM_MAGNETOMETER_AK8963\n");
-            ret = ak8963_config(&slot->dev, &slot->interface);
-
-            if (ret == AKM_SUCCESS) {
-                slot->type = AKM_ST_MAG;
-                g_num_of_device = ++slot_id;
-            }
-
+            config = ak8963_config;
+            type = AKM_ST_MAG;
             break;
 
         case AKM_MAGNETOMETER_AK09911:
@@ -154,70 +246,40 @@ int16_t AKS_Config(
         case AKM_MAGNETOMETER_AK09918:
         case AKM_MAGNETOMETER_AK09919:
             AKH_Print("AKS_Config: Configuring AKM_MAGNETOMETER_AK099xx\n");
-            ret = ak099xx_config(&slot->dev, &slot->interface);
-
-            if (ret == AKM_SUCCESS) {
-                slot->type = AKM_ST_MAG;
-                g_num_of_device = ++slot_id;
-            }
-
+            config = ak099xx_config;
+            type = AKM_ST_MAG;
             break;
 
         case AKM_MAGNETOMETER_AK09940A:
             AKH_Print("AKS_Config: Configuring AKM_MAGNETOMETER_AK09940A\n");
-            ret = ak0994x_config(&slot->dev, &slot->interface);
-
-            if (ret == AKM_SUCCESS) {
-                slot->type = AKM_ST_MAG;
-                g_num_of_device = ++slot_id;
-            }
-
+            config = ak0994x_config;
+            type = AKM_ST_MAG;
             break;
 
         case AKM_ACCELEROMETER_ADXL345:
         case AKM_ACCELEROMETER_ADXL346:
             AKH_Print("AKS_Config: Configuring AKM_ACCELEROMETER_ADXL34x\n");
-            ret = adxl34x_config(&slot->dev, &slot->interface);
-
-            if (ret == AKM_SUCCESS) {
-                slot->type = AKM_ST_ACC;
-                g_num_of_device = ++slot_id;
-            }
-
+            config = adxl34x_config;
+            type = AKM_ST_ACC;
             break;
 
         case AKM_ACCELEROMETER_BMI160:
             AKH_Print("AKS_Config: Configuring AKM_ACCELEROMETER_BMI160\n");
-            ret = bmi160_acc_config(&slot->dev, &slot->interface);
-
-            if (ret == AKM_SUCCESS) {
-                slot->type = AKM_ST_ACC;
-                g_num_of_device = ++slot_id;
-            }
-
+            config = bmi160_acc_config;
+            type = AKM_ST_ACC;
             break;
 
         case AKM_GYROSCOPE_L3G4200D:
         case AKM_GYROSCOPE_L3GD20:
             AKH_Print("AKS_Config: Configuring AKM_GYROSCOPE_L3G4xx\n");
-            ret = l3g4200d_config(&slot->dev, &slot->interface);
-
-            if (ret == AKM_SUCCESS) {
-                slot->type = AKM_ST_GYR;
-                g_num_of_device = ++slot_id;
-            }
-
+            config = l3g4200d_config;
+            type = AKM_ST_GYR;
             break;
 
         case AKM_GYROSCOPE_BMI160:
             AKH_Print("AKS_Config: Configuring AKM_GYROSCOPE_BMI160\n");
-            ret = bmi160_gyr_config(&slot->dev, &slot->interface);
-
-            if (ret == AKM_SUCCESS) {
-                slot->type = AKM_ST_GYR;
-                g_num_of_device = ++slot_id;
-            }
-
+            config = bmi160_gyr_config;
+            type = AKM_ST_GYR;
             break;
 
         case AKM_DEVICE_NONE:
@@ -228,7 +290,7 @@ int16_t AKS_Config(
         case AKM_DEVICE_TEST:
             /* put some test sensor here. */
             AKH_Print("AKS_Config: Configuring AKM_DEVICE_TEST\n");
-            break;
+            continue;
 
         default:
             /* unknown parameter */
@@ -236,16 +298,136 @@ int16_t AKS_Config(
             return AKM_ERR_INVALID_ARG;
         }
 
-        /* if slot is already full, exit */
-        if (slot_id > NUMBER_OF_SLOT) {
-            break;
+        ret = AKH_AddDevice(&desc[i], &handle);
+
+        if (ret != AKM_SUCCESS) {
+            AKH_Print("AKS_Config: Invalid bus address 0x%02X\n",
+                      desc[i].address);
+            continue;
+        }
+
+        ret = config(handle, &slot->ctx, &slot->interface);
+
+        if (ret != AKM_SUCCESS) {
+            /* the entry would take a handle without a driver */
+            (void)AKH_RemoveDevice(handle);
+            continue;
         }
+
+        slot->type = type;
+        g_num_of_device = ++slot_id;
     }
 
     AKH_Print("AKS_Config: End with %d devices configured\n", g_num_of_device);
     return g_num_of_device;
 }
 
+int16_t AKS_Config(
+    const uint8_t     num,
+    const AKM_DEVICES dev[])
+{
+    struct AKH_DEVICE_DESC desc[NUMBER_OF_SLOT];
+    uint8_t                i;
+
+    if (num > NUMBER_OF_SLOT) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    for (i = 0; i < num; i++) {
+        desc[i].device = dev[i];
+        desc[i].address = AKH_ADDRESS_DEFAULT;
+    }
+
+    return AKS_ConfigDevices(num, desc);
+}
+
+/* Match the ID registers of a device against the signatures.
+ * Returns AKM_DEVICE_NONE when nothing answers or nothing matches. */
+static AKM_DEVICES aks_detect(const AKH_HANDLE handle)
+{
+    const struct aks_signature *sig;
+    uint8_t                    id[DETECT_ID_SIZE];
+    uint8_t                    id_reg;
+    uint16_t                   mask;
+    uint16_t                   val;
+    uint8_t                    i;
+
+    id_reg = DETECT_NO_REG;
+
+    for (i = 0; i < sizeof(g_signatures) / sizeof(g_signatures[0]); i++) {
+        sig = &g_signatures[i];
+
+        if (sig->reg != id_reg) {
+            /* Every supported part answers a read of any register, so
+             * an address which fails one has nothing of them. */
+            if (AKH_ProbeData(handle, sig->reg, id, DETECT_ID_SIZE)
+                != AKM_SUCCESS) {
+                return AKM_DEVICE_NONE;
+            }
+
+            id_reg = sig->reg;
+        }
+
+        val = (((uint16_t)id[1] << 8) | id[0]);
+        mask = (sig->len == 1) ? 0x00FFU : 0xFFFFU;
+
+        if ((val & mask) == sig->value) {
+            return sig->device;
+        }
+    }
+
+    return AKM_DEVICE_NONE;
+}
+
+int16_t AKS_ConfigDetect(void)
+{
+    struct AKH_DEVICE_DESC desc[NUMBER_OF_SLOT];
+    struct AKH_DEVICE_DESC probe;
+    AKH_HANDLE             handle;
+    AKM_DEVICES            found;
+    uint8_t                num;
+    uint8_t                i;
+
+    AKH_Print("AKS_Config: Detecting devices\n");
+    num = 0;
+    probe.device = AKM_DEVICE_NONE;
+
+    for (i = 0; i < sizeof(g_detect_addr); i++) {
+        if (num >= NUMBER_OF_SLOT) {
+            break;
+        }
+
+        /* one temporary entry, it has the default bus profile */
+        AKH_ClearDevices();
+        probe.address = g_detect_addr[i];
+
+        if (AKH_AddDevice(&probe, &handle) != AKM_SUCCESS) {
+            continue;
+        }
+
+        found = aks_detect(handle);
+
+        if (found == AKM_DEVICE_NONE) {
+            continue;
+        }
+
+        AKH_Print("AKS_Config: Found device %d at 0x%02X\n",
+                  found, probe.address);
+        desc[num].device = found;
+        desc[num].address = probe.address;
+        num++;
+
+        /* accelerometer and gyroscope in one package */
+        if ((found == AKM_ACCELEROMETER_BMI160) && (num < NUMBER_OF_SLOT)) {
+            desc[num].device = AKM_GYROSCOPE_BMI160;
+            desc[num].address = probe.address;
+            num++;
+        }
+    }
+
+    return AKS_ConfigDevices(num, desc);
+}
+
 /******************************************************************************/
 /***** AKS debug APIs ********************************************************/
 //int16_t AKS_Get_Error();
@@ -264,7 +446,9 @@ int16_t AKS_Init(
     for (id = 0; id < g_num_of_device; id++) {
         if (stype & slot->type) {
             AKH_Print("AKS_Init: Initializing device %d of type %d\n", id, slot->type);
-            ret = slot->interface->aks_init(axis_order, axis_sign);
+            memcpy(slot->axis_order, axis_order, sizeof(slot->axis_order));
+            memcpy(slot->axis_sign, axis_sign, sizeof(slot->axis_sign));
+            ret = slot->interface->aks_init(slot->ctx, axis_order, axis_sign);
 
             if ((ret != AKM_SUCCESS) && (ret != AKM_ERR_NOT_SUPPORT)) {
                 AKH_Print("AKS_Init: Initialization failed for device %d\n", id);
@@ -298,7 +482,7 @@ int16_t AKS_GetDeviceInfo(
     for (id = 0; id < g_num_of_device; id++) {
         if (stype & slot->type) {
             AKH_Print("AKS_GetDeviceInfo: Getting info for device %d of type %d\n", id, slot->type);
-            ret = slot->interface->aks_get_info(head);
+            ret = slot->interface->aks_get_info(slot->ctx, head);
 
             if (ret == AKM_SUCCESS) {
                 /* it's fine. goto next device */
@@ -331,18 +515,26 @@ int16_t AKS_GetDeviceInfo(
 int16_t AKS_Start(
     const AKM_SENSOR_TYPE stype,
     const int32_t         interval_us)
+{
+    return AKS_StartMulti(AKS_GetSensorMask(stype), interval_us);
+}
+
+int16_t AKS_StartMulti(
+    const uint32_t mask,
+    const int32_t  interval_us)
 {
     uint8_t                id;
     int16_t                ret;
     struct aks_sensor_slot *slot = g_slots;
 
     for (id = 0; id < g_num_of_device; id++) {
-        if (stype & slot->type) {
-            AKH_Print("AKS_Start: Starting device %d of type %d\n", id, slot->type);
-            ret = slot->interface->aks_start(interval_us);
+        if ((mask & ((uint32_t)1 << id)) != 0) {
+            AKH_Log("AKS_Start: Starting device %d of type %d\n", id, slot->type);
+            ret = slot->interface->aks_start(slot->ctx, interval_us);
+            slot->interval_us = (ret == AKM_SUCCESS) ? interval_us : 0;
 
             if ((ret != AKM_SUCCESS) && (ret != AKM_ERR_NOT_SUPPORT)) {
-                AKH_Print("AKS_Start: Failed to start device %d\n", id);
+                AKH_Log("AKS_Start: Failed to start device %d\n", id);
                 return ret;
             }
         }
@@ -350,23 +542,223 @@ int16_t AKS_Start(
         slot++;
     }
 
-    AKH_Print("AKS_Start: All devices started successfully\n");
+    AKH_Log("AKS_Start: All devices started successfully\n");
     return AKM_SUCCESS;
 }
 
+/* Sensors of one package (BMI160) have their own handles at the same
+ * address, and reset of one resets the other. */
+static uint8_t aks_same_package(
+    const struct aks_sensor_slot *a,
+    const struct aks_sensor_slot *b)
+{
+    struct AKH_DEVICE_DESC desc_a;
+    struct AKH_DEVICE_DESC desc_b;
+
+    if (a == b) {
+        return 1;
+    }
+
+    if ((AKH_GetDeviceDesc(a->ctx->handle, &desc_a) != AKM_SUCCESS) ||
+        (AKH_GetDeviceDesc(b->ctx->handle, &desc_b) != AKM_SUCCESS)) {
+        return 0;
+    }
+
+    return (desc_a.address == desc_b.address) ? 1 : 0;
+}
+
+uint32_t AKS_GetSiblingMask(const uint8_t sensor)
+{
+    uint8_t  id;
+    uint32_t mask = 0;
+
+    if (sensor >= g_num_of_device) {
+        return 0;
+    }
+
+    for (id = 0; id < g_num_of_device; id++) {
+        if (aks_same_package(&g_slots[sensor], &g_slots[id])) {
+            mask |= ((uint32_t)1 << id);
+        }
+    }
+
+    return mask;
+}
+
+static void restart_next(const int16_t result, void *unused);
+
+/* Run init of the slot. A driver without background init blocks here,
+ * then the restart goes on at once. */
+static int16_t restart_init(struct aks_sensor_slot *slot)
+{
+    int16_t ret;
+
+    if (slot->interface->aks_init_async != NULL) {
+        return slot->interface->aks_init_async(
+                slot->ctx, slot->axis_order, slot->axis_sign,
+                restart_next, NULL);
+    }
+
+    ret = slot->interface->aks_init(
+            slot->ctx, slot->axis_order, slot->axis_sign);
+
+    if (ret == AKM_SUCCESS) {
+        restart_next(AKM_SUCCESS, NULL);
+    }
+
+    return ret;
+}
+
+/* Same as restart_init() for start. */
+static int16_t restart_start(
+    struct aks_sensor_slot *slot,
+    const int32_t          interval_us)
+{
+    int16_t ret;
+
+    if (slot->interface->aks_start_async != NULL) {
+        return slot->interface->aks_start_async(
+                slot->ctx, interval_us, restart_next, NULL);
+    }
+
+    ret = slot->interface->aks_start(slot->ctx, interval_us);
+
+    if (ret == AKM_SUCCESS) {
+        restart_next(AKM_SUCCESS, NULL);
+    }
+
+    return ret;
+}
+
+static void restart_finish(const int16_t result)
+{
+    g_restart.phase = RESTART_IDLE;
+    g_restart.callback(result, g_restart.arg);
+}
+
+/* Completion of each phase. This is called in thread context. */
+static void restart_next(const int16_t result, void *unused)
+{
+    struct aks_sensor_slot *slot = &g_slots[g_restart.sensor];
+    struct aks_sensor_slot *other;
+    int16_t                ret;
+
+    if (result != AKM_SUCCESS) {
+        restart_finish(result);
+        return;
+    }
+
+    switch (g_restart.phase) {
+    case RESTART_INIT:
+        g_restart.phase = RESTART_START;
+        ret = restart_init(slot);
+        break;
+
+    case RESTART_START:
+        g_restart.phase = RESTART_SIBLINGS;
+        ret = restart_start(slot, g_restart.interval_us);
+        break;
+
+    default:
+        slot->interval_us = g_restart.interval_us;
+
+        /* Reset of the package stopped the others too. Start them
+         * again at their last interval. */
+        for (other = NULL; g_restart.next < g_num_of_device; ) {
+            other = &g_slots[g_restart.next++];
+
+            if ((other != slot) && (other->interval_us != 0) &&
+                aks_same_package(slot, other)) {
+                break;
+            }
+
+            other = NULL;
+        }
+
+        if (other == NULL) {
+            restart_finish(AKM_SUCCESS);
+            return;
+        }
+
+        ret = restart_start(other, other->interval_us);
+        break;
+    }
+
+    if (ret != AKM_SUCCESS) {
+        restart_finish(ret);
+    }
+}
+
+int16_t AKS_Restart(
+    const uint8_t           sensor,
+    const int32_t           interval_us,
+    const AKH_XFER_CALLBACK callback,
+    void                    *arg)
+{
+    struct aks_sensor_slot *slot;
+    uint8_t                id;
+    int16_t                ret;
+
+    if ((sensor >= g_num_of_device) || (callback == NULL)) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    if (g_restart.phase != RESTART_IDLE) {
+        return AKM_ERR_BUSY;
+    }
+
+    slot = &g_slots[sensor];
+    AKH_Log("AKS_Restart: Restarting device %d\n", sensor);
+
+    /* The sensor may not respond, go on to reset anyway. */
+    slot->interface->aks_stop(slot->ctx);
+    slot->interval_us = 0;
+
+    /* The part may have been reset behind the register cache, e.g. by
+     * brown-out, and so may the other sensor in its package. */
+    for (id = 0; id < g_num_of_device; id++) {
+        if (aks_same_package(slot, &g_slots[id])) {
+            AKH_InvalidateCache(g_slots[id].ctx->handle);
+        }
+    }
+
+    g_restart.phase = RESTART_INIT;
+    g_restart.sensor = sensor;
+    g_restart.next = 0;
+    g_restart.interval_us = interval_us;
+    g_restart.callback = callback;
+    g_restart.arg = arg;
+
+    /* callback is never called before this function returns */
+    AKH_TransactionInit(&g_restart.tr, slot->ctx->handle);
+    ret = AKH_TransactionRunAsync(&g_restart.tr, restart_next, NULL);
+
+    if (ret != AKM_SUCCESS) {
+        g_restart.phase = RESTART_IDLE;
+    }
+
+    return ret;
+}
+
 int16_t AKS_Stop(const AKM_SENSOR_TYPE stype)
+{
+    return AKS_StopMulti(AKS_GetSensorMask(stype));
+}
+
+int16_t AKS_StopMulti(const uint32_t mask)
 {
     uint8_t                id;
     int16_t                ret;
     struct aks_sensor_slot *slot = g_slots;
 
     for (id = 0; id < g_num_of_device; id++) {
-        if (stype & slot->type) {
-            AKH_Print("AKS_Stop: Stopping device %d of type %d\n", id, slot->type);
-            ret = slot->interface->aks_stop();
+        if ((mask & ((uint32_t)1 << id)) != 0) {
+            AKH_Log("AKS_Stop: Stopping device %d of type %d\n", id, slot->type);
+            ret = slot->interface->aks_stop(slot->ctx);
+            slot->interval_us = 0;
 
             if ((ret != AKM_SUCCESS) && (ret != AKM_ERR_NOT_SUPPORT)) {
-                AKH_Print("AKS_Stop: Failed to stop device %d\n", id);
+                AKH_Log("AKS_Stop: Failed to stop device %d\n", id);
                 return ret;
             }
         }
@@ -374,7 +766,7 @@ int16_t AKS_Stop(const AKM_SENSOR_TYPE stype)
         slot++;
     }
 
-    AKH_Print("AKS_Stop: All devices stopped successfully\n");
+    AKH_Log("AKS_Stop: All devices stopped successfully\n");
     return AKM_SUCCESS;
 }
 
@@ -387,20 +779,19 @@ int16_t AKS_CheckDataReady(
 
     /* this API does not support multi-device */
     if (stype == AKM_ST_ALL_SENSORS) {
-        AKH_Print("AKS_CheckDataReady: Invalid argument for multi-device check\n");
+        AKH_Log("AKS_CheckDataReady: Invalid argument for multi-device check\n");
         return AKM_ERR_INVALID_ARG;
     }
 
     for (id = 0; id < g_num_of_device; id++) {
         if (stype & slot->type) {
-            AKH_Print("AKS_CheckDataReady: Checking data ready for device %d of type %d\n", id, slot->type);
-            return slot->interface->aks_check_rdy(timeout_us);
+            return slot->interface->aks_check_rdy(slot->ctx, timeout_us);
         }
 
         slot++;
     }
 
-    AKH_Print("AKS_CheckDataReady: Data ready check not supported\n");
+    AKH_Log("AKS_CheckDataReady: Data ready check not supported\n");
     return AKM_ERR_NOT_SUPPORT;
 }
 
@@ -428,43 +819,17 @@ int16_t AKS_GetData(
         tmp_num = num_of_remain;
 
         if (stype & slot->type) {
-            ret = slot->interface->aks_get_data(head, &tmp_num);
+            ret = slot->interface->aks_get_data(slot->ctx, head, &tmp_num);
 
             if (ret == AKM_SUCCESS) {
-                // 디버그 출력 추가 및 평균 계산
-                for (uint8_t i = 0; i < tmp_num; i++) {
-               
-                    // 평균을 계산할 데이터 합계에 추가
-                    sum_x += head[i].u.v[0];
-                    sum_y += head[i].u.v[1];
-                    sum_z += head[i].u.v[2];
-                    measurement_index++;
-
-                    // 10개의 데이터가 수집되면 평균을 계산하고 출력
-                    if (measurement_index >= MEASUREMENT_SIZE) {
-                        
-                        int32_t avg_x = sum_x / MEASUREMENT_SIZE;
-                        int32_t avg_y = sum_y / MEASUREMENT_SIZE;
-                        int32_t avg_z = sum_z / MEASUREMENT_SIZE;
-
-                        AKH_Print("Retrived data: x=%d, y=%d, z=%d\n", -avg_x, -avg_y, -avg_z);
-
-                        // 변수 초기화
-                        sum_x = 0;
-                        sum_y = 0;
-                        sum_z = 0;
-                        measurement_index = 0; // 카운터 초기화
-                    }
-                }
-
                 // it's fine. goto next device
                 head += tmp_num;
                 num_of_remain -= tmp_num;
             } else if (ret == AKM_ERR_NOT_SUPPORT) {
                 // ignore this device
-                AKH_Print("AKS_GetData: Data retrieval not supported for device %d\n", id);
+                AKH_Log("AKS_GetData: Data retrieval not supported for device %d\n", id);
             } else {
-                AKH_Print("AKS_GetData: Failed to get data for device %d\n", id);
+                AKH_Log("AKS_GetData: Failed to get data for device %d\n", id);
                 return ret;
             }
 
@@ -484,6 +849,89 @@ int16_t AKS_GetData(
 
 
 
+uint32_t AKS_GetSensorMask(
+    const AKM_SENSOR_TYPE stype)
+{
+    uint8_t  id;
+    uint32_t mask = 0;
+
+    for (id = 0; id < g_num_of_device; id++) {
+        if (stype & g_slots[id].type) {
+            mask |= ((uint32_t)1 << id);
+        }
+    }
+
+    return mask;
+}
+
+int16_t AKS_GetDataMulti(
+    const uint32_t         ready_mask,
+    struct AKM_SENSOR_DATA *data,
+    uint8_t                count[AKS_MAX_SENSORS])
+{
+    uint8_t                id;
+    struct aks_sensor_slot *slot = g_slots;
+    struct AKM_SENSOR_DATA *head = data;
+    int16_t                total = 0;
+    int16_t                err = AKM_SUCCESS;
+    int16_t                ret;
+
+    /* This is called on every sample, so do not log here. */
+    for (id = 0; id < NUMBER_OF_SLOT; id++) {
+        if ((id >= g_num_of_device) ||
+            ((ready_mask & ((uint32_t)1 << id)) == 0) ||
+            (count[id] == 0)) {
+            count[id] = 0;
+            slot++;
+            continue;
+        }
+
+        ret = slot->interface->aks_get_data(slot->ctx, head, &count[id]);
+
+        if (ret == AKM_SUCCESS) {
+            head += count[id];
+            total += count[id];
+        } else {
+            count[id] = 0;
+
+            /* remember the first error, then go next device */
+            if ((ret != AKM_ERR_NOT_SUPPORT) && (err == AKM_SUCCESS)) {
+                err = ret;
+            }
+        }
+
+        slot++;
+    }
+
+    if (err != AKM_SUCCESS) {
+        return err;
+    }
+
+    return total;
+}
+
+int16_t AKS_GetDataAsync(
+    const uint8_t           sensor,
+    struct AKM_SENSOR_DATA  *data,
+    const AKH_XFER_CALLBACK callback,
+    void                    *arg)
+{
+    struct aks_sensor_slot *slot;
+
+    if (sensor >= g_num_of_device) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    slot = &g_slots[sensor];
+
+    if (slot->interface->aks_get_data_async == NULL) {
+        return AKM_ERR_NOT_SUPPORT;
+    }
+
+    return slot->interface->aks_get_data_async(
+            slot->ctx, data, callback, arg);
+}
+
 int16_t AKS_SelfTest(
     const AKM_SENSOR_TYPE stype,
     int32_t               *result)
@@ -500,7 +948,7 @@ int16_t AKS_SelfTest(
     for (id = 0; id < g_num_of_device; id++) {
         if (stype & slot->type) {
             AKH_Print("AKS_SelfTest: Performing self-test for device %d of type %d\n", id, slot->type);
-            return slot->interface->aks_self_test(result);
+            return slot->interface->aks_self_test(slot->ctx, result);
         }
 
         slot++;
@@ -24,9 +24,12 @@
 #define INCLUDE_AKS_APIS_H
 
 #include "AKM_Common.h"
+#include "AKH_APIs.h"
 
 #define AKS_INFO_NAME_SIZE  16 /*!< The length of device name. */
 #define AKS_PARAMETER_SIZE  8  /*!< The length of device parameter. */
+/*! The maximum number of sensors which can be configured. */
+#define AKS_MAX_SENSORS     AKH_MAX_DEVICES
 
 struct AKS_DEVICE_INFO {
     /*! The name of device. */
@@ -49,14 +52,47 @@ void readInput();
  * \retval Negative Something wrong with configuration.
  * \param num The number of sensors in the list. In other words, the
  * length of #dev parameter.
- * \param dev An array of sensors. If same type of sensor is specified,
- * later one will be used.
+ * \param dev An array of sensors. Each sensor is accessed at the default
+ * address of the part.
  */
 int16_t AKS_Config(
     const uint8_t     num,
     const AKM_DEVICES dev[]
 );
 
+/*!
+ * Configure sensors with the bus address of each. The device table of the
+ * HAL is rebuilt from the list, and sensors which do not respond are
+ * skipped. This function must be called before #AKS_Init is called.
+ * Several sensors of the same kind may be listed with different
+ * addresses, each of them gets its own driver context.
+ * \retval Psitive The number of sensors which are successfully configured.
+ * \retval 0 Sensors are not configured at all. May be something wrong.
+ * \retval Negative Something wrong with configuration.
+ * \param num The number of sensors in the list.
+ * \param desc An array of sensor descriptions. #AKH_ADDRESS_DEFAULT can
+ * be used as the address.
+ */
+int16_t AKS_ConfigDevices(
+    const uint8_t                num,
+    const struct AKH_DEVICE_DESC desc[]
+);
+
+/*!
+ * Detect sensors on the bus and configure them. Each known bus address
+ * (or chip select) is read once, and its ID register is matched against
+ * the signatures of supported parts. Then the sensors which are found
+ * are configured as #AKS_ConfigDevices does, so one firmware runs on
+ * any board variant. BMI160 is configured as both accelerometer and
+ * gyroscope. This function must be called before #AKS_Init is called.
+ * \retval Psitive The number of sensors which are successfully configured.
+ * \retval 0 No sensor is found.
+ * \retval Negative Something wrong with configuration.
+ */
+int16_t AKS_ConfigDetect(
+    void
+);
+
 /*!
  * Initialize sensor device.
  * This function resets the device, then intialize the device.
@@ -124,6 +160,17 @@ int16_t AKS_Start(
     const int32_t         interval_us
 );
 
+/*!
+ * Same as #AKS_Start, for the sensors of a mask.
+ * \retval AKM_SUCCESS The operation has done successfully.
+ * \param mask Bit mask of sensors to be started. See #AKS_GetSensorMask.
+ * \param interval_us The measurement interval, see #AKS_Start.
+ */
+int16_t AKS_StartMulti(
+    const uint32_t mask,
+    const int32_t  interval_us
+);
+
 
 /*!
  * Stop device measurement.
@@ -135,6 +182,53 @@ int16_t AKS_Stop(
     const AKM_SENSOR_TYPE stype
 );
 
+/*!
+ * Same as #AKS_Stop, for the sensors of a mask.
+ * \retval AKM_SUCCESS The operation has done successfully.
+ * \param mask Bit mask of sensors to be stopped. See #AKS_GetSensorMask.
+ */
+int16_t AKS_StopMulti(
+    const uint32_t mask
+);
+
+/*!
+ * Reset one sensor and start it again, while other sensors keep running.
+ * The sensor is stopped, initialized with the parameters of the last
+ * #AKS_Init, then started at the interval. When the reset stops another
+ * sensor in the same package (BMI160), that one is started again at the
+ * interval of its last #AKS_Start. This is used to recover a sensor which
+ * stopped responding.
+ * Only the stop is done before return. Initialization and start run in
+ * the background, and the result is passed to callback in thread
+ * context. Sensors of #AKS_GetSiblingMask must not be accessed until
+ * then. One restart runs at a time.
+ * \retval AKM_SUCCESS The restart has started. callback will be called.
+ * \retval AKM_ERR_INVALID_ARG The sensor is not configured.
+ * \retval AKM_ERR_BUSY Another restart is running.
+ * \param sensor The n-th sensor which is configured by #AKS_ConfigDevices.
+ * \param interval_us The measurement interval, see #AKS_Start.
+ * \param callback The function which is called at the end of restart.
+ *  #AKM_SUCCESS is passed when the sensor is measuring again.
+ * \param arg The argument which is passed to callback.
+ */
+int16_t AKS_Restart(
+    const uint8_t           sensor,
+    const int32_t           interval_us,
+    const AKH_XFER_CALLBACK callback,
+    void                    *arg
+);
+
+/*!
+ * Get a mask of sensors which are in the same package as the sensor,
+ * including itself. A reset of one of them resets all of them.
+ * \return The mask of sensors. See #AKS_GetSensorMask. 0 when the sensor
+ *  is not configured.
+ * \param sensor The n-th sensor which is configured by #AKS_ConfigDevices.
+ */
+uint32_t AKS_GetSiblingMask(
+    const uint8_t sensor
+);
+
 
 /*!
  * Check if the sensor is ready to read new data.
@@ -150,7 +244,10 @@ int16_t AKS_Stop(
  *  as 1 (not 3).
  * \param stype Specify a type of sensor.
  * \param timeout_us When 0 or negative value is specified, this function
- *  will return immediately after checking the device.
+ *  will return immediately after checking the device. Otherwise the caller
+ *  sleeps until DRDY interrupt when the device owns DRDY line (the
+ *  AKH_EVENT_XXX of the sensor is consumed), or polls the device with
+ *  increasing interval from 100 us to 8 ms.
  */
 int16_t AKS_CheckDataReady(
     const AKM_SENSOR_TYPE stype,
@@ -183,6 +280,67 @@ int16_t AKS_GetData(
 );
 
 
+/*!
+ * Get a mask of configured sensors. Bit n of the mask corresponds to
+ * the n-th sensor which is configured by #AKS_ConfigDevices.
+ * \return The mask of sensors. 0 means no sensor of the types is
+ *  configured.
+ * \param stype Specify types of sensor. This argument accepts a 'or'
+ *  combination of #AKM_SENSOR_TYPE.
+ */
+uint32_t AKS_GetSensorMask(
+    const AKM_SENSOR_TYPE stype
+);
+
+
+/*!
+ * Get data from several sensors in one call.
+ * Sensors which are specified with ready_mask are read back-to-back in
+ * the order of configuration, and their data is stored into data array
+ * one after another. An error of a sensor does not stop reading the
+ * others.
+ * \retval Positive or 0 The total number of data stored in data array.
+ * \retval Negative The error of the first sensor which failed. count is
+ *  still valid, and it is 0 for the failed sensor.
+ * \param ready_mask Bit mask of sensors to be read, usually the sensors
+ *  which have new data. See #AKS_GetSensorMask.
+ * \param data A pointer to #AKM_SENSOR_DATA struct array. The length must
+ *  be equal or greater than the sum of count of the specified sensors.
+ * \param count An array of #AKS_MAX_SENSORS length. As input, count[n]
+ *  is the maximum number of data of n-th sensor. As output, the number
+ *  of data which is stored. It is 0 for sensors which are not read.
+ */
+int16_t AKS_GetDataMulti(
+    const uint32_t         ready_mask,
+    struct AKM_SENSOR_DATA *data,
+    uint8_t                count[AKS_MAX_SENSORS]
+);
+
+/*!
+ * Start reading one data set of a sensor without blocking the caller.
+ * The transfer runs in the background, and the result is passed to
+ * callback in thread context. Only one transfer is in flight on the bus,
+ * so a blocking access which comes in the meantime waits for its end.
+ * \retval AKM_SUCCESS The read has started. callback will be called.
+ * \retval AKM_ERR_NOT_SUPPORT The sensor is read by #AKS_GetDataMulti
+ *  only.
+ * \retval AKM_ERR_BUSY Another transfer is in flight.
+ * \retval Negative Other error. callback is not called.
+ * \param sensor The index of sensor. See #AKS_GetSensorMask.
+ * \param data A pointer to #AKM_SENSOR_DATA struct. It must be kept
+ *  until callback is called, and is valid only when the result is
+ *  #AKM_SUCCESS.
+ * \param callback The function which is called at the end of transfer.
+ * \param arg The argument which is passed to callback.
+ */
+int16_t AKS_GetDataAsync(
+    const uint8_t           sensor,
+    struct AKM_SENSOR_DATA  *data,
+    const AKH_XFER_CALLBACK callback,
+    void                    *arg
+);
+
+
 /*!
  * Do self-test operation.
  * This function will block the process of caller until operation is done.
@@ -44,6 +44,9 @@
 
 #define AK8963_BDATA_SIZE                8
 
+/* WIA is the company ID of AKM */
+#define AK8963_WIA_VAL                   0x48
+
 #define AK8963_CNTL1_SNG_MEASURE         0x01
 #define AK8963_CNTL1_CONT_MEASURE_MODE1  0x02
 #define AK8963_CNTL1_CONT_MEASURE_MODE2  0x06
@@ -16,11 +16,12 @@
  * and grant commercial license to you.
  *
  ******************************************************************************/
+#include <string.h>
+
 #include "aks_acc_adxl34x.h"
 #include "aks_common.h"
 #include "AKH_APIs.h"
 
-#define ADXL34X_REG_DEVID            0x00
 #define ADXL34X_REG_BW_RATE          0x2C
 #define ADXL34X_REG_POWER_CTL        0x2D
 #define ADXL34X_REG_INT_ENABLE       0x2E
@@ -33,8 +34,6 @@
 #define ADXL34X_REG_DATAZ0           0x36
 #define ADXL34X_REG_DATAZ1           0x37
 
-#define ADXL34X_VAL_DEVID_ADXL345    (0xE5)
-#define ADXL34X_VAL_DEVID_ADXL346    (0xE6)
 #define ADXL34X_VAL_PCTL_MEASURE     (1 << 3)
 #define ADXL34X_VAL_DATA_RATE_200HZ  (0x0B)
 #define ADXL34X_VAL_RANGE_2G         (0x00)
@@ -46,10 +45,18 @@
 #define ADXL34X_VAL_RANGE            ADXL34X_VAL_RANGE_4G
 #define ADXL34X_VAL_RESOLUTION       ADXL34X_VAL_RESOLUTION_4G
 
-static AKM_DEVICES   g_device = AKM_DEVICE_NONE;
-static uint8_t       g_acc_axis_order[3];
-static uint8_t       g_acc_axis_sign[3];
-static AKM_TIMESTAMP g_acc_ts;
+/* Per device state. */
+struct adxl34x_context {
+    struct aks_context base;
+    uint8_t            axis_order[3];
+    uint8_t            axis_sign[3];
+    AKM_TIMESTAMP      drdy_ts;
+};
+
+static struct adxl34x_context g_ctx[AKH_MAX_DEVICES];
+
+/* There is one INT line, so only the first device initialized owns it. */
+static struct adxl34x_context *g_drdy_owner = NULL;
 
 static struct aks_interface adxl34x_interface = {
     .aks_init = adxl34x_init,
@@ -63,20 +70,30 @@ static struct aks_interface adxl34x_interface = {
 
 void acc_irq_handler(void)
 {
-    g_acc_ts = AKH_GetTimestamp();
+    if (g_drdy_owner != NULL) {
+        g_drdy_owner->drdy_ts = AKH_GetTimestamp();
+    }
 }
 
 /******************************************************************************/
 /***** AKS public APIs ********************************************************/
 int16_t adxl34x_config(
-    AKM_DEVICES          *acc_dev,
+    const AKH_HANDLE     handle,
+    struct aks_context   **acc_ctx,
     struct aks_interface **acc_if)
 {
-    uint8_t devid;
-    int16_t fret;
+    struct adxl34x_context *c;
+    AKM_DEVICES            device;
+    uint8_t                devid;
+    int16_t                fret;
+
+    if (handle >= AKH_MAX_DEVICES) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
 
     /* Read WIA */
-    fret = AKH_RxData(AKM_ST_ACC, ADXL34X_REG_DEVID, &devid, 1);
+    fret = AKH_RxData(handle, ADXL34X_REG_DEVID, &devid, 1);
 
     if (fret != AKM_SUCCESS) {
         return fret;
@@ -84,94 +101,81 @@ int16_t adxl34x_config(
 
     switch (devid) {
     case ADXL34X_VAL_DEVID_ADXL345:
-        g_device = AKM_ACCELEROMETER_ADXL345;
+        device = AKM_ACCELEROMETER_ADXL345;
         break;
 
     case ADXL34X_VAL_DEVID_ADXL346:
-        g_device = AKM_ACCELEROMETER_ADXL346;
+        device = AKM_ACCELEROMETER_ADXL346;
         break;
 
     default:
         return AKM_ERR_NOT_SUPPORT;
     }
 
-    *acc_dev = g_device;
+    c = &g_ctx[handle];
+    memset(c, 0, sizeof(*c));
+    c->base.handle = handle;
+    c->base.device = device;
+
+    *acc_ctx = &c->base;
     *acc_if = &adxl34x_interface;
     return AKM_SUCCESS;
 }
 
 int16_t adxl34x_init(
-    const uint8_t axis_order[3],
-    const uint8_t axis_sign[3])
+    struct aks_context *ctx,
+    const uint8_t      axis_order[3],
+    const uint8_t      axis_sign[3])
 {
-    uint8_t i2cData;
-    int16_t fret;
+    struct adxl34x_context *c = (struct adxl34x_context *)ctx;
+    struct AKH_TRANSACTION tr;
+    int16_t                fret;
 
-    /* read 'bw rate' register */
-    fret = AKH_RxData(AKM_ST_ACC, ADXL34X_REG_BW_RATE, &i2cData, 1);
-
-    if (fret != AKM_SUCCESS) {
-        return fret;
-    }
+    /* The part may have been reset behind the shadow, e.g. by brown-out */
+    AKH_InvalidateCache(ctx->handle);
 
+    AKH_TransactionInit(&tr, ctx->handle);
     /* set bw rate */
-    i2cData = ((i2cData & 0xF0) | ADXL34X_VAL_DATA_RATE_200HZ);
-    fret = AKH_TxData(AKM_ST_ACC, ADXL34X_REG_BW_RATE, &i2cData, 1);
-
-    if (fret != AKM_SUCCESS) {
-        return fret;
-    }
-
+    AKH_TransactionUpdate(
+        &tr, ADXL34X_REG_BW_RATE, 0x0F, ADXL34X_VAL_DATA_RATE_200HZ);
     /* set INT pin enable */
-    i2cData = ADXL34X_VAL_INT_ENABLED;
-    fret = AKH_TxData(AKM_ST_ACC, ADXL34X_REG_INT_ENABLE, &i2cData, 1);
-
-    if (fret != AKM_SUCCESS) {
-        return fret;
-    }
-
-    /* read 'range' register */
-    fret = AKH_RxData(AKM_ST_ACC, ADXL34X_REG_DATA_FORMAT, &i2cData, 1);
-
-    if (fret != AKM_SUCCESS) {
-        return fret;
-    }
-
+    AKH_TransactionWrite(&tr, ADXL34X_REG_INT_ENABLE, ADXL34X_VAL_INT_ENABLED);
     /* set range */
-    i2cData = ((i2cData & 0xFC) | ADXL34X_VAL_RANGE);
-    fret = AKH_TxData(AKM_ST_ACC, ADXL34X_REG_DATA_FORMAT, &i2cData, 1);
+    AKH_TransactionUpdate(
+        &tr, ADXL34X_REG_DATA_FORMAT, 0x03, ADXL34X_VAL_RANGE);
+    /* set to power down mode. */
+    AKH_TransactionWrite(&tr, ADXL34X_REG_POWER_CTL, 0);
+    fret = AKH_TransactionRun(&tr);
 
     if (fret != AKM_SUCCESS) {
         return fret;
     }
 
-    fret = AKH_SetIRQHandler(IRQ_ACC_1, acc_irq_handler);
+    if ((g_drdy_owner == NULL) || (g_drdy_owner == c)) {
+        fret = AKH_SetIRQHandler(IRQ_ACC_1, acc_irq_handler);
 
-    if (fret != AKM_SUCCESS) {
-        return fret;
-    }
-
-    /* set to power down mode. */
-    i2cData = 0;
-    fret = AKH_TxData(AKM_ST_ACC, ADXL34X_REG_POWER_CTL, &i2cData, 1);
+        if (fret != AKM_SUCCESS) {
+            return fret;
+        }
 
-    if (fret != AKM_SUCCESS) {
-        return fret;
+        g_drdy_owner = c;
     }
 
     /* axis conversion parameter */
-    g_acc_axis_order[0] = axis_order[0];
-    g_acc_axis_order[1] = axis_order[1];
-    g_acc_axis_order[2] = axis_order[2];
-    g_acc_axis_sign[0] = axis_sign[0];
-    g_acc_axis_sign[1] = axis_sign[1];
-    g_acc_axis_sign[2] = axis_sign[2];
+    c->axis_order[0] = axis_order[0];
+    c->axis_order[1] = axis_order[1];
+    c->axis_order[2] = axis_order[2];
+    c->axis_sign[0] = axis_sign[0];
+    c->axis_sign[1] = axis_sign[1];
+    c->axis_sign[2] = axis_sign[2];
     return AKM_SUCCESS;
 }
 
-int16_t adxl34x_get_info(struct AKS_DEVICE_INFO *info)
+int16_t adxl34x_get_info(
+    struct aks_context     *ctx,
+    struct AKS_DEVICE_INFO *info)
 {
-    switch (g_device) {
+    switch (ctx->device) {
     case AKM_ACCELEROMETER_ADXL345:
         AKS_MyStrcpy(info->name, "ADXL345", AKS_INFO_NAME_SIZE);
         break;
@@ -184,80 +188,75 @@ int16_t adxl34x_get_info(struct AKS_DEVICE_INFO *info)
         return AKM_ERR_NOT_SUPPORT;
     }
 
-    info->device = g_device;
+    info->device = ctx->device;
     return AKM_SUCCESS;
 }
 
-int16_t adxl34x_start(const int32_t interval_us)
+int16_t adxl34x_start(
+    struct aks_context *ctx,
+    const int32_t      interval_us)
 {
-    uint8_t i2cData;
-    int16_t fret;
-
-    /* Read power control register */
-    fret = AKH_RxData(AKM_ST_ACC, ADXL34X_REG_POWER_CTL, &i2cData, 1);
-
-    if (fret != AKM_SUCCESS) {
-        return fret;
-    }
+    struct AKH_TRANSACTION tr;
 
     /* set measure bit to 1 */
-    i2cData |= ADXL34X_VAL_PCTL_MEASURE;
-    fret = AKH_TxData(AKM_ST_ACC, ADXL34X_REG_POWER_CTL, &i2cData, 1);
+    AKH_TransactionInit(&tr, ctx->handle);
+    AKH_TransactionUpdate(
+        &tr, ADXL34X_REG_POWER_CTL,
+        ADXL34X_VAL_PCTL_MEASURE, ADXL34X_VAL_PCTL_MEASURE);
+    return AKH_TransactionRun(&tr);
+}
 
-    if (fret != AKM_SUCCESS) {
-        return fret;
-    }
+int16_t adxl34x_stop(struct aks_context *ctx)
+{
+    struct AKH_TRANSACTION tr;
 
-    return AKM_SUCCESS;
+    /* set measure bit to 0 */
+    AKH_TransactionInit(&tr, ctx->handle);
+    AKH_TransactionUpdate(
+        &tr, ADXL34X_REG_POWER_CTL, ADXL34X_VAL_PCTL_MEASURE, 0);
+    return AKH_TransactionRun(&tr);
 }
 
-int16_t adxl34x_stop(void)
+static int16_t adxl34x_poll_rdy(struct aks_context *ctx)
 {
     uint8_t i2cData;
     int16_t fret;
 
     /* Read power control register */
-    fret = AKH_RxData(AKM_ST_ACC, ADXL34X_REG_POWER_CTL, &i2cData, 1);
+    fret = AKH_RxData(ctx->handle, ADXL34X_REG_INT_SOURCE, &i2cData, 1);
 
     if (fret != AKM_SUCCESS) {
         return fret;
     }
 
-    /* set measure bit to 0 */
-    i2cData &= ~ADXL34X_VAL_PCTL_MEASURE;
-    fret = AKH_TxData(AKM_ST_ACC, ADXL34X_REG_POWER_CTL, &i2cData, 1);
-
-    if (fret != AKM_SUCCESS) {
-        return fret;
-    }
-
-    return AKM_SUCCESS;
+    /* FIFO is not supported yet. */
+    return ((0x80 & i2cData) != 0);
 }
 
-int16_t adxl34x_check_rdy(const int32_t timeout_us)
+int16_t adxl34x_check_rdy(
+    struct aks_context *ctx,
+    const int32_t      timeout_us)
 {
-    uint8_t i2cData;
-    int16_t fret;
+    uint32_t event = 0U;
 
-    /* Read power control register */
-    fret = AKH_RxData(AKM_ST_ACC, ADXL34X_REG_INT_SOURCE, &i2cData, 1);
-
-    if (fret != AKM_SUCCESS) {
-        return fret;
+    /* INT1 reports DATA_READY of the owner */
+    if (g_drdy_owner == (struct adxl34x_context *)ctx) {
+        event = AKH_EVENT_ACC;
     }
 
-    /* FIFO is not supported yet. */
-    return ((0x80 & i2cData) != 0);
+    return aks_wait_ready(ctx, adxl34x_poll_rdy, event, timeout_us);
 }
 
 int16_t adxl34x_get_data(
+    struct aks_context     *ctx,
     struct AKM_SENSOR_DATA *data,
     uint8_t                *num)
 {
-    uint8_t i2cData[6];
-    int16_t tmp;
-    int16_t fret;
-    uint8_t i;
+    struct adxl34x_context *c = (struct adxl34x_context *)ctx;
+    uint8_t                i2cData[6];
+    int16_t                tmp;
+    int16_t                fret;
+    uint8_t                i;
 
     /* check arg */
     if (*num < 1) {
@@ -269,10 +268,10 @@ int16_t adxl34x_get_data(
     /* set MB bit for multiple read operation */
     /* this bit is required only SPI mode */
     fret = AKH_RxData(
-            AKM_ST_ACC, ADXL34X_REG_DATAX0 | 0x40, i2cData, 6);
+            ctx->handle, ADXL34X_REG_DATAX0 | 0x40, i2cData, 6);
 #else
     fret = AKH_RxData(
-            AKM_ST_ACC, ADXL34X_REG_DATAX0, i2cData, 6);
+            ctx->handle, ADXL34X_REG_DATAX0, i2cData, 6);
 #endif
 
     if (fret != AKM_SUCCESS) {
@@ -286,15 +285,22 @@ int16_t adxl34x_get_data(
         data->u.v[i] = (tmp * ACC_1G_IN_Q16 / ADXL34X_VAL_RESOLUTION);
     }
 
-    AKS_ConvertCoordinate(data->u.v, g_acc_axis_order, g_acc_axis_sign);
+    AKS_ConvertCoordinate(data->u.v, c->axis_order, c->axis_sign);
 
     data->stype = AKM_ST_ACC;
-    data->timestamp = g_acc_ts;
+    if (g_drdy_owner == c) {
+        data->timestamp = c->drdy_ts;
+    } else {
+        data->timestamp = AKH_GetTimestamp();
+    }
+
     *num = 1;
     return AKM_SUCCESS;
 }
 
-int16_t adxl34x_self_test(int32_t *result)
+int16_t adxl34x_self_test(
+    struct aks_context *ctx,
+    int32_t            *result)
 {
     return AKM_SUCCESS;
 }
@@ -21,39 +21,51 @@
 #include "AKM_Common.h"
 #include "AKS_APIs.h"
 
+/* ID register. Auto-detection reads it too. */
+#define ADXL34X_REG_DEVID            0x00
+#define ADXL34X_VAL_DEVID_ADXL345    (0xE5)
+#define ADXL34X_VAL_DEVID_ADXL346    (0xE6)
+
 int16_t adxl34x_config(
-    AKM_DEVICES *acc_dev,
+    const AKH_HANDLE     handle,
+    struct aks_context   **acc_ctx,
     struct aks_interface **acc_if
 );
 
 int16_t adxl34x_init(
-    const uint8_t axis_order[3],
-    const uint8_t axis_sign[3]
+    struct aks_context *ctx,
+    const uint8_t      axis_order[3],
+    const uint8_t      axis_sign[3]
 );
 
 int16_t adxl34x_get_info(
+    struct aks_context     *ctx,
     struct AKS_DEVICE_INFO *info
 );
 
 int16_t adxl34x_start(
-    const int32_t interval_us
+    struct aks_context *ctx,
+    const int32_t      interval_us
 );
 
 int16_t adxl34x_stop(
-    void
+    struct aks_context *ctx
 );
 
 int16_t adxl34x_check_rdy(
-    const int32_t timeout_us
+    struct aks_context *ctx,
+    const int32_t      timeout_us
 );
 
 int16_t adxl34x_get_data(
+    struct aks_context     *ctx,
     struct AKM_SENSOR_DATA *data,
     uint8_t                *num
 );
 
 int16_t adxl34x_self_test(
-    int32_t *result
+    struct aks_context *ctx,
+    int32_t            *result
 );
 
 #endif /* INCLUDE_AKS_ACC_ADXL34X_H */
@@ -16,12 +16,13 @@
  * and grant commercial license to you.
  *
  ******************************************************************************/
+#include <string.h>
+
 #include "aks_acc_gyr_bmi160.h"
 #include "aks_common.h"
 #include "AKH_APIs.h"
 
 
-#define BMI160_REG_CHIPID      0x00
 #define BMI160_REG_ERR_REG     0x02
 #define BMI160_REG_PMU_STATUS  0x03
 #define BMI160_REG_GYR_DATA    0x0C
@@ -33,7 +34,6 @@
 #define BMI160_REG_GYR_RANGE   0x43
 #define BMI160_REG_CMD         0x7E
 
-#define BMI160_VAL_CHIPID      (0xD1)
 /* datasheet section 2.11.12 */
 #define BMI160_VAL_ACC_FS2G    (3)
 #define BMI160_VAL_ACC_FS4G    (5)
@@ -85,18 +85,31 @@
 #define BMI160_CHECK_ERR_REG
 
 #ifdef BMI160_CHECK_ERR_REG
-#define RETURN_CHECK(ret)  check_err_reg(ret)
+#define RETURN_CHECK(ret)  check_err_reg(ctx, ret)
 #else
 #define RETURN_CHECK(ret)  (ret)
 #endif
 
-static AKM_DEVICES   g_acc_device = AKM_DEVICE_NONE;
-static AKM_DEVICES   g_gyr_device = AKM_DEVICE_NONE;
-static uint8_t       g_axis_order[3];
-static uint8_t       g_axis_sign[3];
-static int32_t       g_acc_sensitivity;
-static int32_t       g_gyr_sensitivity;
-static AKM_TIMESTAMP g_bmi_ts;
+/* Per device state. Accelerometer and gyroscope of one chip are two
+ * devices, so each of them has its own context. */
+struct bmi160_context {
+    struct aks_context base;
+    int32_t            sensitivity;
+    uint8_t            axis_order[3];
+    uint8_t            axis_sign[3];
+};
+
+static struct bmi160_context g_ctx[AKH_MAX_DEVICES];
+static AKM_TIMESTAMP         g_bmi_ts;
+
+/* Init or start which runs in the background. Reset and power up take
+ * up to 100 ms, so they are not waited for. One at a time. */
+static struct {
+    struct AKH_TRANSACTION tr;
+    uint8_t                err_reg;
+    AKH_XFER_CALLBACK      callback;
+    void                   *arg;
+} g_async;
 
 static struct aks_interface bmi160_acc_interface = {
     .aks_init = bmi160_init,
@@ -105,7 +118,9 @@ static struct aks_interface bmi160_acc_interface = {
     .aks_stop = bmi160_acc_stop,
     .aks_check_rdy = bmi160_acc_check_rdy,
     .aks_get_data = bmi160_acc_get_data,
-    .aks_self_test = bmi160_acc_self_test
+    .aks_self_test = bmi160_acc_self_test,
+    .aks_init_async = bmi160_init_async,
+    .aks_start_async = bmi160_acc_start_async
 };
 
 static struct aks_interface bmi160_gyr_interface = {
@@ -115,7 +130,9 @@ static struct aks_interface bmi160_gyr_interface = {
     .aks_stop = bmi160_gyr_stop,
     .aks_check_rdy = bmi160_gyr_check_rdy,
     .aks_get_data = bmi160_gyr_get_data,
-    .aks_self_test = bmi160_gyr_self_test
+    .aks_self_test = bmi160_gyr_self_test,
+    .aks_init_async = bmi160_init_async,
+    .aks_start_async = bmi160_gyr_start_async
 };
 
 void acc_bmi160_irq_handler(void)
@@ -161,13 +178,15 @@ static uint8_t bmi160_interval_us_to_odr(const int32_t interval_us)
     return setting;
 }
 
-static int16_t check_err_reg(int16_t default_return)
+static int16_t check_err_reg(
+    struct aks_context *ctx,
+    int16_t            default_return)
 {
     uint8_t i2cData;
     int16_t fret;
 
     /* read status register */
-    fret = AKH_RxData(AKM_ST_ACC, BMI160_REG_ERR_REG, &i2cData, 1);
+    fret = AKH_RxData(ctx->handle, BMI160_REG_ERR_REG, &i2cData, 1);
 
     if (fret != AKM_SUCCESS) {
         return fret;
@@ -236,14 +255,20 @@ static int32_t gyr_sensitivity_from_range(uint8_t range)
 /******************************************************************************/
 /***** AKS public APIs ********************************************************/
 int16_t bmi160_acc_config(
-    AKM_DEVICES          *acc_dev,
+    const AKH_HANDLE     handle,
+    struct aks_context   **acc_ctx,
     struct aks_interface **acc_if)
 {
-    uint8_t i2cData;
-    int16_t fret;
+    struct bmi160_context *c;
+    uint8_t               i2cData;
+    int16_t               fret;
+
+    if (handle >= AKH_MAX_DEVICES) {
+        return AKM_ERR_INVALID_ARG;
+    }
 
     /* read status register */
-    fret = AKH_RxData(AKM_ST_ACC, BMI160_REG_CHIPID, &i2cData, 1);
+    fret = AKH_RxData(handle, BMI160_REG_CHIPID, &i2cData, 1);
 
     if (fret != AKM_SUCCESS) {
         return fret;
@@ -253,23 +278,31 @@ int16_t bmi160_acc_config(
         return AKM_ERR_NOT_SUPPORT;
     }
 
-    g_acc_device = AKM_ACCELEROMETER_BMI160;
-    g_gyr_device = AKM_GYROSCOPE_BMI160;
+    c = &g_ctx[handle];
+    memset(c, 0, sizeof(*c));
+    c->base.handle = handle;
+    c->base.device = AKM_ACCELEROMETER_BMI160;
 
-    *acc_dev = g_acc_device;
+    *acc_ctx = &c->base;
     *acc_if = &bmi160_acc_interface;
     return AKM_SUCCESS;
 }
 
 int16_t bmi160_gyr_config(
-    AKM_DEVICES          *gyr_dev,
+    const AKH_HANDLE     handle,
+    struct aks_context   **gyr_ctx,
     struct aks_interface **gyr_if)
 {
-    uint8_t i2cData;
-    int16_t fret;
+    struct bmi160_context *c;
+    uint8_t               i2cData;
+    int16_t               fret;
+
+    if (handle >= AKH_MAX_DEVICES) {
+        return AKM_ERR_INVALID_ARG;
+    }
 
     /* read status register */
-    fret = AKH_RxData(AKM_ST_ACC, BMI160_REG_CHIPID, &i2cData, 1);
+    fret = AKH_RxData(handle, BMI160_REG_CHIPID, &i2cData, 1);
 
     if (fret != AKM_SUCCESS) {
         return fret;
@@ -279,85 +312,162 @@ int16_t bmi160_gyr_config(
         return AKM_ERR_NOT_SUPPORT;
     }
 
-    g_acc_device = AKM_ACCELEROMETER_BMI160;
-    g_gyr_device = AKM_GYROSCOPE_BMI160;
+    c = &g_ctx[handle];
+    memset(c, 0, sizeof(*c));
+    c->base.handle = handle;
+    c->base.device = AKM_GYROSCOPE_BMI160;
 
-    *gyr_dev = g_gyr_device;
+    *gyr_ctx = &c->base;
     *gyr_if = &bmi160_gyr_interface;
     return AKM_SUCCESS;
 }
 
-int16_t bmi160_init(
-    const uint8_t axis_order[3],
-    const uint8_t axis_sign[3])
+/* Soft reset, then ranges. */
+static void bmi160_init_steps(
+    struct aks_context     *ctx,
+    struct AKH_TRANSACTION *tr)
 {
-    uint8_t i2cData;
-    int16_t fret;
+    uint8_t i;
 
+    AKH_TransactionInit(tr, ctx->handle);
     /* Reset BMI160*/
     /* After reset, device should be suspend mode. */
-    i2cData = BMI160_CMD_SOFTRESET;
-    fret = AKH_TxData(AKM_ST_ACC, BMI160_REG_CMD, &i2cData, 1);
+    AKH_TransactionWrite(tr, BMI160_REG_CMD, BMI160_CMD_SOFTRESET);
+    AKH_TransactionDelay(tr, 100000);
+    /* Set Acc range */
+    AKH_TransactionWrite(tr, BMI160_REG_ACC_RANGE, BMI160_ACC_RANGE);
+    /* delay is required (datasheet section 2.2.1) */
+    AKH_TransactionDelay(tr, 400);
+    /* Set Gyr range */
+    AKH_TransactionWrite(tr, BMI160_REG_GYR_RANGE, BMI160_GYR_RANGE);
+    /* delay is required (ditto) */
+    AKH_TransactionDelay(tr, 400);
+
+    /* soft reset sets all registers back to the default value of
+     * both accelerometer and gyroscope */
+    for (i = 0; i < AKH_MAX_DEVICES; i++) {
+        if (g_ctx[i].base.device != AKM_DEVICE_NONE) {
+            AKH_InvalidateCache(g_ctx[i].base.handle);
+        }
+    }
+}
 
-    if (fret != AKM_SUCCESS) {
-        return fret;
+static void bmi160_set_context(
+    struct aks_context *ctx,
+    const uint8_t      axis_order[3],
+    const uint8_t      axis_sign[3])
+{
+    struct bmi160_context *c = (struct bmi160_context *)ctx;
+
+    /* set sensitivity in the context */
+    if (ctx->device == AKM_ACCELEROMETER_BMI160) {
+        c->sensitivity = acc_sensitivity_from_range(BMI160_ACC_RANGE);
+    } else {
+        c->sensitivity = gyr_sensitivity_from_range(BMI160_GYR_RANGE);
     }
 
-    AKH_DelayMilli(100);
+    /* axis conversion parameter */
+    c->axis_order[0] = axis_order[0];
+    c->axis_order[1] = axis_order[1];
+    c->axis_order[2] = axis_order[2];
+    c->axis_sign[0] = axis_sign[0];
+    c->axis_sign[1] = axis_sign[1];
+    c->axis_sign[2] = axis_sign[2];
+}
 
-    /* Set Acc range */
-    i2cData = BMI160_ACC_RANGE;
-    fret = AKH_TxData(AKM_ST_ACC, BMI160_REG_ACC_RANGE, &i2cData, 1);
+static void bmi160_async_done(
+    const int16_t result,
+    void          *arg)
+{
+    int16_t ret = result;
 
-    if (fret != AKM_SUCCESS) {
-        return fret;
+#ifdef BMI160_CHECK_ERR_REG
+    if ((ret == AKM_SUCCESS) && (g_async.err_reg != 0)) {
+        ret = AKM_ERROR;
     }
+#endif
 
-    /* delay is required (datasheet section 2.2.1) */
-    AKH_DelayMicro(400);
-    /* set sensitivity in global memory */
-    g_acc_sensitivity = acc_sensitivity_from_range(BMI160_ACC_RANGE);
+    g_async.callback(ret, g_async.arg);
+}
 
-    /* Set Gyr range */
-    i2cData = BMI160_GYR_RANGE;
-    fret = AKH_TxData(AKM_ST_ACC, BMI160_REG_GYR_RANGE, &i2cData, 1);
+/* Run the steps in g_async.tr. The error register is read at the end,
+ * same as RETURN_CHECK of the blocking functions. */
+static int16_t bmi160_run_async(
+    const AKH_XFER_CALLBACK callback,
+    void                    *arg)
+{
+#ifdef BMI160_CHECK_ERR_REG
+    AKH_TransactionRead(
+        &g_async.tr, BMI160_REG_ERR_REG, &g_async.err_reg, 1);
+#endif
+    g_async.callback = callback;
+    g_async.arg = arg;
+
+    return AKH_TransactionRunAsync(&g_async.tr, bmi160_async_done, NULL);
+}
+
+int16_t bmi160_init(
+    struct aks_context *ctx,
+    const uint8_t      axis_order[3],
+    const uint8_t      axis_sign[3])
+{
+    struct AKH_TRANSACTION tr;
+    int16_t                fret;
+
+    bmi160_init_steps(ctx, &tr);
+    fret = AKH_TransactionRun(&tr);
 
     if (fret != AKM_SUCCESS) {
         return fret;
     }
 
-    /* delay is required (ditto) */
-    AKH_DelayMicro(400);
-    /* set sensitivity in global memory */
-    g_gyr_sensitivity = gyr_sensitivity_from_range(BMI160_GYR_RANGE);
-
-    /* axis conversion parameter */
-    g_axis_order[0] = axis_order[0];
-    g_axis_order[1] = axis_order[1];
-    g_axis_order[2] = axis_order[2];
-    g_axis_sign[0] = axis_sign[0];
-    g_axis_sign[1] = axis_sign[1];
-    g_axis_sign[2] = axis_sign[2];
+    bmi160_set_context(ctx, axis_order, axis_sign);
 
     return RETURN_CHECK(AKM_SUCCESS);
 }
 
-int16_t bmi160_get_info(struct AKS_DEVICE_INFO *info)
+int16_t bmi160_init_async(
+    struct aks_context      *ctx,
+    const uint8_t           axis_order[3],
+    const uint8_t           axis_sign[3],
+    const AKH_XFER_CALLBACK callback,
+    void                    *arg)
+{
+    if (callback == NULL) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    /* the transaction in flight owns g_async */
+    if (g_async.tr.callback != NULL) {
+        return AKM_ERR_BUSY;
+    }
+
+    bmi160_init_steps(ctx, &g_async.tr);
+    /* the values do not depend on the device */
+    bmi160_set_context(ctx, axis_order, axis_sign);
+
+    return bmi160_run_async(callback, arg);
+}
+
+int16_t bmi160_get_info(
+    struct aks_context     *ctx,
+    struct AKS_DEVICE_INFO *info)
 {
-    if ((g_acc_device != AKM_ACCELEROMETER_BMI160) ||
-        (g_gyr_device != AKM_GYROSCOPE_BMI160)) {
+    if ((ctx->device != AKM_ACCELEROMETER_BMI160) &&
+        (ctx->device != AKM_GYROSCOPE_BMI160)) {
         return AKM_ERR_NOT_SUPPORT;
     }
 
     AKS_MyStrcpy(info->name, "BMI160", AKS_INFO_NAME_SIZE);
-    info->device = g_acc_device;
+    info->device = ctx->device;
     return AKM_SUCCESS;
 }
 
-int16_t bmi160_acc_start(const int32_t interval_us)
+static int16_t bmi160_acc_start_steps(
+    struct aks_context     *ctx,
+    const int32_t          interval_us,
+    struct AKH_TRANSACTION *tr)
 {
-    uint8_t i2cData;
-    int16_t fret;
     uint8_t setting;
 
     setting = bmi160_interval_us_to_odr(interval_us);
@@ -368,34 +478,72 @@ int16_t bmi160_acc_start(const int32_t interval_us)
         return AKM_ERR_INVALID_ARG;
     }
 
+    AKH_TransactionInit(tr, ctx->handle);
     /* accelerometer configuration */
-    i2cData = (BMI160_ACC_BWP << 4) | setting;
-    fret = AKH_TxData(AKM_ST_ACC, BMI160_REG_ACC_CONF, &i2cData, 1);
+    AKH_TransactionUpdate(
+        tr, BMI160_REG_ACC_CONF, 0xFF, (BMI160_ACC_BWP << 4) | setting);
+    AKH_TransactionDelay(tr, 400); /* delay is required (ditto) */
+    /* set to normal mode */
+    AKH_TransactionWrite(tr, BMI160_REG_CMD, BMI160_CMD_ACC_NORMAL);
+    /* datasheet section 2.11.38 */
+    AKH_TransactionDelay(tr, 3800);
+
+    return AKM_SUCCESS;
+}
+
+int16_t bmi160_acc_start(
+    struct aks_context *ctx,
+    const int32_t      interval_us)
+{
+    struct AKH_TRANSACTION tr;
+    int16_t                fret;
+
+    fret = bmi160_acc_start_steps(ctx, interval_us, &tr);
 
     if (fret != AKM_SUCCESS) {
         return fret;
     }
 
-    AKH_DelayMicro(400); /* delay is required (ditto) */
-
-    /* set to normal mode */
-    i2cData = BMI160_CMD_ACC_NORMAL;
-    fret = AKH_TxData(AKM_ST_ACC, BMI160_REG_CMD, &i2cData, 1);
+    fret = AKH_TransactionRun(&tr);
 
     if (fret != AKM_SUCCESS) {
         return fret;
     }
 
-    /* datasheet section 2.11.38 */
-    AKH_DelayMicro(3800);
-
     return RETURN_CHECK(AKM_SUCCESS);
 }
 
-int16_t bmi160_gyr_start(const int32_t interval_us)
+int16_t bmi160_acc_start_async(
+    struct aks_context      *ctx,
+    const int32_t           interval_us,
+    const AKH_XFER_CALLBACK callback,
+    void                    *arg)
 {
-    uint8_t i2cData;
     int16_t fret;
+
+    if (callback == NULL) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    /* the transaction in flight owns g_async */
+    if (g_async.tr.callback != NULL) {
+        return AKM_ERR_BUSY;
+    }
+
+    fret = bmi160_acc_start_steps(ctx, interval_us, &g_async.tr);
+
+    if (fret != AKM_SUCCESS) {
+        return fret;
+    }
+
+    return bmi160_run_async(callback, arg);
+}
+
+static int16_t bmi160_gyr_start_steps(
+    struct aks_context     *ctx,
+    const int32_t          interval_us,
+    struct AKH_TRANSACTION *tr)
+{
     uint8_t setting;
 
     setting = bmi160_interval_us_to_odr(interval_us);
@@ -405,38 +553,75 @@ int16_t bmi160_gyr_start(const int32_t interval_us)
         return AKM_ERR_INVALID_ARG;
     }
 
+    AKH_TransactionInit(tr, ctx->handle);
     /* gyroscope configuration */
-    i2cData = (BMI160_GYR_BWP << 4) | setting;
-    fret = AKH_TxData(AKM_ST_GYR, BMI160_REG_GYR_CONF, &i2cData, 1);
+    AKH_TransactionUpdate(
+        tr, BMI160_REG_GYR_CONF, 0xFF, (BMI160_GYR_BWP << 4) | setting);
+    AKH_TransactionDelay(tr, 400); /* delay is required (ditto) */
+    /* set to normal mode */
+    AKH_TransactionWrite(tr, BMI160_REG_CMD, BMI160_CMD_GYR_NORMAL);
+    /* datasheet section 2.11.38 */
+    AKH_TransactionDelay(tr, 80000);
+
+    return AKM_SUCCESS;
+}
+
+int16_t bmi160_gyr_start(
+    struct aks_context *ctx,
+    const int32_t      interval_us)
+{
+    struct AKH_TRANSACTION tr;
+    int16_t                fret;
+
+    fret = bmi160_gyr_start_steps(ctx, interval_us, &tr);
 
     if (fret != AKM_SUCCESS) {
         return fret;
     }
 
-    AKH_DelayMicro(400); /* delay is required (ditto) */
-
-    /* set to normal mode */
-    i2cData = BMI160_CMD_GYR_NORMAL;
-    fret = AKH_TxData(AKM_ST_GYR, BMI160_REG_CMD, &i2cData, 1);
+    fret = AKH_TransactionRun(&tr);
 
     if (fret != AKM_SUCCESS) {
         return fret;
     }
 
-    /* datasheet section 2.11.38 */
-    AKH_DelayMilli(80);
-
     return RETURN_CHECK(AKM_SUCCESS);
 }
 
-int16_t bmi160_acc_stop(void)
+int16_t bmi160_gyr_start_async(
+    struct aks_context      *ctx,
+    const int32_t           interval_us,
+    const AKH_XFER_CALLBACK callback,
+    void                    *arg)
+{
+    int16_t fret;
+
+    if (callback == NULL) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    /* the transaction in flight owns g_async */
+    if (g_async.tr.callback != NULL) {
+        return AKM_ERR_BUSY;
+    }
+
+    fret = bmi160_gyr_start_steps(ctx, interval_us, &g_async.tr);
+
+    if (fret != AKM_SUCCESS) {
+        return fret;
+    }
+
+    return bmi160_run_async(callback, arg);
+}
+
+int16_t bmi160_acc_stop(struct aks_context *ctx)
 {
     uint8_t i2cData;
     int16_t fret;
 
     /* set to suspend mode */
     i2cData = BMI160_CMD_ACC_SUSPEND;
-    fret = AKH_TxData(AKM_ST_ACC, BMI160_REG_CMD, &i2cData, 1);
+    fret = AKH_TxData(ctx->handle, BMI160_REG_CMD, &i2cData, 1);
 
     if (fret != AKM_SUCCESS) {
         return fret;
@@ -447,14 +632,14 @@ int16_t bmi160_acc_stop(void)
     return RETURN_CHECK(AKM_SUCCESS);
 }
 
-int16_t bmi160_gyr_stop(void)
+int16_t bmi160_gyr_stop(struct aks_context *ctx)
 {
     uint8_t i2cData;
     int16_t fret;
 
     /* set to suspend mode */
     i2cData = BMI160_CMD_GYR_SUSPEND;
-    fret = AKH_TxData(AKM_ST_GYR, BMI160_REG_CMD, &i2cData, 1);
+    fret = AKH_TxData(ctx->handle, BMI160_REG_CMD, &i2cData, 1);
 
     if (fret != AKM_SUCCESS) {
         return fret;
@@ -465,13 +650,13 @@ int16_t bmi160_gyr_stop(void)
     return RETURN_CHECK(AKM_SUCCESS);
 }
 
-int16_t bmi160_acc_check_rdy(const int32_t timeout_us)
+static int16_t bmi160_acc_poll_rdy(struct aks_context *ctx)
 {
     uint8_t i2cData;
     int16_t fret;
 
     /* read status register */
-    fret = AKH_RxData(AKM_ST_ACC, BMI160_REG_STATUS, &i2cData, 1);
+    fret = AKH_RxData(ctx->handle, BMI160_REG_STATUS, &i2cData, 1);
 
     if (fret != AKM_SUCCESS) {
         return fret;
@@ -480,13 +665,21 @@ int16_t bmi160_acc_check_rdy(const int32_t timeout_us)
     return ((0x80 & i2cData) != 0);
 }
 
-int16_t bmi160_gyr_check_rdy(const int32_t timeout_us)
+int16_t bmi160_acc_check_rdy(
+    struct aks_context *ctx,
+    const int32_t      timeout_us)
+{
+    /* INT pins are not used, poll status */
+    return aks_wait_ready(ctx, bmi160_acc_poll_rdy, 0U, timeout_us);
+}
+
+static int16_t bmi160_gyr_poll_rdy(struct aks_context *ctx)
 {
     uint8_t i2cData;
     int16_t fret;
 
     /* read status register */
-    fret = AKH_RxData(AKM_ST_GYR, BMI160_REG_STATUS, &i2cData, 1);
+    fret = AKH_RxData(ctx->handle, BMI160_REG_STATUS, &i2cData, 1);
 
     if (fret != AKM_SUCCESS) {
         return fret;
@@ -495,14 +688,24 @@ int16_t bmi160_gyr_check_rdy(const int32_t timeout_us)
     return ((0x40 & i2cData) != 0);
 }
 
+int16_t bmi160_gyr_check_rdy(
+    struct aks_context *ctx,
+    const int32_t      timeout_us)
+{
+    /* INT pins are not used, poll status */
+    return aks_wait_ready(ctx, bmi160_gyr_poll_rdy, 0U, timeout_us);
+}
+
 int16_t bmi160_acc_get_data(
+    struct aks_context     *ctx,
     struct AKM_SENSOR_DATA *data,
     uint8_t                *num)
 {
-    uint8_t i2cData[6];
-    int16_t tmp;
-    int16_t fret;
-    uint8_t i;
+    struct bmi160_context *c = (struct bmi160_context *)ctx;
+    uint8_t               i2cData[6];
+    int16_t               tmp;
+    int16_t               fret;
+    uint8_t               i;
 
     /* check arg */
     if (*num < 1) {
@@ -510,7 +713,7 @@ int16_t bmi160_acc_get_data(
     }
 
     /* read data */
-    fret = AKH_RxData(AKM_ST_ACC, BMI160_REG_ACC_DATA, i2cData, 6);
+    fret = AKH_RxData(ctx->handle, BMI160_REG_ACC_DATA, i2cData, 6);
 
     if (fret != AKM_SUCCESS) {
         return fret;
@@ -520,10 +723,10 @@ int16_t bmi160_acc_get_data(
         /* convert to int16 data */
         tmp = (int16_t)(((uint16_t)i2cData[i * 2 + 1] << 8)
                         | i2cData[i * 2]);
-        data->u.v[i] = (int32_t)tmp * g_acc_sensitivity;
+        data->u.v[i] = (int32_t)tmp * c->sensitivity;
     }
 
-    AKS_ConvertCoordinate(data->u.v, g_axis_order, g_axis_sign);
+    AKS_ConvertCoordinate(data->u.v, c->axis_order, c->axis_sign);
 
     data->stype = AKM_ST_ACC;
     data->timestamp = AKH_GetTimestamp();
@@ -532,13 +735,15 @@ int16_t bmi160_acc_get_data(
 }
 
 int16_t bmi160_gyr_get_data(
+    struct aks_context     *ctx,
     struct AKM_SENSOR_DATA *data,
     uint8_t                *num)
 {
-    uint8_t i2cData[6];
-    int16_t tmp;
-    int16_t fret;
-    uint8_t i;
+    struct bmi160_context *c = (struct bmi160_context *)ctx;
+    uint8_t               i2cData[6];
+    int16_t               tmp;
+    int16_t               fret;
+    uint8_t               i;
 
     /* check arg */
     if (*num < 1) {
@@ -546,7 +751,7 @@ int16_t bmi160_gyr_get_data(
     }
 
     /* read data */
-    fret = AKH_RxData(AKM_ST_GYR, BMI160_REG_GYR_DATA, i2cData, 6);
+    fret = AKH_RxData(ctx->handle, BMI160_REG_GYR_DATA, i2cData, 6);
 
     if (fret != AKM_SUCCESS) {
         return fret;
@@ -556,10 +761,10 @@ int16_t bmi160_gyr_get_data(
         /* convert to int16 data */
         tmp = (int16_t)(((uint16_t)i2cData[i * 2 + 1] << 8)
                         | i2cData[i * 2]);
-        data->u.v[i] = (int32_t)tmp * g_gyr_sensitivity;
+        data->u.v[i] = (int32_t)tmp * c->sensitivity;
     }
 
-    AKS_ConvertCoordinate(data->u.v, g_axis_order, g_axis_sign);
+    AKS_ConvertCoordinate(data->u.v, c->axis_order, c->axis_sign);
 
     data->stype = AKM_ST_GYR;
     data->timestamp = AKH_GetTimestamp();
@@ -567,12 +772,16 @@ int16_t bmi160_gyr_get_data(
     return AKM_SUCCESS;
 }
 
-int16_t bmi160_acc_self_test(int32_t *result)
+int16_t bmi160_acc_self_test(
+    struct aks_context *ctx,
+    int32_t            *result)
 {
     return AKM_SUCCESS;
 }
 
-int16_t bmi160_gyr_self_test(int32_t *result)
+int16_t bmi160_gyr_self_test(
+    struct aks_context *ctx,
+    int32_t            *result)
 {
     return AKM_SUCCESS;
 }
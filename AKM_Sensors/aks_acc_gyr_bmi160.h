@@ -21,64 +21,110 @@
 #include "AKM_Common.h"
 #include "AKS_APIs.h"
 
+/* ID register. Auto-detection reads it too. */
+#define BMI160_REG_CHIPID      0x00
+#define BMI160_VAL_CHIPID      (0xD1)
+
 int16_t bmi160_acc_config(
-    AKM_DEVICES *acc_dev,
+    const AKH_HANDLE     handle,
+    struct aks_context   **acc_ctx,
     struct aks_interface **acc_if
 );
 
 int16_t bmi160_gyr_config(
-    AKM_DEVICES *gyr_dev,
+    const AKH_HANDLE     handle,
+    struct aks_context   **gyr_ctx,
     struct aks_interface **gyr_if
 );
 
 int16_t bmi160_init(
-    const uint8_t axis_order[3],
-    const uint8_t axis_sign[3]
+    struct aks_context *ctx,
+    const uint8_t      axis_order[3],
+    const uint8_t      axis_sign[3]
+);
+
+/*!
+ * Same as #bmi160_init, without blocking the caller. The result is passed
+ * to \c callback in thread context.
+ */
+int16_t bmi160_init_async(
+    struct aks_context      *ctx,
+    const uint8_t           axis_order[3],
+    const uint8_t           axis_sign[3],
+    const AKH_XFER_CALLBACK callback,
+    void                    *arg
 );
 
 int16_t bmi160_get_info(
+    struct aks_context     *ctx,
     struct AKS_DEVICE_INFO *info
 );
 
 int16_t bmi160_acc_start(
-    const int32_t interval_us
+    struct aks_context *ctx,
+    const int32_t      interval_us
 );
 
 int16_t bmi160_gyr_start(
-    const int32_t interval_us
+    struct aks_context *ctx,
+    const int32_t      interval_us
+);
+
+/*!
+ * Same as #bmi160_acc_start and #bmi160_gyr_start, without blocking the
+ * caller. The result is passed to \c callback in thread context.
+ */
+int16_t bmi160_acc_start_async(
+    struct aks_context      *ctx,
+    const int32_t           interval_us,
+    const AKH_XFER_CALLBACK callback,
+    void                    *arg
+);
+
+int16_t bmi160_gyr_start_async(
+    struct aks_context      *ctx,
+    const int32_t           interval_us,
+    const AKH_XFER_CALLBACK callback,
+    void                    *arg
 );
 
 int16_t bmi160_acc_stop(
-    void
+    struct aks_context *ctx
 );
 
 int16_t bmi160_gyr_stop(
-    void
+    struct aks_context *ctx
 );
 
 int16_t bmi160_acc_check_rdy(
-    const int32_t timeout_us
+    struct aks_context *ctx,
+    const int32_t      timeout_us
 );
 
 int16_t bmi160_gyr_check_rdy(
-    const int32_t timeout_us
+    struct aks_context *ctx,
+    const int32_t      timeout_us
 );
 
 int16_t bmi160_acc_get_data(
+    struct aks_context     *ctx,
     struct AKM_SENSOR_DATA *data,
     uint8_t                *num
 );
 
 int16_t bmi160_gyr_get_data(
+    struct aks_context     *ctx,
     struct AKM_SENSOR_DATA *data,
     uint8_t                *num
 );
 
 int16_t bmi160_acc_self_test(
-    int32_t *result
+    struct aks_context *ctx,
+    int32_t            *result
 );
 
 int16_t bmi160_gyr_self_test(
-    int32_t *result
+    struct aks_context *ctx,
+    int32_t            *result
 );
 #endif /* INCLUDE_AKS_ACC_GYR_BMI160_H */
@@ -19,6 +19,11 @@
 #include "aks_common.h"
 #include "AKM_Common.h"
 
+/* Polling interval of aks_wait_ready when DRDY interrupt is not used.
+ * It starts from MIN and is doubled up to MAX. */
+#define AKS_POLL_MIN_US  100U
+#define AKS_POLL_MAX_US  8000U
+
 void AKS_MyStrcpy(
     char          *dst,
     const char    *src,
@@ -99,4 +104,64 @@ int16_t aks_fst_test_data32(
         *err = AKM_FST_ERRCODE(testno, testdata);
         return AKM_ERROR;
     }
-}
\ No newline at end of file
+}
+
+int16_t aks_wait_ready(
+    struct aks_context  *ctx,
+    const aks_poll_func poll,
+    const uint32_t      event,
+    const int32_t       timeout_us)
+{
+    uint64_t deadline;
+    uint64_t now;
+    uint32_t remain_us;
+    uint32_t step_us;
+    uint32_t wait_us;
+    int16_t  ret;
+
+    ret = poll(ctx);
+
+    if ((ret != 0) || (timeout_us <= 0)) {
+        return ret;
+    }
+
+    deadline = AKH_GetTimeNs() + ((uint64_t)timeout_us * 1000U);
+    step_us = AKS_POLL_MIN_US;
+
+    for (;;) {
+        now = AKH_GetTimeNs();
+
+        if (now >= deadline) {
+            return 0;
+        }
+
+        remain_us = (uint32_t)((deadline - now + 999U) / 1000U);
+
+        if (event != 0U) {
+            /* An event which was signaled before also wakes this up,
+             * so status is read again anyway. */
+            AKH_WaitEvent(event, remain_us, NULL);
+        } else {
+            wait_us = (step_us < remain_us) ? step_us : remain_us;
+
+            /* Sleep in OS tick when it is long enough */
+            if (wait_us >= 1000U) {
+                AKH_DelayMilli((uint16_t)(wait_us / 1000U));
+            } else {
+                AKH_DelayMicro((uint16_t)wait_us);
+            }
+
+            step_us *= 2U;
+
+            if (step_us > AKS_POLL_MAX_US) {
+                step_us = AKS_POLL_MAX_US;
+            }
+        }
+
+        ret = poll(ctx);
+
+        if (ret != 0) {
+            return ret;
+        }
+    }
+}
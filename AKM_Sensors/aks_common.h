@@ -20,6 +20,7 @@
 #define INCLUDE_AKS_COMMON_H
 
 #include "AKM_Common.h"
+#include "AKH_APIs.h"
 
 #define ACC_1G_IN_Q16  (642908)
 
@@ -32,14 +33,29 @@
     if (aks_fst_test_data32((no), (data), (lo), (hi), (err)) != AKM_SUCCESS) \
     { goto SELFTEST_FAIL; }
 
+/* State of one device. Each driver has its own context struct which has
+ * this as the first member, and casts the pointer back to it. */
+struct aks_context {
+    AKH_HANDLE  handle;
+    AKM_DEVICES device;
+};
+
+/* Read status once. Returns the number of new data, 0 or negative error. */
+typedef int16_t (*aks_poll_func)(struct aks_context *ctx);
+
 struct aks_interface {
-    int16_t (* aks_init)(const uint8_t axis_order[3], const uint8_t axis_sign[3]);
-    int16_t (* aks_get_info)(struct AKS_DEVICE_INFO *info);
-    int16_t (* aks_start)(const int32_t interval_us);
-    int16_t (* aks_stop)(void);
-    int16_t (* aks_check_rdy)(const int32_t timeout_us);
-    int16_t (* aks_get_data)(struct AKM_SENSOR_DATA *data, uint8_t *num);
-    int16_t (* aks_self_test)(int32_t *result);
+    int16_t (* aks_init)(struct aks_context *ctx, const uint8_t axis_order[3], const uint8_t axis_sign[3]);
+    int16_t (* aks_get_info)(struct aks_context *ctx, struct AKS_DEVICE_INFO *info);
+    int16_t (* aks_start)(struct aks_context *ctx, const int32_t interval_us);
+    int16_t (* aks_stop)(struct aks_context *ctx);
+    int16_t (* aks_check_rdy)(struct aks_context *ctx, const int32_t timeout_us);
+    int16_t (* aks_get_data)(struct aks_context *ctx, struct AKM_SENSOR_DATA *data, uint8_t *num);
+    int16_t (* aks_self_test)(struct aks_context *ctx, int32_t *result);
+    /* Optional. NULL when the driver reads data in blocking mode only. */
+    int16_t (* aks_get_data_async)(struct aks_context *ctx, struct AKM_SENSOR_DATA *data, AKH_XFER_CALLBACK callback, void *arg);
+    /* Optional. NULL when init and start wait for the device. */
+    int16_t (* aks_init_async)(struct aks_context *ctx, const uint8_t axis_order[3], const uint8_t axis_sign[3], AKH_XFER_CALLBACK callback, void *arg);
+    int16_t (* aks_start_async)(struct aks_context *ctx, const int32_t interval_us, AKH_XFER_CALLBACK callback, void *arg);
 };
 
 void AKS_MyStrcpy(
@@ -70,5 +86,17 @@ int16_t aks_fst_test_data32(
     int32_t  *err
 );
 
+/* Implementation of aks_check_rdy. Status is polled once, then when it is
+ * not ready, the caller sleeps until the data is ready or timeout_us
+ * elapses. When event is not 0, the caller sleeps on that AKH_EVENT_XXX,
+ * which is signaled by DRDY interrupt (the event is consumed). Otherwise
+ * status is polled with exponential backoff. */
+int16_t aks_wait_ready(
+    struct aks_context  *ctx,
+    const aks_poll_func poll,
+    const uint32_t      event,
+    const int32_t       timeout_us
+);
+
 #endif /*INCLUDE_AKS_COMMON_H*/
 
@@ -16,6 +16,8 @@
  * and grant commercial license to you.
  *
  ******************************************************************************/
+#include <string.h>
+
 #include "aks_common.h"
 #include "aks_gyr_l3g4200d.h"
 #include "AKH_APIs.h"
@@ -25,7 +27,6 @@
  * address auto-increment. If the MSb of the SUB field is 1, the SUB (register
  * address) will be automatically incremented to allow multiple data
  * read/write.*/
-#define L3G4200D_REG_WHO_AM_I     0x0F
 #define L3G4200D_REG_CTRL_REG1    0x20
 #define L3G4200D_REG_CTRL_REG2    0x21
 #define L3G4200D_REG_CTRL_REG3    0x22
@@ -39,24 +40,26 @@
 #define L3G4200D_REG_OUT_Z_L_REG  0x2C
 #define L3G4200D_REG_OUT_Z_H_REG  0x2D
 
-#define WHOAMI_VAL_L3G4200D       0xD3
-#define WHOAMI_VAL_L3GD20         0xD4
-
 /* So, add 0x80 when multiple read/write operation is requested.*/
 #define L3G4200D_REG_MULTIPLE(reg)  ((reg) + 0x80)
 
 /* Power */
-#define L3G4200D_CTRL_REG1_SET_POWERDOWN(val)  ((val) & 0xF7)
-#define L3G4200D_CTRL_REG1_SET_NORMAL(val)     ((val) | 0x08)
+/* PD bit. 0 power down, 1 normal mode. */
+#define L3G4200D_CTRL_REG1_PD  (0x08)
 
 /* */
 #define L3G4200D_SENSITIVITY_2000_Q16  (4588) /* 0.070 in Q16 */
 #define L3G4200D_SENSITIVITY_500_Q16   (1147) /* 0.0175 in Q16 */
 #define L3G4200D_SENSITIVITY_250_Q16   (574)  /* 0.00875 in Q16 */
 
-static AKM_DEVICES g_device = AKM_DEVICE_NONE;
-static uint8_t     g_gyr_axis_order[3];
-static uint8_t     g_gyr_axis_sign[3];
+/* Per device state. */
+struct l3g4200d_context {
+    struct aks_context base;
+    uint8_t            axis_order[3];
+    uint8_t            axis_sign[3];
+};
+
+static struct l3g4200d_context g_ctx[AKH_MAX_DEVICES];
 
 static struct aks_interface l3g4200d_interface = {
     .aks_init = l3g4200d_init,
@@ -71,13 +74,20 @@ static struct aks_interface l3g4200d_interface = {
 /******************************************************************************/
 /***** AKS public APIs ********************************************************/
 int16_t l3g4200d_config(
-    AKM_DEVICES          *gyr_dev,
+    const AKH_HANDLE     handle,
+    struct aks_context   **gyr_ctx,
     struct aks_interface **gyr_if)
 {
-    uint8_t whoami;
-    int16_t fret;
+    struct l3g4200d_context *c;
+    AKM_DEVICES             device;
+    uint8_t                 whoami;
+    int16_t                 fret;
 
-    fret = AKH_RxData(AKM_ST_GYR, L3G4200D_REG_WHO_AM_I, &whoami, 1);
+    if (handle >= AKH_MAX_DEVICES) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    fret = AKH_RxData(handle, L3G4200D_REG_WHO_AM_I, &whoami, 1);
 
     if (fret != AKM_SUCCESS) {
         return fret;
@@ -85,28 +95,35 @@ int16_t l3g4200d_config(
 
     switch (whoami) {
     case WHOAMI_VAL_L3G4200D:
-        g_device = AKM_GYROSCOPE_L3G4200D;
+        device = AKM_GYROSCOPE_L3G4200D;
         break;
 
     case WHOAMI_VAL_L3GD20:
-        g_device = AKM_GYROSCOPE_L3GD20;
+        device = AKM_GYROSCOPE_L3GD20;
         break;
 
     default:
         return AKM_ERR_NOT_SUPPORT;
     }
 
-    *gyr_dev = g_device;
+    c = &g_ctx[handle];
+    memset(c, 0, sizeof(*c));
+    c->base.handle = handle;
+    c->base.device = device;
+
+    *gyr_ctx = &c->base;
     *gyr_if = &l3g4200d_interface;
     return AKM_SUCCESS;
 }
 
 int16_t l3g4200d_init(
-    const uint8_t axis_order[3],
-    const uint8_t axis_sign[3])
+    struct aks_context *ctx,
+    const uint8_t      axis_order[3],
+    const uint8_t      axis_sign[3])
 {
-    uint8_t i2cData;
-    int16_t fret;
+    struct l3g4200d_context *c = (struct l3g4200d_context *)ctx;
+    uint8_t                 i2cData;
+    int16_t                 fret;
 
     /* Init sequence ignores reset value! */
 
@@ -116,7 +133,7 @@ int16_t l3g4200d_init(
     /* 1010x111: ODR=380Hz, Cut-Off= 50 */
     /* 1011x111: ODR=380Hz, Cut-Off=100 */
     i2cData = 0x97;
-    fret = AKH_TxData(AKM_ST_GYR, L3G4200D_REG_CTRL_REG1, &i2cData, 1);
+    fret = AKH_TxData(ctx->handle, L3G4200D_REG_CTRL_REG1, &i2cData, 1);
 
     if (fret != AKM_SUCCESS) {
         return fret;
@@ -129,25 +146,27 @@ int16_t l3g4200d_init(
     /* CTRL_REG4[0]  : SPI serial. 0 4-wire, 1 3-wire.*/
     /* set range */
     i2cData = 0x20;
-    fret = AKH_TxData(AKM_ST_GYR, L3G4200D_REG_CTRL_REG4, &i2cData, 1);
+    fret = AKH_TxData(ctx->handle, L3G4200D_REG_CTRL_REG4, &i2cData, 1);
 
     if (fret != AKM_SUCCESS) {
         return fret;
     }
 
     /* axis conversion parameter */
-    g_gyr_axis_order[0] = axis_order[0];
-    g_gyr_axis_order[1] = axis_order[1];
-    g_gyr_axis_order[2] = axis_order[2];
-    g_gyr_axis_sign[0] = axis_sign[0];
-    g_gyr_axis_sign[1] = axis_sign[1];
-    g_gyr_axis_sign[2] = axis_sign[2];
+    c->axis_order[0] = axis_order[0];
+    c->axis_order[1] = axis_order[1];
+    c->axis_order[2] = axis_order[2];
+    c->axis_sign[0] = axis_sign[0];
+    c->axis_sign[1] = axis_sign[1];
+    c->axis_sign[2] = axis_sign[2];
     return AKM_SUCCESS;
 }
 
-int16_t l3g4200d_get_info(struct AKS_DEVICE_INFO *info)
+int16_t l3g4200d_get_info(
+    struct aks_context     *ctx,
+    struct AKS_DEVICE_INFO *info)
 {
-    switch (g_device) {
+    switch (ctx->device) {
     case AKM_GYROSCOPE_L3G4200D:
         AKS_MyStrcpy(info->name, "L3G4200D", AKS_INFO_NAME_SIZE);
         break;
@@ -160,61 +179,35 @@ int16_t l3g4200d_get_info(struct AKS_DEVICE_INFO *info)
         return AKM_ERR_NOT_SUPPORT;
     }
 
-    info->device = g_device;
+    info->device = ctx->device;
     return AKM_SUCCESS;
 }
 
-int16_t l3g4200d_start(const int32_t interval_us)
+int16_t l3g4200d_start(
+    struct aks_context *ctx,
+    const int32_t      interval_us)
 {
-    uint8_t i2cData;
-    int16_t fret;
-
-    /* Read power control register */
-    fret = AKH_RxData(AKM_ST_GYR, L3G4200D_REG_CTRL_REG1, &i2cData, 1);
-
-    if (fret != AKM_SUCCESS) {
-        return fret;
-    }
-
-    i2cData = L3G4200D_CTRL_REG1_SET_NORMAL(i2cData);
-    fret = AKH_TxData(AKM_ST_GYR, L3G4200D_REG_CTRL_REG1, &i2cData, 1);
-
-    if (fret != AKM_SUCCESS) {
-        return fret;
-    }
-
-    return AKM_SUCCESS;
+    /* set to normal mode */
+    return AKH_UpdateBits(
+            ctx->handle, L3G4200D_REG_CTRL_REG1,
+            L3G4200D_CTRL_REG1_PD, L3G4200D_CTRL_REG1_PD);
 }
 
-int16_t l3g4200d_stop(void)
+int16_t l3g4200d_stop(struct aks_context *ctx)
 {
-    uint8_t i2cData;
-    int16_t fret;
-
-    /* Read power control register */
-    fret = AKH_RxData(AKM_ST_GYR, L3G4200D_REG_CTRL_REG1, &i2cData, 1);
-
-    if (fret != AKM_SUCCESS) {
-        return fret;
-    }
-
-    i2cData = L3G4200D_CTRL_REG1_SET_POWERDOWN(i2cData);
-    fret = AKH_TxData(AKM_ST_GYR, L3G4200D_REG_CTRL_REG1, &i2cData, 1);
-
-    if (fret != AKM_SUCCESS) {
-        return fret;
-    }
-
-    return AKM_SUCCESS;
+    /* set to power down mode */
+    return AKH_UpdateBits(
+            ctx->handle, L3G4200D_REG_CTRL_REG1,
+            L3G4200D_CTRL_REG1_PD, 0);
 }
 
-int16_t l3g4200d_check_rdy(const int32_t timeout_us)
+static int16_t l3g4200d_poll_rdy(struct aks_context *ctx)
 {
     uint8_t i2cData;
     int16_t fret;
 
     /* Read power status register */
-    fret = AKH_RxData(AKM_ST_GYR, L3G4200D_REG_STATUS_REG, &i2cData, 1);
+    fret = AKH_RxData(ctx->handle, L3G4200D_REG_STATUS_REG, &i2cData, 1);
 
     if (fret != AKM_SUCCESS) {
         return fret;
@@ -223,14 +216,24 @@ int16_t l3g4200d_check_rdy(const int32_t timeout_us)
     return ((0x80 & i2cData) != 0);
 }
 
+int16_t l3g4200d_check_rdy(
+    struct aks_context *ctx,
+    const int32_t      timeout_us)
+{
+    /* DRDY pin is not used, poll status */
+    return aks_wait_ready(ctx, l3g4200d_poll_rdy, 0U, timeout_us);
+}
+
 int16_t l3g4200d_get_data(
+    struct aks_context     *ctx,
     struct AKM_SENSOR_DATA *data,
     uint8_t                *num)
 {
-    uint8_t i2cData[6];
-    int16_t tmp;
-    int16_t fret;
-    uint8_t i;
+    struct l3g4200d_context *c = (struct l3g4200d_context *)ctx;
+    uint8_t                 i2cData[6];
+    int16_t                 tmp;
+    int16_t                 fret;
+    uint8_t                 i;
 
     /* check arg */
     if (*num < 1) {
@@ -239,7 +242,7 @@ int16_t l3g4200d_get_data(
 
     /* Read data */
     fret = AKH_RxData(
-            AKM_ST_GYR,
+            ctx->handle,
             L3G4200D_REG_MULTIPLE(L3G4200D_REG_OUT_X_L_REG),
             i2cData,
             6);
@@ -255,7 +258,7 @@ int16_t l3g4200d_get_data(
         data->u.v[i] = (tmp * L3G4200D_SENSITIVITY_2000_Q16);
     }
 
-    AKS_ConvertCoordinate(data->u.v, g_gyr_axis_order, g_gyr_axis_sign);
+    AKS_ConvertCoordinate(data->u.v, c->axis_order, c->axis_sign);
 
     data->stype = AKM_ST_GYR;
     data->timestamp = AKH_GetTimestamp();
@@ -263,7 +266,9 @@ int16_t l3g4200d_get_data(
     return AKM_SUCCESS;
 }
 
-int16_t l3g4200d_self_test(int32_t *result)
+int16_t l3g4200d_self_test(
+    struct aks_context *ctx,
+    int32_t            *result)
 {
     return AKM_ERR_NOT_SUPPORT;
 }
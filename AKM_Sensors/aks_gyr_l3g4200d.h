@@ -21,39 +21,51 @@
 #include "AKM_Common.h"
 #include "AKS_APIs.h"
 
+/* ID register. Auto-detection reads it too. */
+#define L3G4200D_REG_WHO_AM_I     0x0F
+#define WHOAMI_VAL_L3G4200D       0xD3
+#define WHOAMI_VAL_L3GD20         0xD4
+
 int16_t l3g4200d_config(
-    AKM_DEVICES *gyr_dev,
+    const AKH_HANDLE     handle,
+    struct aks_context   **gyr_ctx,
     struct aks_interface **gyr_if
 );
 
 int16_t l3g4200d_init(
-    const uint8_t axis_order[3],
-    const uint8_t axis_sign[3]
+    struct aks_context *ctx,
+    const uint8_t      axis_order[3],
+    const uint8_t      axis_sign[3]
 );
 
 int16_t l3g4200d_get_info(
+    struct aks_context     *ctx,
     struct AKS_DEVICE_INFO *info
 );
 
 int16_t l3g4200d_start(
-    const int32_t interval_us
+    struct aks_context *ctx,
+    const int32_t      interval_us
 );
 
 int16_t l3g4200d_stop(
-    void
+    struct aks_context *ctx
 );
 
 int16_t l3g4200d_check_rdy(
-    const int32_t timeout_us
+    struct aks_context *ctx,
+    const int32_t      timeout_us
 );
 
 int16_t l3g4200d_get_data(
+    struct aks_context     *ctx,
     struct AKM_SENSOR_DATA *data,
     uint8_t                *num
 );
 
 int16_t l3g4200d_self_test(
-    int32_t *result
+    struct aks_context *ctx,
+    int32_t            *result
 );
 
 #endif /* INCLUDE_AKS_GYR_L3G4200D_H */
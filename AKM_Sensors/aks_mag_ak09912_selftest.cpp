@@ -103,7 +103,9 @@
  * \result upper_16bit test number
  * \result lower_16bit test result data.
  */
-int16_t ak09912_self_test(int32_t *result)
+int16_t ak09912_self_test(
+    struct aks_context *ctx,
+    int32_t            *result)
 {
     int16_t fret;
     uint8_t i2cData[AK099XX_BDATA_SIZE];
@@ -115,7 +117,7 @@ int16_t ak09912_self_test(int32_t *result)
      **********************************************************************/
 
     /* Soft Reset */
-    fret = ak099xx_soft_reset();
+    fret = ak099xx_soft_reset(ctx);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_RST, fret);
@@ -126,7 +128,7 @@ int16_t ak09912_self_test(int32_t *result)
     AKH_DelayMicro(100);
 
     /* Read values. */
-    fret = AKH_RxData(AKM_ST_MAG, AK099XX_REG_WIA1, i2cData, 2);
+    fret = AKH_RxData(ctx->handle, AK099XX_REG_WIA1, i2cData, 2);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_RST_READ, fret);
@@ -139,14 +141,14 @@ int16_t ak09912_self_test(int32_t *result)
             TLIMIT_HI_RST_WIA2, result);
 
     /* Read FUSE ROM value */
-    fret = ak099xx_set_mode(AK099XX_MODE_FUSE_ACCESS);
+    fret = ak099xx_set_mode(ctx, AK099XX_MODE_FUSE_ACCESS);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_FUSE_SET, fret);
         goto SELFTEST_FAIL;
     }
 
-    fret = AKH_RxData(AKM_ST_MAG, AK099XX_FUSE_ASAX, asa, 3);
+    fret = AKH_RxData(ctx->handle, AK099XX_FUSE_ASAX, asa, 3);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_FUSE_READ, fret);
@@ -157,7 +159,7 @@ int16_t ak09912_self_test(int32_t *result)
     AKM_FST(TLIMIT_NO_ASAY, asa[1], TLIMIT_LO_ASAY, TLIMIT_HI_ASAY, result);
     AKM_FST(TLIMIT_NO_ASAZ, asa[2], TLIMIT_LO_ASAZ, TLIMIT_HI_ASAZ, result);
 
-    fret = ak099xx_set_mode(AK099XX_MODE_POWER_DOWN);
+    fret = ak099xx_set_mode(ctx, AK099XX_MODE_POWER_DOWN);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_FUSE_PDN, fret);
@@ -170,7 +172,7 @@ int16_t ak09912_self_test(int32_t *result)
 
     /* Set temperature measurement */
     i2cData[0] = 0x80;
-    fret = AKH_TxData(AKM_ST_MAG, AK099XX_REG_CNTL1, i2cData, 1);
+    fret = AKH_TxData(ctx->handle, AK099XX_REG_CNTL1, i2cData, 1);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_SNG_CNTL1, fret);
@@ -178,7 +180,7 @@ int16_t ak09912_self_test(int32_t *result)
     }
 
     /* Set to SNG measurement pattern. */
-    fret = ak099xx_set_mode(AK099XX_MODE_SNG_MEASURE);
+    fret = ak099xx_set_mode(ctx, AK099XX_MODE_SNG_MEASURE);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_SNG_CNTL2, fret);
@@ -192,7 +194,7 @@ int16_t ak09912_self_test(int32_t *result)
      * Get measurement data from AK09912
      * ST1 + (HXL/H) + (HYL/H) + (HZL/H) + TMPS + ST2 = 9bytes */
     fret = AKH_RxData(
-            AKM_ST_MAG, AK099XX_REG_ST1, i2cData, AK099XX_BDATA_SIZE);
+            ctx->handle, AK099XX_REG_ST1, i2cData, AK099XX_BDATA_SIZE);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_SNG_WAIT, fret);
@@ -218,7 +220,7 @@ int16_t ak09912_self_test(int32_t *result)
             TLIMIT_HI_SNG_ST2, result);
 
     /* Set to self-test mode. */
-    fret = ak099xx_set_mode(AK099XX_MODE_SELF_TEST);
+    fret = ak099xx_set_mode(ctx, AK099XX_MODE_SELF_TEST);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_SLF_CNTL2, fret);
@@ -232,7 +234,7 @@ int16_t ak09912_self_test(int32_t *result)
      * Get measurement data from AK09912
      * ST1 + (HXL/H) + (HYL/H) + (HZL/H) + TMPS + ST2 = 9bytes */
     fret = AKH_RxData(
-            AKM_ST_MAG, AK099XX_REG_ST1, i2cData, AK099XX_BDATA_SIZE);
+            ctx->handle, AK099XX_REG_ST1, i2cData, AK099XX_BDATA_SIZE);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_SLF_WAIT, fret);
@@ -81,7 +81,9 @@
  * \result upper_16bit test number
  * \result lower_16bit test result data.
  */
-int16_t ak09913_self_test(int32_t *result)
+int16_t ak09913_self_test(
+    struct aks_context *ctx,
+    int32_t            *result)
 {
     int16_t fret;
     uint8_t i2cData[AK099XX_BDATA_SIZE];
@@ -95,7 +97,7 @@ int16_t ak09913_self_test(int32_t *result)
      **********************************************************************/
 
     /* Soft Reset */
-    fret = ak099xx_soft_reset();
+    fret = ak099xx_soft_reset(ctx);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_RST, fret);
@@ -106,7 +108,7 @@ int16_t ak09913_self_test(int32_t *result)
     AKH_DelayMicro(100);
 
     /* Read values. */
-    fret = AKH_RxData(AKM_ST_MAG, AK099XX_REG_WIA1, i2cData, 2);
+    fret = AKH_RxData(ctx->handle, AK099XX_REG_WIA1, i2cData, 2);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_RST_READ, fret);
@@ -123,7 +125,7 @@ int16_t ak09913_self_test(int32_t *result)
      **********************************************************************/
 
     /* Set to SNG measurement pattern. */
-    fret = ak099xx_set_mode(AK099XX_MODE_SNG_MEASURE);
+    fret = ak099xx_set_mode(ctx, AK099XX_MODE_SNG_MEASURE);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_SNG_CNTL2, fret);
@@ -137,7 +139,7 @@ int16_t ak09913_self_test(int32_t *result)
      * Get measurement data from AK09913
      * ST1 + (HXL/H) + (HYL/H) + (HZL/H) + TMPS + ST2 = 9bytes */
     fret = AKH_RxData(
-            AKM_ST_MAG, AK099XX_REG_ST1, i2cData, AK099XX_BDATA_SIZE);
+            ctx->handle, AK099XX_REG_ST1, i2cData, AK099XX_BDATA_SIZE);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_SNG_WAIT, fret);
@@ -161,7 +163,7 @@ int16_t ak09913_self_test(int32_t *result)
             TLIMIT_HI_SNG_ST2, result);
 
     /* Set to self-test mode. */
-    fret = ak099xx_set_mode(AK099XX_MODE_SELF_TEST);
+    fret = ak099xx_set_mode(ctx, AK099XX_MODE_SELF_TEST);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_SLF_CNTL2, fret);
@@ -177,7 +179,7 @@ int16_t ak09913_self_test(int32_t *result)
      * Get measurement data from AK09913
      * ST1 + (HXL + HXH) + (HYL + HYH) + (HZL + HZH) + TMPS + ST2 = 9bytes */
     fret = AKH_RxData(
-            AKM_ST_MAG, AK099XX_REG_ST1, i2cData, AK099XX_BDATA_SIZE);
+            ctx->handle, AK099XX_REG_ST1, i2cData, AK099XX_BDATA_SIZE);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_SLF_WAIT, fret);
@@ -83,7 +83,9 @@
  * \result upper_16bit test number
  * \result lower_16bit test result data.
  */
-int16_t ak09919_self_test(int32_t *result)
+int16_t ak09919_self_test(
+    struct aks_context *ctx,
+    int32_t            *result)
 {
     int16_t fret;
     uint8_t i2cData[AK099XX_BDATA_SIZE+1];
@@ -98,7 +100,7 @@ int16_t ak09919_self_test(int32_t *result)
      **********************************************************************/
 
     /* Soft Reset */
-    fret = ak099xx_soft_reset();
+    fret = ak099xx_soft_reset(ctx);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_RST, fret);
@@ -109,7 +111,7 @@ int16_t ak09919_self_test(int32_t *result)
     AKH_DelayMicro(100);
 
     /* Read values. */
-    fret = AKH_RxData(AKM_ST_MAG, AK099XX_REG_WIA1, i2cData, 2);
+    fret = AKH_RxData(ctx->handle, AK099XX_REG_WIA1, i2cData, 2);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_RST_READ, fret);
@@ -128,7 +130,7 @@ int16_t ak09919_self_test(int32_t *result)
     AKH_Print("* Step 2 *\n");
 #endif
     /* Set to SNG measurement pattern. */
-    fret = ak099xx_set_mode(AK099XX_MODE_SNG_MEASURE);
+    fret = ak099xx_set_mode(ctx, AK099XX_MODE_SNG_MEASURE);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_SNG_CNTL2, fret);
@@ -141,7 +143,7 @@ int16_t ak09919_self_test(int32_t *result)
     /*
      * Get measurement data from AK09919
      * ST1 */
-    fret = AKH_RxData(AKM_ST_MAG, AK099XX_REG_ST1, i2cData, 1);
+    fret = AKH_RxData(ctx->handle, AK099XX_REG_ST1, i2cData, 1);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_SNG_WAIT, fret);
@@ -151,7 +153,7 @@ int16_t ak09919_self_test(int32_t *result)
     
     /*
      * (HXH/L) + (HYH/L) + (HZH/L) + TMPS + ST2 = 8bytes */
-    fret = AKH_RxData(AKM_ST_MAG, AK099XX_REG_MEASURE_DATA_HEAD, i2cData, AK099XX_BDATA_SIZE - 1);
+    fret = AKH_RxData(ctx->handle, AK099XX_REG_MEASURE_DATA_HEAD, i2cData, AK099XX_BDATA_SIZE - 1);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_SNG_WAIT, fret);
@@ -176,10 +178,10 @@ int16_t ak09919_self_test(int32_t *result)
             TLIMIT_LO_SNG_ST2, TLIMIT_HI_SNG_ST2, result);
     
     /* Set to SNG measurement pattern. */
-    fret = ak099xx_set_mode(AK099XX_MODE_POWER_DOWN);
+    fret = ak099xx_set_mode(ctx, AK099XX_MODE_POWER_DOWN);
     
     /* Set to self-test mode. */
-    fret = ak099xx_set_mode(AK099XX_MODE_SELF_TEST);
+    fret = ak099xx_set_mode(ctx, AK099XX_MODE_SELF_TEST);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_SLF_CNTL2, fret);
@@ -194,7 +196,7 @@ int16_t ak09919_self_test(int32_t *result)
     /*
      * Get measurement data from AK09919
      * ST1 */
-    fret = AKH_RxData(AKM_ST_MAG, AK099XX_REG_ST1, i2cData, 1);
+    fret = AKH_RxData(ctx->handle, AK099XX_REG_ST1, i2cData, 1);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_SLF_WAIT, fret);
@@ -204,7 +206,7 @@ int16_t ak09919_self_test(int32_t *result)
     
     /*
      * (HXH/L) + (HYH/L) + (HZH/L) + TMPS + ST2 = 8bytes */
-    fret = AKH_RxData(AKM_ST_MAG, AK099XX_REG_MEASURE_DATA_HEAD, i2cData, AK099XX_BDATA_SIZE - 1);
+    fret = AKH_RxData(ctx->handle, AK099XX_REG_MEASURE_DATA_HEAD, i2cData, AK099XX_BDATA_SIZE - 1);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_SNG_WAIT, fret);
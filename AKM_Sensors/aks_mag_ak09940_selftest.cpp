@@ -81,7 +81,9 @@
  * \result upper_16bit test number
  * \result lower_16bit test result data.
  */
-int16_t ak09940_self_test(int32_t *result)
+int16_t ak09940_self_test(
+    struct aks_context *ctx,
+    int32_t            *result)
 {
     int16_t fret;
     uint8_t i2cData[AK0994X_BDATA_SIZE];
@@ -95,7 +97,7 @@ int16_t ak09940_self_test(int32_t *result)
      **********************************************************************/
 
     /* Soft Reset */
-    fret = ak0994x_soft_reset();
+    fret = ak0994x_soft_reset(ctx);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_RST, fret);
@@ -105,7 +107,7 @@ int16_t ak09940_self_test(int32_t *result)
     AKH_DelayMicro(100);
 
     /* Read values. */
-    fret = AKH_RxData(AKM_ST_MAG, AK0994X_REG_WIA1, i2cData, 2);
+    fret = AKH_RxData(ctx->handle, AK0994X_REG_WIA1, i2cData, 2);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_RST_READ, fret);
@@ -122,7 +124,7 @@ int16_t ak09940_self_test(int32_t *result)
      **********************************************************************/
 
     /* Set to SNG measurement pattern. */
-    fret = ak0994x_set_mode(AK0994X_MODE_SNG_MEASURE);
+    fret = ak0994x_set_mode(ctx, AK0994X_MODE_SNG_MEASURE);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_SNG_CNTL2, fret);
@@ -136,7 +138,7 @@ int16_t ak09940_self_test(int32_t *result)
      * Get measurement data from AK09940
      * ST1 + (HXL/M/H) + (HYL/M/H) + (HZL/M/H) + TMPS + ST2 = 12bytes */
     fret = AKH_RxData(
-            AKM_ST_MAG, AK0994X_REG_ST1, i2cData, AK0994X_BDATA_SIZE);
+            ctx->handle, AK0994X_REG_ST1, i2cData, AK0994X_BDATA_SIZE);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_SNG_WAIT, fret);
@@ -169,7 +171,7 @@ int16_t ak09940_self_test(int32_t *result)
             TLIMIT_HI_SNG_ST2, result);
 
     /* Set to self-test mode. */
-    fret = ak0994x_set_mode(AK0994X_MODE_SELF_TEST);
+    fret = ak0994x_set_mode(ctx, AK0994X_MODE_SELF_TEST);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_SLF_CNTL2, fret);
@@ -183,7 +185,7 @@ int16_t ak09940_self_test(int32_t *result)
      * Get measurement data from AK09940
      * ST1 + (HXL/M/H) + (HYL/M/H) + (HZL/M/H) + TMPS + ST2 = 12bytes */
     fret = AKH_RxData(
-            AKM_ST_MAG, AK0994X_REG_ST1, i2cData, AK0994X_BDATA_SIZE);
+            ctx->handle, AK0994X_REG_ST1, i2cData, AK0994X_BDATA_SIZE);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_SLF_WAIT, fret);
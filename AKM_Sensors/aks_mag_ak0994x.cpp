@@ -16,6 +16,8 @@
  * and grant commercial license to you.
  *
  ******************************************************************************/
+#include <string.h>
+
 #include "AKH_APIs.h"
 #include "ak0994x_register.h"
 #include "aks_common.h"
@@ -25,17 +27,33 @@
 
 #define AVE_TIMES   4
 
-/* Global variable for ASA value. */
-static AKM_DEVICES g_device = AKM_DEVICE_NONE;
-static int32_t     g_raw_to_micro_q16[3];
-static uint8_t     g_mag_axis_order[3];
-static uint8_t     g_mag_axis_sign[3];
+/* Per device state. */
+struct ak0994x_context {
+    struct aks_context     base;
+    int32_t                raw_to_micro_q16[3];
+    uint8_t                axis_order[3];
+    uint8_t                axis_sign[3];
+#ifdef AKM_MAGNETOMETER_DRDY_EN
+    AKM_TIMESTAMP          drdy_ts;
+#endif
+    /* asynchronous read */
+    uint8_t                async_buf[AK0994X_BDATA_SIZE];
+    struct AKM_SENSOR_DATA *async_data;
+    AKM_TIMESTAMP          async_ts;
+    AKH_XFER_CALLBACK      async_cb;
+    void                   *async_arg;
+};
+
+static struct ak0994x_context g_ctx[AKH_MAX_DEVICES];
 
 #ifdef AKM_MAGNETOMETER_DRDY_EN
-static AKM_TIMESTAMP g_mag_ts;
+/* There is one DRDY line, so only the first device initialized owns it. */
+static struct ak0994x_context *g_drdy_owner = NULL;
 void mag_ak0994x_irq_handler(void)
 {
-    g_mag_ts = AKH_GetTimestamp();
+    if (g_drdy_owner != NULL) {
+        g_drdy_owner->drdy_ts = AKH_GetTimestamp();
+    }
 }
 #endif
 
@@ -46,23 +64,26 @@ static struct aks_interface ak0994x_interface = {
     .aks_stop = ak0994x_stop,
     .aks_check_rdy = ak0994x_check_rdy,
     .aks_get_data = ak0994x_get_data,
-    .aks_self_test = NULL
+    .aks_self_test = ak09940a_self_test,
+    .aks_get_data_async = ak0994x_get_data_async
 };
 
-static int32_t ak0994x_self_test_compensation(void)
+#ifdef AKM_USE_SELF_TEST_COMPENSATION_AK09940
+static int32_t ak0994x_self_test_compensation(struct aks_context *ctx)
 {
-    uint8_t i2cData[AK0994X_BDATA_SIZE];
-    uint8_t i;
-    uint8_t num;
-    int16_t fret;
-    int32_t tmp;
-    int32_t ave_cur[3] = {0};
-    int16_t ref[3];
+    struct ak0994x_context *c = (struct ak0994x_context *)ctx;
+    uint8_t                i2cData[AK0994X_BDATA_SIZE];
+    uint8_t                i;
+    uint8_t                num;
+    int16_t                fret;
+    int32_t                tmp;
+    int32_t                ave_cur[3] = {0};
+    int16_t                ref[3];
 
     for (num = 0; num < AVE_TIMES; num++) {
         /* Set to self-test mode. */
         i2cData[0] = 0x70;
-        fret = AKH_TxData(AKM_ST_MAG, AK0994X_REG_CNTL3, &i2cData[0], 1);
+        fret = AKH_TxData(ctx->handle, AK0994X_REG_CNTL3, &i2cData[0], 1);
 
         if (fret != AKM_SUCCESS) {
             return fret;
@@ -73,7 +94,7 @@ static int32_t ak0994x_self_test_compensation(void)
 
         /* Read data */
         fret = AKH_RxData(
-                AKM_ST_MAG, AK0994X_REG_ST1, i2cData, AK0994X_BDATA_SIZE);
+                ctx->handle, AK0994X_REG_ST1, i2cData, AK0994X_BDATA_SIZE);
 
         if (fret != AKM_SUCCESS) {
             return fret;
@@ -96,7 +117,7 @@ static int32_t ak0994x_self_test_compensation(void)
 
     /* Read reference data */
     fret = AKH_RxData(
-            AKM_ST_MAG, AK0994X_REG_SXL, i2cData, AK0994X_SDATA_SIZE);
+            ctx->handle, AK0994X_REG_SXL, i2cData, AK0994X_SDATA_SIZE);
 
     if (fret != AKM_SUCCESS) {
         return fret;
@@ -116,27 +137,35 @@ static int32_t ak0994x_self_test_compensation(void)
     }
 
     /* Converts from normal to compensated data. */
-    g_raw_to_micro_q16[0] = SENS_0010_Q16 * ref[0] / ave_cur[0];
-    g_raw_to_micro_q16[1] = SENS_0010_Q16 * ref[1] / ave_cur[1];
-    g_raw_to_micro_q16[2] = SENS_0010_Q16 * ref[2] / ave_cur[2];
+    c->raw_to_micro_q16[0] = SENS_0010_Q16 * ref[0] / ave_cur[0];
+    c->raw_to_micro_q16[1] = SENS_0010_Q16 * ref[1] / ave_cur[1];
+    c->raw_to_micro_q16[2] = SENS_0010_Q16 * ref[2] / ave_cur[2];
 
     return AKM_SUCCESS;
 }
+#endif
 
 /******************************************************************************/
 /***** AKS public APIs ********************************************************/
 int16_t ak0994x_config(
-    AKM_DEVICES          *mag_dev,
+    const AKH_HANDLE     handle,
+    struct aks_context   **mag_ctx,
     struct aks_interface **mag_if)
 {
-    uint8_t  i2cData[4];
-    uint16_t dev;
-    int16_t  fret;
+    struct ak0994x_context *c;
+    AKM_DEVICES            device;
+    uint8_t                i2cData[4];
+    uint16_t               dev;
+    int16_t                fret;
+
+    if (handle >= AKH_MAX_DEVICES) {
+        return AKM_ERR_INVALID_ARG;
+    }
 
     AKH_Print("ak0994x_config: Start\n");
 
     /* Read WIA */
-    fret = AKH_RxData(AKM_ST_MAG, AK0994X_REG_WIA1, i2cData, 4);
+    fret = AKH_RxData(handle, AK0994X_REG_WIA1, i2cData, 4);
 
     if (fret != AKM_SUCCESS) {
         AKH_Print("ak0994x_config: Failed to read WIA\n");
@@ -150,8 +179,7 @@ int16_t ak0994x_config(
     /* Detect device number */
     switch (dev) {
     case AK09940A_WIA_VAL:
-        g_device = AKM_MAGNETOMETER_AK09940A;
-        ak0994x_interface.aks_self_test = ak09940a_self_test;
+        device = AKM_MAGNETOMETER_AK09940A;
         AKH_Print("ak0994x_config: Detected AKM_MAGNETOMETER_AK09940A\n");
         break;
     default:
@@ -159,7 +187,12 @@ int16_t ak0994x_config(
         return AKM_ERR_NOT_SUPPORT;
     }
 
-    *mag_dev = g_device;
+    c = &g_ctx[handle];
+    memset(c, 0, sizeof(*c));
+    c->base.handle = handle;
+    c->base.device = device;
+
+    *mag_ctx = &c->base;
     *mag_if = &ak0994x_interface;
 
     AKH_Print("ak0994x_config: End\n");
@@ -167,14 +200,17 @@ int16_t ak0994x_config(
     return AKM_SUCCESS;
 }
 
-int16_t ak0994x_set_mode(const uint8_t mode)
+int16_t ak0994x_set_mode(
+    struct aks_context *ctx,
+    const uint8_t      mode)
 {
     uint8_t i2cData;
     int16_t fret;
 
 #ifdef AKM_USE_ULTRA_LOW_POWER_DRIVE_AK09940
-    i2cData = 0x80;
-    fret = AKH_TxData(AKM_ST_MAG, AK0994X_REG_CNTL1, &i2cData, 1);
+    fret = AKH_UpdateBits(
+            ctx->handle, AK0994X_REG_CNTL1,
+            0xFF, AK0994X_MODE_ULTRA_LOW_POWER_DRIVE);
 
     if (fret != AKM_SUCCESS) {
         return fret;
@@ -197,7 +233,15 @@ int16_t ak0994x_set_mode(const uint8_t mode)
         // Set Low noise drive 2
         i2cData |= 0x60;
     }
-    fret = AKH_TxData(AKM_ST_MAG, AK0994X_REG_CNTL3, &i2cData, 1);
+
+    if (mode == AK0994X_MODE_POWER_DOWN) {
+        /* The part leaves a mode by itself only to power-down, so
+         * a shadowed power-down is never stale. */
+        fret = AKH_UpdateBits(
+                ctx->handle, AK0994X_REG_CNTL3, 0xFF, i2cData);
+    } else {
+        fret = AKH_TxData(ctx->handle, AK0994X_REG_CNTL3, &i2cData, 1);
+    }
 
     if (fret != AKM_SUCCESS) {
         return fret;
@@ -208,64 +252,73 @@ int16_t ak0994x_set_mode(const uint8_t mode)
     return AKM_SUCCESS;
 }
 
-int16_t ak0994x_soft_reset(void)
+int16_t ak0994x_soft_reset(struct aks_context *ctx)
 {
     uint8_t i2cData;
     int16_t fret;
 
     /* Soft Reset */
     i2cData = AK0994X_SOFT_RESET;
-    fret = AKH_TxData(AKM_ST_MAG, AK0994X_REG_CNTL4, &i2cData, 1);
+    fret = AKH_TxData(ctx->handle, AK0994X_REG_CNTL4, &i2cData, 1);
 
     if (fret != AKM_SUCCESS) {
         return fret;
     }
 
+    /* all registers are back to the default value */
+    AKH_InvalidateCache(ctx->handle);
+
     /* When succeeded, sleep 'Twait' */
     AKH_DelayMicro(100);
     return AKM_SUCCESS;
 }
 
 int16_t ak0994x_init(
-    const uint8_t axis_order[3],
-    const uint8_t axis_sign[3])
+    struct aks_context *ctx,
+    const uint8_t      axis_order[3],
+    const uint8_t      axis_sign[3])
 {
-    int16_t fret;
+    struct ak0994x_context *c = (struct ak0994x_context *)ctx;
+    int16_t                fret;
 
-    fret = ak0994x_soft_reset();
+    fret = ak0994x_soft_reset(ctx);
 
     if (fret != AKM_SUCCESS) {
         return fret;
     }
 
 #ifdef AKM_MAGNETOMETER_DRDY_EN
-    fret = AKH_SetIRQHandler(IRQ_MAG_1, mag_ak0994x_irq_handler);
+    if ((g_drdy_owner == NULL) || (g_drdy_owner == c)) {
+        fret = AKH_SetIRQHandler(IRQ_MAG_1, mag_ak0994x_irq_handler);
 
-    if (fret != AKM_SUCCESS) {
-        return fret;
+        if (fret != AKM_SUCCESS) {
+            return fret;
+        }
+
+        g_drdy_owner = c;
     }
 #endif
 
-    /* Trust g_device parameter */
-    if (g_device == AKM_DEVICE_NONE) {
+    /* Trust device parameter */
+    if (ctx->device == AKM_DEVICE_NONE) {
         return AKM_ERR_NOT_SUPPORT;
     }
 
     /* Converts from raw to micro-tesla unit. */
-    g_raw_to_micro_q16[0] = SENS_0010_Q16;
-    g_raw_to_micro_q16[1] = SENS_0010_Q16;
-    g_raw_to_micro_q16[2] = SENS_0010_Q16;
+    c->raw_to_micro_q16[0] = SENS_0010_Q16;
+    c->raw_to_micro_q16[1] = SENS_0010_Q16;
+    c->raw_to_micro_q16[2] = SENS_0010_Q16;
 
     /* axis conversion parameter */
-    g_mag_axis_order[0] = axis_order[0];
-    g_mag_axis_order[1] = axis_order[1];
-    g_mag_axis_order[2] = axis_order[2];
-    g_mag_axis_sign[0] = axis_sign[0];
-    g_mag_axis_sign[1] = axis_sign[1];
-    g_mag_axis_sign[2] = axis_sign[2];
+    c->axis_order[0] = axis_order[0];
+    c->axis_order[1] = axis_order[1];
+    c->axis_order[2] = axis_order[2];
+    c->axis_sign[0] = axis_sign[0];
+    c->axis_sign[1] = axis_sign[1];
+    c->axis_sign[2] = axis_sign[2];
 
 #ifdef AKM_USE_SELF_TEST_COMPENSATION_AK09940
-    fret = ak0994x_self_test_compensation();
+    fret = ak0994x_self_test_compensation(ctx);
 
     if (fret != AKM_SUCCESS) {
         return fret;
@@ -275,9 +328,11 @@ int16_t ak0994x_init(
     return AKM_SUCCESS;
 }
 
-int16_t ak0994x_get_info(struct AKS_DEVICE_INFO *info)
+int16_t ak0994x_get_info(
+    struct aks_context     *ctx,
+    struct AKS_DEVICE_INFO *info)
 {
-    switch (g_device) {
+    switch (ctx->device) {
     case AKM_MAGNETOMETER_AK09940A:
         AKS_MyStrcpy(info->name, "AK09940A", AKS_INFO_NAME_SIZE);
         info->parameter[0] = 9940;
@@ -288,7 +343,7 @@ int16_t ak0994x_get_info(struct AKS_DEVICE_INFO *info)
         return AKM_ERR_NOT_SUPPORT;
     }
 
-    info->device = g_device;
+    info->device = ctx->device;
     info->parameter[2] = 0x80;
     info->parameter[3] = 0x80;
     info->parameter[4] = 0x80;
@@ -296,69 +351,71 @@ int16_t ak0994x_get_info(struct AKS_DEVICE_INFO *info)
     return AKM_SUCCESS;
 }
 
-int16_t ak0994x_start(const int32_t interval_us)
+int16_t ak0994x_start(
+    struct aks_context *ctx,
+    const int32_t      interval_us)
 {
     int16_t ret;
 
     if (0 > interval_us) {
         /* Single Measurement */
-        ret = ak0994x_set_mode(AK0994X_MODE_SNG_MEASURE);
+        ret = ak0994x_set_mode(ctx, AK0994X_MODE_SNG_MEASURE);
     } else if (400 > interval_us) {
         /* Out of range */
         ret = AKM_ERR_INVALID_ARG;
     } else if (1000 > interval_us) {
 #if defined (AKM_USE_ULTRA_LOW_POWER_DRIVE_AK09940)
         /* 1000 - 2500 Hz */
-        ret = ak0994x_set_mode(AK0994X_MODE_CONT_MEASURE_MODE8);
+        ret = ak0994x_set_mode(ctx, AK0994X_MODE_CONT_MEASURE_MODE8);
 #else
         ret = AKM_ERR_INVALID_ARG;
 #endif
     } else if (2500 > interval_us) {
 #if defined (AKM_USE_LOW_POWER_DRIVE_1_AK09940) | defined(AKM_USE_ULTRA_LOW_POWER_DRIVE_AK09940)
         /* 400 - 1000 Hz */
-        ret = ak0994x_set_mode(AK0994X_MODE_CONT_MEASURE_MODE7);
+        ret = ak0994x_set_mode(ctx, AK0994X_MODE_CONT_MEASURE_MODE7);
 #else
         ret = AKM_ERR_INVALID_ARG;
 #endif
     } else if (5000 > interval_us) {
 #if defined (AKM_USE_LOW_POWER_DRIVE_1_AK09940) | defined(AKM_USE_LOW_POWER_DRIVE_2_AK09940) | defined(AKM_USE_ULTRA_LOW_POWER_DRIVE_AK09940)
         /* 200 - 400 Hz */
-        ret = ak0994x_set_mode(AK0994X_MODE_CONT_MEASURE_MODE6);
+        ret = ak0994x_set_mode(ctx, AK0994X_MODE_CONT_MEASURE_MODE6);
 #else
         ret = AKM_ERR_INVALID_ARG;
 #endif
     } else if (10000 > interval_us) {
         /* 100 - 200 Hz */
-        ret = ak0994x_set_mode(AK0994X_MODE_CONT_MEASURE_MODE5);
+        ret = ak0994x_set_mode(ctx, AK0994X_MODE_CONT_MEASURE_MODE5);
     } else if (20000 > interval_us) {
         /* 50 - 100 Hz */
-        ret = ak0994x_set_mode(AK0994X_MODE_CONT_MEASURE_MODE4);
+        ret = ak0994x_set_mode(ctx, AK0994X_MODE_CONT_MEASURE_MODE4);
     } else if (50000 > interval_us) {
         /* 20 - 50 Hz */
-        ret = ak0994x_set_mode(AK0994X_MODE_CONT_MEASURE_MODE3);
+        ret = ak0994x_set_mode(ctx, AK0994X_MODE_CONT_MEASURE_MODE3);
     } else if (100000 > interval_us) {
         /* 10 - 20 Hz */
-        ret = ak0994x_set_mode(AK0994X_MODE_CONT_MEASURE_MODE2);
+        ret = ak0994x_set_mode(ctx, AK0994X_MODE_CONT_MEASURE_MODE2);
     } else {
         /* 10 Hz or slower */
-        ret = ak0994x_set_mode(AK0994X_MODE_CONT_MEASURE_MODE1);
+        ret = ak0994x_set_mode(ctx, AK0994X_MODE_CONT_MEASURE_MODE1);
     }
 
     return ret;
 }
 
-int16_t ak0994x_stop(void)
+int16_t ak0994x_stop(struct aks_context *ctx)
 {
-    return ak0994x_set_mode(AK0994X_MODE_POWER_DOWN);
+    return ak0994x_set_mode(ctx, AK0994X_MODE_POWER_DOWN);
 }
 
-int16_t ak0994x_check_rdy(const int32_t timeout_us)
+static int16_t ak0994x_poll_rdy(struct aks_context *ctx)
 {
     uint8_t i2cData;
     int16_t fret;
 
     /* Check DRDY bit of ST register */
-    fret = AKH_RxData(AKM_ST_MAG, AK0994X_REG_ST, &i2cData, 1);
+    fret = AKH_RxData(ctx->handle, AK0994X_REG_ST, &i2cData, 1);
 
     if (fret != AKM_SUCCESS) {
         return fret;
@@ -367,27 +424,31 @@ int16_t ak0994x_check_rdy(const int32_t timeout_us)
     return (i2cData & 0x01);
 }
 
-int16_t ak0994x_get_data(
-    struct AKM_SENSOR_DATA *data,
-    uint8_t                *num)
+int16_t ak0994x_check_rdy(
+    struct aks_context *ctx,
+    const int32_t      timeout_us)
 {
-    uint8_t i2cData[AK0994X_BDATA_SIZE];
-    int32_t tmp;
-    int16_t fret;
-    uint8_t i;
+    uint32_t event = 0U;
 
-    /* check arg */
-    if (*num < 1) {
-        return AKM_ERR_INVALID_ARG;
+#ifdef AKM_MAGNETOMETER_DRDY_EN
+    /* Other devices on the same board are polled */
+    if (g_drdy_owner == (struct ak0994x_context *)ctx) {
+        event = AKH_EVENT_MAG;
     }
+#endif
 
-    /* Read data */
-    fret = AKH_RxData(
-            AKM_ST_MAG, AK0994X_REG_ST1, i2cData, AK0994X_BDATA_SIZE);
+    return aks_wait_ready(ctx, ak0994x_poll_rdy, event, timeout_us);
+}
 
-    if (fret != AKM_SUCCESS) {
-        return fret;
-    }
+/* Convert a raw data block (ST1 to ST2) to sensor data. */
+static void ak0994x_convert_data(
+    struct ak0994x_context *c,
+    const uint8_t          i2cData[AK0994X_BDATA_SIZE],
+    struct AKM_SENSOR_DATA *data,
+    const AKM_TIMESTAMP    timestamp)
+{
+    int32_t tmp;
+    uint8_t i;
 
     for (i = 0; i < 3; i++) {
         /* convert to int32 data */
@@ -397,19 +458,86 @@ int16_t ak0994x_get_data(
                 ((uint32_t)i2cData[i * 3 + 1] << 8)) >> 8;
         /* convert to micro tesla in Q16 */
         /* tmp value is 18-bit data, so result will not over flow */
-        data->u.v[i] = tmp * g_raw_to_micro_q16[i];
+        data->u.v[i] = tmp * c->raw_to_micro_q16[i];
     }
 
-    AKS_ConvertCoordinate(data->u.v, g_mag_axis_order, g_mag_axis_sign);
+    AKS_ConvertCoordinate(data->u.v, c->axis_order, c->axis_sign);
 
     data->stype = AKM_ST_MAG;
-#ifdef AKM_MAGNETOMETER_DRDY_EN
-    data->timestamp = g_mag_ts;
-#else
-    data->timestamp = AKH_GetTimestamp();
-#endif
+    data->timestamp = timestamp;
     data->status[0] = i2cData[0];
     data->status[1] = i2cData[AK0994X_BDATA_SIZE - 1];
+}
+
+/* Decide the timestamp of the data which is going to be read. */
+static AKM_TIMESTAMP ak0994x_data_timestamp(struct ak0994x_context *c)
+{
+#ifdef AKM_MAGNETOMETER_DRDY_EN
+    if (g_drdy_owner == c) {
+        return c->drdy_ts;
+    }
+#endif
+    return AKH_GetTimestamp();
+}
+
+int16_t ak0994x_get_data(
+    struct aks_context     *ctx,
+    struct AKM_SENSOR_DATA *data,
+    uint8_t                *num)
+{
+    struct ak0994x_context *c = (struct ak0994x_context *)ctx;
+    uint8_t                i2cData[AK0994X_BDATA_SIZE];
+    int16_t                fret;
+
+    /* check arg */
+    if (*num < 1) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    /* Read data */
+    fret = AKH_RxData(
+            ctx->handle, AK0994X_REG_ST1, i2cData, AK0994X_BDATA_SIZE);
+
+    if (fret != AKM_SUCCESS) {
+        return fret;
+    }
+
+    ak0994x_convert_data(c, i2cData, data, ak0994x_data_timestamp(c));
     *num = 1;
     return AKM_SUCCESS;
 }
+
+static void ak0994x_async_done(
+    const int16_t result,
+    void          *arg)
+{
+    struct ak0994x_context *c = (struct ak0994x_context *)arg;
+
+    if (result == AKM_SUCCESS) {
+        ak0994x_convert_data(c, c->async_buf, c->async_data, c->async_ts);
+    }
+
+    c->async_cb(result, c->async_arg);
+}
+
+int16_t ak0994x_get_data_async(
+    struct aks_context      *ctx,
+    struct AKM_SENSOR_DATA  *data,
+    const AKH_XFER_CALLBACK callback,
+    void                    *arg)
+{
+    struct ak0994x_context *c = (struct ak0994x_context *)ctx;
+
+    if ((data == NULL) || (callback == NULL)) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    c->async_data = data;
+    c->async_ts = ak0994x_data_timestamp(c);
+    c->async_cb = callback;
+    c->async_arg = arg;
+
+    return AKH_RxDataAsync(
+            ctx->handle, AK0994X_REG_ST1, c->async_buf, AK0994X_BDATA_SIZE,
+            ak0994x_async_done, c);
+}
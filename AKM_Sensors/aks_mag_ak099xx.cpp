@@ -16,6 +16,8 @@
  * and grant commercial license to you.
  *
  ******************************************************************************/
+#include <string.h>
+
 #include "AKH_APIs.h"
 
 #include "ak099xx_register.h"
@@ -25,21 +27,48 @@
 #define SENS_0600_Q16  ((int32_t)(39322)) /* 0.6  in Q16 format */
 #define SENS_0150_Q16  ((int32_t)(9830))  /* 0.15 in Q16 format */
 
-/* Global variable for ASA value. */
-static AKM_DEVICES g_device = AKM_DEVICE_NONE;
-static uint8_t     g_asa[3];
-static int32_t     g_raw_to_micro_q16[3];
-static uint8_t     g_mag_axis_order[3];
-static uint8_t     g_mag_axis_sign[3];
+/* Per device state. */
+struct ak099xx_context {
+    struct aks_context base;
+    uint8_t            asa[3];
+    int32_t            raw_to_micro_q16[3];
+    uint8_t            axis_order[3];
+    uint8_t            axis_sign[3];
 #ifdef AKM_USE_FIFO
-static AKM_TIMESTAMP g_prev_fifo_timestamp;
+    AKM_TIMESTAMP      prev_fifo_timestamp;
+#endif
+#ifdef AKM_MAGNETOMETER_DRDY_EN
+    AKM_TIMESTAMP      drdy_ts;
 #endif
+#ifndef AKM_USE_FIFO
+    /* asynchronous read */
+    uint8_t                async_buf[AK099XX_BDATA_SIZE];
+    struct AKM_SENSOR_DATA *async_data;
+    AKM_TIMESTAMP          async_ts;
+    AKH_XFER_CALLBACK      async_cb;
+    void                   *async_arg;
+#endif
+};
+
+static struct ak099xx_context g_ctx[AKH_MAX_DEVICES];
 
 #ifdef AKM_MAGNETOMETER_DRDY_EN
-static AKM_TIMESTAMP g_mag_ts;
+/* There is one DRDY line, so only the first device initialized owns it. */
+static struct ak099xx_context *g_drdy_owner = NULL;
 void mag_ak099xx_irq_handler(void)
 {
-    g_mag_ts = AKH_GetTimestamp();
+    if (g_drdy_owner != NULL) {
+        g_drdy_owner->drdy_ts = AKH_GetTimestamp();
+    }
+}
+
+static AKM_TIMESTAMP ak099xx_drdy_timestamp(struct ak099xx_context *c)
+{
+    if (g_drdy_owner == c) {
+        return c->drdy_ts;
+    }
+
+    return AKH_GetTimestamp();
 }
 
 #endif
@@ -51,21 +80,29 @@ static struct aks_interface ak099xx_interface = {
     .aks_stop = ak099xx_stop,
     .aks_check_rdy = ak099xx_check_rdy,
     .aks_get_data = ak099xx_get_data,
-    .aks_self_test = NULL
+    .aks_self_test = ak099xx_self_test,
+    .aks_get_data_async = ak099xx_get_data_async
 };
 
 /******************************************************************************/
 /***** AKS public APIs ********************************************************/
 int16_t ak099xx_config(
-    AKM_DEVICES          *mag_dev,
+    const AKH_HANDLE     handle,
+    struct aks_context   **mag_ctx,
     struct aks_interface **mag_if)
 {
-    uint8_t  i2cData[4];
-    uint16_t dev;
-    int16_t  fret;
+    struct ak099xx_context *c;
+    AKM_DEVICES            device;
+    uint8_t                i2cData[4];
+    uint16_t               dev;
+    int16_t                fret;
+
+    if (handle >= AKH_MAX_DEVICES) {
+        return AKM_ERR_INVALID_ARG;
+    }
 
     /* Read WIA */
-    fret = AKH_RxData(AKM_ST_MAG, AK099XX_REG_WIA1, i2cData, 4);
+    fret = AKH_RxData(handle, AK099XX_REG_WIA1, i2cData, 4);
 
     if (fret != AKM_SUCCESS) {
         return fret;
@@ -77,67 +114,101 @@ int16_t ak099xx_config(
     /* Detect device number */
     switch (dev) {
     case AK09911_WIA_VAL:
-        g_device = AKM_MAGNETOMETER_AK09911;
-        ak099xx_interface.aks_self_test = ak09911_self_test;
+        device = AKM_MAGNETOMETER_AK09911;
         break;
 
     case AK09912_WIA_VAL:
-        g_device = AKM_MAGNETOMETER_AK09912;
-        ak099xx_interface.aks_self_test = ak09912_self_test;
+        device = AKM_MAGNETOMETER_AK09912;
         break;
 
     case AK09913_WIA_VAL:
-        g_device = AKM_MAGNETOMETER_AK09913;
-        ak099xx_interface.aks_self_test = ak09913_self_test;
+        device = AKM_MAGNETOMETER_AK09913;
         break;
 
     case AK09915_WIA_VAL:
 
         if (i2cData[3] == AK09915D_INFO_VAL) {
-            g_device = AKM_MAGNETOMETER_AK09915D;
+            device = AKM_MAGNETOMETER_AK09915D;
         } else {
-            g_device = AKM_MAGNETOMETER_AK09915;
+            device = AKM_MAGNETOMETER_AK09915;
         }
 
-        ak099xx_interface.aks_self_test = ak09915_self_test;
         break;
 
     case AK09916C_WIA_VAL:
-        g_device = AKM_MAGNETOMETER_AK09916C;
-        ak099xx_interface.aks_self_test = ak09916_self_test;
+        device = AKM_MAGNETOMETER_AK09916C;
         break;
 
     case AK09916D_WIA_VAL:
-        g_device = AKM_MAGNETOMETER_AK09916D;
-        ak099xx_interface.aks_self_test = ak09916_self_test;
+        device = AKM_MAGNETOMETER_AK09916D;
         break;
 
     case AK09917D_WIA_VAL:
-        g_device = AKM_MAGNETOMETER_AK09917D;
-        ak099xx_interface.aks_self_test = ak09917_self_test;
+        device = AKM_MAGNETOMETER_AK09917D;
         break;
 
     case AK09918_WIA_VAL:
-        g_device = AKM_MAGNETOMETER_AK09918;
-        ak099xx_interface.aks_self_test = ak09918_self_test;
+        device = AKM_MAGNETOMETER_AK09918;
         break;
 
     case AK09919_WIA_VAL:
-        g_device = AKM_MAGNETOMETER_AK09919;
-        ak099xx_interface.aks_self_test = ak09919_self_test;
+        device = AKM_MAGNETOMETER_AK09919;
         break;
 
     default:
         return AKM_ERR_NOT_SUPPORT;
     }
 
-    *mag_dev = g_device;
+    c = &g_ctx[handle];
+    memset(c, 0, sizeof(*c));
+    c->base.handle = handle;
+    c->base.device = device;
+
+    *mag_ctx = &c->base;
     *mag_if = &ak099xx_interface;
 
     return AKM_SUCCESS;
 }
 
-int16_t ak099xx_set_mode(const uint8_t mode)
+int16_t ak099xx_self_test(
+    struct aks_context *ctx,
+    int32_t            *result)
+{
+    switch (ctx->device) {
+    case AKM_MAGNETOMETER_AK09911:
+        return ak09911_self_test(ctx, result);
+
+    case AKM_MAGNETOMETER_AK09912:
+        return ak09912_self_test(ctx, result);
+
+    case AKM_MAGNETOMETER_AK09913:
+        return ak09913_self_test(ctx, result);
+
+    case AKM_MAGNETOMETER_AK09915:
+    case AKM_MAGNETOMETER_AK09915D:
+        return ak09915_self_test(ctx, result);
+
+    case AKM_MAGNETOMETER_AK09916C:
+    case AKM_MAGNETOMETER_AK09916D:
+        return ak09916_self_test(ctx, result);
+
+    case AKM_MAGNETOMETER_AK09917D:
+        return ak09917_self_test(ctx, result);
+
+    case AKM_MAGNETOMETER_AK09918:
+        return ak09918_self_test(ctx, result);
+
+    case AKM_MAGNETOMETER_AK09919:
+        return ak09919_self_test(ctx, result);
+
+    default:
+        return AKM_ERR_NOT_SUPPORT;
+    }
+}
+
+int16_t ak099xx_set_mode(
+    struct aks_context *ctx,
+    const uint8_t      mode)
 {
     uint8_t i2cData;
     int16_t fret;
@@ -151,8 +222,8 @@ int16_t ak099xx_set_mode(const uint8_t mode)
        (mode == AK099XX_MODE_CONT_MEASURE_MODE5) ||
        (mode == AK099XX_MODE_CONT_MEASURE_MODE6)) {
 #ifdef AKM_CUSTOM_CONTINUOUS_MEASURE
-        if((g_device == AKM_MAGNETOMETER_AK09917D) ||
-        (g_device == AKM_MAGNETOMETER_AK09919)) {
+        if((ctx->device == AKM_MAGNETOMETER_AK09917D) ||
+        (ctx->device == AKM_MAGNETOMETER_AK09919)) {
             i2cData = AK099XX_SET_FIFO(i2cData);
         }
 #else
@@ -162,14 +233,22 @@ int16_t ak099xx_set_mode(const uint8_t mode)
 #endif
 
 #if defined(AKM_USE_LOW_NOISE)
-    if ((g_device == AKM_MAGNETOMETER_AK09915) ||
-        (g_device == AKM_MAGNETOMETER_AK09915D) ||
-        (g_device == AKM_MAGNETOMETER_AK09917D) ||
-        (g_device == AKM_MAGNETOMETER_AK09919)) {
+    if ((ctx->device == AKM_MAGNETOMETER_AK09915) ||
+        (ctx->device == AKM_MAGNETOMETER_AK09915D) ||
+        (ctx->device == AKM_MAGNETOMETER_AK09917D) ||
+        (ctx->device == AKM_MAGNETOMETER_AK09919)) {
         i2cData = AK099XX_SET_LOWNOISE(i2cData);
     }
 #endif
-    fret = AKH_TxData(AKM_ST_MAG, AK099XX_REG_CNTL2, &i2cData, 1);
+
+    if (mode == AK099XX_MODE_POWER_DOWN) {
+        /* The part leaves a mode by itself only to power-down, so
+         * a shadowed power-down is never stale. */
+        fret = AKH_UpdateBits(
+                ctx->handle, AK099XX_REG_CNTL2, 0xFF, i2cData);
+    } else {
+        fret = AKH_TxData(ctx->handle, AK099XX_REG_CNTL2, &i2cData, 1);
+    }
 
     if (fret != AKM_SUCCESS) {
         return fret;
@@ -177,7 +256,7 @@ int16_t ak099xx_set_mode(const uint8_t mode)
 
 #ifdef AKM_USE_FIFO
     // Reset preview fifo timestamp
-    g_prev_fifo_timestamp = 0;
+    ((struct ak099xx_context *)ctx)->prev_fifo_timestamp = 0;
 #endif
 
     /* When succeeded, sleep 'Twait' */
@@ -185,127 +264,140 @@ int16_t ak099xx_set_mode(const uint8_t mode)
     return AKM_SUCCESS;
 }
 
-int16_t ak099xx_soft_reset(void)
+int16_t ak099xx_soft_reset(struct aks_context *ctx)
 {
     uint8_t i2cData;
     int16_t fret;
 
     /* Soft Reset */
     i2cData = AK099XX_SOFT_RESET;
-    fret = AKH_TxData(AKM_ST_MAG, AK099XX_REG_CNTL3, &i2cData, 1);
+    fret = AKH_TxData(ctx->handle, AK099XX_REG_CNTL3, &i2cData, 1);
 
     if (fret != AKM_SUCCESS) {
         return fret;
     }
 
+    /* all registers are back to the default value */
+    AKH_InvalidateCache(ctx->handle);
+
     /* When succeeded, sleep 'Twait' */
     AKH_DelayMicro(100);
     return AKM_SUCCESS;
 }
 
 int16_t ak099xx_init(
-    const uint8_t axis_order[3],
-    const uint8_t axis_sign[3])
+    struct aks_context *ctx,
+    const uint8_t      axis_order[3],
+    const uint8_t      axis_sign[3])
 {
-    int16_t fret;
+    struct ak099xx_context *c = (struct ak099xx_context *)ctx;
+    int16_t                fret;
 
-    fret = ak099xx_soft_reset();
+    fret = ak099xx_soft_reset(ctx);
 
     if (fret != AKM_SUCCESS) {
         return fret;
     }
 
 #ifdef AKM_MAGNETOMETER_DRDY_EN
-    fret = AKH_SetIRQHandler(IRQ_MAG_1, mag_ak099xx_irq_handler);
+    if ((g_drdy_owner == NULL) || (g_drdy_owner == c)) {
+        fret = AKH_SetIRQHandler(IRQ_MAG_1, mag_ak099xx_irq_handler);
 
-    if (fret != AKM_SUCCESS) {
-        return fret;
+        if (fret != AKM_SUCCESS) {
+            return fret;
+        }
+
+        g_drdy_owner = c;
     }
 #endif
 
-    /* Trust g_device parameter */
-    if (g_device == AKM_DEVICE_NONE) {
+    /* Trust device parameter */
+    if (ctx->device == AKM_DEVICE_NONE) {
         return AKM_ERR_NOT_SUPPORT;
     }
 
-    if ((g_device == AKM_MAGNETOMETER_AK09911) ||
-        (g_device == AKM_MAGNETOMETER_AK09912)) {
+    if ((ctx->device == AKM_MAGNETOMETER_AK09911) ||
+        (ctx->device == AKM_MAGNETOMETER_AK09912)) {
         /* Read FUSE ROM value */
-        fret = ak099xx_set_mode(AK099XX_MODE_FUSE_ACCESS);
+        fret = ak099xx_set_mode(ctx, AK099XX_MODE_FUSE_ACCESS);
 
         if (fret != AKM_SUCCESS) {
             return fret;
         }
 
-        fret = AKH_RxData(AKM_ST_MAG, AK099XX_FUSE_ASAX, g_asa, 3);
+        fret = AKH_RxData(ctx->handle, AK099XX_FUSE_ASAX, c->asa, 3);
 
         if (fret != AKM_SUCCESS) {
             return fret;
         }
 
-        fret = ak099xx_set_mode(AK099XX_MODE_POWER_DOWN);
+        fret = ak099xx_set_mode(ctx, AK099XX_MODE_POWER_DOWN);
 
         if (fret != AKM_SUCCESS) {
             return fret;
         }
     } else {
         /* Other device does not have ASA. */
-        g_asa[0] = 128;
-        g_asa[1] = 128;
-        g_asa[2] = 128;
+        c->asa[0] = 128;
+        c->asa[1] = 128;
+        c->asa[2] = 128;
     }
 
     /* Calculate coeff which converts from raw to micro-tesla unit. */
-    if (g_device == AKM_MAGNETOMETER_AK09911) {
+    if (ctx->device == AKM_MAGNETOMETER_AK09911) {
         /* The equation is: H_adj = H_raw x (ASA / 128 + 1)
          * Convert from LSB to micro tesla in Q16, multiply (SENS x 2^16)
          * Simplify the equation: coeff = ((ASA + 128) x SENS x 2^16) >> 7
          * In case of AK09911, SENS = 0.6.
          * So coeff = ((ASA + 128) x 39322) >> 7 */
-        g_raw_to_micro_q16[0] = ((int32_t)(g_asa[0] + 128) * SENS_0600_Q16) >>
+        c->raw_to_micro_q16[0] = ((int32_t)(c->asa[0] + 128) * SENS_0600_Q16) >>
             7;
-        g_raw_to_micro_q16[1] = ((int32_t)(g_asa[1] + 128) * SENS_0600_Q16) >>
+        c->raw_to_micro_q16[1] = ((int32_t)(c->asa[1] + 128) * SENS_0600_Q16) >>
             7;
-        g_raw_to_micro_q16[2] = ((int32_t)(g_asa[2] + 128) * SENS_0600_Q16) >>
+        c->raw_to_micro_q16[2] = ((int32_t)(c->asa[2] + 128) * SENS_0600_Q16) >>
             7;
-    } else if (g_device == AKM_MAGNETOMETER_AK09912) {
+    } else if (ctx->device == AKM_MAGNETOMETER_AK09912) {
         /* The equation is: H_adj = H_raw x ((ASA - 128) / 256 + 1)
          * To convert micro tesla in Q16, multiply (SENS x 2^16)
          * Simplify the equation: coeff = ((ASA + 128) x SENS x 2^16) >> 8
          * In case of AK09912, SENS = 0.15
          * So coeff = ((ASA + 128) x 9830) >> 8 */
-        g_raw_to_micro_q16[0] = ((int32_t)(g_asa[0] + 128) * SENS_0150_Q16) >>
+        c->raw_to_micro_q16[0] = ((int32_t)(c->asa[0] + 128) * SENS_0150_Q16) >>
             8;
-        g_raw_to_micro_q16[1] = ((int32_t)(g_asa[1] + 128) * SENS_0150_Q16) >>
+        c->raw_to_micro_q16[1] = ((int32_t)(c->asa[1] + 128) * SENS_0150_Q16) >>
             8;
-        g_raw_to_micro_q16[2] = ((int32_t)(g_asa[2] + 128) * SENS_0150_Q16) >>
+        c->raw_to_micro_q16[2] = ((int32_t)(c->asa[2] + 128) * SENS_0150_Q16) >>
             8;
     } else {
         /* AK09913 or newer devices does not have ASA register. It means that user
          * does not need to write adjustment equation.
          */
-        g_raw_to_micro_q16[0] = SENS_0150_Q16;
-        g_raw_to_micro_q16[1] = SENS_0150_Q16;
-        g_raw_to_micro_q16[2] = SENS_0150_Q16;
+        c->raw_to_micro_q16[0] = SENS_0150_Q16;
+        c->raw_to_micro_q16[1] = SENS_0150_Q16;
+        c->raw_to_micro_q16[2] = SENS_0150_Q16;
     }
 
     /* axis conversion parameter */
-    g_mag_axis_order[0] = axis_order[0];
-    g_mag_axis_order[1] = axis_order[1];
-    g_mag_axis_order[2] = axis_order[2];
-    g_mag_axis_sign[0] = axis_sign[0];
-    g_mag_axis_sign[1] = axis_sign[1];
-    g_mag_axis_sign[2] = axis_sign[2];
+    c->axis_order[0] = axis_order[0];
+    c->axis_order[1] = axis_order[1];
+    c->axis_order[2] = axis_order[2];
+    c->axis_sign[0] = axis_sign[0];
+    c->axis_sign[1] = axis_sign[1];
+    c->axis_sign[2] = axis_sign[2];
 
 #ifdef AKM_USE_FIFO
-    g_prev_fifo_timestamp = 0;
+    c->prev_fifo_timestamp = 0;
 #endif
     return AKM_SUCCESS;
 }
 
-int16_t ak099xx_get_info(struct AKS_DEVICE_INFO *info)
+int16_t ak099xx_get_info(
+    struct aks_context     *ctx,
+    struct AKS_DEVICE_INFO *info)
 {
-    switch (g_device) {
+    struct ak099xx_context *c = (struct ak099xx_context *)ctx;
+
+    switch (ctx->device) {
     case AKM_MAGNETOMETER_AK09911:
         AKS_MyStrcpy(info->name, "AK09911", AKS_INFO_NAME_SIZE);
         info->parameter[0] = 9911;
@@ -370,30 +462,32 @@ int16_t ak099xx_get_info(struct AKS_DEVICE_INFO *info)
         return AKM_ERR_NOT_SUPPORT;
     }
 
-    info->device = g_device;
-    info->parameter[2] = g_asa[0];
-    info->parameter[3] = g_asa[1];
-    info->parameter[4] = g_asa[2];
+    info->device = ctx->device;
+    info->parameter[2] = c->asa[0];
+    info->parameter[3] = c->asa[1];
+    info->parameter[4] = c->asa[2];
 
     return AKM_SUCCESS;
 }
 
-int16_t ak099xx_start(const int32_t interval_us)
+int16_t ak099xx_start(
+    struct aks_context *ctx,
+    const int32_t      interval_us)
 {
     int16_t ret;
 
-    if (g_device == AKM_MAGNETOMETER_AK09912) {
+    if (ctx->device == AKM_MAGNETOMETER_AK09912) {
         /* Set NSF */
         uint8_t i2cData;
 
         i2cData = AK099XX_NSF_VAL;
-        ret = AKH_TxData(AKM_ST_MAG, AK099XX_REG_CNTL1, &i2cData, 1);
+        ret = AKH_UpdateBits(ctx->handle, AK099XX_REG_CNTL1, 0xFF, i2cData);
 
         if (ret != AKM_SUCCESS) {
             return ret;
         }
     }
-    else if(g_device == AKM_MAGNETOMETER_AK09917D) {
+    else if(ctx->device == AKM_MAGNETOMETER_AK09917D) {
         /* Set NSF */
         uint8_t i2cData;
 
@@ -405,13 +499,13 @@ int16_t ak099xx_start(const int32_t interval_us)
         }
         i2cData |= AKM_USE_FIFO_WATERMARK - 1;
 #endif
-        ret = AKH_TxData(AKM_ST_MAG, AK099XX_REG_CNTL1, &i2cData, 1);
+        ret = AKH_UpdateBits(ctx->handle, AK099XX_REG_CNTL1, 0xFF, i2cData);
 
         if (ret != AKM_SUCCESS) {
             return ret;
         }
     }
-    else if (g_device == AKM_MAGNETOMETER_AK09919) {
+    else if (ctx->device == AKM_MAGNETOMETER_AK09919) {
         uint8_t i2cData = 0;
 #if defined(AKM_USE_LOW_NOISE)
         /* Set ITS */
@@ -424,7 +518,7 @@ int16_t ak099xx_start(const int32_t interval_us)
         }
         i2cData |= AKM_USE_FIFO_WATERMARK - 1;
 #endif
-        ret = AKH_TxData(AKM_ST_MAG, AK099XX_REG_CNTL1, &i2cData, 1);
+        ret = AKH_UpdateBits(ctx->handle, AK099XX_REG_CNTL1, 0xFF, i2cData);
 
         if (ret != AKM_SUCCESS) {
             return ret;
@@ -433,42 +527,42 @@ int16_t ak099xx_start(const int32_t interval_us)
 
     if (0 > interval_us) {
         /* Single Measurement */
-        ret = ak099xx_set_mode(AK099XX_MODE_SNG_MEASURE);
+        ret = ak099xx_set_mode(ctx, AK099XX_MODE_SNG_MEASURE);
     } else if (10000 > interval_us) {
         /* Out of range */
         ret = AKM_ERR_INVALID_ARG;
     } else if (20000 > interval_us) {
         /* 50 - 100 Hz */
-        ret = ak099xx_set_mode(AK099XX_MODE_CONT_MEASURE_MODE4);
+        ret = ak099xx_set_mode(ctx, AK099XX_MODE_CONT_MEASURE_MODE4);
     } else if (50000 > interval_us) {
         /* 20 - 50 Hz */
-        ret = ak099xx_set_mode(AK099XX_MODE_CONT_MEASURE_MODE3);
+        ret = ak099xx_set_mode(ctx, AK099XX_MODE_CONT_MEASURE_MODE3);
     } else if (100000 > interval_us) {
         /* 10 - 20 Hz */
-        ret = ak099xx_set_mode(AK099XX_MODE_CONT_MEASURE_MODE2);
+        ret = ak099xx_set_mode(ctx, AK099XX_MODE_CONT_MEASURE_MODE2);
     } else {
         /* 10 Hz or slower */
-        ret = ak099xx_set_mode(AK099XX_MODE_CONT_MEASURE_MODE1);
+        ret = ak099xx_set_mode(ctx, AK099XX_MODE_CONT_MEASURE_MODE1);
     }
 
 #ifdef AKM_USE_FIFO
-    g_prev_fifo_timestamp = AKH_GetTimestamp();
+    ((struct ak099xx_context *)ctx)->prev_fifo_timestamp = AKH_GetTimestamp();
 #endif
     return ret;
 }
 
-int16_t ak099xx_stop(void)
+int16_t ak099xx_stop(struct aks_context *ctx)
 {
-    return ak099xx_set_mode(AK099XX_MODE_POWER_DOWN);
+    return ak099xx_set_mode(ctx, AK099XX_MODE_POWER_DOWN);
 }
 
-int16_t ak099xx_check_rdy(const int32_t timeout_us)
+static int16_t ak099xx_poll_rdy(struct aks_context *ctx)
 {
     uint8_t i2cData;
     int16_t fret;
 
     /* Check DRDY bit of ST1 register */
-    fret = AKH_RxData(AKM_ST_MAG, AK099XX_REG_ST1, &i2cData, 1);
+    fret = AKH_RxData(ctx->handle, AK099XX_REG_ST1, &i2cData, 1);
 
     if (fret != AKM_SUCCESS) {
         return fret;
@@ -479,15 +573,75 @@ int16_t ak099xx_check_rdy(const int32_t timeout_us)
     return (i2cData & 0x01);
 }
 
-int16_t ak099xx_get_data(
+int16_t ak099xx_check_rdy(
+    struct aks_context *ctx,
+    const int32_t      timeout_us)
+{
+    uint32_t event = 0U;
+
+#ifdef AKM_MAGNETOMETER_DRDY_EN
+    /* Only the device which owns DRDY line is woken up by it */
+    if (g_drdy_owner == (struct ak099xx_context *)ctx) {
+        event = AKH_EVENT_MAG;
+    }
+#endif
+
+    return aks_wait_ready(ctx, ak099xx_poll_rdy, event, timeout_us);
+}
+
+#ifndef AKM_USE_FIFO
+/* Decide the timestamp of the data which is going to be read. */
+static AKM_TIMESTAMP ak099xx_data_timestamp(struct ak099xx_context *c)
+{
+#ifdef AKM_MAGNETOMETER_DRDY_EN
+    return ak099xx_drdy_timestamp(c);
+#else
+    return AKH_GetTimestamp();
+#endif
+}
+
+/* Convert a raw data block (ST1 to ST2) to sensor data. */
+static void ak099xx_convert_data(
+    struct ak099xx_context *c,
+    const uint8_t          i2cData[AK099XX_BDATA_SIZE],
     struct AKM_SENSOR_DATA *data,
-    uint8_t                *num)
+    const AKM_TIMESTAMP    timestamp)
 {
-    uint8_t i2cData[AK099XX_BDATA_SIZE * 32];
     int16_t tmp;
-    int16_t fret;
     uint8_t i;
-    uint8_t st1;
+
+    for (i = 0; i < 3; i++) {
+        /* convert to int16 data */
+        if (c->base.device == AKM_MAGNETOMETER_AK09917D) {
+            tmp = MAKE_S16(i2cData[i * 2 + 1], i2cData[i * 2 + 2]);
+        } else {
+            tmp = MAKE_S16(i2cData[i * 2 + 2], i2cData[i * 2 + 1]);
+        }
+
+        /* multiply ASA and convert to micro tesla in Q16 */
+        data->u.v[i] = tmp * c->raw_to_micro_q16[i];
+    }
+
+    AKS_ConvertCoordinate(data->u.v, c->axis_order, c->axis_sign);
+
+    data->stype = AKM_ST_MAG;
+    data->timestamp = timestamp;
+    data->status[0] = i2cData[0];
+    data->status[1] = i2cData[AK099XX_BDATA_SIZE - 1];
+}
+#endif
+
+int16_t ak099xx_get_data(
+    struct aks_context     *ctx,
+    struct AKM_SENSOR_DATA *data,
+    uint8_t                *num)
+{
+    struct ak099xx_context *c = (struct ak099xx_context *)ctx;
+    uint8_t                i2cData[AK099XX_BDATA_SIZE * 32];
+    int16_t                tmp;
+    int16_t                fret;
+    uint8_t                i;
+    uint8_t                st1 = 0;
 
 #ifdef AKM_USE_FIFO
     uint8_t j;
@@ -512,12 +666,12 @@ int16_t ak099xx_get_data(
 #ifdef AKM_USE_FIFO
     // Decide latest timestamp
 #ifdef AKM_MAGNETOMETER_DRDY_EN
-    latest_timestamp = g_mag_ts;
+    latest_timestamp = ak099xx_drdy_timestamp(c);
 #else
     latest_timestamp = AKH_GetTimestamp();
 #endif
     /* Read ST1 */
-    fret = AKH_RxData(AKM_ST_MAG, AK099XX_REG_ST1, i2cData, 1);
+    fret = AKH_RxData(ctx->handle, AK099XX_REG_ST1, i2cData, 1);
     if (fret != AKM_SUCCESS) {
         return fret;
     }
@@ -526,7 +680,7 @@ int16_t ak099xx_get_data(
 
     /* Read HXH/L to ST2 */
     read_bytes = fnum * (AK099XX_BDATA_SIZE - 1);
-    fret = AKH_RxData(AKM_ST_MAG, AK099XX_REG_MEASURE_DATA_HEAD, i2cData, read_bytes);
+    fret = AKH_RxData(ctx->handle, AK099XX_REG_MEASURE_DATA_HEAD, i2cData, read_bytes);
     if (fret != AKM_SUCCESS) {
         return fret;
     }
@@ -535,8 +689,8 @@ int16_t ak099xx_get_data(
     for(i = 0; i < fnum; i++) {
         for (j = 0; j < 3; j++) {
             /* convert to int16 data */
-            if ((g_device == AKM_MAGNETOMETER_AK09917D)  ||
-                (g_device == AKM_MAGNETOMETER_AK09919) ) {
+            if ((ctx->device == AKM_MAGNETOMETER_AK09917D)  ||
+                (ctx->device == AKM_MAGNETOMETER_AK09919) ) {
                 tmp = MAKE_S16(i2cData[(i * 8) + (j * 2)], i2cData[(i * 8) + (j * 2) + 1]);
             }
             else {
@@ -544,10 +698,10 @@ int16_t ak099xx_get_data(
             }
 
             /* multiply ASA and convert to micro tesla in Q16 */
-            fifoData[i].u.v[j] = tmp * g_raw_to_micro_q16[j];
+            fifoData[i].u.v[j] = tmp * c->raw_to_micro_q16[j];
         }
 
-        AKS_ConvertCoordinate(fifoData[i].u.v, g_mag_axis_order, g_mag_axis_sign);
+        AKS_ConvertCoordinate(fifoData[i].u.v, c->axis_order, c->axis_sign);
         fifoData[i].stype = AKM_ST_MAG;
         fifoData[i].status[0] = st1;
         fifoData[i].status[1] = i2cData[i * 8 + 7];
@@ -557,7 +711,7 @@ int16_t ak099xx_get_data(
     copy_index = 0;
     if(fnum < *num) {
         // Copy latest data
-        AKH_Print("read_num less than *num, copy data.\n");
+        AKH_Log("read_num less than *num, copy data.\n");
         for(i = fnum; i < *num; i++) {
             fifoData[i] = fifoData[i - 1];
         }
@@ -567,64 +721,119 @@ int16_t ak099xx_get_data(
     }
 
     /* Decide all timestamp and copy arrays */
-    AKM_TIMESTAMP diff = latest_timestamp - g_prev_fifo_timestamp;
+#ifdef AKM_TIMESTAMP_NANOSECOND
+    AKM_TIMESTAMP diff = latest_timestamp - c->prev_fifo_timestamp;
+#else
+    /* 32-bit timestamp wraps around. unsigned arithmetic keeps interval. */
+    AKM_TIMESTAMP diff =
+        (AKM_TIMESTAMP)((uint32_t)latest_timestamp -
+                        (uint32_t)c->prev_fifo_timestamp);
+#endif
     AKM_TIMESTAMP addTime = (AKM_TIMESTAMP)(diff / *num);
     for(i = 0; i < *num; i++)
     {
-        fifoData[copy_index].timestamp = g_prev_fifo_timestamp + (addTime * (i + 1));
+        fifoData[copy_index].timestamp =
+            (AKM_TIMESTAMP)((uint64_t)c->prev_fifo_timestamp +
+                            (uint64_t)(addTime * (i + 1)));
         data[i] = fifoData[copy_index];
         copy_index++;
     }
 
     /* Update preview timestamp */
-    g_prev_fifo_timestamp = latest_timestamp;
+    c->prev_fifo_timestamp = latest_timestamp;
     return AKM_SUCCESS;
 #else
-    if(g_device == AKM_MAGNETOMETER_AK09919) {
-        fret = AKH_RxData(
-            AKM_ST_MAG, AK099XX_REG_ST1, i2cData, 1);
-        st1 = i2cData[0];
-        fret = AKH_RxData(
-            AKM_ST_MAG, AK099XX_REG_MEASURE_DATA_HEAD, i2cData, AK099XX_BDATA_SIZE - 1);
-    } else {
+    if (ctx->device != AKM_MAGNETOMETER_AK09919) {
         fret = AKH_RxData(
-            AKM_ST_MAG, AK099XX_REG_ST1, i2cData, AK099XX_BDATA_SIZE);
+            ctx->handle, AK099XX_REG_ST1, i2cData, AK099XX_BDATA_SIZE);
+
+        if (fret != AKM_SUCCESS) {
+            return fret;
+        }
+
+        ak099xx_convert_data(c, i2cData, data, ak099xx_data_timestamp(c));
+        *num = 1;
+        return AKM_SUCCESS;
+    }
+
+    /* AK09919 does not have ST1 in front of the data */
+    fret = AKH_RxData(
+        ctx->handle, AK099XX_REG_ST1, i2cData, 1);
+
+    if (fret != AKM_SUCCESS) {
+        return fret;
     }
 
+    st1 = i2cData[0];
+    fret = AKH_RxData(
+        ctx->handle, AK099XX_REG_MEASURE_DATA_HEAD, i2cData, AK099XX_BDATA_SIZE - 1);
+
     if (fret != AKM_SUCCESS) {
         return fret;
     }
 
     for (i = 0; i < 3; i++) {
         /* convert to int16 data */
-        if (g_device == AKM_MAGNETOMETER_AK09917D) {
-            tmp = MAKE_S16(i2cData[i * 2 + 1], i2cData[i * 2 + 2]);
-        } else if (g_device == AKM_MAGNETOMETER_AK09919) {
-            tmp = MAKE_S16(i2cData[i * 2], i2cData[i * 2 + 1]);
-        } else {
-            tmp = MAKE_S16(i2cData[i * 2 + 2], i2cData[i * 2 + 1]);
-        }
+        tmp = MAKE_S16(i2cData[i * 2], i2cData[i * 2 + 1]);
 
         /* multiply ASA and convert to micro tesla in Q16 */
-        data->u.v[i] = tmp * g_raw_to_micro_q16[i];
+        data->u.v[i] = tmp * c->raw_to_micro_q16[i];
     }
 
-    AKS_ConvertCoordinate(data->u.v, g_mag_axis_order, g_mag_axis_sign);
+    AKS_ConvertCoordinate(data->u.v, c->axis_order, c->axis_sign);
 
     data->stype = AKM_ST_MAG;
-#ifdef AKM_MAGNETOMETER_DRDY_EN
-    data->timestamp = g_mag_ts;
-#else
-    data->timestamp = AKH_GetTimestamp();
-#endif
-    if(g_device == AKM_MAGNETOMETER_AK09919) {
-        data->status[0] = st1;
-        data->status[1] = i2cData[AK099XX_BDATA_SIZE - 2];
-    } else {
-        data->status[0] = i2cData[0];
-        data->status[1] = i2cData[AK099XX_BDATA_SIZE - 1];
-    }
+    data->timestamp = ak099xx_data_timestamp(c);
+    data->status[0] = st1;
+    data->status[1] = i2cData[AK099XX_BDATA_SIZE - 2];
     *num = 1;
     return AKM_SUCCESS;
 #endif
 }
+
+#ifndef AKM_USE_FIFO
+static void ak099xx_async_done(
+    const int16_t result,
+    void          *arg)
+{
+    struct ak099xx_context *c = (struct ak099xx_context *)arg;
+
+    if (result == AKM_SUCCESS) {
+        ak099xx_convert_data(c, c->async_buf, c->async_data, c->async_ts);
+    }
+
+    c->async_cb(result, c->async_arg);
+}
+#endif
+
+/* FIFO and AK09919 take more than one transfer, so they are read by
+ * ak099xx_get_data() only. */
+int16_t ak099xx_get_data_async(
+    struct aks_context      *ctx,
+    struct AKM_SENSOR_DATA  *data,
+    const AKH_XFER_CALLBACK callback,
+    void                    *arg)
+{
+#ifdef AKM_USE_FIFO
+    return AKM_ERR_NOT_SUPPORT;
+#else
+    struct ak099xx_context *c = (struct ak099xx_context *)ctx;
+
+    if ((data == NULL) || (callback == NULL)) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    if (ctx->device == AKM_MAGNETOMETER_AK09919) {
+        return AKM_ERR_NOT_SUPPORT;
+    }
+
+    c->async_data = data;
+    c->async_ts = ak099xx_data_timestamp(c);
+    c->async_cb = callback;
+    c->async_arg = arg;
+
+    return AKH_RxDataAsync(
+            ctx->handle, AK099XX_REG_ST1, c->async_buf, AK099XX_BDATA_SIZE,
+            ak099xx_async_done, c);
+#endif
+}
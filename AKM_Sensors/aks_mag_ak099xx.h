@@ -25,74 +25,106 @@
     (int16_t)(((uint16_t)(U8H) << 8) | (uint16_t)(U8L))
 
 int16_t ak099xx_set_mode(
-    const uint8_t mode
+    struct aks_context *ctx,
+    const uint8_t      mode
 );
 
 int16_t ak099xx_soft_reset(
-    void
+    struct aks_context *ctx
 );
 
 int16_t ak099xx_config(
-    AKM_DEVICES *mag_dev,
+    const AKH_HANDLE     handle,
+    struct aks_context   **mag_ctx,
     struct aks_interface **mag_if
 );
 
 int16_t ak099xx_init(
-    const uint8_t axis_order[3],
-    const uint8_t axis_sign[3]
+    struct aks_context *ctx,
+    const uint8_t      axis_order[3],
+    const uint8_t      axis_sign[3]
 );
 
 int16_t ak099xx_get_info(
+    struct aks_context     *ctx,
     struct AKS_DEVICE_INFO *info
 );
 
 int16_t ak099xx_start(
-    const int32_t interval_us
+    struct aks_context *ctx,
+    const int32_t      interval_us
 );
 
 int16_t ak099xx_stop(
-    void
+    struct aks_context *ctx
 );
 
 int16_t ak099xx_check_rdy(
-    const int32_t timeout_us
+    struct aks_context *ctx,
+    const int32_t      timeout_us
 );
 
 int16_t ak099xx_get_data(
+    struct aks_context     *ctx,
     struct AKM_SENSOR_DATA *data,
     uint8_t                *num
 );
 
+/*!
+ * Start reading one data set without blocking the caller.
+ * \c data is filled before \c callback is called with #AKM_SUCCESS.
+ * FIFO and AK09919 return #AKM_ERR_NOT_SUPPORT.
+ */
+int16_t ak099xx_get_data_async(
+    struct aks_context      *ctx,
+    struct AKM_SENSOR_DATA  *data,
+    const AKH_XFER_CALLBACK callback,
+    void                    *arg
+);
+
+int16_t ak099xx_self_test(
+    struct aks_context *ctx,
+    int32_t            *result
+);
+
 int16_t ak09911_self_test(
-    int32_t *result
+    struct aks_context *ctx,
+    int32_t            *result
 );
 
 int16_t ak09912_self_test(
-    int32_t *result
+    struct aks_context *ctx,
+    int32_t            *result
 );
 
 int16_t ak09913_self_test(
-    int32_t *result
+    struct aks_context *ctx,
+    int32_t            *result
 );
 
 int16_t ak09915_self_test(
-    int32_t *result
+    struct aks_context *ctx,
+    int32_t            *result
 );
 
 int16_t ak09916_self_test(
-    int32_t *result
+    struct aks_context *ctx,
+    int32_t            *result
 );
 
 int16_t ak09917_self_test(
-    int32_t *result
+    struct aks_context *ctx,
+    int32_t            *result
 );
 
 int16_t ak09918_self_test(
-    int32_t *result
+    struct aks_context *ctx,
+    int32_t            *result
 );
 
 int16_t ak09919_self_test(
-    int32_t *result
+    struct aks_context *ctx,
+    int32_t            *result
 );
 
 #endif /* INCLUDE_AKS_MAG_AK099XX_H */
@@ -16,6 +16,8 @@
  * and grant commercial license to you.
  *
  ******************************************************************************/
+#include <string.h>
+
 #include "AKH_APIs.h"
 
 #include "ak8963_register.h"
@@ -28,17 +30,27 @@
 #define SENS_IN_Q16  (9830)  /* 0.15 in Q16 format */
 #endif
 
-/* Global variable for ASA value. */
-static uint16_t      g_dev;
-static uint8_t       g_asa[3];
-static int32_t       g_raw_to_micro_q16[3];
-static uint8_t       g_mag_axis_order[3];
-static uint8_t       g_mag_axis_sign[3];
-static AKM_TIMESTAMP g_mag_ts;
+/* Per device state. */
+struct ak8963_context {
+    struct aks_context base;
+    uint16_t           dev;
+    uint8_t            asa[3];
+    int32_t            raw_to_micro_q16[3];
+    uint8_t            axis_order[3];
+    uint8_t            axis_sign[3];
+    AKM_TIMESTAMP      drdy_ts;
+};
+
+static struct ak8963_context g_ctx[AKH_MAX_DEVICES];
+
+/* There is one DRDY line, so only the first device initialized owns it. */
+static struct ak8963_context *g_drdy_owner = NULL;
 
 void mag_ak8963_irq_handler(void)
 {
-    g_mag_ts = AKH_GetTimestamp();
+    if (g_drdy_owner != NULL) {
+        g_drdy_owner->drdy_ts = AKH_GetTimestamp();
+    }
 }
 
 static struct aks_interface ak8963_interface = {
@@ -55,22 +67,44 @@ static struct aks_interface ak8963_interface = {
 /******************************************************************************/
 /***** AKS public APIs ********************************************************/
 int16_t ak8963_config(
-    AKM_DEVICES          *mag_dev,
+    const AKH_HANDLE     handle,
+    struct aks_context   **mag_ctx,
     struct aks_interface **mag_if)
 {
-    *mag_dev = AKM_MAGNETOMETER_AK8963;
+    struct ak8963_context *c;
+
+    if (handle >= AKH_MAX_DEVICES) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    c = &g_ctx[handle];
+    memset(c, 0, sizeof(*c));
+    c->base.handle = handle;
+    c->base.device = AKM_MAGNETOMETER_AK8963;
+
+    *mag_ctx = &c->base;
     *mag_if = &ak8963_interface;
 
     return AKM_SUCCESS;
 }
 
-int16_t ak8963_set_mode(const uint8_t mode)
+int16_t ak8963_set_mode(
+    struct aks_context *ctx,
+    const uint8_t      mode)
 {
     uint8_t i2cData[2];
     int16_t fret;
 
     i2cData[0] = AK8963_bit_mode(mode);
-    fret = AKH_TxData(AKM_ST_MAG, AK8963_REG_CNTL1, i2cData, 1);
+
+    if (mode == AK8963_CNTL1_POWER_DOWN) {
+        /* The part leaves a mode by itself only to power-down, so
+         * a shadowed power-down is never stale. */
+        fret = AKH_UpdateBits(
+                ctx->handle, AK8963_REG_CNTL1, 0xFF, i2cData[0]);
+    } else {
+        fret = AKH_TxData(ctx->handle, AK8963_REG_CNTL1, i2cData, 1);
+    }
 
     if (fret != AKM_SUCCESS) {
         return fret;
@@ -81,67 +115,76 @@ int16_t ak8963_set_mode(const uint8_t mode)
     return AKM_SUCCESS;
 }
 
-int16_t ak8963_soft_reset(void)
+int16_t ak8963_soft_reset(struct aks_context *ctx)
 {
     uint8_t i2cData[2];
     int16_t fret;
 
     /* Soft Reset */
     i2cData[0] = AK8963_CNTL2_SOFT_RESET;
-    fret = AKH_TxData(AKM_ST_MAG, AK8963_REG_CNTL2, i2cData, 1);
+    fret = AKH_TxData(ctx->handle, AK8963_REG_CNTL2, i2cData, 1);
 
     if (fret != AKM_SUCCESS) {
         return fret;
     }
 
+    /* all registers are back to the default value */
+    AKH_InvalidateCache(ctx->handle);
+
     /* When succeeded, sleep */
     AKH_DelayMicro(100);
     return AKM_SUCCESS;
 }
 
 int16_t ak8963_init(
-    const uint8_t axis_order[3],
-    const uint8_t axis_sign[3])
+    struct aks_context *ctx,
+    const uint8_t      axis_order[3],
+    const uint8_t      axis_sign[3])
 {
-    uint8_t i2cData;
-    int16_t fret;
+    struct ak8963_context *c = (struct ak8963_context *)ctx;
+    uint8_t               i2cData;
+    int16_t               fret;
 
-    fret = ak8963_soft_reset();
+    fret = ak8963_soft_reset(ctx);
 
     if (fret != AKM_SUCCESS) {
         return fret;
     }
 
-    fret = AKH_SetIRQHandler(IRQ_MAG_1, mag_ak8963_irq_handler);
+    if ((g_drdy_owner == NULL) || (g_drdy_owner == c)) {
+        fret = AKH_SetIRQHandler(IRQ_MAG_1, mag_ak8963_irq_handler);
 
-    if (fret != AKM_SUCCESS) {
-        return fret;
+        if (fret != AKM_SUCCESS) {
+            return fret;
+        }
+
+        g_drdy_owner = c;
     }
 
     /* Read WIA */
-    fret = AKH_RxData(AKM_ST_MAG, AK8963_REG_WIA, &i2cData, 1);
+    fret = AKH_RxData(ctx->handle, AK8963_REG_WIA, &i2cData, 1);
 
     if (fret != AKM_SUCCESS) {
         return fret;
     }
 
     /* Store device id (actually, it is company id.) */
-    g_dev = i2cData;
+    c->dev = i2cData;
 
     /* Read FUSE ROM value */
-    fret = ak8963_set_mode(AK8963_CNTL1_FUSE_ACCESS);
+    fret = ak8963_set_mode(ctx, AK8963_CNTL1_FUSE_ACCESS);
 
     if (fret != AKM_SUCCESS) {
         return fret;
     }
 
-    fret = AKH_RxData(AKM_ST_MAG, AK8963_FUSE_ASAX, g_asa, 3);
+    fret = AKH_RxData(ctx->handle, AK8963_FUSE_ASAX, c->asa, 3);
 
     if (fret != AKM_SUCCESS) {
         return fret;
     }
 
-    fret = ak8963_set_mode(AK8963_CNTL1_POWER_DOWN);
+    fret = ak8963_set_mode(ctx, AK8963_CNTL1_POWER_DOWN);
 
     if (fret != AKM_SUCCESS) {
         return fret;
@@ -152,66 +195,72 @@ int16_t ak8963_init(
      * To convert micro tesla in Q16, multiply (SENS x 2^16)
      * Simplify the equation: coeff = ((ASA + 128) x SENS x 2^16) >> 8
      * So coeff = ((ASA + 128) x SENS) >> 8 */
-    g_raw_to_micro_q16[0] = ((g_asa[0] + 128) * SENS_IN_Q16) >> 8;
-    g_raw_to_micro_q16[1] = ((g_asa[1] + 128) * SENS_IN_Q16) >> 8;
-    g_raw_to_micro_q16[2] = ((g_asa[2] + 128) * SENS_IN_Q16) >> 8;
+    c->raw_to_micro_q16[0] = ((c->asa[0] + 128) * SENS_IN_Q16) >> 8;
+    c->raw_to_micro_q16[1] = ((c->asa[1] + 128) * SENS_IN_Q16) >> 8;
+    c->raw_to_micro_q16[2] = ((c->asa[2] + 128) * SENS_IN_Q16) >> 8;
 
     /* axis conversion parameter */
-    g_mag_axis_order[0] = axis_order[0];
-    g_mag_axis_order[1] = axis_order[1];
-    g_mag_axis_order[2] = axis_order[2];
-    g_mag_axis_sign[0] = axis_sign[0];
-    g_mag_axis_sign[1] = axis_sign[1];
-    g_mag_axis_sign[2] = axis_sign[2];
+    c->axis_order[0] = axis_order[0];
+    c->axis_order[1] = axis_order[1];
+    c->axis_order[2] = axis_order[2];
+    c->axis_sign[0] = axis_sign[0];
+    c->axis_sign[1] = axis_sign[1];
+    c->axis_sign[2] = axis_sign[2];
     return AKM_SUCCESS;
 }
 
-int16_t ak8963_get_info(struct AKS_DEVICE_INFO *info)
+int16_t ak8963_get_info(
+    struct aks_context     *ctx,
+    struct AKS_DEVICE_INFO *info)
 {
+    struct ak8963_context *c = (struct ak8963_context *)ctx;
+
     AKS_MyStrcpy(info->name, "AK8963", AKS_INFO_NAME_SIZE);
     info->device = AKM_MAGNETOMETER_AK8963;
     info->parameter[0] = 8963;
-    info->parameter[1] = g_dev;
-    info->parameter[2] = g_asa[0];
-    info->parameter[3] = g_asa[1];
-    info->parameter[4] = g_asa[2];
+    info->parameter[1] = c->dev;
+    info->parameter[2] = c->asa[0];
+    info->parameter[3] = c->asa[1];
+    info->parameter[4] = c->asa[2];
 
     return AKM_SUCCESS;
 }
 
-int16_t ak8963_start(const int32_t interval_us)
+int16_t ak8963_start(
+    struct aks_context *ctx,
+    const int32_t      interval_us)
 {
     int16_t ret;
 
     if (0 > interval_us) {
         /* Single Measurement */
-        ret = ak8963_set_mode(AK8963_CNTL1_SNG_MEASURE);
+        ret = ak8963_set_mode(ctx, AK8963_CNTL1_SNG_MEASURE);
     } else if (10000 >= interval_us) {
         /* Out of range */
         ret = AKM_ERR_INVALID_ARG;
     } else if (125000 >= interval_us) {
         /* 8 - 100 Hz */
-        ret = ak8963_set_mode(AK8963_CNTL1_CONT_MEASURE_MODE2);
+        ret = ak8963_set_mode(ctx, AK8963_CNTL1_CONT_MEASURE_MODE2);
     } else {
         /* 8 Hz or slower */
-        ret = ak8963_set_mode(AK8963_CNTL1_CONT_MEASURE_MODE1);
+        ret = ak8963_set_mode(ctx, AK8963_CNTL1_CONT_MEASURE_MODE1);
     }
 
     return ret;
 }
 
-int16_t ak8963_stop(void)
+int16_t ak8963_stop(struct aks_context *ctx)
 {
-    return ak8963_set_mode(AK8963_CNTL1_POWER_DOWN);
+    return ak8963_set_mode(ctx, AK8963_CNTL1_POWER_DOWN);
 }
 
-int16_t ak8963_check_rdy(const int32_t timeout_us)
+static int16_t ak8963_poll_rdy(struct aks_context *ctx)
 {
     uint8_t i2cData;
     int16_t fret;
 
     /* Check DRDY bit of ST1 register */
-    fret = AKH_RxData(AKM_ST_MAG, AK8963_REG_ST1, &i2cData, 1);
+    fret = AKH_RxData(ctx->handle, AK8963_REG_ST1, &i2cData, 1);
 
     if (fret != AKM_SUCCESS) {
         return fret;
@@ -222,14 +271,30 @@ int16_t ak8963_check_rdy(const int32_t timeout_us)
     return (i2cData & 0x01);
 }
 
+int16_t ak8963_check_rdy(
+    struct aks_context *ctx,
+    const int32_t      timeout_us)
+{
+    uint32_t event = 0U;
+
+    /* DRDY interrupt is routed to the first device only */
+    if (g_drdy_owner == (struct ak8963_context *)ctx) {
+        event = AKH_EVENT_MAG;
+    }
+
+    return aks_wait_ready(ctx, ak8963_poll_rdy, event, timeout_us);
+}
+
 int16_t ak8963_get_data(
+    struct aks_context     *ctx,
     struct AKM_SENSOR_DATA *data,
     uint8_t                *num)
 {
-    uint8_t i2cData[AK8963_BDATA_SIZE];
-    int16_t tmp;
-    int16_t fret;
-    uint8_t i;
+    struct ak8963_context *c = (struct ak8963_context *)ctx;
+    uint8_t               i2cData[AK8963_BDATA_SIZE];
+    int16_t               tmp;
+    int16_t               fret;
+    uint8_t               i;
 
     /* check arg */
     if (*num < 1) {
@@ -238,7 +303,7 @@ int16_t ak8963_get_data(
 
     /* Read data */
     fret = AKH_RxData(
-            AKM_ST_MAG, AK8963_REG_ST1, i2cData, AK8963_BDATA_SIZE);
+            ctx->handle, AK8963_REG_ST1, i2cData, AK8963_BDATA_SIZE);
 
     if (fret != AKM_SUCCESS) {
         return fret;
@@ -249,13 +314,18 @@ int16_t ak8963_get_data(
         tmp = (int16_t)(((uint16_t)i2cData[i * 2 + 2] << 8)
                         | i2cData[i * 2 + 1]);
         /* multiply ASA and convert to micro tesla in Q16 */
-        data->u.v[i] = tmp * g_raw_to_micro_q16[i];
+        data->u.v[i] = tmp * c->raw_to_micro_q16[i];
     }
 
-    AKS_ConvertCoordinate(data->u.v, g_mag_axis_order, g_mag_axis_sign);
+    AKS_ConvertCoordinate(data->u.v, c->axis_order, c->axis_sign);
 
     data->stype = AKM_ST_MAG;
-    data->timestamp = g_mag_ts;
+    if (g_drdy_owner == c) {
+        data->timestamp = c->drdy_ts;
+    } else {
+        data->timestamp = AKH_GetTimestamp();
+    }
+
     data->status[0] = i2cData[0];
     data->status[1] = i2cData[7];
     *num = 1;
@@ -22,46 +22,54 @@
 #include "AKS_APIs.h"
 
 int16_t ak8963_set_mode(
-    const uint8_t mode
+    struct aks_context *ctx,
+    const uint8_t      mode
 );
 
 int16_t ak8963_soft_reset(
-    void
+    struct aks_context *ctx
 );
 
 int16_t ak8963_config(
-    AKM_DEVICES *mag_dev,
+    const AKH_HANDLE     handle,
+    struct aks_context   **mag_ctx,
     struct aks_interface **mag_if
 );
 
 int16_t ak8963_init(
-    const uint8_t axis_order[3],
-    const uint8_t axis_sign[3]
+    struct aks_context *ctx,
+    const uint8_t      axis_order[3],
+    const uint8_t      axis_sign[3]
 );
 
 int16_t ak8963_get_info(
+    struct aks_context     *ctx,
     struct AKS_DEVICE_INFO *info
 );
 
 int16_t ak8963_start(
-    const int32_t interval_us
+    struct aks_context *ctx,
+    const int32_t      interval_us
 );
 
 int16_t ak8963_stop(
-    void
+    struct aks_context *ctx
 );
 
 int16_t ak8963_check_rdy(
-    const int32_t timeout_us
+    struct aks_context *ctx,
+    const int32_t      timeout_us
 );
 
 int16_t ak8963_get_data(
+    struct aks_context     *ctx,
     struct AKM_SENSOR_DATA *data,
     uint8_t                *num
 );
 
 int16_t ak8963_self_test(
-    int32_t *result
+    struct aks_context *ctx,
+    int32_t            *result
 );
 
 #endif /* INCLUDE_AKS_MAG_AK89XX_H */
@@ -178,7 +178,9 @@
  * \result upper_16bit test number
  * \result lower_16bit test result data.
  */
-int16_t ak8963_self_test(int32_t *result)
+int16_t ak8963_self_test(
+    struct aks_context *ctx,
+    int32_t            *result)
 {
     int16_t fret;
     uint8_t i2cData[13];
@@ -190,7 +192,7 @@ int16_t ak8963_self_test(int32_t *result)
      **********************************************************************/
 
     /* Soft Reset */
-    fret = ak8963_soft_reset();
+    fret = ak8963_soft_reset(ctx);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_RST, fret);
@@ -204,7 +206,7 @@ int16_t ak8963_self_test(int32_t *result)
      * write "00011011" to I2CDIS register(to disable I2C,). */
 #ifdef AKM_SPI_USED
     i2cData[0] = 0x1B;
-    fret = AKH_TxData(AKM_ST_MAG, AK8963_REG_I2CDIS, i2cData, 1);
+    fret = AKH_TxData(ctx->handle, AK8963_REG_I2CDIS, i2cData, 1);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_RST_SPI, fret);
@@ -212,7 +214,7 @@ int16_t ak8963_self_test(int32_t *result)
     }
 #endif
     /* Read values. */
-    fret = AKH_RxData(AKM_ST_MAG, AK8963_REG_WIA, i2cData, 13);
+    fret = AKH_RxData(ctx->handle, AK8963_REG_WIA, i2cData, 13);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_RST_READ, fret);
@@ -247,7 +249,7 @@ int16_t ak8963_self_test(int32_t *result)
             TLIMIT_HI_RST_ASTC, result);
 
     /* Read I2CDIS value. */
-    fret = AKH_RxData(AKM_ST_MAG, AK8963_REG_I2CDIS, i2cData, 1);
+    fret = AKH_RxData(ctx->handle, AK8963_REG_I2CDIS, i2cData, 1);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_RST_I2CDIS, fret);
@@ -264,14 +266,14 @@ int16_t ak8963_self_test(int32_t *result)
 #endif
 
     /* Read FUSE ROM value */
-    fret = ak8963_set_mode(AK8963_CNTL1_FUSE_ACCESS);
+    fret = ak8963_set_mode(ctx, AK8963_CNTL1_FUSE_ACCESS);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_FUSE_SET, fret);
         goto SELFTEST_FAIL;
     }
 
-    fret = AKH_RxData(AKM_ST_MAG, AK8963_FUSE_ASAX, asa, 3);
+    fret = AKH_RxData(ctx->handle, AK8963_FUSE_ASAX, asa, 3);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_FUSE_READ, fret);
@@ -285,7 +287,7 @@ int16_t ak8963_self_test(int32_t *result)
     AKM_FST(TLIMIT_NO_ASAZ, asa[2], TLIMIT_LO_ASAZ,
             TLIMIT_HI_ASAZ, result);
 
-    fret = ak8963_set_mode(AK8963_CNTL1_POWER_DOWN);
+    fret = ak8963_set_mode(ctx, AK8963_CNTL1_POWER_DOWN);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_FUSE_PDN, fret);
@@ -297,7 +299,7 @@ int16_t ak8963_self_test(int32_t *result)
      **********************************************************************/
 
     /* Set to SNG measurement pattern (Set CNTL1 register) */
-    fret = ak8963_set_mode(AK8963_CNTL1_SNG_MEASURE);
+    fret = ak8963_set_mode(ctx, AK8963_CNTL1_SNG_MEASURE);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_SNG_CNTL1, fret);
@@ -310,7 +312,7 @@ int16_t ak8963_self_test(int32_t *result)
      * Get measurement data from AK8963
      * ST1 + (HXL + HXH) + (HYL + HYH) + (HZL + HZH) + ST2
      *  = 1 + (1 + 1) + (1 + 1) + (1 + 1) + 1 = 8Byte */
-    fret = AKH_RxData(AKM_ST_MAG, AK8963_REG_ST1, i2cData, AK8963_BDATA_SIZE);
+    fret = AKH_RxData(ctx->handle, AK8963_REG_ST1, i2cData, AK8963_BDATA_SIZE);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_SNG_WAIT, fret);
@@ -335,7 +337,7 @@ int16_t ak8963_self_test(int32_t *result)
 
     /* Generate magnetic field for self-test (Set ASTC register) */
     i2cData[0] = 0x40;
-    fret = AKH_TxData(AKM_ST_MAG, AK8963_REG_ASTC, i2cData, 1);
+    fret = AKH_TxData(ctx->handle, AK8963_REG_ASTC, i2cData, 1);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_SLF_ASTC, fret);
@@ -343,7 +345,7 @@ int16_t ak8963_self_test(int32_t *result)
     }
 
     /* Set to Self-test mode (Set CNTL1 register) */
-    fret = ak8963_set_mode(AK8963_CNTL1_SELF_TEST);
+    fret = ak8963_set_mode(ctx, AK8963_CNTL1_SELF_TEST);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_SLF_CNTL1, fret);
@@ -356,7 +358,7 @@ int16_t ak8963_self_test(int32_t *result)
      * Get measurement data from AK8963
      * ST1 + (HXL + HXH) + (HYL + HYH) + (HZL + HZH) + ST2
      *  = 1 + (1 + 1) + (1 + 1) + (1 + 1) + 1 = 8Byte */
-    fret = AKH_RxData(AKM_ST_MAG, AK8963_REG_ST1, i2cData,
+    fret = AKH_RxData(ctx->handle, AK8963_REG_ST1, i2cData,
                       AK8963_BDATA_SIZE);
 
     if (AKM_SUCCESS != fret) {
@@ -385,7 +387,7 @@ int16_t ak8963_self_test(int32_t *result)
 
     /* Reset ASTC register */
     i2cData[0] = 0x00;
-    fret = AKH_TxData(AKM_ST_MAG, AK8963_REG_ASTC, i2cData, 1);
+    fret = AKH_TxData(ctx->handle, AK8963_REG_ASTC, i2cData, 1);
 
     if (AKM_SUCCESS != fret) {
         *result = AKM_FST_ERRCODE(TLIMIT_NO_SLF_ASTC_RST, fret);
@@ -0,0 +1,148 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+#include "mbed.h"
+#include "AKH_APIs.h"
+#include "console.h"
+#include "print_util.h"
+
+#define CONSOLE_LINE_SIZE  64
+#define CONSOLE_READ_SIZE  16
+
+static const struct console_cmd *g_table;
+static uint8_t                  g_table_num;
+
+static char     g_line[CONSOLE_LINE_SIZE];
+static uint16_t g_line_len;
+static bool     g_line_over;
+
+/* Set in interrupt context, cleared by console_poll. */
+static volatile uint8_t g_poll_pending;
+
+static void console_help(void)
+{
+    uint8_t i;
+
+    print_text("help : show this message\n");
+
+    for (i = 0; i < g_table_num; i++) {
+        print_text("%s : %s\n", g_table[i].name, g_table[i].help);
+    }
+}
+
+static void console_dispatch(char *line)
+{
+    char    *argv[CONSOLE_MAX_ARGS];
+    int     argc = 0;
+    char    *p = line;
+    uint8_t i;
+    int16_t fret;
+
+    /* split by white space */
+    while ((*p != '\0') && (argc < CONSOLE_MAX_ARGS)) {
+        while ((*p == ' ') || (*p == '\t')) {
+            *p++ = '\0';
+        }
+
+        if (*p == '\0') {
+            break;
+        }
+
+        argv[argc++] = p;
+
+        while ((*p != '\0') && (*p != ' ') && (*p != '\t')) {
+            p++;
+        }
+    }
+
+    if (argc == 0) {
+        return;
+    }
+
+    if (strcmp(argv[0], "help") == 0) {
+        console_help();
+        return;
+    }
+
+    for (i = 0; i < g_table_num; i++) {
+        if (strcmp(argv[0], g_table[i].name) == 0) {
+            fret = g_table[i].func(argc, argv);
+
+            if (fret != AKM_SUCCESS) {
+                print_text("%s failed (%d)\n", argv[0], fret);
+            }
+
+            return;
+        }
+    }
+
+    print_text("Unknown command: %s\n", argv[0]);
+}
+
+/* This is called in the thread of shared event queue. */
+static void console_poll(void)
+{
+    uint8_t  buf[CONSOLE_READ_SIZE];
+    uint16_t len;
+    uint16_t i;
+
+    core_util_atomic_store_u8(&g_poll_pending, 0);
+
+    while (AKH_Read(buf, sizeof(buf), &len) == AKM_SUCCESS) {
+        for (i = 0; i < len; i++) {
+            if ((buf[i] == '\r') || (buf[i] == '\n')) {
+                g_line[g_line_len] = '\0';
+
+                if (g_line_over) {
+                    print_text("Too long line\n");
+                } else {
+                    console_dispatch(g_line);
+                }
+
+                g_line_len = 0;
+                g_line_over = false;
+            } else if (g_line_len < (CONSOLE_LINE_SIZE - 1)) {
+                g_line[g_line_len++] = (char)buf[i];
+            } else {
+                g_line_over = true;
+            }
+        }
+    }
+}
+
+/* This is called in interrupt context. */
+static void console_rx(void)
+{
+    /* one pending call is enough to drain the buffer */
+    if (core_util_atomic_exchange_u8(&g_poll_pending, 1) == 0) {
+        mbed_event_queue()->call(console_poll);
+    }
+}
+
+int16_t console_init(
+    const struct console_cmd *table,
+    const uint8_t            num)
+{
+    g_table = table;
+    g_table_num = num;
+    g_line_len = 0;
+    g_line_over = false;
+    g_poll_pending = 0;
+
+    return AKH_SetIRQHandler(IRQ_UART, console_rx);
+}
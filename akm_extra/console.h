@@ -0,0 +1,57 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+#ifndef INCLUDE_CONSOLE_H
+#define INCLUDE_CONSOLE_H
+
+#include "AKM_Common.h"
+
+/* The maximum number of arguments including command name. */
+#define CONSOLE_MAX_ARGS  4
+
+/*!
+ * An entry of command table.
+ */
+struct console_cmd {
+    /*! Command name, which is the first word of a line. */
+    const char *name;
+    /*! One line help message. */
+    const char *help;
+    /*! Handler. argv[0] is the command name.
+     * This is called in the thread of shared event queue. */
+    int16_t (*func)(int argc, char *argv[]);
+};
+
+/*!
+ * \brief Start command console on UART input.
+ *
+ * Received bytes are collected in interrupt driven way, and each line is
+ * dispatched to the table outside of measurement loop. "help" command is
+ * provided by console itself.
+ *
+ * \param table Command table. It must be valid until program ends.
+ * \param num The number of entries in the table.
+ *
+ * \return #AKM_SUCCESS on success.
+ */
+int16_t console_init(
+    const struct console_cmd *table,
+    const uint8_t            num
+);
+
+#endif /* INCLUDE_CONSOLE_H */
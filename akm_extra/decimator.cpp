@@ -0,0 +1,103 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+#include "decimator.h"
+
+int16_t decimator_init(
+    struct decimator *dec,
+    const uint16_t   factor)
+{
+    if ((factor == 0U) || (factor > DECIMATOR_MAX_FACTOR)) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    dec->sum[0] = 0;
+    dec->sum[1] = 0;
+    dec->sum[2] = 0;
+    dec->first = 0;
+    dec->status[0] = 0;
+    dec->status[1] = 0;
+    dec->factor = factor;
+    dec->count = 0U;
+
+    return AKM_SUCCESS;
+}
+
+/* Half of the divisor with the sign of the sum, to round to nearest */
+static int64_t half(const int64_t sum, const int64_t n)
+{
+    return ((sum < 0) ? -n : n) / 2;
+}
+
+int16_t decimator_push(
+    struct decimator             *dec,
+    const struct AKM_SENSOR_DATA *in,
+    struct AKM_SENSOR_DATA       *out)
+{
+    int64_t       n;
+    AKM_TIMESTAMP span;
+
+    /* no filter, copy as it is */
+    if (dec->factor <= 1U) {
+        if (out != in) {
+            *out = *in;
+        }
+
+        return AKM_SUCCESS;
+    }
+
+    if (dec->count == 0U) {
+        dec->first = in->timestamp;
+    }
+
+    dec->sum[0] += in->u.s.x;
+    dec->sum[1] += in->u.s.y;
+    dec->sum[2] += in->u.s.z;
+    dec->status[0] |= in->status[0];
+    dec->status[1] |= in->status[1];
+    dec->count++;
+
+    if (dec->count < dec->factor) {
+        return AKM_ERR_BUSY;
+    }
+
+    /* Divide only once per window, round to nearest */
+    n = (int64_t)dec->factor;
+    out->u.s.x = (int32_t)((dec->sum[0] + half(dec->sum[0], n)) / n);
+    out->u.s.y = (int32_t)((dec->sum[1] + half(dec->sum[1], n)) / n);
+    out->u.s.z = (int32_t)((dec->sum[2] + half(dec->sum[2], n)) / n);
+    out->u.v[3] = 0;
+    out->u.v[4] = 0;
+    /* Stamp at the middle of the window. Unsigned arithmetic keeps it
+     * right across the wrap of microsecond timestamp. */
+    span = (AKM_TIMESTAMP)((uint64_t)in->timestamp - (uint64_t)dec->first);
+    out->timestamp = (AKM_TIMESTAMP)((uint64_t)dec->first +
+                                     (uint64_t)(span / 2));
+    out->status[0] = dec->status[0];
+    out->status[1] = dec->status[1];
+    out->stype = in->stype;
+
+    dec->sum[0] = 0;
+    dec->sum[1] = 0;
+    dec->sum[2] = 0;
+    dec->status[0] = 0;
+    dec->status[1] = 0;
+    dec->count = 0U;
+
+    return AKM_SUCCESS;
+}
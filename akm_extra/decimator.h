@@ -0,0 +1,81 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+#ifndef INCLUDE_DECIMATOR_H
+#define INCLUDE_DECIMATOR_H
+
+#include "AKM_Common.h"
+
+/* The maximum decimation factor. Samples are Q16 physical values which
+ * may use the whole int32_t range, so the window is summed in int64_t. */
+#define DECIMATOR_MAX_FACTOR  256U
+
+/*!
+ * Box-car decimator of three axis data.
+ * Each sensor should have its own instance.
+ */
+struct decimator {
+    /*! Sum of the samples in current window. */
+    int64_t       sum[3];
+    /*! Timestamp of the first sample in current window. */
+    AKM_TIMESTAMP first;
+    /*! Status of the samples in current window. Bitwise OR. */
+    int16_t       status[2];
+    /*! The number of samples averaged into one output. */
+    uint16_t      factor;
+    /*! The number of samples in current window. */
+    uint16_t      count;
+};
+
+/*!
+ * \brief Initialize decimator and set its factor.
+ *
+ * \param dec Decimator.
+ * \param factor The number of samples averaged into one output.
+ * 1 to #DECIMATOR_MAX_FACTOR. 1 passes every sample through.
+ *
+ * \return #AKM_SUCCESS on success. #AKM_ERR_INVALID_ARG if factor is out
+ * of range, in this case the decimator is not changed.
+ */
+int16_t decimator_init(
+    struct decimator *dec,
+    const uint16_t   factor
+);
+
+/*!
+ * \brief Add one sample to decimator.
+ *
+ * Each output is the average of \c factor input samples. Its timestamp is
+ * the middle of the first and the last sample, which is the group delay
+ * of box-car filter. The sensor type is taken from the last sample.
+ *
+ * \param dec Decimator.
+ * \param in Input sample.
+ * \param out Output sample. This is written only when #AKM_SUCCESS is
+ * returned. It can be the same as \c in.
+ *
+ * \return #AKM_SUCCESS when a window is completed and \c out is written.
+ * #AKM_ERR_BUSY when the sample is accumulated.
+ */
+int16_t decimator_push(
+    struct decimator             *dec,
+    const struct AKM_SENSOR_DATA *in,
+    struct AKM_SENSOR_DATA       *out
+);
+
+#endif /* INCLUDE_DECIMATOR_H */
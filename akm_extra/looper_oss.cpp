@@ -5,36 +5,1007 @@
 #include "looper.h"
 #include "print_util.h"
 #include "akh_i2c.h"
+#include "console.h"
+#include "decimator.h"
+#include "sample_ring.h"
+#include "sensor_health.h"
+#include "stream_sync.h"
+#include <stdlib.h>
+#include <string.h>
 
 #define GET_VEC_BUF_SIZE   6U
+/* The maximum number of samples taken from a ring at once */
+#define READ_BATCH_SIZE    8U
+/* MAG, ACC and GYR */
+#define NUM_OF_STREAMS     3U
 #define STATISTICS
 #define PRINT_INTERVAL_MS  200U
+/* The longest wait for a restart at exit */
+#define RESTART_WAIT_US    1000000U
+/* The size of each write when a trace is dumped */
+#define TRACE_DUMP_CHUNK   256U
 
 #define FREQ_TO_INTERVAL_US(f)  (1000000 / (f))
 #define FREQ_TO_INTERVAL_MS(f)  (1000 / (f))
+#define FREQ_TO_INTERVAL_NS(f)  (1000000000ULL / (f))
+#define MS_TO_NS(ms)            ((uint64_t)(ms) * 1000000ULL)
 
-/*! Timer tick counter.
- * Timer callback function ('interrupt') increments this variable
- * every 1 millisecond. This counter is set to 0 at start up.
- * This variable reset at the beginning of measurement loop.*/
-static uint32_t tm_event;
-/*! Magnetic event counter.
- * Timer callback function ('interrupt') increments this variable
- * every 1 millisecond.
- * This counter is reset when new data is obtained. */
-static uint32_t mag_event;
+/* Poll the sensor if DRDY does not come within 1.5 times of interval */
+#define DRDY_WATCHDOG_NS(iv)    ((iv) + ((iv) / 2U))
 
-static uint32_t acc_event;
+#ifdef AKM_MAGNETOMETER_DRDY_EN
+#define MAG_DRDY_EVENT  AKH_EVENT_MAG
+#else
+#define MAG_DRDY_EVENT  0U
+#endif
+
+/*!
+ * Sensors of one type, which are read together at their own rate.
+ */
+struct loop_stream {
+    const char             *name;
+    AKM_SENSOR_TYPE        stype;
+    /*! AKM_VT_XXX which selects output of this stream. */
+    uint32_t               vt;
+    /*! AKH_EVENT_XXX which is signaled on DRDY. 0 if it is not used. */
+    uint32_t               event;
+    /*! Sensors of this type. 0 when the stream is not running. */
+    uint32_t               mask;
+    /*! The sensor which feeds the library and text output. */
+    uint8_t                primary;
+    uint64_t               interval_ns;
+    /*! Deadline of the next read in nano seconds.
+     * When DRDY interrupt is used, this works as a watchdog in case the
+     * interrupt edge is lost. Otherwise the loop reads data at this time. */
+    uint64_t               deadline;
+    /*! The latest data of primary sensor. */
+    struct AKM_SENSOR_DATA last;
+    uint8_t                has_last;
+    /*! Set when the library does not take this type of data. */
+    uint8_t                no_library;
+    /* statistics */
+    uint32_t               reads;
+    uint32_t               errors;
+    /*! The number of intervals which were skipped. */
+    uint32_t               missed;
+    /*! The maximum delay of read from its deadline. */
+    uint64_t               late_max_ns;
+};
+
+static struct loop_stream streams[NUM_OF_STREAMS];
+
+/*! Deadline of the next periodic print in nano seconds. */
+static uint64_t print_deadline;
+
+/* Requests from command console. Console handlers run in the thread of
+ * shared event queue, so they only post requests here, and the
+ * measurement loop takes them between samples. */
+#define REQ_ODR      0x01U
+#define REQ_RECAL    0x02U
+#define REQ_STATS    0x04U
+#define REQ_QUIT     0x08U
+#define REQ_DEC      0x10U
+#define REQ_SYNC     0x20U
+#define REQ_RESTART  0x40U
+
+static volatile uint32_t req_flags;
+static volatile uint32_t req_odr_hz;
+static volatile uint32_t req_dec_factor;
+static volatile uint32_t req_sync_hz;
+
+/*! Decimation of each sensor. Only magnetometers are averaged. */
+static struct decimator sensor_dec[AKS_MAX_SENSORS];
+
+/*! Samples from acquisition to fusion and output. Indexed by sensor. */
+static struct sample_ring sensor_ring[AKS_MAX_SENSORS];
+
+/*!
+ * A read which runs in the background. The callback writes it in the
+ * thread of the HAL, and the loop takes the result.
+ */
+struct async_read {
+    struct AKM_SENSOR_DATA data;
+    /*! Set while the transfer is in flight. */
+    volatile uint8_t       busy;
+    /*! Set when the transfer has failed. Cleared by the loop. */
+    volatile uint8_t       failed;
+};
+
+/*! Background read of each sensor. */
+static struct async_read sensor_async[AKS_MAX_SENSORS];
+/*! Sensors which can be read in the background. */
+static uint32_t          async_mask;
+
+/*! Health of each sensor. */
+static struct sensor_health sensor_hlt[AKS_MAX_SENSORS];
+/*! Sensors which are not read until they are recovered. */
+static uint32_t             faulty_mask;
+/*! The package of the sensor which is being restarted. It is not read
+ * until the restart ends. 0 when no restart is running. */
+static uint32_t             restart_mask;
+static uint8_t              restart_sensor;
+static volatile int16_t     restart_result;
+/*! The stream of the sensor, and its interval when the restart began. */
+static struct loop_stream   *restart_stream;
+static uint64_t             restart_interval_ns;
+
+/*! Alignment of streams before fusion. Channel n is streams[n]. */
+static struct stream_sync fusion_sync;
+/*! The rate of the grid. 0 when alignment is off. */
+static uint16_t           sync_hz;
+
+/*! Vectors which are output. Bitwise OR of AKM_VT_XXX. */
+static volatile uint32_t out_vectors = AKM_VT_MAG;
+/*! Measurement is paused when this is non-zero. */
+static volatile uint8_t  out_paused;
+
+static void post_request(const uint32_t req)
+{
+    core_util_atomic_fetch_or_u32(&req_flags, req);
+    AKH_SignalEvent(AKH_EVENT_APP);
+}
+
+static int16_t cmd_odr(int argc, char *argv[])
+{
+    uint32_t hz;
+
+    if (argc != 2) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    hz = (uint32_t)strtoul(argv[1], NULL, 10);
+
+    if ((hz == 0U) || (hz > 1000U)) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    req_odr_hz = hz;
+    post_request(REQ_ODR);
+
+    return AKM_SUCCESS;
+}
+
+static int16_t cmd_dec(int argc, char *argv[])
+{
+    uint32_t factor;
+
+    if (argc != 2) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    factor = (uint32_t)strtoul(argv[1], NULL, 10);
+
+    if ((factor == 0U) || (factor > DECIMATOR_MAX_FACTOR)) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    req_dec_factor = factor;
+    post_request(REQ_DEC);
+
+    return AKM_SUCCESS;
+}
+
+static int16_t cmd_sync(int argc, char *argv[])
+{
+    uint32_t hz;
+
+    if (argc != 2) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    hz = (uint32_t)strtoul(argv[1], NULL, 10);
+
+    if (hz > SYNC_MAX_FREQ) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    req_sync_hz = hz;
+    post_request(REQ_SYNC);
+
+    return AKM_SUCCESS;
+}
+
+static int16_t cmd_out(int argc, char *argv[])
+{
+    uint32_t vt = 0U;
+    int      i;
+
+    if (argc < 2) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "mag") == 0) {
+            vt |= AKM_VT_MAG;
+        } else if (strcmp(argv[i], "acc") == 0) {
+            vt |= AKM_VT_ACC;
+        } else if (strcmp(argv[i], "gyr") == 0) {
+            vt |= AKM_VT_GYR;
+        } else if (strcmp(argv[i], "ori") == 0) {
+            vt |= AKM_VT_ORI;
+        } else if (strcmp(argv[i], "quat") == 0) {
+            vt |= AKM_VT_QUAT;
+        } else if (strcmp(argv[i], "none") != 0) {
+            return AKM_ERR_INVALID_ARG;
+        }
+    }
+
+    core_util_atomic_store_u32(&out_vectors, vt);
+
+    return AKM_SUCCESS;
+}
+
+static int16_t cmd_mode(int argc, char *argv[])
+{
+    if (argc != 2) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    if (strcmp(argv[1], "text") == 0) {
+        print_set_mode(PRINT_MODE_TEXT);
+    } else if (strcmp(argv[1], "bin") == 0) {
+        print_set_mode(PRINT_MODE_BINARY);
+    } else {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    return AKM_SUCCESS;
+}
+
+static int16_t cmd_recal(int argc, char *argv[])
+{
+    post_request(REQ_RECAL);
+    return AKM_SUCCESS;
+}
+
+static int16_t cmd_stats(int argc, char *argv[])
+{
+    post_request(REQ_STATS);
+    return AKM_SUCCESS;
+}
+
+static int16_t cmd_pause(int argc, char *argv[])
+{
+    core_util_atomic_store_u8(&out_paused, 1U);
+    print_text("Program paused. Enter 'r' to resume.\n");
+    AKH_SignalEvent(AKH_EVENT_APP);
+    return AKM_SUCCESS;
+}
+
+static int16_t cmd_resume(int argc, char *argv[])
+{
+    core_util_atomic_store_u8(&out_paused, 0U);
+    print_text("Program resumed.\n");
+    AKH_SignalEvent(AKH_EVENT_APP);
+    return AKM_SUCCESS;
+}
+
+static int16_t cmd_trace(int argc, char *argv[])
+{
+    const uint8_t *trace;
+    uint32_t      len;
+    uint32_t      pos;
+    uint16_t      n;
+    int16_t       fret;
+
+    if (argc != 2) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    if (strcmp(argv[1], "start") == 0) {
+        return AKH_TraceStart();
+    }
+
+    if (strcmp(argv[1], "stop") == 0) {
+        return AKH_TraceStop();
+    }
+
+    if (strcmp(argv[1], "dump") != 0) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    /* Raw binary. The header lets the reader find it in the capture. */
+    fret = AKH_TraceGet(&trace, &len);
+
+    for (pos = 0U; (fret == AKM_SUCCESS) && (pos < len); pos += n) {
+        n = (uint16_t)(((len - pos) < TRACE_DUMP_CHUNK) ?
+                       (len - pos) : TRACE_DUMP_CHUNK);
+        fret = AKH_Write(&trace[pos], n);
+    }
+
+    return fret;
+}
+
+static int16_t cmd_quit(int argc, char *argv[])
+{
+    print_text("Exiting program...\n");
+    post_request(REQ_QUIT);
+    return AKM_SUCCESS;
+}
+
+static const struct console_cmd looper_cmds[] = {
+    { "odr",   "odr <Hz> : set magnetometer output data rate", cmd_odr },
+    { "dec",   "dec <n> : average n magnetometer samples into one output",
+      cmd_dec },
+    { "sync",  "sync <Hz> : align sensors to a time grid before fusion, "
+      "0 is off", cmd_sync },
+    { "out",   "out <mag|acc|gyr|ori|quat|none>... : select output vectors",
+      cmd_out },
+    { "mode",  "mode <text|bin> : select output format", cmd_mode },
+    { "recal", "restart magnetometer offset calibration", cmd_recal },
+    { "stats", "print statistics", cmd_stats },
+    { "trace", "trace <start|stop|dump> : record bus transactions",
+      cmd_trace },
+    { "q",     "pause measurement", cmd_pause },
+    { "r",     "resume measurement", cmd_resume },
+    { "z",     "save parameters and exit", cmd_quit },
+};
+
+#ifdef STATISTICS
+/*!
+ * \brief Print statistics of sensor streams and HAL.
+ */
+static void print_statistics(void)
+{
+    struct AKH_BUS_THROUGHPUT tp;
+    struct AKH_CACHE_STATS    cs;
+    struct AKH_BUS_ERRORS     be;
+    struct AKH_LOG_STATS      ls;
+    struct AKH_POWER_STATS    ps;
+    struct AKH_TRACE_STATS    ts;
+    struct AKH_DEVICE_DESC    desc;
+    struct loop_stream        *s;
+    AKH_HANDLE                dev;
+
+    if (AKH_GetBusThroughput(&tp) == AKM_SUCCESS) {
+        print_text("Bus: %u bytes in %u us (%u bytes/s)\n",
+                   (unsigned int)tp.bytes,
+                   (unsigned int)tp.busy_us,
+                   (unsigned int)tp.bytes_per_sec);
+    }
+
+    for (s = streams; s < &streams[NUM_OF_STREAMS]; s++) {
+        if (s->mask == 0U) {
+            continue;
+        }
+
+        print_text("%s: %u read, %u read error, %u missed, "
+                   "%u us late at most\n",
+                   s->name,
+                   (unsigned int)s->reads,
+                   (unsigned int)s->errors,
+                   (unsigned int)s->missed,
+                   (unsigned int)(s->late_max_ns / 1000U));
+    }
+
+    for (dev = 0; dev < AKS_MAX_SENSORS; dev++) {
+        if (sensor_ring[dev].pushed == 0U) {
+            continue;
+        }
+
+        print_text("Sensor %u ring: %u pushed, %u overrun\n",
+                   (unsigned int)dev,
+                   (unsigned int)sensor_ring[dev].pushed,
+                   (unsigned int)sensor_ring[dev].overruns);
+    }
+
+    for (dev = 0; dev < AKS_MAX_SENSORS; dev++) {
+        if (sensor_hlt[dev].faults == 0U) {
+            continue;
+        }
+
+        print_text("Sensor %u health: %u fault, %u recovered, "
+                   "%u failed attempt, %u us to recover at most\n",
+                   (unsigned int)dev,
+                   (unsigned int)sensor_hlt[dev].faults,
+                   (unsigned int)sensor_hlt[dev].recoveries,
+                   (unsigned int)sensor_hlt[dev].failures,
+                   (unsigned int)(sensor_hlt[dev].recovery_max_ns / 1000U));
+    }
+
+    for (dev = 0; dev < AKH_GetNumberOfDevices(); dev++) {
+        if ((AKH_GetDeviceDesc(dev, &desc) != AKM_SUCCESS) ||
+            (AKH_GetBusErrors(dev, &be) != AKM_SUCCESS)) {
+            continue;
+        }
+
+        print_text("Device %u at 0x%02X: %u nack, %u timeout, "
+                   "%u retry, %u recovery\n",
+                   (unsigned int)dev,
+                   (unsigned int)desc.address,
+                   (unsigned int)be.nacks,
+                   (unsigned int)be.timeouts,
+                   (unsigned int)be.retries,
+                   (unsigned int)be.recoveries);
+    }
+
+    if (fusion_sync.mask != 0U) {
+        print_text("Sync: %u output, %u dropped, %u resync\n",
+                   (unsigned int)fusion_sync.outputs,
+                   (unsigned int)fusion_sync.dropped,
+                   (unsigned int)fusion_sync.resyncs);
+    }
+
+    if (AKH_GetCacheStats(&cs) == AKM_SUCCESS) {
+        print_text("Reg cache: %u hit, %u miss, %u write skipped\n",
+                   (unsigned int)cs.hits,
+                   (unsigned int)cs.misses,
+                   (unsigned int)cs.skipped_writes);
+    }
+
+    if (AKH_GetLogStats(&ls) == AKM_SUCCESS) {
+        print_text("Log: %u queued, %u dropped\n",
+                   (unsigned int)ls.logged,
+                   (unsigned int)ls.dropped);
+    }
+
+    if (AKH_GetPowerStats(&ps) == AKM_SUCCESS) {
+        print_text("Idle: %u wakeup/s, %u us active per wakeup, "
+                   "active %u, deep sleep %u per mille\n",
+                   (unsigned int)ps.wakeups_per_sec,
+                   (unsigned int)ps.avg_active_us,
+                   (unsigned int)ps.active_permille,
+                   (unsigned int)ps.deep_sleep_permille);
+    }
+
+    if (AKH_GetTraceStats(&ts) == AKM_SUCCESS) {
+        print_text("Trace: %u records, %u bytes, %u dropped\n",
+                   (unsigned int)ts.records,
+                   (unsigned int)ts.bytes,
+                   (unsigned int)ts.dropped);
+    }
+}
+#endif
+
+/* Time from a read to the next one. */
+static uint64_t stream_period(const struct loop_stream *s)
+{
+    if (s->event != 0U) {
+        return DRDY_WATCHDOG_NS(s->interval_ns);
+    }
+
+    return s->interval_ns;
+}
+
+/*!
+ * \brief Start all sensors of a type at the frequency.
+ *
+ * When no sensor of the type is configured, the stream is left stopped
+ * and #AKM_SUCCESS is returned. Deadline is set by caller.
+ */
+static int16_t stream_start(
+    struct loop_stream    *s,
+    const char            *name,
+    const AKM_SENSOR_TYPE stype,
+    const uint32_t        vt,
+    const uint32_t        event,
+    const uint32_t        freq)
+{
+    int16_t fret;
+
+    memset(s, 0, sizeof(*s));
+    s->name = name;
+    s->stype = stype;
+    s->vt = vt;
+    s->event = event;
+
+    if (AKS_GetSensorMask(stype) == 0U) {
+        return AKM_SUCCESS;
+    }
+
+    fret = AKS_Start(stype, FREQ_TO_INTERVAL_US(freq));
+
+    if (fret != AKM_SUCCESS) {
+        return fret;
+    }
+
+    s->mask = AKS_GetSensorMask(stype);
+
+    for (s->primary = 0U; s->primary < AKS_MAX_SENSORS; s->primary++) {
+        if ((s->mask & ((uint32_t)1U << s->primary)) != 0U) {
+            break;
+        }
+    }
+
+    s->interval_ns = FREQ_TO_INTERVAL_NS(freq);
+
+    return AKM_SUCCESS;
+}
+
+/* Stop the stream if it is running. */
+static void stream_stop(struct loop_stream *s)
+{
+    if (s->mask != 0U) {
+        AKS_Stop(s->stype);
+        s->mask = 0U;
+    }
+}
+
+/* Find the stream which has data or whose deadline has passed.
+ * When more than one stream is due, the earliest deadline comes first. */
+static struct loop_stream *stream_next_due(
+    const uint32_t events,
+    const uint64_t now)
+{
+    struct loop_stream *s;
+    struct loop_stream *due = NULL;
+
+    for (s = streams; s < &streams[NUM_OF_STREAMS]; s++) {
+        if ((s->mask == 0U) ||
+            (((events & s->event) == 0U) && (now < s->deadline))) {
+            continue;
+        }
+
+        if ((due == NULL) || (s->deadline < due->deadline)) {
+            due = s;
+        }
+    }
+
+    return due;
+}
+
+/* Set the next deadline of the stream which is read now. */
+static void stream_schedule(
+    struct loop_stream *s,
+    const uint8_t      by_event,
+    const uint64_t     now)
+{
+    uint64_t late;
+
+    if (by_event != 0U) {
+        s->deadline = now + stream_period(s);
+        return;
+    }
+
+    late = now - s->deadline;
+
+    if (late > s->late_max_ns) {
+        s->late_max_ns = late;
+    }
+
+    /* DRDY was lost, or the loop was busy for whole interval */
+    if ((s->event != 0U) || (late >= s->interval_ns)) {
+        s->missed += (uint32_t)(late / s->interval_ns) + 1U;
+    }
+
+    /* Do not try to catch up missed intervals */
+    s->deadline += stream_period(s);
+
+    if (s->deadline <= now) {
+        s->deadline = now + stream_period(s);
+    }
+}
+
+/* Take a sensor out of its stream when it has just become faulty.
+ * It is restarted by stream_recover(). */
+static void sensor_fault(
+    const uint8_t sensor,
+    const uint8_t reason)
+{
+    if (reason == HEALTH_OK) {
+        return;
+    }
+
+    faulty_mask |= ((uint32_t)1U << sensor);
+    print_text("Sensor %u: %s, recovering\n",
+               (unsigned int)sensor, health_reason(reason));
+}
+
+/* The end of a restart. This is called in the thread of the HAL. */
+static void restart_done(
+    const int16_t result,
+    void          *arg)
+{
+    restart_result = result;
+    post_request(REQ_RESTART);
+}
+
+/*!
+ * \brief Restart a faulty sensor whose retry time has come, at the rate
+ * of its stream. The restart runs in the background, and other sensors
+ * keep streaming. See stream_restarted().
+ */
+static void stream_recover(void)
+{
+    struct loop_stream   *s;
+    struct sensor_health *h;
+    uint32_t             bit;
+    uint8_t              i;
+    int16_t              fret;
+
+    /* One at a time */
+    if (restart_mask != 0U) {
+        return;
+    }
+
+    for (s = streams; s < &streams[NUM_OF_STREAMS]; s++) {
+        for (i = 0U; i < AKS_MAX_SENSORS; i++) {
+            bit = (uint32_t)1U << i;
+            h = &sensor_hlt[i];
+
+            if (((s->mask & faulty_mask & bit) == 0U) ||
+                (AKH_GetTimeNs() < h->retry_ns)) {
+                continue;
+            }
+
+            fret = AKS_Restart(i, (int32_t)(s->interval_ns / 1000U),
+                               restart_done, NULL);
+
+            if (fret != AKM_SUCCESS) {
+                health_recovered(h, fret, AKH_GetTimeNs());
+                continue;
+            }
+
+            restart_sensor = i;
+            restart_mask = AKS_GetSiblingMask(i);
+            restart_stream = s;
+            restart_interval_ns = s->interval_ns;
+            return;
+        }
+    }
+}
+
+/*!
+ * \brief Take the result of the restart which was started by
+ * stream_recover().
+ */
+static void stream_restarted(
+    const int16_t  result,
+    const uint64_t now)
+{
+    struct sensor_health *h = &sensor_hlt[restart_sensor];
+    uint32_t             bit = (uint32_t)1U << restart_sensor;
+    uint8_t              i;
+    int16_t              fret = result;
 
-static uint32_t gyr_event;
+    /* The rate was changed while it restarted */
+    if ((fret == AKM_SUCCESS) &&
+        (restart_stream->interval_ns != restart_interval_ns)) {
+        AKS_StopMulti(bit);
+        fret = AKS_StartMulti(bit,
+                              (int32_t)(restart_stream->interval_ns / 1000U));
+    }
+
+    health_recovered(h, fret, now);
+
+    if (fret == AKM_SUCCESS) {
+        /* Start new windows, samples before the reset are gone */
+        for (i = 0U; i < AKS_MAX_SENSORS; i++) {
+            if ((restart_mask & ((uint32_t)1U << i)) != 0U) {
+                decimator_init(&sensor_dec[i], sensor_dec[i].factor);
+            }
+        }
+
+        sync_reset(&fusion_sync);
+        faulty_mask &= ~bit;
+        print_text("Sensor %u: recovered in %u us, %u times\n",
+                   (unsigned int)restart_sensor,
+                   (unsigned int)((now - h->fault_ns) / 1000U),
+                   (unsigned int)h->recoveries);
+    }
+
+    restart_mask = 0U;
+}
+
+/* The earliest retry time of faulty sensors, or limit if it is later. */
+static uint64_t stream_next_retry(uint64_t limit)
+{
+    uint8_t i;
+
+    /* The end of restart is signaled */
+    if (restart_mask != 0U) {
+        return limit;
+    }
+
+    for (i = 0U; i < AKS_MAX_SENSORS; i++) {
+        if (((faulty_mask & ((uint32_t)1U << i)) != 0U) &&
+            (sensor_hlt[i].retry_ns < limit)) {
+            limit = sensor_hlt[i].retry_ns;
+        }
+    }
+
+    return limit;
+}
+
+/* Align the streams which feed the library, when there are two or more
+ * of them. Otherwise samples go to the library as they are read.
+ * Alignment starts again when the set of streams changes, or by force. */
+static void stream_sync_update(const uint8_t force)
+{
+    struct loop_stream *s;
+    uint32_t           mask = 0U;
+    uint8_t            num = 0U;
+
+    for (s = streams; s < &streams[NUM_OF_STREAMS]; s++) {
+        if ((s->mask != 0U) && (s->no_library == 0U)) {
+            mask |= (uint32_t)1U << (s - streams);
+            num++;
+        }
+    }
+
+    if ((num < 2U) || (sync_hz == 0U)) {
+        mask = 0U;
+    }
+
+    if ((force == 0U) && (mask == fusion_sync.mask)) {
+        return;
+    }
+
+    if (mask == 0U) {
+        sync_reset(&fusion_sync);
+        fusion_sync.mask = 0U;
+    } else {
+        sync_init(&fusion_sync, mask, sync_hz);
+    }
+}
+
+/*!
+ * \brief Feed the library with vectors which are aligned to the grid.
+ *
+ * \return Non-zero when the library took new data.
+ */
+static uint8_t stream_fuse(struct AKL_SCL_PRMS *prm)
+{
+    struct AKM_SENSOR_DATA aligned[SYNC_MAX_CHANNELS];
+    struct loop_stream     *s;
+    int16_t                fret;
+    uint8_t                updated = 0U;
+    uint8_t                changed = 0U;
+    uint8_t                n;
+    uint8_t                j;
+
+    while ((changed == 0U) &&
+           ((n = sync_pop(&fusion_sync, aligned)) > 0U)) {
+        for (j = 0U; j < n; j++) {
+            fret = AKL_SetVector(prm, &aligned[j], 1U);
+
+            if (fret == AKM_SUCCESS) {
+                updated = 1U;
+                continue;
+            }
+
+            if (fret != AKM_ERR_NOT_SUPPORT) {
+                continue;
+            }
+
+            /* The library does not take this type, stop aligning it */
+            for (s = streams; s < &streams[NUM_OF_STREAMS]; s++) {
+                if (s->stype == aligned[j].stype) {
+                    s->no_library = 1U;
+                    changed = 1U;
+                }
+            }
+        }
+    }
+
+    if (changed != 0U) {
+        stream_sync_update(0U);
+    }
+
+    return updated;
+}
+
+/* The end of a background read. The sample goes to the ring of the
+ * sensor, and the loop is woken up to take it. */
+static void async_read_done(
+    const int16_t result,
+    void          *arg)
+{
+    struct async_read *a = (struct async_read *)arg;
+
+    if (result == AKM_SUCCESS) {
+        sample_ring_push(&sensor_ring[a - sensor_async], &a->data);
+    } else {
+        a->failed = 1U;
+    }
+
+    a->busy = 0U;
+    AKH_SignalEvent(AKH_EVENT_APP);
+}
+
+/*!
+ * \brief Read all sensors of the stream into the ring of each sensor.
+ *
+ * Sensors which can be read in the background are only started here,
+ * so that the loop does not wait for the bus. Others are read now.
+ * Data is taken by stream_drain().
+ */
+static void stream_read(
+    struct loop_stream *s,
+    const uint64_t     now)
+{
+    struct AKM_SENSOR_DATA sd[AKS_MAX_SENSORS];
+    uint8_t                count[AKS_MAX_SENSORS];
+    struct async_read      *a;
+    int16_t                fret;
+    uint32_t               mask;
+    uint32_t               bit;
+    uint8_t                i;
+    uint8_t                j;
+    uint8_t                n;
+
+    /* Faulty sensors are left to stream_recover() */
+    mask = s->mask & ~(faulty_mask | restart_mask);
+
+    if (mask == 0U) {
+        return;
+    }
+
+    s->reads++;
+
+    for (i = 0U; i < AKS_MAX_SENSORS; i++) {
+        count[i] = 1U;
+        bit = (uint32_t)1U << i;
+        a = &sensor_async[i];
+
+        if ((mask & async_mask & bit) == 0U) {
+            continue;
+        }
+
+        /* The previous read has not ended, so this interval is lost */
+        if (a->busy != 0U) {
+            mask &= ~bit;
+            continue;
+        }
+
+        a->busy = 1U;
+        fret = AKS_GetDataAsync(i, &a->data, async_read_done, a);
+
+        if (fret == AKM_SUCCESS) {
+            mask &= ~bit;
+            continue;
+        }
+
+        /* Read it now. The bus may be in use by other transfer. */
+        a->busy = 0U;
+
+        if (fret == AKM_ERR_NOT_SUPPORT) {
+            async_mask &= ~bit;
+        }
+    }
+
+    if (mask == 0U) {
+        return;
+    }
+
+    if (AKS_GetDataMulti(mask, sd, count) < 0) {
+        /* The HAL has already retried and recovered the bus.
+         * A sensor which has no data is the one which failed. */
+        s->errors++;
+
+        for (i = 0U; i < AKS_MAX_SENSORS; i++) {
+            if (((mask & ((uint32_t)1U << i)) != 0U) && (count[i] == 0U)) {
+                sensor_fault(i, health_error(&sensor_hlt[i], now));
+            }
+        }
+    }
+
+    /* Data is stored in the order of sensors */
+    n = 0U;
+
+    for (i = 0U; i < AKS_MAX_SENSORS; i++) {
+        for (j = 0U; j < count[i]; j++, n++) {
+            sample_ring_push(&sensor_ring[i], &sd[n]);
+        }
+    }
+}
+
+/*!
+ * \brief Pass data of the stream to output through the ring and the
+ * decimator of each sensor. The primary sensor also feeds the library.
+ *
+ * \return Non-zero when the library took new data.
+ */
+static uint8_t stream_drain(
+    struct loop_stream  *s,
+    struct AKL_SCL_PRMS *prm,
+    const uint64_t      now)
+{
+    struct AKM_SENSOR_DATA batch[READ_BATCH_SIZE];
+    int32_t                data[GET_VEC_BUF_SIZE];
+    struct async_read      *a;
+    int16_t                fret;
+    uint32_t               bit;
+    uint8_t                updated = 0U;
+    uint8_t                i;
+    uint8_t                j;
+    uint8_t                k;
+    uint8_t                n;
+
+    /* Drain each ring in batches */
+    for (i = 0U; i < AKS_MAX_SENSORS; i++) {
+        bit = (uint32_t)1U << i;
+        a = &sensor_async[i];
+
+        if ((s->mask & bit) == 0U) {
+            continue;
+        }
+
+        /* Samples which come after the fault are dropped */
+        if (((faulty_mask | restart_mask) & bit) != 0U) {
+            a->failed = 0U;
+
+            while (sample_ring_pop(&sensor_ring[i], batch,
+                                   READ_BATCH_SIZE) > 0U) {
+            }
+
+            continue;
+        }
+
+        if (a->failed != 0U) {
+            a->failed = 0U;
+            s->errors++;
+            sensor_fault(i, health_error(&sensor_hlt[i], now));
+        }
+
+        while ((n = sample_ring_pop(&sensor_ring[i], batch,
+                                    READ_BATCH_SIZE)) > 0U) {
+            /* Output and library take averaged data only */
+            k = 0U;
+
+            for (j = 0U; j < n; j++) {
+                sensor_fault(i, health_sample(&sensor_hlt[i], &batch[j],
+                                              now));
+
+                if (decimator_push(&sensor_dec[i], &batch[j],
+                                   &batch[k]) == AKM_SUCCESS) {
+                    k++;
+                }
+            }
+
+            if (k == 0U) {
+                continue;
+            }
+
+            if ((print_get_mode() == PRINT_MODE_BINARY) &&
+                ((out_vectors & s->vt) != 0U)) {
+                /* Stream every sample. Bias is not known here. */
+                for (j = 0U; j < k; j++) {
+                    data[0] = batch[j].u.s.x;
+                    data[1] = batch[j].u.s.y;
+                    data[2] = batch[j].u.s.z;
+                    data[3] = 0;
+                    data[4] = 0;
+                    data[5] = 0;
+                    print_data(s->stype, data, 0, batch[j].timestamp);
+                }
+            }
+
+            if (i != s->primary) {
+                continue;
+            }
+
+            s->last = batch[k - 1U];
+            s->has_last = 1U;
+
+            if (s->no_library != 0U) {
+                continue;
+            }
 
-static uint32_t print_event;
+            /* Aligned with other streams before fusion */
+            if ((fusion_sync.mask &
+                 ((uint32_t)1U << (s - streams))) != 0U) {
+                for (j = 0U; j < k; j++) {
+                    sync_push(&fusion_sync, (uint8_t)(s - streams),
+                              &batch[j]);
+                }
 
-static uint32_t stop_count = 0; // 
+                continue;
+            }
 
-// UART 입력과 관련된 전역 변수 선언
-extern volatile bool inputReady;  // UART 입력 완료 플래그
-extern char inputBuffer[128];     // UART 입력 버퍼
+            /* Primary sensor feeds the library for calibration and fusion */
+            fret = AKL_SetVector(prm, batch, k);
+
+            if (fret == AKM_SUCCESS) {
+                updated = 1U;
+            } else if (fret == AKM_ERR_NOT_SUPPORT) {
+                s->no_library = 1U;
+            }
+        }
+    }
+
+    return updated;
+}
 
 /*!
  * \brief 
@@ -46,46 +1017,94 @@ extern char inputBuffer[128];     // UART 입력 버퍼
 int16_t measurement_loop(struct AKL_SCL_PRMS *prm)
 {
     int16_t fret;
-    uint32_t interval_mag_ms;
-    uint32_t interval_acc_ms;
-    uint32_t interval_gyr_ms;
+    int16_t ret = AKM_SUCCESS;
+    uint32_t req;
+    uint32_t mask;
+    uint32_t vt;
+    uint32_t wait_events;
+    uint64_t now;
+    uint64_t next;
+    uint32_t events;
     uint16_t calc_flag;
     uint16_t isContinue = 1;
     int32_t data[GET_VEC_BUF_SIZE];
     int32_t st;
-    uint32_t ch_count = 0;
 
     AKM_TIMESTAMP ts;
-#ifdef STATISTICS
-    uint32_t st_mag;
-    uint32_t st_acc;
-    uint32_t st_gyr;
-#endif
-    struct AKM_SENSOR_DATA sd_mag;
-    struct AKM_SENSOR_DATA sd_acc;
-    struct AKM_SENSOR_DATA sd_gyr;
-    int32_t gyro_data[3];
+    struct loop_stream *s;
+    struct loop_stream *mag = &streams[0];
+    uint8_t i;
+    uint8_t by_event;
 
-    /* calculate interval from frequency */
-    interval_mag_ms = (uint32_t)FREQ_TO_INTERVAL_MS(AKM_CUSTOM_MAG_FREQ);
-  
+    /* Averaging runs here, after data is read */
+    for (i = 0U; i < AKS_MAX_SENSORS; i++) {
+        decimator_init(&sensor_dec[i], 1U);
+        sample_ring_init(&sensor_ring[i]);
+        health_init(&sensor_hlt[i]);
+        sensor_async[i].busy = 0U;
+        sensor_async[i].failed = 0U;
+    }
+
+    faulty_mask = 0U;
+    restart_mask = 0U;
+    /* Every sensor is tried, and left to blocking read if not supported */
+    async_mask = ~0U;
+
+    /* Start each sensor type at its own rate.
+     * Magnetometer is continuous measurement mode. */
+    fret = stream_start(&streams[0], "MAG", AKM_ST_MAG, AKM_VT_MAG,
+                        MAG_DRDY_EVENT, AKM_CUSTOM_MAG_FREQ);
+
+    if (fret == AKM_SUCCESS) {
+        fret = stream_start(&streams[1], "ACC", AKM_ST_ACC, AKM_VT_ACC,
+                            0U, AKM_CUSTOM_ACC_FREQ);
+    }
+
+    if (fret == AKM_SUCCESS) {
+        fret = stream_start(&streams[2], "GYR", AKM_ST_GYR, AKM_VT_GYR,
+                            0U, AKM_CUSTOM_GYR_FREQ);
+    }
+
+    if (fret != AKM_SUCCESS) {
+        for (s = streams; s < &streams[NUM_OF_STREAMS]; s++) {
+            stream_stop(s);
+        }
 
-    /* Start magnetometer with continuous measurement mode */
-    if ((fret = AKS_Start(AKM_ST_MAG, FREQ_TO_INTERVAL_US(AKM_CUSTOM_MAG_FREQ))) != AKM_SUCCESS) {
         return fret;
     }
 
-    /* Initialize event counters */
-    tm_event = 0U;
-    mag_event = 0U;
-    acc_event = 0U;
-    gyr_event = 0U;
-    print_event = 0U;
+    for (i = 0U; i < AKS_MAX_SENSORS; i++) {
+        if ((mag->mask & ((uint32_t)1U << i)) != 0U) {
+            decimator_init(&sensor_dec[i], AKM_CUSTOM_MAG_DECIMATION);
+        }
+    }
+
+    /* Initialize deadlines */
+    now = AKH_GetTimeNs();
+
+    for (s = streams; s < &streams[NUM_OF_STREAMS]; s++) {
+        s->deadline = now + stream_period(s);
+    }
+
+    print_deadline = now + MS_TO_NS(PRINT_INTERVAL_MS);
+
+    sync_hz = AKM_CUSTOM_FUSION_FREQ;
+    stream_sync_update(1U);
+
+    /* Commands are handled outside of this loop */
+    req_flags = 0U;
+    out_paused = 0U;
+    console_init(looper_cmds, sizeof(looper_cmds) / sizeof(looper_cmds[0]));
 
+    /* Drop events which were signaled before start */
+    AKH_WaitEvent(AKH_EVENT_ALL, 0U, NULL);
 #ifdef STATISTICS
-    st_mag = 0U;
-    st_acc = 0U;
-    st_gyr = 0U;
+    {
+        struct AKH_POWER_STATS ps;
+
+        /* start measurement window of idle statistics */
+        AKH_GetPowerStats(&ps);
+    }
 #endif
 
     /* Reset calculation flag */
@@ -94,20 +1113,143 @@ int16_t measurement_loop(struct AKL_SCL_PRMS *prm)
     /* Measurement loop */
     while (isContinue != 0U) {
 
-        readInput();  
-        processInput();  
-        
-        /* Take measurement when the measurement flag is true */
-        if (mag_event >= interval_mag_ms) {
-            uint8_t num = 1U;
+        /* Sleep until a sensor has data or the nearest deadline */
+        next = print_deadline;
+        wait_events = AKH_EVENT_USER | AKH_EVENT_APP;
+
+        if (out_paused == 0U) {
+            for (s = streams; s < &streams[NUM_OF_STREAMS]; s++) {
+                if (s->mask == 0U) {
+                    continue;
+                }
+
+                wait_events |= s->event;
 
-            /* Reset the flag */
-            mag_event = 0U;
-            sd_mag.u.v[0] = 0;
-            sd_mag.u.v[1] = 0;
-            sd_mag.u.v[2] = 0;
+                if (s->deadline < next) {
+                    next = s->deadline;
+                }
+            }
+
+            next = stream_next_retry(next);
+        }
+
+        AKH_Idle(wait_events, next, &events);
+
+        now = AKH_GetTimeNs();
+
+        /* Apply console requests */
+        req = core_util_atomic_exchange_u32(&req_flags, 0U);
+
+        if (((req & REQ_ODR) != 0U) && (mag->mask != 0U)) {
+            /* Sensors which are down take the rate when they restart */
+            mask = mag->mask & ~(faulty_mask | restart_mask);
+            AKS_StopMulti(mask);
+            fret = AKS_StartMulti(mask, FREQ_TO_INTERVAL_US(req_odr_hz));
+
+            if (fret == AKM_SUCCESS) {
+                mag->interval_ns = FREQ_TO_INTERVAL_NS(req_odr_hz);
+                print_text("ODR: %u Hz\n", (unsigned int)req_odr_hz);
+            } else {
+                /* restore previous rate */
+                print_text("ODR: %u Hz is not supported\n",
+                           (unsigned int)req_odr_hz);
+                fret = AKS_StartMulti(mask,
+                                      (int32_t)(mag->interval_ns / 1000U));
+
+                if (fret != AKM_SUCCESS) {
+                    ret = fret;
+                    isContinue = 0U;
+                }
+            }
+
+            mag->deadline = now + stream_period(mag);
+        }
+
+        if ((req & REQ_DEC) != 0U) {
+            /* Restart every window with the new factor */
+            for (i = 0U; i < AKS_MAX_SENSORS; i++) {
+                if ((mag->mask & ((uint32_t)1U << i)) != 0U) {
+                    decimator_init(&sensor_dec[i], (uint16_t)req_dec_factor);
+                }
+            }
+
+            print_text("DEC: %u\n", (unsigned int)req_dec_factor);
+        }
 
-            AKS_GetData(AKM_ST_MAG, &sd_mag, &num);
+        if ((req & REQ_SYNC) != 0U) {
+            sync_hz = (uint16_t)req_sync_hz;
+            stream_sync_update(1U);
+            print_text("SYNC: %u Hz\n", (unsigned int)sync_hz);
+        }
+
+        if ((req & REQ_RESTART) != 0U) {
+            stream_restarted(restart_result, now);
+        }
+
+        if ((req & REQ_RECAL) != 0U) {
+            AKL_ForceReCalibration(prm);
+        }
+
+#ifdef STATISTICS
+        if ((req & REQ_STATS) != 0U) {
+            print_statistics();
+        }
+#endif
+
+        if ((req & REQ_QUIT) != 0U) {
+            ret = LOOPER_EXIT;
+            isContinue = 0U;
+        }
+
+        /* User button toggles output format */
+        if (AKH_CheckUserInput(NULL) == AKM_SUCCESS) {
+            if (print_get_mode() == PRINT_MODE_TEXT) {
+                print_set_mode(PRINT_MODE_BINARY);
+            } else {
+                print_set_mode(PRINT_MODE_TEXT);
+            }
+        }
+
+        if (out_paused != 0U) {
+            /* Start again from the next interval when resumed */
+            for (s = streams; s < &streams[NUM_OF_STREAMS]; s++) {
+                s->deadline = now + stream_period(s);
+            }
+
+            /* Do not interpolate over the pause */
+            sync_reset(&fusion_sync);
+        } else {
+            /* Read every stream which has data or whose deadline has
+             * passed, in the order of deadline */
+            while ((s = stream_next_due(events, now)) != NULL) {
+                by_event = ((events & s->event) != 0U) ? 1U : 0U;
+                stream_schedule(s, by_event, now);
+                events &= ~s->event;
+
+                /* The primary sensor has the interrupt */
+                if (s->event != 0U) {
+                    sensor_fault(s->primary,
+                                 health_drdy(&sensor_hlt[s->primary],
+                                             by_event, now));
+                }
+
+                stream_read(s, now);
+            }
+
+            /* Background reads end in later iterations */
+            for (s = streams; s < &streams[NUM_OF_STREAMS]; s++) {
+                if ((s->mask != 0U) && (stream_drain(s, prm, now) != 0U)) {
+                    calc_flag = 1U;
+                }
+            }
+
+            if ((fusion_sync.mask != 0U) && (stream_fuse(prm) != 0U)) {
+                calc_flag = 1U;
+            }
+
+            if (faulty_mask != 0U) {
+                stream_recover();
+            }
         }
 
         /* Calculate fusion if needed */
@@ -122,35 +1264,75 @@ int16_t measurement_loop(struct AKL_SCL_PRMS *prm)
         }
 
         /* Output result periodically */
-        if (print_event >= PRINT_INTERVAL_MS) {
-            print_event = 0U;
-#ifdef STATISTICS
-          
-#endif
-            // Example for printing sensor data
-            // print_data(AKM_ST_GYR, gyro_data, 0, ts);
-        } else {
-            /* Wait for next timer event */
-            AKH_DelayMilli(1);
+        if (now >= print_deadline) {
+            print_deadline = now + MS_TO_NS(PRINT_INTERVAL_MS);
+            vt = out_vectors;
+
+            if (out_paused != 0U) {
+                vt = 0U;
+            }
+
+            /* Raw data is streamed per sample in binary mode */
+            if (((vt & AKM_VT_MAG) != 0U) &&
+                (print_get_mode() == PRINT_MODE_TEXT) &&
+                (AKL_GetVector(AKM_VT_MAG, prm, data, GET_VEC_BUF_SIZE,
+                               &st, &ts) == AKM_SUCCESS)) {
+                print_data(AKM_ST_MAG, data, st, ts);
+            }
+
+            for (s = &streams[1]; s < &streams[NUM_OF_STREAMS]; s++) {
+                if (((vt & s->vt) != 0U) && (s->has_last != 0U) &&
+                    (print_get_mode() == PRINT_MODE_TEXT)) {
+                    data[0] = s->last.u.s.x;
+                    data[1] = s->last.u.s.y;
+                    data[2] = s->last.u.s.z;
+                    data[3] = 0;
+                    data[4] = 0;
+                    data[5] = 0;
+                    print_data(s->stype, data, 0, s->last.timestamp);
+                }
+            }
+
+            if (((vt & AKM_VT_ORI) != 0U) &&
+                (AKL_GetVector(AKM_VT_ORI, prm, data, GET_VEC_BUF_SIZE,
+                               &st, &ts) == AKM_SUCCESS)) {
+                print_ypr(data, ts);
+            }
+
+            if (((vt & AKM_VT_QUAT) != 0U) &&
+                (AKL_GetVector(AKM_VT_QUAT, prm, data, GET_VEC_BUF_SIZE,
+                               &st, &ts) == AKM_SUCCESS)) {
+                print_quat(data, ts);
+            }
         }
     }
 
-    /* Stop magnetometer */
-    AKS_Stop(AKM_ST_MAG);
+    /* Stop console, then sensors */
+    AKH_SetIRQHandler(IRQ_UART, NULL);
 
-    return fret;
-}
+    /* A restart in the background would start its sensor again */
+    while ((restart_mask != 0U) &&
+           (AKH_WaitEvent(AKH_EVENT_APP, RESTART_WAIT_US, NULL)
+            == AKM_SUCCESS)) {
+        if ((core_util_atomic_exchange_u32(&req_flags, 0U) &
+             REQ_RESTART) != 0U) {
+            restart_mask = 0U;
+        }
+    }
 
+    /* Stop before the report so that it counts the stop too. The streams
+     * keep their masks, the report lists the streams by them. */
+    mask = 0U;
 
-/*!
- * \brief This is timer callback function.
- * This function is called every 1 millisecond to count the current time.
- */
-void interrupt(void)
-{
-    tm_event++;
-    mag_event++;
-    acc_event++;
-    gyr_event++;
-    print_event++;
+    for (s = streams; s < &streams[NUM_OF_STREAMS]; s++) {
+        mask |= s->mask;
+    }
+
+    AKS_StopMulti(mask);
+
+#ifdef STATISTICS
+    print_statistics();
+#endif
+
+    return ret;
 }
@@ -2,13 +2,198 @@
 #include "AKL_APIs.h"
 #include "AKM_CustomerSpec.h"
 #include "AKS_APIs.h"
+#include "print_util.h"
 #include <math.h>
+#include <stdarg.h>
 #include <stdio.h>
+#include <string.h>
 
 /*#define DEBUG*/
 /*#define VERBOSE*/
 #define PRINT_DETAIL
 
+/* type + seq + timestamp + payload + crc. Payload is up to 7 values,
+ * or text which is truncated to 128 bytes. */
+#define TLM_MAX_VALUES      7
+#define TLM_MAX_TEXT        128
+#define TLM_MAX_RAW_SIZE    (1 + 2 + 8 + TLM_MAX_TEXT + 2)
+/* COBS adds one byte per 254 bytes, plus delimiter */
+#define TLM_MAX_FRAME_SIZE  (TLM_MAX_RAW_SIZE + 2)
+
+#ifdef AKM_TIMESTAMP_NANOSECOND
+#define TS_UNSIGNED(ts)     ((uint64_t)(ts))
+#else
+/* Microsecond timestamp is the lower 32 bits of the time, so it is
+ * unsigned even though AKM_TIMESTAMP is int32_t */
+#define TS_UNSIGNED(ts)     ((uint64_t)(uint32_t)(ts))
+#endif
+
+static PRINT_MODE        g_print_mode = PRINT_MODE_TEXT;
+/* The logger thread sends frames too, so it is taken atomically */
+static volatile uint32_t g_tlm_seq;
+
+/* CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) */
+static uint16_t tlm_crc16(const uint8_t *buf, const uint16_t len)
+{
+    uint16_t crc = 0xFFFF;
+    uint16_t i;
+    uint8_t  bit;
+
+    for (i = 0; i < len; i++) {
+        crc ^= (uint16_t)buf[i] << 8;
+
+        for (bit = 0; bit < 8; bit++) {
+            if (crc & 0x8000) {
+                crc = (uint16_t)((crc << 1) ^ 0x1021);
+            } else {
+                crc = (uint16_t)(crc << 1);
+            }
+        }
+    }
+
+    return crc;
+}
+
+/* Consistent Overhead Byte Stuffing. The output has no 0x00 byte, so 0x00
+ * can be used as frame delimiter. Returns the encoded length. */
+static uint16_t tlm_cobs_encode(
+    const uint8_t  *in,
+    const uint16_t len,
+    uint8_t        *out)
+{
+    uint16_t code_pos = 0;
+    uint16_t out_pos = 1;
+    uint8_t  code = 1;
+    uint16_t i;
+
+    for (i = 0; i < len; i++) {
+        if (in[i] == 0) {
+            out[code_pos] = code;
+            code_pos = out_pos++;
+            code = 1;
+        } else {
+            out[out_pos++] = in[i];
+            code++;
+
+            if (code == 0xFF) {
+                out[code_pos] = code;
+                code_pos = out_pos++;
+                code = 1;
+            }
+        }
+    }
+
+    out[code_pos] = code;
+    return out_pos;
+}
+
+static uint16_t tlm_put_le(uint8_t *buf, uint64_t val, const uint8_t size)
+{
+    uint8_t i;
+
+    for (i = 0; i < size; i++) {
+        buf[i] = (uint8_t)(val & 0xFF);
+        val >>= 8;
+    }
+
+    return size;
+}
+
+static void tlm_send_bytes(
+    const uint8_t  type,
+    AKM_TIMESTAMP  ts,
+    const uint8_t  *payload,
+    const uint16_t size)
+{
+    uint8_t  raw[TLM_MAX_RAW_SIZE];
+    uint8_t  frame[TLM_MAX_FRAME_SIZE];
+    uint16_t len = 0;
+    uint16_t crc;
+
+    raw[len++] = type;
+    len += tlm_put_le(&raw[len],
+                      core_util_atomic_incr_u32(&g_tlm_seq, 1U) - 1U, 2);
+    len += tlm_put_le(&raw[len], TS_UNSIGNED(ts), 8);
+
+    memcpy(&raw[len], payload, size);
+    len += size;
+
+    crc = tlm_crc16(raw, len);
+    len += tlm_put_le(&raw[len], crc, 2);
+
+    len = tlm_cobs_encode(raw, len, frame);
+    frame[len++] = 0x00;
+
+    AKH_Write(frame, len);
+}
+
+static void tlm_send(
+    const uint8_t type,
+    AKM_TIMESTAMP ts,
+    const int32_t values[],
+    const uint8_t num)
+{
+    uint8_t  payload[4 * TLM_MAX_VALUES];
+    uint16_t len = 0;
+    uint8_t  i;
+
+    for (i = 0; (i < num) && (i < TLM_MAX_VALUES); i++) {
+        len += tlm_put_le(&payload[len], (uint32_t)values[i], 4);
+    }
+
+    tlm_send_bytes(type, ts, payload, len);
+}
+
+/* Frame the deferred log of the HAL as text packets */
+static void tlm_log_writer(const char *text, const uint16_t len)
+{
+    uint16_t pos;
+    uint16_t size;
+
+    for (pos = 0; pos < len; pos += size) {
+        size = ((len - pos) > TLM_MAX_TEXT) ? TLM_MAX_TEXT : (len - pos);
+        tlm_send_bytes(TLM_TYPE_TEXT, AKH_GetTimestamp(),
+                       (const uint8_t *)&text[pos], size);
+    }
+}
+
+void print_set_mode(const PRINT_MODE mode)
+{
+    g_print_mode = mode;
+    AKH_SetLogWriter((mode == PRINT_MODE_BINARY) ? tlm_log_writer : NULL);
+}
+
+PRINT_MODE print_get_mode(void)
+{
+    return g_print_mode;
+}
+
+void print_text(const char *format, ...)
+{
+    char    text[TLM_MAX_TEXT + 1];
+    va_list va;
+    int     len;
+
+    va_start(va, format);
+    len = vsnprintf(text, sizeof(text), format, va);
+    va_end(va);
+
+    if (len < 0) {
+        return;
+    }
+
+    if (len > TLM_MAX_TEXT) {
+        len = TLM_MAX_TEXT;
+    }
+
+    if (g_print_mode == PRINT_MODE_BINARY) {
+        tlm_send_bytes(TLM_TYPE_TEXT, AKH_GetTimestamp(),
+                       (const uint8_t *)text, (uint16_t)len);
+    } else {
+        AKH_Print("%s", text);
+    }
+}
+
 void print_version(void)
 {
     AKH_Print("Debug: Entering print_version\n");
@@ -57,13 +242,44 @@ void print_data(
     const int32_t st,
     AKM_TIMESTAMP ts )
 {
-    AKH_Print("Debug: Entering print_data\n");
-
     if (data == NULL) {
         AKH_Print("Error: data pointer is NULL\n");
         return;
     }
 
+    if (g_print_mode == PRINT_MODE_BINARY) {
+        int32_t values[TLM_MAX_VALUES];
+        uint8_t type;
+        uint8_t i;
+
+        switch (stype) {
+        case AKM_ST_MAG:
+            type = TLM_TYPE_MAG;
+            break;
+
+        case AKM_ST_ACC:
+            type = TLM_TYPE_ACC;
+            break;
+
+        case AKM_ST_GYR:
+            type = TLM_TYPE_GYR;
+            break;
+
+        default:
+            return;
+        }
+
+        for (i = 0; i < 6; i++) {
+            values[i] = data[i];
+        }
+
+        values[6] = st;
+        tlm_send(type, ts, values, 7);
+        return;
+    }
+
+    AKH_Print("Debug: Entering print_data\n");
+
 
 
     float fx, fy, fz;
@@ -81,16 +297,16 @@ void print_data(
         print_bias = 1;
         break;
 
-    // case AKM_ST_ACC:
-    //     name = "ACC";
-    //     unit = "m/s^2";
-    //     break;
+    case AKM_ST_ACC:
+        name = "ACC";
+        unit = "m/s^2";
+        break;
 
-    // case AKM_ST_GYR:
-    //     name = "GYR";
-    //     unit = "dps";
-    //     print_bias = 1;
-    //     break;
+    case AKM_ST_GYR:
+        name = "GYR";
+        unit = "dps";
+        print_bias = 1;
+        break;
 
     default:
         name = "UNKNOWN";
@@ -98,7 +314,7 @@ void print_data(
     }
 
     AKH_Print("%.3f (%s) = %6.3f, %6.3f, %6.3f %s\n",
-              (float)(ts / 1000.0),
+              (float)(TS_UNSIGNED(ts) / 1000.0),
               name,
               fx, fy, fz,
               unit);
@@ -113,8 +329,6 @@ void print_data(
                       unit);
             AKH_Print("  R           = %6.1f %s\n",
                       sqrtf(fx * fx + fy * fy + fz * fz), unit);
-        } else {
-            AKH_Print("Error: data array size is less than expected for bias data\n");
     }
     
 
@@ -126,8 +340,13 @@ void print_ypr(
     const int32_t data[],
     AKM_TIMESTAMP ts)
 {
+    if (g_print_mode == PRINT_MODE_BINARY) {
+        tlm_send(TLM_TYPE_YPR, ts, data, 3);
+        return;
+    }
+
     AKH_Print("%f (ypr) = %6.1f, %6.1f, %6.1f degree.\n",
-              ts / 1000.0f,
+              TS_UNSIGNED(ts) / 1000.0f,
               data[0] / 65536.f,
               data[1] / 65536.f,
               data[2] / 65536.f);
@@ -138,13 +357,18 @@ void print_quat(
     const int32_t quat[],
     AKM_TIMESTAMP ts)
 {
-    AKH_Print("Debug: Entering print_quat\n");
-
     if (quat == NULL) {
         AKH_Print("Error: quat pointer is NULL\n");
         return;
     }
 
+    if (g_print_mode == PRINT_MODE_BINARY) {
+        tlm_send(TLM_TYPE_QUAT, ts, quat, 4);
+        return;
+    }
+
+    AKH_Print("Debug: Entering print_quat\n");
+
     float q0 = quat[0] / 65536.f;
     float q1 = quat[1] / 65536.f;
     float q2 = quat[2] / 65536.f;
@@ -152,7 +376,7 @@ void print_quat(
 
     AKH_Print("Debug: q0=%.4f, q1=%.4f, q2=%.4f, q3=%.4f\n", q0, q1, q2, q3);
     AKH_Print("%.3f (quat) = %6.4f, %6.4f, %6.4f, %6.4f\n",
-              (float)(ts / 1000.0),
+              (float)(TS_UNSIGNED(ts) / 1000.0),
               q0,
               q1,
               q2,
@@ -21,6 +21,56 @@
 
 #include "AKM_Common.h"
 
+/*!
+ * Output format of print functions.
+ */
+typedef enum _PRINT_MODE {
+    /*! Human readable text. */
+    PRINT_MODE_TEXT = 0,
+    /*! COBS framed binary telemetry. */
+    PRINT_MODE_BINARY
+} PRINT_MODE;
+
+/* Packet type of binary telemetry. */
+#define TLM_TYPE_MAG   0x01
+#define TLM_TYPE_ACC   0x02
+#define TLM_TYPE_GYR   0x03
+#define TLM_TYPE_YPR   0x10
+#define TLM_TYPE_QUAT  0x11
+#define TLM_TYPE_TEXT  0x20
+
+/*!
+ * \brief Select output format of print_data, print_ypr and print_quat.
+ *
+ * In binary mode, each call sends one packet which is encoded with COBS
+ * and terminated by 0x00. The packet before encoding is (little endian):
+ *   type (1), sequence number (2), timestamp (8), values (4 * n), CRC (2).
+ * The timestamp has the unit of #AKM_TIMESTAMP, and is unsigned (micro
+ * seconds wrap around at 2^32). The values are Q16.
+ * The CRC is CRC-16/CCITT-FALSE of all preceding bytes. The sequence
+ * number is incremented for each packet, so the receiver can detect loss.
+ * Messages of AKH_Log() are sent in #TLM_TYPE_TEXT packets too.
+ *
+ * \param mode Output format.
+ */
+void print_set_mode(const PRINT_MODE mode);
+
+/*!
+ * \brief Get current output format.
+ */
+PRINT_MODE print_get_mode(void);
+
+/*!
+ * \brief Print a message which is not sensor data.
+ *
+ * In binary mode, the message is sent in a #TLM_TYPE_TEXT packet, whose
+ * values are replaced with the text (up to 128 bytes, no terminator), so
+ * that it does not break the framing of telemetry.
+ *
+ * \param format A format string of printf.
+ */
+void print_text(const char *format, ...);
+
 /*!
  * \brief Print software version information.
  */
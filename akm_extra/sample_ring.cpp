@@ -0,0 +1,77 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+#include "mbed.h"
+#include "sample_ring.h"
+
+void sample_ring_init(struct sample_ring *ring)
+{
+    ring->head = 0U;
+    ring->tail = 0U;
+    ring->pushed = 0U;
+    ring->overruns = 0U;
+}
+
+int16_t sample_ring_push(
+    struct sample_ring           *ring,
+    const struct AKM_SENSOR_DATA *data)
+{
+    uint32_t head;
+
+    head = ring->head;
+
+    if ((head - core_util_atomic_load_u32(&ring->tail)) >=
+        SAMPLE_RING_SIZE) {
+        ring->overruns++;
+        return AKM_ERR_BUSY;
+    }
+
+    ring->buf[head & (SAMPLE_RING_SIZE - 1U)] = *data;
+    ring->pushed++;
+
+    /* publish. atomic store orders the copy above */
+    core_util_atomic_store_u32(&ring->head, head + 1U);
+
+    return AKM_SUCCESS;
+}
+
+uint8_t sample_ring_pop(
+    struct sample_ring     *ring,
+    struct AKM_SENSOR_DATA *data,
+    const uint8_t          max)
+{
+    uint32_t tail;
+    uint32_t avail;
+    uint8_t  n;
+
+    tail = ring->tail;
+    avail = core_util_atomic_load_u32(&ring->head) - tail;
+
+    if (avail > max) {
+        avail = max;
+    }
+
+    for (n = 0U; n < avail; n++) {
+        data[n] = ring->buf[(tail + n) & (SAMPLE_RING_SIZE - 1U)];
+    }
+
+    /* release the slots only after they are copied */
+    core_util_atomic_store_u32(&ring->tail, tail + avail);
+
+    return n;
+}
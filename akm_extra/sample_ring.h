@@ -0,0 +1,92 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+#ifndef INCLUDE_SAMPLE_RING_H
+#define INCLUDE_SAMPLE_RING_H
+
+#include "AKM_Common.h"
+
+/* The number of samples in each ring. Must be power of 2. */
+#ifndef SAMPLE_RING_SIZE
+#define SAMPLE_RING_SIZE  16U
+#endif
+
+#if ((SAMPLE_RING_SIZE) & ((SAMPLE_RING_SIZE) - 1U)) != 0U
+#error "SAMPLE_RING_SIZE must be power of 2"
+#endif
+
+/*!
+ * Single producer, single consumer ring of sensor samples.
+ * The producer can be an interrupt handler. Neither side takes a lock,
+ * and the producer never waits for the consumer.
+ */
+struct sample_ring {
+    struct AKM_SENSOR_DATA buf[SAMPLE_RING_SIZE];
+    /*! Free running index of next push. Written by producer only. */
+    volatile uint32_t      head;
+    /*! Free running index of next pop. Written by consumer only. */
+    volatile uint32_t      tail;
+    /*! The number of samples which were pushed. */
+    volatile uint32_t      pushed;
+    /*! The number of samples which were dropped because ring was full. */
+    volatile uint32_t      overruns;
+};
+
+/*!
+ * \brief Make ring empty and clear counters.
+ *
+ * This must not be called while producer or consumer is running.
+ *
+ * \param ring Ring.
+ */
+void sample_ring_init(
+    struct sample_ring *ring
+);
+
+/*!
+ * \brief Push one sample. This can be called from interrupt context.
+ *
+ * When ring is full, the new sample is dropped and counted as overrun,
+ * so that samples which consumer is reading are not overwritten.
+ *
+ * \param ring Ring.
+ * \param data Sample to be copied.
+ *
+ * \return #AKM_SUCCESS on success. #AKM_ERR_BUSY when ring is full.
+ */
+int16_t sample_ring_push(
+    struct sample_ring           *ring,
+    const struct AKM_SENSOR_DATA *data
+);
+
+/*!
+ * \brief Pop samples in the order of push.
+ *
+ * \param ring Ring.
+ * \param data Buffer to store samples.
+ * \param max The maximum number of samples to be popped.
+ *
+ * \return The number of samples which are stored in data.
+ */
+uint8_t sample_ring_pop(
+    struct sample_ring     *ring,
+    struct AKM_SENSOR_DATA *data,
+    const uint8_t          max
+);
+
+#endif /* INCLUDE_SAMPLE_RING_H */
@@ -0,0 +1,166 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+#include "sensor_health.h"
+#include <string.h>
+
+/* Mark the sensor faulty. The first attempt is made at once. */
+static uint8_t health_fault(
+    struct sensor_health *h,
+    const uint8_t        reason,
+    const uint64_t       now_ns)
+{
+    h->fault = reason;
+    h->fault_ns = now_ns;
+    h->retry_ns = now_ns;
+    h->backoff_ns = HEALTH_RETRY_MIN_NS;
+    h->faults++;
+
+    return reason;
+}
+
+void health_init(struct sensor_health *h)
+{
+    memset(h, 0, sizeof(*h));
+}
+
+uint8_t health_sample(
+    struct sensor_health         *h,
+    const struct AKM_SENSOR_DATA *data,
+    const uint64_t               now_ns)
+{
+    if (h->fault != HEALTH_OK) {
+        return HEALTH_OK;
+    }
+
+    h->errors = 0U;
+
+    if ((h->has_prev != 0U) &&
+        (data->u.s.x == h->prev[0]) &&
+        (data->u.s.y == h->prev[1]) &&
+        (data->u.s.z == h->prev[2])) {
+        h->same++;
+    } else {
+        h->same = 0U;
+    }
+
+    h->prev[0] = data->u.s.x;
+    h->prev[1] = data->u.s.y;
+    h->prev[2] = data->u.s.z;
+    h->has_prev = 1U;
+
+    if (h->same >= HEALTH_MAX_STUCK) {
+        return health_fault(h, HEALTH_STUCK, now_ns);
+    }
+
+    return HEALTH_OK;
+}
+
+uint8_t health_error(
+    struct sensor_health *h,
+    const uint64_t       now_ns)
+{
+    if (h->fault != HEALTH_OK) {
+        return HEALTH_OK;
+    }
+
+    h->errors++;
+
+    if (h->errors >= HEALTH_MAX_ERRORS) {
+        return health_fault(h, HEALTH_READ_ERROR, now_ns);
+    }
+
+    return HEALTH_OK;
+}
+
+uint8_t health_drdy(
+    struct sensor_health *h,
+    const uint8_t        by_event,
+    const uint64_t       now_ns)
+{
+    if (h->fault != HEALTH_OK) {
+        return HEALTH_OK;
+    }
+
+    if (by_event != 0U) {
+        h->drdy_miss = 0U;
+        return HEALTH_OK;
+    }
+
+    h->drdy_miss++;
+
+    if (h->drdy_miss >= HEALTH_MAX_DRDY_MISS) {
+        return health_fault(h, HEALTH_NO_DRDY, now_ns);
+    }
+
+    return HEALTH_OK;
+}
+
+void health_recovered(
+    struct sensor_health *h,
+    const int16_t        result,
+    const uint64_t       now_ns)
+{
+    uint64_t t;
+
+    if (result != AKM_SUCCESS) {
+        h->failures++;
+        h->retry_ns = now_ns + h->backoff_ns;
+        h->backoff_ns *= 2U;
+
+        if (h->backoff_ns > HEALTH_RETRY_MAX_NS) {
+            h->backoff_ns = HEALTH_RETRY_MAX_NS;
+        }
+
+        return;
+    }
+
+    t = now_ns - h->fault_ns;
+
+    if (t > h->recovery_max_ns) {
+        h->recovery_max_ns = t;
+    }
+
+    h->recoveries++;
+    h->fault = HEALTH_OK;
+    h->errors = 0U;
+    h->same = 0U;
+    h->drdy_miss = 0U;
+    /* the value after reset may be the same as before */
+    h->has_prev = 0U;
+}
+
+const char *health_reason(const uint8_t fault)
+{
+    switch (fault) {
+    case HEALTH_OK:
+        return "ok";
+
+    case HEALTH_READ_ERROR:
+        return "read error";
+
+    case HEALTH_STUCK:
+        return "stuck value";
+
+    case HEALTH_NO_DRDY:
+        return "no data ready";
+
+    default:
+        return "unknown";
+    }
+}
@@ -0,0 +1,151 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+#ifndef INCLUDE_SENSOR_HEALTH_H
+#define INCLUDE_SENSOR_HEALTH_H
+
+#include "AKM_Common.h"
+
+/* The number of read errors in a row which makes a sensor faulty. */
+#ifndef HEALTH_MAX_ERRORS
+#define HEALTH_MAX_ERRORS     3U
+#endif
+
+/* The number of identical samples in a row which makes a sensor faulty.
+ * Real sensor data always has some noise. */
+#ifndef HEALTH_MAX_STUCK
+#define HEALTH_MAX_STUCK      32U
+#endif
+
+/* The number of data ready interrupts in a row which are lost. */
+#ifndef HEALTH_MAX_DRDY_MISS
+#define HEALTH_MAX_DRDY_MISS  3U
+#endif
+
+/* Wait before the next recovery attempt. Doubled on each failure. */
+#define HEALTH_RETRY_MIN_NS   (10ULL * 1000000ULL)
+#define HEALTH_RETRY_MAX_NS   (1000ULL * 1000000ULL)
+
+/* Reason of fault */
+#define HEALTH_OK             0U
+#define HEALTH_READ_ERROR     1U
+#define HEALTH_STUCK          2U
+#define HEALTH_NO_DRDY        3U
+
+/*!
+ * Health of one sensor.
+ * The sensor is faulty from the time a fault is found until the caller
+ * reports that it is recovered.
+ */
+struct sensor_health {
+    /*! The previous sample, to find a stuck value. */
+    int32_t  prev[3];
+    /*! Read errors in a row. */
+    uint16_t errors;
+    /*! Identical samples in a row. */
+    uint16_t same;
+    /*! Lost data ready interrupts in a row. */
+    uint16_t drdy_miss;
+    uint8_t  has_prev;
+    /*! HEALTH_XXX. Not #HEALTH_OK while the sensor is faulty. */
+    uint8_t  fault;
+    /*! Time when the fault was found. */
+    uint64_t fault_ns;
+    /*! Time of the next recovery attempt. */
+    uint64_t retry_ns;
+    uint64_t backoff_ns;
+    /* statistics */
+    uint32_t faults;
+    uint32_t recoveries;
+    /*! The number of recovery attempts which failed. */
+    uint32_t failures;
+    /*! The longest time from fault to recovery. */
+    uint64_t recovery_max_ns;
+};
+
+/*!
+ * \brief Initialize health of a sensor. Statistics are cleared.
+ *
+ * \param h Health.
+ */
+void health_init(
+    struct sensor_health *h
+);
+
+/*!
+ * \brief Report a sample which is read from the sensor.
+ *
+ * \param h Health.
+ * \param data The sample.
+ * \param now_ns Current time.
+ *
+ * \return HEALTH_XXX when the sensor has just become faulty.
+ * #HEALTH_OK otherwise.
+ */
+uint8_t health_sample(
+    struct sensor_health         *h,
+    const struct AKM_SENSOR_DATA *data,
+    const uint64_t               now_ns
+);
+
+/*!
+ * \brief Report a read error of the sensor.
+ *
+ * \return HEALTH_XXX when the sensor has just become faulty.
+ * #HEALTH_OK otherwise.
+ */
+uint8_t health_error(
+    struct sensor_health *h,
+    const uint64_t       now_ns
+);
+
+/*!
+ * \brief Report whether the sensor was read by its data ready interrupt
+ * or by the watchdog.
+ *
+ * \param by_event Non-zero when read by the interrupt.
+ *
+ * \return HEALTH_XXX when the sensor has just become faulty.
+ * #HEALTH_OK otherwise.
+ */
+uint8_t health_drdy(
+    struct sensor_health *h,
+    const uint8_t        by_event,
+    const uint64_t       now_ns
+);
+
+/*!
+ * \brief Report the result of a recovery attempt. On success the sensor
+ * is healthy again. Otherwise the next attempt is scheduled.
+ *
+ * \param result The result of the attempt.
+ */
+void health_recovered(
+    struct sensor_health *h,
+    const int16_t        result,
+    const uint64_t       now_ns
+);
+
+/*!
+ * \brief Get the name of a fault reason.
+ */
+const char *health_reason(
+    const uint8_t fault
+);
+
+#endif /* INCLUDE_SENSOR_HEALTH_H */
@@ -0,0 +1,227 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+#include "stream_sync.h"
+#include <string.h>
+
+/* a - b in timestamp unit. Microsecond timestamp may wrap around. */
+static int64_t ts_diff(
+    const AKM_TIMESTAMP a,
+    const AKM_TIMESTAMP b)
+{
+    return (int64_t)(AKM_TIMESTAMP)((uint64_t)a - (uint64_t)b);
+}
+
+/* a + b, which wraps around as the timestamp does */
+static AKM_TIMESTAMP ts_add(
+    const AKM_TIMESTAMP a,
+    const AKM_TIMESTAMP b)
+{
+    return (AKM_TIMESTAMP)((uint64_t)a + (uint64_t)b);
+}
+
+static uint8_t is_aligned(
+    const struct stream_sync *sync,
+    const uint8_t            ch)
+{
+    return ((sync->mask & ((uint32_t)1U << ch)) != 0U) ? 1U : 0U;
+}
+
+/* Remove the oldest sample */
+static void channel_drop(struct sync_channel *c)
+{
+    c->count--;
+    memmove(&c->hist[0], &c->hist[1], c->count * sizeof(c->hist[0]));
+}
+
+/* Start the grid at the latest of the oldest samples, so that every
+ * channel has a sample at or before the first grid time. */
+static uint8_t sync_start(struct stream_sync *sync)
+{
+    AKM_TIMESTAMP t = 0;
+    uint8_t       first = 1U;
+    uint8_t       ch;
+
+    for (ch = 0U; ch < SYNC_MAX_CHANNELS; ch++) {
+        if (is_aligned(sync, ch) == 0U) {
+            continue;
+        }
+
+        if (sync->ch[ch].count == 0U) {
+            return 0U;
+        }
+
+        if ((first != 0U) || (ts_diff(sync->ch[ch].hist[0].timestamp, t) > 0)) {
+            t = sync->ch[ch].hist[0].timestamp;
+            first = 0U;
+        }
+    }
+
+    sync->next = t;
+    sync->started = 1U;
+
+    return 1U;
+}
+
+/* Linear interpolation between the samples around t. */
+static void channel_interpolate(
+    const struct sync_channel *c,
+    const AKM_TIMESTAMP       t,
+    struct AKM_SENSOR_DATA    *out)
+{
+    const struct AKM_SENSOR_DATA *a;
+    const struct AKM_SENSOR_DATA *b;
+    int64_t                      dt;
+    int64_t                      w;
+    uint8_t                      i;
+
+    /* the last sample at or before t */
+    for (i = 0U; ((i + 1U) < c->count) &&
+         (ts_diff(c->hist[i + 1U].timestamp, t) <= 0); i++) {
+    }
+
+    a = &c->hist[i];
+    b = ((i + 1U) < c->count) ? &c->hist[i + 1U] : a;
+    dt = ts_diff(b->timestamp, a->timestamp);
+    w = ts_diff(t, a->timestamp);
+
+    *out = *a;
+
+    if (dt > 0) {
+        for (i = 0U; i < 3U; i++) {
+            out->u.v[i] = a->u.v[i] + (int32_t)(
+                    ((int64_t)(b->u.v[i] - a->u.v[i]) * w) / dt);
+        }
+
+        out->status[0] |= b->status[0];
+        out->status[1] |= b->status[1];
+    }
+
+    out->timestamp = t;
+}
+
+int16_t sync_init(
+    struct stream_sync *sync,
+    const uint32_t     mask,
+    const uint16_t     freq)
+{
+    if ((freq == 0U) || (freq > SYNC_MAX_FREQ) ||
+        ((mask >> SYNC_MAX_CHANNELS) != 0U)) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    memset(sync, 0, sizeof(*sync));
+    sync->mask = mask;
+    sync->period = (AKM_TIMESTAMP)(SYNC_TS_PER_SEC / freq);
+
+    return AKM_SUCCESS;
+}
+
+void sync_reset(struct stream_sync *sync)
+{
+    uint8_t ch;
+
+    for (ch = 0U; ch < SYNC_MAX_CHANNELS; ch++) {
+        sync->ch[ch].count = 0U;
+    }
+
+    sync->started = 0U;
+}
+
+int16_t sync_push(
+    struct stream_sync           *sync,
+    const uint8_t                ch,
+    const struct AKM_SENSOR_DATA *data)
+{
+    struct sync_channel *c;
+    int16_t             ret = AKM_SUCCESS;
+
+    if ((ch >= SYNC_MAX_CHANNELS) || (is_aligned(sync, ch) == 0U)) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    c = &sync->ch[ch];
+
+    if (c->count >= SYNC_HISTORY) {
+        channel_drop(c);
+        sync->dropped++;
+        ret = AKM_ERR_BUSY;
+    }
+
+    c->hist[c->count++] = *data;
+
+    return ret;
+}
+
+uint8_t sync_pop(
+    struct stream_sync     *sync,
+    struct AKM_SENSOR_DATA out[SYNC_MAX_CHANNELS])
+{
+    struct sync_channel *c;
+    uint8_t             ch;
+    uint8_t             n;
+
+    if ((sync->mask == 0U) ||
+        ((sync->started == 0U) && (sync_start(sync) == 0U))) {
+        return 0U;
+    }
+
+    /* Wait until every channel has passed the grid time */
+    for (ch = 0U; ch < SYNC_MAX_CHANNELS; ch++) {
+        c = &sync->ch[ch];
+
+        if ((is_aligned(sync, ch) != 0U) &&
+            ((c->count == 0U) ||
+             (ts_diff(c->hist[c->count - 1U].timestamp, sync->next) < 0))) {
+            return 0U;
+        }
+    }
+
+    /* The sample before the grid time was dropped. Start again. */
+    for (ch = 0U; ch < SYNC_MAX_CHANNELS; ch++) {
+        if ((is_aligned(sync, ch) != 0U) &&
+            (ts_diff(sync->ch[ch].hist[0].timestamp, sync->next) > 0)) {
+            sync->resyncs++;
+            sync_start(sync);
+            return sync_pop(sync, out);
+        }
+    }
+
+    n = 0U;
+
+    for (ch = 0U; ch < SYNC_MAX_CHANNELS; ch++) {
+        if (is_aligned(sync, ch) != 0U) {
+            channel_interpolate(&sync->ch[ch], sync->next, &out[n++]);
+        }
+    }
+
+    sync->next = ts_add(sync->next, sync->period);
+    sync->outputs++;
+
+    /* Keep the last sample at or before the next grid time */
+    for (ch = 0U; ch < SYNC_MAX_CHANNELS; ch++) {
+        c = &sync->ch[ch];
+
+        while ((c->count >= 2U) &&
+               (ts_diff(c->hist[1].timestamp, sync->next) <= 0)) {
+            channel_drop(c);
+        }
+    }
+
+    return n;
+}
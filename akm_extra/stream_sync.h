@@ -0,0 +1,131 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+#ifndef INCLUDE_STREAM_SYNC_H
+#define INCLUDE_STREAM_SYNC_H
+
+#include "AKM_Common.h"
+
+/* The number of samples which are kept for each channel. It must cover
+ * the fastest channel while the slowest one is waited. */
+#ifndef SYNC_HISTORY
+#define SYNC_HISTORY       16U
+#endif
+
+#define SYNC_MAX_CHANNELS  4U
+#define SYNC_MAX_FREQ      1000U
+
+/* Timestamp ticks per second */
+#ifdef AKM_TIMESTAMP_NANOSECOND
+#define SYNC_TS_PER_SEC    1000000000LL
+#else
+#define SYNC_TS_PER_SEC    1000000L
+#endif
+
+/*!
+ * Recent samples of one channel, the oldest first.
+ */
+struct sync_channel {
+    struct AKM_SENSOR_DATA hist[SYNC_HISTORY];
+    uint8_t                count;
+};
+
+/*!
+ * Alignment of several sensor streams to a common time grid.
+ * Each output is a set of vectors, one per channel, which are linearly
+ * interpolated to the same grid time. A grid time is output when every
+ * channel has a sample at or after it.
+ */
+struct stream_sync {
+    struct sync_channel ch[SYNC_MAX_CHANNELS];
+    /*! The next grid time. */
+    AKM_TIMESTAMP       next;
+    /*! Grid interval in timestamp unit. */
+    AKM_TIMESTAMP       period;
+    /*! Channels which are aligned. Bit n is channel n. */
+    uint32_t            mask;
+    /*! Non-zero when next is valid. */
+    uint8_t             started;
+    /* statistics */
+    uint32_t            outputs;
+    /*! Samples which were dropped because history was full. */
+    uint32_t            dropped;
+    /*! The number of times the grid was started again. */
+    uint32_t            resyncs;
+};
+
+/*!
+ * \brief Initialize synchronization. Statistics are cleared.
+ *
+ * \param sync Synchronization.
+ * \param mask Channels which are aligned. Bit n is channel n.
+ * \param freq The rate of the grid in Hz. 1 to #SYNC_MAX_FREQ.
+ *
+ * \return #AKM_SUCCESS on success. #AKM_ERR_INVALID_ARG if an argument is
+ * out of range, in this case synchronization is not changed.
+ */
+int16_t sync_init(
+    struct stream_sync *sync,
+    const uint32_t     mask,
+    const uint16_t     freq
+);
+
+/*!
+ * \brief Drop all samples and start the grid again from the next output.
+ * Used when streams have a gap, e.g. pause or recovery of a sensor.
+ *
+ * \param sync Synchronization.
+ */
+void sync_reset(
+    struct stream_sync *sync
+);
+
+/*!
+ * \brief Add a sample of a channel. Samples of each channel must come in
+ * order of time.
+ *
+ * \param sync Synchronization.
+ * \param ch Channel number.
+ * \param data The sample.
+ *
+ * \return #AKM_SUCCESS on success. #AKM_ERR_BUSY when history was full
+ * and the oldest sample was dropped. #AKM_ERR_INVALID_ARG when the channel
+ * is not aligned.
+ */
+int16_t sync_push(
+    struct stream_sync           *sync,
+    const uint8_t                ch,
+    const struct AKM_SENSOR_DATA *data
+);
+
+/*!
+ * \brief Take the vectors of the next grid time.
+ *
+ * \param sync Synchronization.
+ * \param out One vector per aligned channel, in order of channel number.
+ * Each has the timestamp of the grid time.
+ *
+ * \return The number of vectors which are stored. 0 when a channel has
+ * no sample at or after the grid time yet.
+ */
+uint8_t sync_pop(
+    struct stream_sync     *sync,
+    struct AKM_SENSOR_DATA out[SYNC_MAX_CHANNELS]
+);
+
+#endif /* INCLUDE_STREAM_SYNC_H */
@@ -0,0 +1,1150 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+/*!
+ * \file akh_host.cpp
+ * \brief Hardware abstraction layer for host build.
+ *
+ * Sensors are replaced with register level models (host/sim), and time is
+ * virtual. Time advances only when the program waits (delay, idle) or
+ * transfers data on the bus, so a measurement runs much faster than real
+ * time and every run is reproducible. Everything runs in one thread:
+ * data ready handlers are called at the time of the sample, and the event
+ * queue is dispatched while the program waits.
+ *
+ * Environment variables:
+ *  - AKM_HOST_DURATION_S : virtual seconds until "z" (quit) is injected
+ *    to the console. Default is 10.
+ *  - AKM_HOST_NV : file which stores the non-volatile parameter.
+ *    Default is "akm_nv.bin".
+ *  - AKM_HOST_RECORD : file to which the bus transaction trace is saved
+ *    at exit.
+ *  - AKM_HOST_FAULT : "<handle>@<start s>+<length s>" makes the device
+ *    of the handle stop responding for the time, e.g. "0@3+0.5".
+ *  - AKM_HOST_REPLAY : trace file (or a capture of UART output which
+ *    contains "trace dump") to replay instead of the sensor models.
+ *
+ * Console input is read from stdin when it is not a terminal. A line
+ * which starts with "@<seconds>" is delivered at that virtual time,
+ * other lines are delivered at the time of the previous line.
+ *
+ * The board has the devices of CONFIG_DEVICES. Auto-detection, which
+ * reads addresses without knowing the part, finds them there.
+ *
+ * On replay, recorded reads are served in order, and each transfer does
+ * not complete before its recorded time. Data ready interrupts and console
+ * input are delivered at their recorded time. A transfer which does not
+ * match the trace is counted as divergence and fails with AKM_ERR_IO.
+ */
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "mbed.h"
+#include "AKH_APIs.h"
+#include "akh_cache.h"
+#include "akh_power.h"
+#include "akh_profile.h"
+#include "akh_timebase.h"
+#include "akh_device.h"
+#include "akh_trace.h"
+#include "sim/sim.h"
+
+#define HOST_DEFAULT_DURATION_S  10
+#define HOST_DEFAULT_NV_FILE     "akm_nv.bin"
+/* The program is aborted when it does not quit within this margin
+ * after "z" is injected. */
+#define HOST_EXIT_MARGIN_NS      (5ULL * SIM_NSEC_PER_SEC)
+/* "z" is injected this time after the last record of replay. */
+#define HOST_REPLAY_TAIL_NS      (1ULL * SIM_NSEC_PER_SEC)
+/* Divergences which are reported in detail. */
+#define HOST_REPLAY_REPORT_MAX   10
+
+/* Virtual time */
+static uint64_t g_now_ns;
+static uint64_t g_limit_ns;
+static uint64_t g_suspend_ns;
+static struct timespec g_real_start;
+
+/* Timed callbacks. Calls which are posted at the same time are kept in
+ * order of posting. */
+static std::multimap<uint64_t, std::function<void()> > g_queue;
+static int       g_queue_id;
+static EventQueue g_event_queue;
+
+/* Sensor models of each device handle. They are created when the device
+ * is accessed first. BMI160 has the same instance for ACC and GYR. */
+static struct sim_device *g_sim[AKH_MAX_DEVICES];
+
+/* Injected fault. The device does not respond in [start, end). */
+static AKH_HANDLE g_fault_dev = AKH_MAX_DEVICES;
+static uint64_t   g_fault_start_ns;
+static uint64_t   g_fault_end_ns;
+
+/* Devices on the board */
+static const struct AKH_DEVICE_DESC g_board[] = { CONFIG_DEVICES };
+
+static uint32_t     g_events;
+static IRQ_CALLBACK g_mag_cb;
+static IRQ_CALLBACK g_acc_cb;
+static IRQ_CALLBACK g_gyr_cb;
+static IRQ_CALLBACK g_uart_cb;
+
+/* Console input which has been delivered */
+static std::string g_rx;
+
+/* Bus statistics */
+static uint32_t g_stat_bytes;
+static uint64_t g_stat_busy_ns;
+static bool     g_async_busy;
+
+/* Asynchronous transfer in flight. The number tells it from later ones
+ * when the queued completion runs. */
+static uint64_t              g_async_end_ns;
+static uint32_t              g_async_seq;
+static std::function<void()> g_async_end;
+
+static uint32_t       g_logged;
+static AKH_LOG_WRITER g_log_writer;
+
+/* Replay. Records point into g_replay_buf. */
+static bool                              g_replay;
+static std::vector<uint8_t>              g_replay_buf;
+static std::vector<struct akh_trace_rec> g_replay_xfer;
+static std::vector<struct akh_trace_rec> g_replay_irq;
+static size_t                            g_replay_xfer_pos;
+static size_t                            g_replay_irq_pos;
+static uint32_t                          g_replay_diverged;
+static uint32_t                          g_replay_overrun;
+
+/* The part of the device table entry. A probe of auto-detection does
+ * not know it, so it is looked up on the board by the address. */
+static AKM_DEVICES desc_to_device(const struct AKH_DEVICE_DESC *desc)
+{
+    uint8_t i;
+    uint8_t address;
+
+    if (desc->device != AKM_DEVICE_NONE) {
+        return desc->device;
+    }
+
+    for (i = 0; i < sizeof(g_board) / sizeof(g_board[0]); i++) {
+        if (g_board[i].device == AKM_DEVICE_NONE) {
+            continue;
+        }
+
+        address = g_board[i].address;
+
+        if (address == AKH_ADDRESS_DEFAULT) {
+            address = AKH_Profile_DefaultAddress(g_board[i].device);
+        }
+
+        if (address == desc->address) {
+            return g_board[i].device;
+        }
+    }
+
+    return AKM_DEVICE_NONE;
+}
+
+static struct sim_device *handle_to_sim(const AKH_HANDLE dev)
+{
+    const struct AKH_DEVICE_DESC *desc = AKH_Device_Get(dev);
+    AKM_DEVICES                  device;
+
+    if (desc == NULL) {
+        return NULL;
+    }
+
+    if ((dev == g_fault_dev) &&
+        (g_now_ns >= g_fault_start_ns) && (g_now_ns < g_fault_end_ns)) {
+        return NULL;
+    }
+
+    device = desc_to_device(desc);
+
+    /* the handle may be given to other device after AKH_ClearDevices() */
+    if ((g_sim[dev] == NULL) || (g_sim[dev]->dev != device)) {
+        g_sim[dev] = sim_create(device);
+    }
+
+    return g_sim[dev];
+}
+
+/* The earliest time of sensor samples and queued calls. */
+static uint64_t next_event_time(const bool with_queue)
+{
+    uint64_t t = SIM_NEVER;
+    uint64_t s;
+    uint8_t  i;
+
+    for (i = 0; i < AKH_MAX_DEVICES; i++) {
+        if (g_sim[i] != NULL) {
+            s = sim_next_event(g_sim[i]);
+
+            if (s < t) {
+                t = s;
+            }
+        }
+    }
+
+    if ((g_replay_irq_pos < g_replay_irq.size()) &&
+        (g_replay_irq[g_replay_irq_pos].time_ns < t)) {
+        t = g_replay_irq[g_replay_irq_pos].time_ns;
+    }
+
+    if (with_queue && !g_queue.empty() && (g_queue.begin()->first < t)) {
+        t = g_queue.begin()->first;
+    }
+
+    return t;
+}
+
+static void set_now(const uint64_t t)
+{
+    if (t > g_now_ns) {
+        g_now_ns = t;
+    }
+
+    if (g_now_ns > g_limit_ns) {
+        fprintf(stderr, "host: no exit after %llu ns, aborted.\n",
+                (unsigned long long)g_now_ns);
+        exit(2);
+    }
+}
+
+/* Run sensor samples, then one queued call which is due at time t. */
+static void run_at(const uint64_t t, const bool with_queue)
+{
+    std::function<void()> func;
+    uint8_t               i;
+
+    set_now(t);
+
+    for (i = 0; i < AKH_MAX_DEVICES; i++) {
+        if (g_sim[i] != NULL) {
+            sim_advance(g_sim[i], g_now_ns);
+        }
+    }
+
+    /* Recorded interrupts come even while the program is on the bus. */
+    while ((g_replay_irq_pos < g_replay_irq.size()) &&
+           (g_replay_irq[g_replay_irq_pos].time_ns <= g_now_ns)) {
+        sim_raise_irq((AKH_IRQ)g_replay_irq[g_replay_irq_pos++].irq);
+    }
+
+    if (with_queue && !g_queue.empty() &&
+        (g_queue.begin()->first <= g_now_ns)) {
+        /* The call may post another one, or wait. */
+        func = g_queue.begin()->second;
+        g_queue.erase(g_queue.begin());
+        func();
+    }
+}
+
+/* Advance virtual time to 'until'. Queued calls are not dispatched while
+ * the program is on the bus, same as a thread which holds the bus. */
+static void advance(const uint64_t until, const bool with_queue)
+{
+    uint64_t t;
+
+    for (;;) {
+        t = next_event_time(with_queue);
+
+        if (t > until) {
+            break;
+        }
+
+        run_at(t, with_queue);
+    }
+
+    set_now(until);
+}
+
+static uint64_t bus_time_ns(
+    const AKH_HANDLE      dev,
+    const uint16_t        len)
+{
+#ifdef AKH_USE_SPI
+    /* address + data, 8 clocks each */
+    return ((uint64_t)(len + 1) * 8U * SIM_NSEC_PER_SEC) /
+           AKH_Profile_SPIClock(dev);
+#else
+    /* slave address + register address + data, 9 clocks each, and
+     * start/stop conditions */
+    return ((uint64_t)((len + 2) * 9 + 2) * SIM_NSEC_PER_SEC) /
+           AKH_Profile_I2CClock(dev);
+#endif
+}
+
+/* Account the transfer, and let time pass while the bus is busy. */
+static void bus_transfer(
+    const AKH_HANDLE      dev,
+    const uint16_t        len)
+{
+    uint64_t dur = bus_time_ns(dev, len);
+
+    g_stat_bytes += len;
+    g_stat_busy_ns += dur;
+    advance(g_now_ns + dur, false);
+}
+
+/* Deliver a console input line. */
+static void deliver_input(const std::string line)
+{
+    g_rx += line;
+
+    if (g_uart_cb != NULL) {
+        g_uart_cb();
+    }
+
+    AKH_SignalEvent(AKH_EVENT_UART);
+}
+
+static void load_script(void)
+{
+    char     line[256];
+    uint64_t t = 0;
+    char     *body;
+    char     *end;
+    double   sec;
+
+    if (isatty(STDIN_FILENO)) {
+        return;
+    }
+
+    while (fgets(line, sizeof(line), stdin) != NULL) {
+        body = line;
+
+        if (line[0] == '@') {
+            sec = strtod(&line[1], &end);
+
+            if ((end != &line[1]) && (sec >= 0.0)) {
+                t = (uint64_t)(sec * (double)SIM_NSEC_PER_SEC);
+                body = end;
+
+                while (*body == ' ') {
+                    body++;
+                }
+            }
+        }
+
+        g_queue.emplace(t, std::bind(deliver_input, std::string(body)));
+    }
+}
+
+static void print_summary(void)
+{
+    struct timespec now;
+    double          real;
+    double          virt;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    real = (double)(now.tv_sec - g_real_start.tv_sec) +
+           (double)(now.tv_nsec - g_real_start.tv_nsec) / 1e9;
+    virt = (double)g_now_ns / (double)SIM_NSEC_PER_SEC;
+
+    fprintf(stderr, "host: %.3f s simulated in %.3f s (x%.0f)\n",
+            virt, real, (real > 0.0) ? (virt / real) : 0.0);
+}
+
+static void save_trace(void)
+{
+    const char    *file = getenv("AKM_HOST_RECORD");
+    const uint8_t *trace;
+    uint32_t      len;
+    FILE          *fp;
+
+    AKH_TraceStop();
+
+    if (AKH_TraceGet(&trace, &len) != AKM_SUCCESS) {
+        return;
+    }
+
+    fp = fopen(file, "wb");
+
+    if ((fp == NULL) || (fwrite(trace, 1, len, fp) != len)) {
+        fprintf(stderr, "host: cannot write %s\n", file);
+    }
+
+    if (fp != NULL) {
+        fclose(fp);
+    }
+}
+
+static void print_replay_summary(void)
+{
+    fprintf(stderr, "host: replayed %u of %u transfers, %u diverged, "
+            "%u after the end\n",
+            (unsigned int)g_replay_xfer_pos,
+            (unsigned int)g_replay_xfer.size(),
+            (unsigned int)g_replay_diverged,
+            (unsigned int)g_replay_overrun);
+}
+
+/* Load a trace, and return the time of the last record. */
+static uint64_t load_replay(const char *file)
+{
+    FILE                 *fp = fopen(file, "rb");
+    struct akh_trace_rec rec;
+    uint32_t             pos;
+    uint32_t             len;
+    uint32_t             end;
+    int                  c;
+
+    if (fp == NULL) {
+        fprintf(stderr, "host: cannot open %s\n", file);
+        exit(2);
+    }
+
+    while ((c = fgetc(fp)) != EOF) {
+        g_replay_buf.push_back((uint8_t)c);
+    }
+
+    fclose(fp);
+
+    if (AKH_Trace_Find(g_replay_buf.data(), g_replay_buf.size(),
+                       &pos, &len) != AKM_SUCCESS) {
+        fprintf(stderr, "host: no trace in %s\n", file);
+        exit(2);
+    }
+
+    memset(&rec, 0, sizeof(rec));
+    end = pos + len;
+
+    while (AKH_Trace_Next(g_replay_buf.data(), end, &pos, &rec) ==
+           AKM_SUCCESS) {
+        switch (rec.kind) {
+        case AKH_TRACE_TX:
+        case AKH_TRACE_RX:
+            g_replay_xfer.push_back(rec);
+            break;
+
+        case AKH_TRACE_IRQ:
+            g_replay_irq.push_back(rec);
+            break;
+
+        case AKH_TRACE_INPUT:
+            g_queue.emplace(rec.time_ns, std::bind(
+                    deliver_input,
+                    std::string((const char *)rec.data, rec.len)));
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    atexit(print_replay_summary);
+    return rec.time_ns;
+}
+
+static void diverged(
+    const char            *what,
+    const uint8_t         kind,
+    const AKH_HANDLE      dev,
+    const uint8_t         address,
+    const uint16_t        len)
+{
+    if (g_replay_diverged++ < HOST_REPLAY_REPORT_MAX) {
+        fprintf(stderr, "host: replay %s at %llu ns: %s dev %d reg 0x%02X "
+                "len %u\n", what, (unsigned long long)g_now_ns,
+                (kind == AKH_TRACE_TX) ? "write" : "read",
+                (int)dev, (unsigned int)address, (unsigned int)len);
+    }
+}
+
+/* Take the next transfer from the trace. wdata is the data to be written,
+ * rdata is the buffer to be read. done_ns is set to the recorded time of
+ * completion. */
+static int16_t replay_xfer(
+    const uint8_t         kind,
+    const AKH_HANDLE      dev,
+    const uint8_t         address,
+    const uint8_t         *wdata,
+    uint8_t               *rdata,
+    const uint16_t        len,
+    uint64_t              *done_ns)
+{
+    const struct akh_trace_rec *rec;
+
+    *done_ns = g_now_ns;
+
+    /* A trace which was stopped in a session ends before "z". */
+    if (g_replay_xfer_pos >= g_replay_xfer.size()) {
+        g_replay_overrun++;
+        return AKM_ERR_IO;
+    }
+
+    rec = &g_replay_xfer[g_replay_xfer_pos++];
+    *done_ns = rec->time_ns;
+
+    if ((rec->kind != kind) || (rec->dev != dev) ||
+        (rec->address != address) || (rec->len != len)) {
+        diverged("mismatch", kind, dev, address, len);
+        return AKM_ERR_IO;
+    }
+
+    if (rec->result != AKM_SUCCESS) {
+        return rec->result;
+    }
+
+    if (kind == AKH_TRACE_TX) {
+        if (memcmp(rec->data, wdata, len) != 0) {
+            /* the device got other data than the recording */
+            diverged("data", kind, dev, address, len);
+        }
+    } else {
+        memcpy(rdata, rec->data, len);
+    }
+
+    return AKM_SUCCESS;
+}
+
+/******************************************************************************/
+/***** Host hooks *************************************************************/
+int host_event_post(const uint64_t delay_ns, std::function<void()> func)
+{
+    g_queue.emplace(g_now_ns + delay_ns, func);
+    return ++g_queue_id;
+}
+
+EventQueue *mbed_event_queue(void)
+{
+    return &g_event_queue;
+}
+
+EventQueue *mbed_highprio_event_queue(void)
+{
+    return &g_event_queue;
+}
+
+void wait_us(int us)
+{
+    advance(g_now_ns + (uint64_t)us * 1000U, true);
+}
+
+uint64_t sim_now(void)
+{
+    return g_now_ns;
+}
+
+void sim_raise_irq(const AKH_IRQ irq)
+{
+    /* Handlers are called only when the pin is enabled. */
+    switch (irq) {
+    case IRQ_MAG_1:
+        if (g_mag_cb != NULL) {
+            AKH_Trace_IRQ(irq);
+            g_mag_cb();
+            AKH_SignalEvent(AKH_EVENT_MAG);
+        }
+        break;
+
+    case IRQ_ACC_1:
+        if (g_acc_cb != NULL) {
+            AKH_Trace_IRQ(irq);
+            g_acc_cb();
+            AKH_SignalEvent(AKH_EVENT_ACC);
+        }
+        break;
+
+    case IRQ_GYR_1:
+        if (g_gyr_cb != NULL) {
+            AKH_Trace_IRQ(irq);
+            g_gyr_cb();
+            AKH_SignalEvent(AKH_EVENT_GYR);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+void AKH_TimebaseSuspend(void)
+{
+    g_suspend_ns = g_now_ns;
+}
+
+uint64_t AKH_TimebaseResume(void)
+{
+    /* The board would be in deep sleep unless a transfer is in flight. */
+    return g_async_busy ? 0 : (g_now_ns - g_suspend_ns);
+}
+
+static void load_fault(void)
+{
+    const char   *env = getenv("AKM_HOST_FAULT");
+    unsigned int dev;
+    double       start_s;
+    double       len_s;
+
+    if (env == NULL) {
+        return;
+    }
+
+    if ((sscanf(env, "%u@%lf+%lf", &dev, &start_s, &len_s) != 3) ||
+        (dev >= AKH_MAX_DEVICES) || (start_s < 0.0) || (len_s < 0.0)) {
+        fprintf(stderr, "host: invalid AKM_HOST_FAULT \"%s\"\n", env);
+        return;
+    }
+
+    g_fault_dev = (AKH_HANDLE)dev;
+    g_fault_start_ns = (uint64_t)(start_s * SIM_NSEC_PER_SEC);
+    g_fault_end_ns = g_fault_start_ns + (uint64_t)(len_s * SIM_NSEC_PER_SEC);
+}
+
+/******************************************************************************/
+/***** AKH public APIs ********************************************************/
+void AKH_Init(void)
+{
+    const char *env;
+    uint64_t   duration_s = HOST_DEFAULT_DURATION_S;
+    uint64_t   end_ns;
+
+    clock_gettime(CLOCK_MONOTONIC, &g_real_start);
+    atexit(print_summary);
+
+    env = getenv("AKM_HOST_REPLAY");
+    g_replay = (env != NULL);
+
+    if (g_replay) {
+        /* sensor models and the script are not used */
+        end_ns = load_replay(env) + HOST_REPLAY_TAIL_NS;
+    } else {
+        env = getenv("AKM_HOST_DURATION_S");
+
+        if (env != NULL) {
+            duration_s = strtoull(env, NULL, 10);
+        }
+
+        end_ns = duration_s * SIM_NSEC_PER_SEC;
+        load_script();
+        load_fault();
+    }
+
+    g_limit_ns = end_ns + HOST_EXIT_MARGIN_NS;
+    g_queue.emplace(end_ns, std::bind(deliver_input, std::string("z\n")));
+
+    if (getenv("AKM_HOST_RECORD") != NULL) {
+        if (AKH_TraceStart() == AKM_SUCCESS) {
+            atexit(save_trace);
+        } else {
+            fprintf(stderr, "host: built without AKH_USE_TRACE\n");
+        }
+    }
+
+    AKH_Profile_Init();
+    AKH_Print("Hello host!!!\n");
+
+    AKH_PowerInit();
+}
+
+/* End of asynchronous transfer, which is interrupt context on the target.
+ * Read is recorded when the data has arrived, as the target HAL does. */
+static void async_end(
+    const uint32_t   seq,
+    const int16_t    result,
+    const AKH_HANDLE dev,
+    const uint8_t    address,
+    uint8_t          *rdata,
+    const uint16_t   len)
+{
+    if (!g_async_busy || (seq != g_async_seq)) {
+        /* already ended by a blocking access */
+        return;
+    }
+
+    g_async_busy = false;
+
+    if (rdata != NULL) {
+        AKH_Trace_Xfer(AKH_TRACE_RX, dev, address, rdata, len, result);
+    }
+}
+
+/* Complete asynchronous transfer in thread context. */
+static void async_done(
+    const uint32_t          seq,
+    const AKH_XFER_CALLBACK callback,
+    void                    *arg,
+    const int16_t           result,
+    const AKH_HANDLE        dev,
+    const uint8_t           address,
+    uint8_t                 *rdata,
+    const uint16_t          len)
+{
+    async_end(seq, result, dev, address, rdata, len);
+
+    if (callback != NULL) {
+        callback(result, arg);
+    }
+}
+
+/* A blocking access waits on the bus until the transfer in flight ends.
+ * Its callback still runs later from the queue. */
+static void bus_acquire(void)
+{
+    if (g_async_busy) {
+        advance(g_async_end_ns, false);
+        g_async_end();
+    }
+}
+
+int16_t AKH_TxData(
+    const AKH_HANDLE dev,
+    const uint8_t address,
+    const uint8_t *data,
+    const uint16_t numberOfBytesToWrite)
+{
+    struct sim_device *sim = handle_to_sim(dev);
+    uint64_t          done_ns;
+    int16_t           fret = AKM_SUCCESS;
+
+    if (numberOfBytesToWrite > AKH_Profile_MaxBurst(dev)) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    bus_acquire();
+
+    if (g_replay) {
+        fret = replay_xfer(AKH_TRACE_TX, dev, address, data, NULL,
+                           numberOfBytesToWrite, &done_ns);
+        bus_transfer(dev, (fret == AKM_SUCCESS) ? numberOfBytesToWrite : 0);
+        advance(done_ns, false);
+    } else if (sim == NULL) {
+        /* nobody acknowledges, only the address phase takes time */
+        fret = AKM_ERR_IO;
+        bus_transfer(dev, 0);
+    } else {
+        sim_write(sim, address, data, numberOfBytesToWrite);
+        bus_transfer(dev, numberOfBytesToWrite);
+    }
+
+    AKH_Trace_Xfer(
+        AKH_TRACE_TX, dev, address, data, numberOfBytesToWrite, fret);
+
+    if (fret == AKM_SUCCESS) {
+        AKH_Cache_Store(dev, address, data, numberOfBytesToWrite);
+    } else {
+        AKH_Cache_Drop(dev, address, numberOfBytesToWrite);
+    }
+
+    return fret;
+}
+
+int16_t AKH_RxData(
+    const AKH_HANDLE dev,
+    const uint8_t address,
+    uint8_t *data,
+    const uint16_t numberOfBytesToRead)
+{
+    struct sim_device *sim = handle_to_sim(dev);
+    uint64_t          done_ns;
+    int16_t           fret = AKM_SUCCESS;
+
+    if (numberOfBytesToRead > AKH_Profile_MaxBurst(dev)) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    bus_acquire();
+
+    if (g_replay) {
+        fret = replay_xfer(AKH_TRACE_RX, dev, address, NULL, data,
+                           numberOfBytesToRead, &done_ns);
+        bus_transfer(dev, (fret == AKM_SUCCESS) ? numberOfBytesToRead : 0);
+        advance(done_ns, false);
+    } else if (sim == NULL) {
+        /* nobody acknowledges, only the address phase takes time */
+        fret = AKM_ERR_IO;
+        bus_transfer(dev, 0);
+    } else {
+        /* Data is latched at the start of the transfer. */
+        sim_read(sim, address, data, numberOfBytesToRead);
+        bus_transfer(dev, numberOfBytesToRead);
+    }
+
+    AKH_Trace_Xfer(
+        AKH_TRACE_RX, dev, address, data, numberOfBytesToRead, fret);
+
+    return fret;
+}
+
+/* The models do not fail, so probe is the same as read. An address
+ * without a model fails as on the target. */
+int16_t AKH_ProbeData(
+    const AKH_HANDLE dev,
+    const uint8_t address,
+    uint8_t *data,
+    const uint16_t numberOfBytesToRead)
+{
+    return AKH_RxData(dev, address, data, numberOfBytesToRead);
+}
+
+/* Start asynchronous transfer on the model or the trace. */
+static int16_t async_start(
+    const uint8_t           kind,
+    const AKH_HANDLE        dev,
+    const uint8_t           address,
+    const uint8_t           *wdata,
+    uint8_t                 *rdata,
+    const uint16_t          len,
+    const AKH_XFER_CALLBACK callback,
+    void                    *arg)
+{
+    struct sim_device *sim = handle_to_sim(dev);
+    uint64_t          dur;
+    uint64_t          done_ns;
+    int16_t           result = AKM_SUCCESS;
+
+    /* Same limit as the target HAL */
+    if (len > AKH_Profile_MaxBurst(dev)) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    if (g_async_busy) {
+        return AKM_ERR_BUSY;
+    }
+
+    if (g_replay) {
+        result = replay_xfer(kind, dev, address, wdata, rdata, len,
+                             &done_ns);
+    } else if (sim == NULL) {
+        /* nobody acknowledges, which is found at the end as on target */
+        result = AKM_ERR_IO;
+    } else if (kind == AKH_TRACE_TX) {
+        sim_write(sim, address, wdata, len);
+    } else {
+        sim_read(sim, address, rdata, len);
+    }
+
+    /* a failed transfer ends after the address phase */
+    dur = bus_time_ns(dev, (result == AKM_SUCCESS) ? len : 0);
+
+    if (g_replay && (done_ns > g_now_ns + dur)) {
+        dur = done_ns - g_now_ns;
+    }
+
+    if (kind == AKH_TRACE_TX) {
+        /* data is released after return, so it is recorded at start */
+        AKH_Trace_Xfer(AKH_TRACE_TX, dev, address, wdata, len, result);
+    }
+
+    if (result == AKM_SUCCESS) {
+        g_stat_bytes += len;
+    }
+
+    g_stat_busy_ns += bus_time_ns(dev, (result == AKM_SUCCESS) ? len : 0);
+    g_async_busy = true;
+    g_async_seq++;
+    g_async_end_ns = g_now_ns + dur;
+    g_async_end = std::bind(async_end, g_async_seq, result, dev, address,
+                            rdata, len);
+    host_event_post(dur, std::bind(async_done, g_async_seq, callback, arg,
+                                   result, dev, address, rdata, len));
+    return AKM_SUCCESS;
+}
+
+int16_t AKH_TxDataAsync(
+    const AKH_HANDLE dev,
+    const uint8_t address,
+    const uint8_t *data,
+    const uint16_t numberOfBytesToWrite,
+    const AKH_XFER_CALLBACK callback,
+    void *arg)
+{
+    /* the result is not known here, so forget the shadow */
+    AKH_Cache_Drop(dev, address, numberOfBytesToWrite);
+
+    return async_start(AKH_TRACE_TX, dev, address, data, NULL,
+                       numberOfBytesToWrite, callback, arg);
+}
+
+int16_t AKH_RxDataAsync(
+    const AKH_HANDLE dev,
+    const uint8_t address,
+    uint8_t *data,
+    const uint16_t numberOfBytesToRead,
+    const AKH_XFER_CALLBACK callback,
+    void *arg)
+{
+    return async_start(AKH_TRACE_RX, dev, address, NULL, data,
+                       numberOfBytesToRead, callback, arg);
+}
+
+int16_t AKH_GetBusThroughput(struct AKH_BUS_THROUGHPUT *tp)
+{
+    tp->bytes = g_stat_bytes;
+    tp->busy_us = (uint32_t)(g_stat_busy_ns / 1000U);
+
+    if (g_stat_busy_ns == 0) {
+        tp->bytes_per_sec = 0;
+    } else {
+        tp->bytes_per_sec = (uint32_t)(
+                ((uint64_t)g_stat_bytes * SIM_NSEC_PER_SEC) / g_stat_busy_ns);
+    }
+
+    return AKM_SUCCESS;
+}
+
+int16_t AKH_GetBusClock(
+    const AKH_HANDLE      dev,
+    uint32_t              *hz)
+{
+#ifdef AKH_USE_SPI
+    *hz = AKH_Profile_SPIClock(dev);
+#else
+    *hz = AKH_Profile_I2CClock(dev);
+#endif
+    return AKM_SUCCESS;
+}
+
+int16_t AKH_GetBusErrors(
+    const AKH_HANDLE      dev,
+    struct AKH_BUS_ERRORS *errors)
+{
+    /* Simulated bus never fails. */
+    errors->nacks = 0;
+    errors->timeouts = 0;
+    errors->retries = 0;
+    errors->recoveries = 0;
+    return AKM_SUCCESS;
+}
+
+int16_t AKH_Reset(const AKM_SENSOR_TYPE stype)
+{
+    return AKM_SUCCESS;
+}
+
+void AKH_DelayMicro(const uint16_t us)
+{
+    advance(g_now_ns + (uint64_t)us * 1000U, true);
+}
+
+void AKH_DelayMilli(const uint16_t ms)
+{
+    advance(g_now_ns + (uint64_t)ms * 1000000U, true);
+}
+
+int16_t AKH_SetIRQHandler(
+    const AKH_IRQ stype,
+    IRQ_CALLBACK func)
+{
+    switch (stype) {
+    case IRQ_MAG_1:
+        g_mag_cb = func;
+        break;
+
+    case IRQ_ACC_1:
+        g_acc_cb = func;
+        break;
+
+    case IRQ_GYR_1:
+        g_gyr_cb = func;
+        break;
+
+    case IRQ_UART:
+        g_uart_cb = func;
+        break;
+
+    default:
+        return AKM_ERR_NOT_SUPPORT;
+    }
+
+    return AKM_SUCCESS;
+}
+
+void AKH_SignalEvent(const uint32_t events)
+{
+    g_events |= events;
+}
+
+int16_t AKH_WaitEvent(
+    const uint32_t mask,
+    const uint32_t timeout_us,
+    uint32_t       *events)
+{
+    uint64_t deadline = g_now_ns + (uint64_t)timeout_us * 1000U;
+    uint64_t t;
+
+    while ((g_events & mask) == 0) {
+        t = next_event_time(true);
+
+        if (t > deadline) {
+            set_now(deadline);
+            return AKM_ERR_TIMEOUT;
+        }
+
+        run_at(t, true);
+    }
+
+    if (events != NULL) {
+        *events = g_events & mask;
+    }
+
+    g_events &= ~mask;
+    return AKM_SUCCESS;
+}
+
+AKM_TIMESTAMP AKH_GetTimestamp(void)
+{
+#ifdef AKM_TIMESTAMP_NANOSECOND
+    return (AKM_TIMESTAMP)AKH_GetTimeNs();
+#else
+    return (AKM_TIMESTAMP)(uint32_t)(AKH_GetTimeNs() / 1000);
+#endif
+}
+
+uint64_t AKH_GetTimeNs(void)
+{
+    return g_now_ns;
+}
+
+uint32_t AKH_GetTimebaseResolution(void)
+{
+    return 1;
+}
+
+static const char *nv_file(void)
+{
+    const char *env = getenv("AKM_HOST_NV");
+
+    return (env != NULL) ? env : HOST_DEFAULT_NV_FILE;
+}
+
+int16_t AKH_SaveParameter(
+    const uint8_t *param,
+    const uint16_t nBytes)
+{
+    FILE   *fp = fopen(nv_file(), "wb");
+    size_t n;
+
+    if (fp == NULL) {
+        return AKM_ERR_IO;
+    }
+
+    n = fwrite(param, 1, nBytes, fp);
+    fclose(fp);
+    return (n == nBytes) ? AKM_SUCCESS : AKM_ERR_IO;
+}
+
+int16_t AKH_LoadParameter(
+    uint8_t *param,
+    const uint16_t nBytes)
+{
+    FILE   *fp = fopen(nv_file(), "rb");
+    size_t n;
+    int    extra;
+
+    if (fp == NULL) {
+        return AKM_ERROR;
+    }
+
+    n = fread(param, 1, nBytes, fp);
+    extra = fgetc(fp);
+    fclose(fp);
+
+    /* The size is different, the record is of other build. */
+    if ((n != nBytes) || (extra != EOF)) {
+        return AKM_ERROR;
+    }
+
+    return AKM_SUCCESS;
+}
+
+void AKH_Print(
+    const char *format,
+    ...)
+{
+    va_list va;
+
+    va_start(va, format);
+    vfprintf(stdout, format, va);
+    va_end(va);
+}
+
+int16_t AKH_Write(
+    const uint8_t  *data,
+    const uint16_t len)
+{
+    if (fwrite(data, 1, len, stdout) != len) {
+        return AKM_ERR_IO;
+    }
+
+    return AKM_SUCCESS;
+}
+
+int16_t AKH_Read(
+    uint8_t        *data,
+    const uint16_t size,
+    uint16_t       *len)
+{
+    *len = 0;
+
+    if (g_rx.empty()) {
+        return AKM_ERR_TIMEOUT;
+    }
+
+    *len = (uint16_t)g_rx.copy((char *)data, size);
+    g_rx.erase(0, *len);
+    AKH_Trace_Input(data, *len);
+    return AKM_SUCCESS;
+}
+
+void AKH_Log(
+    const char *format,
+    ...)
+{
+    char    line[160];
+    va_list va;
+
+    va_start(va, format);
+
+    if (g_log_writer != NULL) {
+        if (vsnprintf(line, sizeof(line), format, va) > 0) {
+            g_log_writer(line, (uint16_t)strlen(line));
+        }
+    } else {
+        /* Log goes to stderr, so that stdout has measurement data only. */
+        vfprintf(stderr, format, va);
+    }
+
+    va_end(va);
+    g_logged++;
+}
+
+int16_t AKH_SetLogWriter(AKH_LOG_WRITER writer)
+{
+    g_log_writer = writer;
+    return AKM_SUCCESS;
+}
+
+int16_t AKH_GetLogStats(struct AKH_LOG_STATS *stats)
+{
+    stats->logged = g_logged;
+    stats->dropped = 0;
+    return AKM_SUCCESS;
+}
+
+int16_t AKH_CheckUserInput(uint32_t *code)
+{
+    /* No user button on host */
+    return AKM_ERR_TIMEOUT;
+}
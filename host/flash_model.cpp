@@ -0,0 +1,186 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+/*!
+ * \file flash_model.cpp
+ * \brief Internal flash model for host build.
+ *
+ * Flash of STM32F446RE (512 KB: 4 x 16 KB, 64 KB and 3 x 128 KB sectors)
+ * in RAM. Like the real part, program only works on erased bytes, and
+ * erase works on whole sectors. Power loss is modelled by stopping in the
+ * middle of a program or erase, see host_flash_cut_after().
+ */
+#include "mbed.h"
+
+#define FLASH_START        0x08000000UL
+#define FLASH_SIZE         0x80000UL
+#define FLASH_ERASE_VALUE  0xFF
+
+static uint8_t  g_mem[FLASH_SIZE];
+static uint32_t g_page_size = 1;
+static int32_t  g_cut = -1;
+static uint32_t g_programs;
+
+/* Returns false when the power is lost before the byte. */
+static bool flash_alive(void)
+{
+    if (g_cut == 0) {
+        return false;
+    }
+
+    if (g_cut > 0) {
+        g_cut--;
+    }
+
+    return true;
+}
+
+static bool flash_in_range(const uint32_t addr, const uint32_t size)
+{
+    return (addr >= FLASH_START) && (size <= FLASH_SIZE) &&
+           (addr - FLASH_START <= FLASH_SIZE - size);
+}
+
+void host_flash_reset(const uint32_t page_size)
+{
+    memset(g_mem, FLASH_ERASE_VALUE, sizeof(g_mem));
+    g_page_size = page_size;
+    g_cut = -1;
+    g_programs = 0;
+}
+
+void host_flash_cut_after(const int32_t bytes)
+{
+    g_cut = bytes;
+}
+
+uint32_t host_flash_programs(void)
+{
+    return g_programs;
+}
+
+int FlashIAP::init(void)
+{
+    return 0;
+}
+
+int FlashIAP::deinit(void)
+{
+    return 0;
+}
+
+int FlashIAP::read(void *buffer, uint32_t addr, uint32_t size)
+{
+    if (!flash_in_range(addr, size)) {
+        return -1;
+    }
+
+    memcpy(buffer, &g_mem[addr - FLASH_START], size);
+    return 0;
+}
+
+int FlashIAP::program(const void *buffer, uint32_t addr, uint32_t size)
+{
+    const uint8_t *src = (const uint8_t *)buffer;
+    uint8_t       *dst;
+    uint32_t      i;
+
+    if (!flash_in_range(addr, size) ||
+        ((addr % g_page_size) != 0) || ((size % g_page_size) != 0)) {
+        return -1;
+    }
+
+    dst = &g_mem[addr - FLASH_START];
+    g_programs++;
+
+    for (i = 0; i < size; i++) {
+        if (dst[i] != FLASH_ERASE_VALUE) {
+            fprintf(stderr, "flash: program on 0x%08lX, not erased\n",
+                    (unsigned long)(addr + i));
+            return -1;
+        }
+
+        if (!flash_alive()) {
+            return -1;
+        }
+
+        dst[i] = src[i];
+    }
+
+    return 0;
+}
+
+int FlashIAP::erase(uint32_t addr, uint32_t size)
+{
+    uint32_t i;
+
+    if (!flash_in_range(addr, size) ||
+        (get_sector_size(addr) == 0) ||
+        (get_sector_size(addr + size - 1) == 0)) {
+        return -1;
+    }
+
+    for (i = 0; i < size; i++) {
+        if (!flash_alive()) {
+            return -1;
+        }
+
+        g_mem[addr - FLASH_START + i] = FLASH_ERASE_VALUE;
+    }
+
+    return 0;
+}
+
+uint32_t FlashIAP::get_page_size(void) const
+{
+    return g_page_size;
+}
+
+uint32_t FlashIAP::get_sector_size(uint32_t addr) const
+{
+    uint32_t offset = addr - FLASH_START;
+
+    if (!flash_in_range(addr, 1)) {
+        return 0;
+    }
+
+    if (offset < 0x10000UL) {
+        return 0x4000UL;
+    }
+
+    if (offset < 0x20000UL) {
+        return 0x10000UL;
+    }
+
+    return 0x20000UL;
+}
+
+uint32_t FlashIAP::get_flash_start(void) const
+{
+    return FLASH_START;
+}
+
+uint32_t FlashIAP::get_flash_size(void) const
+{
+    return FLASH_SIZE;
+}
+
+uint8_t FlashIAP::get_erase_value(void) const
+{
+    return FLASH_ERASE_VALUE;
+}
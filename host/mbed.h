@@ -0,0 +1,176 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+/*!
+ * \file mbed.h
+ * \brief Subset of mbed OS API for host build.
+ *
+ * Portable modules (sensor drivers, library, application and a few HAL
+ * helpers) include "mbed.h" through AKM_Platform.h. On host, this file is
+ * found instead. Everything runs in one thread, and the event queue is
+ * dispatched by the host HAL in virtual time.
+ */
+#ifndef INCLUDE_HOST_MBED_H
+#define INCLUDE_HOST_MBED_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <functional>
+
+using namespace std::chrono_literals;
+
+typedef uint64_t us_timestamp_t;
+
+/* Post a call to the host event queue. delay_ns is relative to virtual
+ * time. Returns non-zero id on success. Implemented by the host HAL. */
+int host_event_post(const uint64_t delay_ns, std::function<void()> func);
+
+namespace events {
+class EventQueue {
+public:
+    template<typename F, typename... A>
+    int call(F f, A... args)
+    {
+        return host_event_post(0, std::bind(f, args...));
+    }
+
+    template<typename F, typename... A>
+    int call_in(std::chrono::milliseconds ms, F f, A... args)
+    {
+        return host_event_post(
+                   (uint64_t)ms.count() * 1000000ULL, std::bind(f, args...));
+    }
+};
+}
+
+using events::EventQueue;
+
+EventQueue *mbed_event_queue(void);
+EventQueue *mbed_highprio_event_queue(void);
+
+/* Implemented by the host HAL. It advances virtual time. */
+void wait_us(int us);
+
+/* Single thread. Nothing to protect. */
+static inline void core_util_critical_section_enter(void)
+{
+}
+
+static inline void core_util_critical_section_exit(void)
+{
+}
+
+static inline void sleep_manager_lock_deep_sleep(void)
+{
+}
+
+static inline void sleep_manager_unlock_deep_sleep(void)
+{
+}
+
+static inline uint8_t core_util_atomic_load_u8(const volatile uint8_t *ptr)
+{
+    return __atomic_load_n(ptr, __ATOMIC_SEQ_CST);
+}
+
+static inline void core_util_atomic_store_u8(volatile uint8_t *ptr, uint8_t v)
+{
+    __atomic_store_n(ptr, v, __ATOMIC_SEQ_CST);
+}
+
+static inline uint8_t core_util_atomic_exchange_u8(
+    volatile uint8_t *ptr,
+    uint8_t          v)
+{
+    return __atomic_exchange_n(ptr, v, __ATOMIC_SEQ_CST);
+}
+
+static inline uint32_t core_util_atomic_load_u32(const volatile uint32_t *ptr)
+{
+    return __atomic_load_n(ptr, __ATOMIC_SEQ_CST);
+}
+
+static inline void core_util_atomic_store_u32(
+    volatile uint32_t *ptr,
+    uint32_t          v)
+{
+    __atomic_store_n(ptr, v, __ATOMIC_SEQ_CST);
+}
+
+static inline uint32_t core_util_atomic_exchange_u32(
+    volatile uint32_t *ptr,
+    uint32_t          v)
+{
+    return __atomic_exchange_n(ptr, v, __ATOMIC_SEQ_CST);
+}
+
+static inline uint32_t core_util_atomic_fetch_or_u32(
+    volatile uint32_t *ptr,
+    uint32_t          arg)
+{
+    return __atomic_fetch_or(ptr, arg, __ATOMIC_SEQ_CST);
+}
+
+static inline uint32_t core_util_atomic_incr_u32(
+    volatile uint32_t *ptr,
+    uint32_t          delta)
+{
+    return __atomic_add_fetch(ptr, delta, __ATOMIC_SEQ_CST);
+}
+
+static inline bool core_util_atomic_cas_u32(
+    volatile uint32_t *ptr,
+    uint32_t          *expected,
+    uint32_t          desired)
+{
+    return __atomic_compare_exchange_n(
+               ptr, expected, desired, false,
+               __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+/* Internal flash of NUCLEO_F446RE, kept in RAM (flash_model.cpp). All
+ * instances share the memory. Only the store check links the model. */
+class FlashIAP {
+public:
+    int init(void);
+    int deinit(void);
+    int read(void *buffer, uint32_t addr, uint32_t size);
+    int program(const void *buffer, uint32_t addr, uint32_t size);
+    int erase(uint32_t addr, uint32_t size);
+    uint32_t get_page_size(void) const;
+    uint32_t get_sector_size(uint32_t addr) const;
+    uint32_t get_flash_start(void) const;
+    uint32_t get_flash_size(void) const;
+    uint8_t get_erase_value(void) const;
+};
+
+/* Erase the whole flash, and set the program page size. */
+void host_flash_reset(const uint32_t page_size);
+
+/* Program and erase stop after the given number of bytes, as if the
+ * power was lost, and fail from then on. Negative value never stops. */
+void host_flash_cut_after(const int32_t bytes);
+
+/* Number of program calls since reset. */
+uint32_t host_flash_programs(void);
+
+#endif /* INCLUDE_HOST_MBED_H */
@@ -0,0 +1,222 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+/*!
+ * \file nvstore_check.cpp
+ * \brief Check of the NV record store on the flash model.
+ *
+ * akh_nvstore.cpp is built into this file, so that a reboot can be done
+ * by clearing its state. Each case runs with 1 byte (STM32F4) and 8 byte
+ * program pages.
+ *
+ *   make -C host nvcheck
+ */
+#include "akh_nvstore.cpp"
+
+#define PAYLOAD_SIZE  200
+
+#define CHECK(cond)                                                     \
+    do {                                                                \
+        if (!(cond)) {                                                  \
+            printf("nvstore: %s:%d: %s\n", __func__, __LINE__, #cond);  \
+            return false;                                               \
+        }                                                               \
+    } while (0)
+
+static uint8_t g_data[PAYLOAD_SIZE];
+
+static void reboot(void)
+{
+    host_flash_cut_after(-1);
+    g_nv_ready = false;
+}
+
+static const uint8_t *payload(const uint32_t n)
+{
+    uint32_t i;
+
+    for (i = 0; i < sizeof(g_data); i++) {
+        g_data[i] = (uint8_t)(n * 7 + i);
+    }
+
+    return g_data;
+}
+
+static bool loads(const uint32_t n)
+{
+    uint8_t buf[PAYLOAD_SIZE];
+
+    return (AKH_NV_Load(buf, sizeof(buf)) == AKM_SUCCESS) &&
+           (memcmp(buf, payload(n), sizeof(buf)) == 0);
+}
+
+/* true when the next save erases the other sector */
+static bool next_rolls_over(void)
+{
+    const struct nv_sector *sec = &g_sectors[g_last_sector];
+
+    return sec->write_offset + nv_record_size(PAYLOAD_SIZE) > sec->size;
+}
+
+static bool check_empty(void)
+{
+    uint8_t buf[PAYLOAD_SIZE];
+
+    CHECK(AKH_NV_Init() == AKM_SUCCESS);
+    /* image ends where mbed_app.json says */
+    CHECK(g_sectors[0].addr == 0x08040000UL);
+    CHECK(g_sectors[1].addr == 0x08060000UL);
+    CHECK(AKH_NV_Load(buf, sizeof(buf)) == AKM_ERROR);
+    return true;
+}
+
+static bool check_rollover(void)
+{
+    uint32_t n;
+    int8_t   sector = 0;
+    uint32_t rollovers = 0;
+    uint32_t limit;
+
+    CHECK(AKH_NV_Init() == AKM_SUCCESS);
+    limit = 4 * (g_sectors[0].size / nv_record_size(PAYLOAD_SIZE));
+
+    for (n = 0; rollovers < 3; n++) {
+        CHECK(n < limit);
+        CHECK(AKH_NV_Save(payload(n), PAYLOAD_SIZE) == AKM_SUCCESS);
+        CHECK(g_last_seq == n);
+
+        if (g_last_sector != sector) {
+            sector = g_last_sector;
+            rollovers++;
+        }
+
+        /* scanning is slow. reboot now and then, and around the sector
+         * boundary */
+        if ((n % 64 == 0) || next_rolls_over() ||
+            (g_sectors[sector].write_offset ==
+             nv_record_size(PAYLOAD_SIZE))) {
+            reboot();
+        }
+
+        CHECK(loads(n));
+    }
+
+    return true;
+}
+
+static bool check_unchanged(void)
+{
+    uint32_t programs;
+
+    CHECK(AKH_NV_Save(payload(1), PAYLOAD_SIZE) == AKM_SUCCESS);
+    programs = host_flash_programs();
+    CHECK(AKH_NV_Save(payload(1), PAYLOAD_SIZE) == AKM_SUCCESS);
+    CHECK(host_flash_programs() == programs);
+    return true;
+}
+
+static bool check_length(void)
+{
+    uint8_t buf[PAYLOAD_SIZE];
+
+    CHECK(AKH_NV_Save(payload(1), PAYLOAD_SIZE) == AKM_SUCCESS);
+    reboot();
+    CHECK(AKH_NV_Load(buf, PAYLOAD_SIZE - 1) == AKM_ERR_NOT_SUPPORT);
+    return true;
+}
+
+/* Power is lost after cut bytes of the next save. The previous record
+ * must survive, and the store must keep working. */
+static bool check_torn(const int32_t cut, const bool at_rollover)
+{
+    uint32_t n = 0;
+
+    CHECK(AKH_NV_Save(payload(n), PAYLOAD_SIZE) == AKM_SUCCESS);
+
+    while (at_rollover && !next_rolls_over()) {
+        n++;
+        CHECK(AKH_NV_Save(payload(n), PAYLOAD_SIZE) == AKM_SUCCESS);
+    }
+
+    host_flash_cut_after(cut);
+    CHECK(AKH_NV_Save(payload(n + 1), PAYLOAD_SIZE) == AKM_ERR_IO);
+    reboot();
+    CHECK(loads(n));
+
+    CHECK(AKH_NV_Save(payload(n + 2), PAYLOAD_SIZE) == AKM_SUCCESS);
+    reboot();
+    CHECK(loads(n + 2));
+    CHECK(AKH_NV_Save(payload(n + 3), PAYLOAD_SIZE) == AKM_SUCCESS);
+    reboot();
+    CHECK(loads(n + 3));
+    return true;
+}
+
+static bool run(const uint32_t page_size)
+{
+    const uint32_t sector = 0x20000UL;
+    const int32_t  header = (int32_t)sizeof(struct nv_record_header);
+
+    host_flash_reset(page_size);
+    reboot();
+
+    if (!check_empty() || !check_rollover() || !check_unchanged() ||
+        !check_length()) {
+        return false;
+    }
+
+    struct {
+        int32_t cut;
+        bool    at_rollover;
+    } torn[] = {
+        /* in the header */
+        { 3, false },
+        /* in the payload */
+        { header + 10, false },
+        /* before the last byte */
+        { header + PAYLOAD_SIZE - 1, false },
+        /* while erasing the other sector */
+        { 1000, true },
+        /* after erase, in the new record */
+        { (int32_t)sector + header + 10, true },
+    };
+    uint32_t i;
+
+    for (i = 0; i < sizeof(torn) / sizeof(torn[0]); i++) {
+        host_flash_reset(page_size);
+        reboot();
+
+        if (!check_torn(torn[i].cut, torn[i].at_rollover)) {
+            printf("nvstore: torn case %u\n", (unsigned int)i);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(void)
+{
+    if (!run(1) || !run(8)) {
+        printf("nvstore: FAILED\n");
+        return 1;
+    }
+
+    printf("nvstore: all checks passed\n");
+    return 0;
+}
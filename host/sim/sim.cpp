@@ -0,0 +1,276 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+#include <math.h>
+#include "sim.h"
+
+#ifndef M_PI
+#define M_PI  3.14159265358979323846
+#endif
+
+#define DEG_TO_RAD  (M_PI / 180.0)
+
+/* Earth's magnetic field in micro tesla. The world frame is x: east,
+ * y: north, z: up. Total 48 uT, inclination 50 degree. */
+#define EARTH_FIELD_NORTH  30.85
+#define EARTH_FIELD_UP     (-36.77)
+
+/* Magnetization of the board, which AOC is expected to remove. */
+static const double g_hard_iron[3] = { 15.0, -10.0, 25.0 };
+
+/* Motion of the board: constant turn, and nodding on the other axes.
+ * It is as fast as figure-8 motion, so that AOC can find the offset. */
+#define YAW_RATE_DPS     90.0
+#define PITCH_AMP_DEG    60.0
+#define PITCH_PERIOD_S   3.1
+#define ROLL_AMP_DEG     45.0
+#define ROLL_PERIOD_S    2.3
+
+/* Step to differentiate attitude. */
+#define DIFF_STEP_S      0.001
+
+/* BMI160 has two sensors in one package, so both sensor types share
+ * one instance. */
+static struct sim_device g_bmi160;
+static bool              g_bmi160_used;
+
+static struct sim_device g_devices[AKH_MAX_DEVICES];
+static uint8_t           g_num_of_devices;
+
+/* Rotation matrix from the board frame to the world frame. */
+static void attitude(const double t, double r[3][3])
+{
+    double yaw = YAW_RATE_DPS * t * DEG_TO_RAD;
+    double pitch = PITCH_AMP_DEG * DEG_TO_RAD *
+                   sin(2.0 * M_PI * t / PITCH_PERIOD_S);
+    double roll = ROLL_AMP_DEG * DEG_TO_RAD *
+                  sin(2.0 * M_PI * t / ROLL_PERIOD_S);
+    double cy = cos(yaw), sy = sin(yaw);
+    double cp = cos(pitch), sp = sin(pitch);
+    double cr = cos(roll), sr = sin(roll);
+
+    /* Rz(yaw) * Rx(pitch) * Ry(roll) */
+    r[0][0] = cy * cr - sy * sp * sr;
+    r[0][1] = -sy * cp;
+    r[0][2] = cy * sr + sy * sp * cr;
+    r[1][0] = sy * cr + cy * sp * sr;
+    r[1][1] = cy * cp;
+    r[1][2] = sy * sr - cy * sp * cr;
+    r[2][0] = -cp * sr;
+    r[2][1] = sp;
+    r[2][2] = cp * cr;
+}
+
+/* Transform a world vector to the board frame. */
+static void to_board(const double r[3][3], const double w[3], double b[3])
+{
+    uint8_t i;
+
+    for (i = 0; i < 3; i++) {
+        b[i] = r[0][i] * w[0] + r[1][i] * w[1] + r[2][i] * w[2];
+    }
+}
+
+void sim_world(
+    const uint64_t now_ns,
+    double         mag[3],
+    double         acc[3],
+    double         gyr[3])
+{
+    static const double field[3] = { 0.0, EARTH_FIELD_NORTH, EARTH_FIELD_UP };
+    static const double up[3] = { 0.0, 0.0, 1.0 };
+    double  t = (double)now_ns / (double)SIM_NSEC_PER_SEC;
+    double  r0[3][3];
+    double  r1[3][3];
+    double  d[3][3];
+    uint8_t i, j;
+
+    attitude(t, r0);
+    to_board(r0, field, mag);
+    to_board(r0, up, acc);
+
+    for (i = 0; i < 3; i++) {
+        mag[i] += g_hard_iron[i];
+    }
+
+    /* Angular rate in the board frame: R0^T * R1 = I + [w]x * dt */
+    attitude(t + DIFF_STEP_S, r1);
+
+    for (i = 0; i < 3; i++) {
+        for (j = 0; j < 3; j++) {
+            d[i][j] = r0[0][i] * r1[0][j] + r0[1][i] * r1[1][j] +
+                      r0[2][i] * r1[2][j];
+        }
+    }
+
+    gyr[0] = (d[2][1] - d[1][2]) / (2.0 * DIFF_STEP_S) / DEG_TO_RAD;
+    gyr[1] = (d[0][2] - d[2][0]) / (2.0 * DIFF_STEP_S) / DEG_TO_RAD;
+    gyr[2] = (d[1][0] - d[0][1]) / (2.0 * DIFF_STEP_S) / DEG_TO_RAD;
+}
+
+double sim_noise(const double sigma)
+{
+    /* Fixed seed, so that every run is reproducible. */
+    static uint64_t state = 0x2545F4914F6CDD1DULL;
+    double          u1, u2;
+
+    /* xorshift64, then Box-Muller */
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    u1 = ((double)(state >> 11) + 1.0) / 9007199254740993.0;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    u2 = (double)(state >> 11) / 9007199254740992.0;
+
+    return sigma * sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+int32_t sim_clamp(const double val, const uint8_t bits)
+{
+    double max = (double)((1L << (bits - 1)) - 1);
+    double min = -(double)(1L << (bits - 1));
+
+    if (val > max) {
+        return (int32_t)max;
+    }
+
+    if (val < min) {
+        return (int32_t)min;
+    }
+
+    return (int32_t)lround(val);
+}
+
+struct sim_device *sim_create(const AKM_DEVICES dev)
+{
+    struct sim_device *sim;
+    const sim_ops     *ops;
+
+    switch (dev) {
+    case AKM_MAGNETOMETER_AK09940A:
+        ops = &sim_ak0994x_ops;
+        break;
+
+    case AKM_MAGNETOMETER_AK09911:
+    case AKM_MAGNETOMETER_AK09912:
+    case AKM_MAGNETOMETER_AK09913:
+    case AKM_MAGNETOMETER_AK09915:
+    case AKM_MAGNETOMETER_AK09915D:
+    case AKM_MAGNETOMETER_AK09916C:
+    case AKM_MAGNETOMETER_AK09916D:
+    case AKM_MAGNETOMETER_AK09917D:
+    case AKM_MAGNETOMETER_AK09918:
+    case AKM_MAGNETOMETER_AK09919:
+        ops = &sim_ak099xx_ops;
+        break;
+
+    case AKM_MAGNETOMETER_AK8963:
+        ops = &sim_ak8963_ops;
+        break;
+
+    case AKM_ACCELEROMETER_BMI160:
+    case AKM_GYROSCOPE_BMI160:
+        if (!g_bmi160_used) {
+            g_bmi160.ops = &sim_bmi160_ops;
+            g_bmi160.dev = dev;
+            g_bmi160.ops->reset(&g_bmi160);
+            g_bmi160_used = true;
+        }
+
+        return &g_bmi160;
+
+    case AKM_ACCELEROMETER_ADXL345:
+    case AKM_ACCELEROMETER_ADXL346:
+        ops = &sim_adxl34x_ops;
+        break;
+
+    case AKM_GYROSCOPE_L3G4200D:
+    case AKM_GYROSCOPE_L3GD20:
+        ops = &sim_l3g4200d_ops;
+        break;
+
+    default:
+        return NULL;
+    }
+
+    if (g_num_of_devices >= sizeof(g_devices) / sizeof(g_devices[0])) {
+        return NULL;
+    }
+
+    sim = &g_devices[g_num_of_devices++];
+    sim->ops = ops;
+    sim->dev = dev;
+    sim->ops->reset(sim);
+    return sim;
+}
+
+void sim_write(
+    struct sim_device *dev,
+    const uint8_t     reg,
+    const uint8_t     *data,
+    const uint16_t    len)
+{
+    uint8_t  addr = reg;
+    uint16_t i;
+
+    for (i = 0; i < len; i++) {
+        addr = dev->ops->write(dev, addr, data[i]);
+    }
+
+    dev->writes++;
+}
+
+void sim_read(
+    struct sim_device *dev,
+    const uint8_t     reg,
+    uint8_t           *data,
+    const uint16_t    len)
+{
+    uint8_t  addr = reg;
+    uint16_t i;
+
+    for (i = 0; i < len; i++) {
+        addr = dev->ops->read(dev, addr, &data[i]);
+    }
+
+    dev->reads++;
+}
+
+uint64_t sim_next_event(const struct sim_device *dev)
+{
+    return (dev->next_ns < dev->next2_ns) ? dev->next_ns : dev->next2_ns;
+}
+
+void sim_advance(
+    struct sim_device *dev,
+    const uint64_t    now_ns)
+{
+    uint64_t t;
+
+    for (;;) {
+        t = sim_next_event(dev);
+
+        if (t > now_ns) {
+            break;
+        }
+
+        dev->ops->sample(dev, t);
+    }
+}
@@ -0,0 +1,167 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+/*!
+ * \file sim.h
+ * \brief Register level models of sensors for host build.
+ */
+#ifndef INCLUDE_SIM_H
+#define INCLUDE_SIM_H
+
+#include "AKM_Common.h"
+#include "AKH_APIs.h"
+
+#define SIM_NUM_OF_REGS   256
+#define SIM_FIFO_DEPTH    32
+#define SIM_FRAME_SIZE    8
+
+#define SIM_NSEC_PER_SEC  1000000000ULL
+/* Time which is used when no event is scheduled */
+#define SIM_NEVER         UINT64_MAX
+
+struct sim_device;
+
+/*!
+ * Model specific behavior. Register access is done one byte at a time,
+ * so that each model can implement its own auto-increment and the side
+ * effects of read.
+ */
+struct sim_ops {
+    /*! Set all registers to the power-on value. */
+    void (*reset)(struct sim_device *dev);
+    /*! Write one register, and return the next address of burst write. */
+    uint8_t (*write)(struct sim_device *dev, const uint8_t reg, const uint8_t val);
+    /*! Read one register, and return the next address of burst read. */
+    uint8_t (*read)(struct sim_device *dev, const uint8_t reg, uint8_t *val);
+    /*! Take a sample which is due at now_ns. The model must advance
+     * next_ns (and next2_ns) past now_ns. */
+    void (*sample)(struct sim_device *dev, const uint64_t now_ns);
+};
+
+/*!
+ * State of one sensor device.
+ */
+struct sim_device {
+    const struct sim_ops *ops;
+    AKM_DEVICES          dev;
+    /*! IRQ line which is connected to the data ready pin. */
+    AKH_IRQ              irq;
+    uint8_t              regs[SIM_NUM_OF_REGS];
+    /*! Measurement period in nano seconds. 0 means stopped. */
+    uint64_t             period_ns;
+    /*! Virtual time of the next sample, or #SIM_NEVER. */
+    uint64_t             next_ns;
+    /*! Second sensor in the same package (BMI160 gyroscope). */
+    uint64_t             period2_ns;
+    uint64_t             next2_ns;
+    /*! IRQ line of the second sensor. */
+    AKH_IRQ              irq2;
+    /*! FIFO of raw frames. */
+    uint8_t              fifo[SIM_FIFO_DEPTH][SIM_FRAME_SIZE];
+    uint8_t              fifo_count;
+    /*! The number of register accesses, for statistics. */
+    uint32_t             reads;
+    uint32_t             writes;
+};
+
+/*!
+ * Physical quantity which the board is exposed to.
+ * \param now_ns Virtual time.
+ * \param mag Magnetic field in micro tesla, in sensor frame.
+ * \param acc Acceleration in G, in sensor frame.
+ * \param gyr Angular rate in degree per second, in sensor frame.
+ */
+void sim_world(
+    const uint64_t now_ns,
+    double         mag[3],
+    double         acc[3],
+    double         gyr[3]
+);
+
+/*!
+ * Get a sample of white noise.
+ * \param sigma Standard deviation.
+ */
+double sim_noise(const double sigma);
+
+/*!
+ * Round and saturate a value into signed range of the given bit width.
+ */
+int32_t sim_clamp(const double val, const uint8_t bits);
+
+/*! Convert output data rate to period in nano seconds. */
+#define SIM_HZ_TO_NS(hz)  ((uint64_t)(SIM_NSEC_PER_SEC / (hz)))
+
+/*!
+ * Create the model of a device. When a device has two sensors (BMI160),
+ * the same instance is returned for both.
+ * \return NULL when the device is not modeled.
+ */
+struct sim_device *sim_create(const AKM_DEVICES dev);
+
+/*! Write registers with auto-increment. */
+void sim_write(
+    struct sim_device *dev,
+    const uint8_t     reg,
+    const uint8_t     *data,
+    const uint16_t    len
+);
+
+/*! Read registers with auto-increment. */
+void sim_read(
+    struct sim_device *dev,
+    const uint8_t     reg,
+    uint8_t           *data,
+    const uint16_t    len
+);
+
+/*! Take all samples which are due at now_ns. */
+void sim_advance(
+    struct sim_device *dev,
+    const uint64_t    now_ns
+);
+
+/*! Get the time of the next sample, or #SIM_NEVER. */
+uint64_t sim_next_event(
+    const struct sim_device *dev
+);
+
+/*!
+ * Get virtual time. Implemented by the host HAL.
+ */
+uint64_t sim_now(
+    void
+);
+
+/*!
+ * Raise data ready pin of the device. Implemented by the host HAL.
+ * The handler is called immediately, at the time of the sample.
+ */
+void sim_raise_irq(
+    const AKH_IRQ irq
+);
+
+/* Models */
+extern const struct sim_ops sim_ak0994x_ops;
+extern const struct sim_ops sim_ak099xx_ops;
+extern const struct sim_ops sim_ak8963_ops;
+extern const struct sim_ops sim_bmi160_ops;
+extern const struct sim_ops sim_adxl34x_ops;
+extern const struct sim_ops sim_l3g4200d_ops;
+
+#endif /* INCLUDE_SIM_H */
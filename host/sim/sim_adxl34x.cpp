@@ -0,0 +1,152 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+#include <math.h>
+#include <string.h>
+#include "sim.h"
+
+#define REG_DEVID        0x00
+#define REG_BW_RATE      0x2C
+#define REG_POWER_CTL    0x2D
+#define REG_INT_ENABLE   0x2E
+#define REG_INT_SOURCE   0x30
+#define REG_DATA_FORMAT  0x31
+#define REG_DATAX0       0x32
+#define REG_DATAZ1       0x37
+
+#define PCTL_MEASURE     0x08
+#define INT_DATA_READY   0x80
+#define FORMAT_FULL_RES  0x08
+
+/* SPI read and multi-byte bits are not part of the address. */
+#define ADDRESS_MASK     0x3F
+
+#define NOISE_LSB        1.0
+
+/* Rate code 15 is 3200 Hz, and each step halves the rate. */
+static uint64_t rate_to_period(const uint8_t bw_rate)
+{
+    return (uint64_t)(SIM_NSEC_PER_SEC /
+                      (3200.0 * ldexp(1.0, (int)(bw_rate & 0x0F) - 15)));
+}
+
+static void start_stop(struct sim_device *dev)
+{
+    if ((dev->regs[REG_POWER_CTL] & PCTL_MEASURE) != 0) {
+        dev->period_ns = rate_to_period(dev->regs[REG_BW_RATE]);
+        dev->next_ns = sim_now() + dev->period_ns;
+    } else {
+        dev->period_ns = 0;
+        dev->next_ns = SIM_NEVER;
+    }
+}
+
+static void adxl34x_reset(struct sim_device *dev)
+{
+    memset(dev->regs, 0, sizeof(dev->regs));
+    dev->regs[REG_DEVID] =
+        (dev->dev == AKM_ACCELEROMETER_ADXL346) ? 0xE6 : 0xE5;
+    dev->regs[REG_BW_RATE] = 0x0A;
+    dev->irq = IRQ_ACC_1;
+    dev->period_ns = 0;
+    dev->next_ns = SIM_NEVER;
+    dev->next2_ns = SIM_NEVER;
+}
+
+static uint8_t adxl34x_write(
+    struct sim_device *dev,
+    const uint8_t     reg,
+    const uint8_t     val)
+{
+    uint8_t r = reg & ADDRESS_MASK;
+
+    switch (r) {
+    case REG_BW_RATE:
+    case REG_POWER_CTL:
+        dev->regs[r] = val;
+        start_stop(dev);
+        break;
+
+    case REG_INT_ENABLE:
+    case REG_DATA_FORMAT:
+        dev->regs[r] = val;
+        break;
+
+    default:
+        break;
+    }
+
+    return (uint8_t)((reg & ~ADDRESS_MASK) | ((r + 1) & ADDRESS_MASK));
+}
+
+static uint8_t adxl34x_read(
+    struct sim_device *dev,
+    const uint8_t     reg,
+    uint8_t           *val)
+{
+    uint8_t r = reg & ADDRESS_MASK;
+
+    *val = dev->regs[r];
+
+    if (r == REG_DATAZ1) {
+        dev->regs[REG_INT_SOURCE] &= ~INT_DATA_READY;
+    }
+
+    return (uint8_t)((reg & ~ADDRESS_MASK) | ((r + 1) & ADDRESS_MASK));
+}
+
+static void adxl34x_sample(struct sim_device *dev, const uint64_t now_ns)
+{
+    double  mag[3], acc[3], gyr[3];
+    double  lsb_per_g;
+    uint8_t range = dev->regs[REG_DATA_FORMAT] & 0x03;
+    uint8_t bits;
+    int32_t raw;
+    uint8_t i;
+
+    /* 10-bit output, or 4 mg/LSB in full resolution mode. */
+    if ((dev->regs[REG_DATA_FORMAT] & FORMAT_FULL_RES) != 0) {
+        lsb_per_g = 256.0;
+        bits = (uint8_t)(10 + range);
+    } else {
+        lsb_per_g = 256.0 / (double)(1 << range);
+        bits = 10;
+    }
+
+    sim_world(now_ns, mag, acc, gyr);
+
+    for (i = 0; i < 3; i++) {
+        raw = sim_clamp(acc[i] * lsb_per_g + sim_noise(NOISE_LSB), bits);
+        dev->regs[REG_DATAX0 + i * 2 + 0] = (uint8_t)raw;
+        dev->regs[REG_DATAX0 + i * 2 + 1] = (uint8_t)(raw >> 8);
+    }
+
+    dev->regs[REG_INT_SOURCE] |= INT_DATA_READY;
+    dev->next_ns += dev->period_ns;
+
+    if ((dev->regs[REG_INT_ENABLE] & INT_DATA_READY) != 0) {
+        sim_raise_irq(dev->irq);
+    }
+}
+
+const struct sim_ops sim_adxl34x_ops = {
+    adxl34x_reset,
+    adxl34x_write,
+    adxl34x_read,
+    adxl34x_sample
+};
@@ -0,0 +1,194 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+#include <string.h>
+#include "sim.h"
+
+#define REG_WIA1   0x00
+#define REG_WIA2   0x01
+#define REG_ST     0x0F
+#define REG_ST1    0x10
+#define REG_HXL    0x11
+#define REG_TMPS   0x1A
+#define REG_ST2    0x1B
+#define REG_SXL    0x20
+#define REG_CNTL3  0x32
+#define REG_CNTL4  0x33
+
+#define ST_DRDY    0x01
+#define ST1_DOR    0x02
+
+#define MODE_MASK       0x1F
+#define MODE_POWER_DOWN 0x00
+#define MODE_SINGLE     0x01
+#define MODE_SELF_TEST  0x10
+
+/* Sensitivity is 10 nT/LSB, data is 18-bit in 24-bit register. */
+#define LSB_PER_UT   100.0
+#define DATA_BITS    18
+#define NOISE_LSB    3.0
+
+/* Time to complete one measurement. */
+#define MEASURE_NS   1500000ULL
+
+/* Response to the internal coil, which is also stored to the reference
+ * data (SX, SY, SZ) as factory value. */
+static const int16_t g_self_test[3] = { -500, 700, -1000 };
+
+static uint64_t mode_to_period(const uint8_t mode)
+{
+    switch (mode) {
+    case 0x02: return SIM_HZ_TO_NS(10);
+    case 0x04: return SIM_HZ_TO_NS(20);
+    case 0x06: return SIM_HZ_TO_NS(50);
+    case 0x08: return SIM_HZ_TO_NS(100);
+    case 0x0A: return SIM_HZ_TO_NS(200);
+    case 0x0C: return SIM_HZ_TO_NS(400);
+    case 0x0E: return SIM_HZ_TO_NS(1000);
+    case 0x0F: return SIM_HZ_TO_NS(2500);
+    default:   return 0;
+    }
+}
+
+static void ak0994x_reset(struct sim_device *dev)
+{
+    uint16_t sx = (uint16_t)g_self_test[0] & 0x07FF;
+    uint16_t sy = (uint16_t)g_self_test[1] & 0x07FF;
+    uint16_t sz = (uint16_t)g_self_test[2] & 0x0FFF;
+
+    memset(dev->regs, 0, sizeof(dev->regs));
+    dev->regs[REG_WIA1] = 0x48;
+    dev->regs[REG_WIA2] = 0xA3;
+    dev->regs[REG_SXL + 0] = (uint8_t)sx;
+    dev->regs[REG_SXL + 1] = (uint8_t)(sx >> 8);
+    dev->regs[REG_SXL + 2] = (uint8_t)sy;
+    dev->regs[REG_SXL + 3] = (uint8_t)(sy >> 8);
+    dev->regs[REG_SXL + 4] = (uint8_t)sz;
+    dev->regs[REG_SXL + 5] = (uint8_t)(sz >> 8);
+    dev->irq = IRQ_MAG_1;
+    dev->period_ns = 0;
+    dev->next_ns = SIM_NEVER;
+    dev->next2_ns = SIM_NEVER;
+}
+
+static uint8_t ak0994x_write(
+    struct sim_device *dev,
+    const uint8_t     reg,
+    const uint8_t     val)
+{
+    uint8_t mode;
+
+    switch (reg) {
+    case REG_CNTL3:
+        dev->regs[reg] = val;
+        mode = val & MODE_MASK;
+
+        if ((mode == MODE_SINGLE) || (mode == MODE_SELF_TEST)) {
+            dev->period_ns = 0;
+            dev->next_ns = sim_now() + MEASURE_NS;
+        } else {
+            dev->period_ns = mode_to_period(mode);
+            dev->next_ns = (dev->period_ns != 0) ?
+                           sim_now() + dev->period_ns : SIM_NEVER;
+        }
+        break;
+
+    case REG_CNTL4:
+        if ((val & 0x01) != 0) {
+            ak0994x_reset(dev);
+        }
+        break;
+
+    case 0x30:
+    case 0x31:
+        dev->regs[reg] = val;
+        break;
+
+    default:
+        /* read only */
+        break;
+    }
+
+    return reg + 1;
+}
+
+static uint8_t ak0994x_read(
+    struct sim_device *dev,
+    const uint8_t     reg,
+    uint8_t           *val)
+{
+    *val = dev->regs[reg];
+
+    /* Reading ST2 means the end of data read. */
+    if (reg == REG_ST2) {
+        dev->regs[REG_ST] &= ~ST_DRDY;
+        dev->regs[REG_ST1] &= ~(ST_DRDY | ST1_DOR);
+    }
+
+    return reg + 1;
+}
+
+static void ak0994x_sample(struct sim_device *dev, const uint64_t now_ns)
+{
+    double  mag[3], acc[3], gyr[3];
+    double  val;
+    int32_t raw;
+    uint8_t mode = dev->regs[REG_CNTL3] & MODE_MASK;
+    uint8_t i;
+
+    sim_world(now_ns, mag, acc, gyr);
+
+    for (i = 0; i < 3; i++) {
+        if (mode == MODE_SELF_TEST) {
+            val = g_self_test[i] + sim_noise(NOISE_LSB);
+        } else {
+            val = mag[i] * LSB_PER_UT + sim_noise(NOISE_LSB);
+        }
+
+        raw = sim_clamp(val, DATA_BITS);
+        dev->regs[REG_HXL + i * 3 + 0] = (uint8_t)raw;
+        dev->regs[REG_HXL + i * 3 + 1] = (uint8_t)(raw >> 8);
+        dev->regs[REG_HXL + i * 3 + 2] = (uint8_t)(raw >> 16);
+    }
+
+    dev->regs[REG_TMPS] = 0x80;
+
+    if ((dev->regs[REG_ST1] & ST_DRDY) != 0) {
+        dev->regs[REG_ST1] |= ST1_DOR;
+    }
+
+    dev->regs[REG_ST] |= ST_DRDY;
+    dev->regs[REG_ST1] |= ST_DRDY;
+
+    if (dev->period_ns != 0) {
+        dev->next_ns += dev->period_ns;
+    } else {
+        /* single shot modes go back to power down */
+        dev->regs[REG_CNTL3] &= ~MODE_MASK;
+        dev->next_ns = SIM_NEVER;
+    }
+
+    sim_raise_irq(dev->irq);
+}
+
+const struct sim_ops sim_ak0994x_ops = {
+    ak0994x_reset,
+    ak0994x_write,
+    ak0994x_read,
+    ak0994x_sample
+};
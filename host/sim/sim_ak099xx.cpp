@@ -0,0 +1,282 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+#include <string.h>
+#include "sim.h"
+
+#define REG_WIA1   0x00
+#define REG_WIA2   0x01
+#define REG_INFO2  0x03
+#define REG_ST1    0x10
+#define REG_HXL    0x11
+#define REG_TMPS   0x17
+#define REG_ST2    0x18
+#define REG_CNTL1  0x30
+#define REG_CNTL2  0x31
+#define REG_CNTL3  0x32
+#define REG_ASAX   0x60
+
+#define ST1_DRDY   0x01
+#define ST1_DOR    0x02
+#define ST1_FNUM_SHIFT  2
+#define CNTL2_FIFO 0x80
+
+#define MODE_MASK       0x1F
+#define MODE_SINGLE     0x01
+#define MODE_SELF_TEST  0x10
+#define MODE_FUSE       0x1F
+
+/* FNUM field of ST1 is 5-bit. */
+#define FIFO_MAX   31
+
+#define MEASURE_NS  4000000ULL
+#define NOISE_LSB   1.5
+
+static uint8_t device_wia2(const AKM_DEVICES dev)
+{
+    switch (dev) {
+    case AKM_MAGNETOMETER_AK09911:  return 0x05;
+    case AKM_MAGNETOMETER_AK09912:  return 0x04;
+    case AKM_MAGNETOMETER_AK09913:  return 0x08;
+    case AKM_MAGNETOMETER_AK09915:
+    case AKM_MAGNETOMETER_AK09915D: return 0x10;
+    case AKM_MAGNETOMETER_AK09916C: return 0x09;
+    case AKM_MAGNETOMETER_AK09916D: return 0x0B;
+    case AKM_MAGNETOMETER_AK09917D: return 0x0D;
+    case AKM_MAGNETOMETER_AK09918:  return 0x0C;
+    case AKM_MAGNETOMETER_AK09919:  return 0x0E;
+    default:                        return 0x00;
+    }
+}
+
+/* AK09917D and AK09919 output big endian data. */
+static bool big_endian(const AKM_DEVICES dev)
+{
+    return (dev == AKM_MAGNETOMETER_AK09917D) ||
+           (dev == AKM_MAGNETOMETER_AK09919);
+}
+
+static uint64_t mode_to_period(const uint8_t mode)
+{
+    switch (mode) {
+    case 0x02: return SIM_HZ_TO_NS(10);
+    case 0x04: return SIM_HZ_TO_NS(20);
+    case 0x06: return SIM_HZ_TO_NS(50);
+    case 0x08: return SIM_HZ_TO_NS(100);
+    case 0x0A: return SIM_HZ_TO_NS(200);
+    case 0x0C: return SIM_HZ_TO_NS(1);
+    default:   return 0;
+    }
+}
+
+/* Copy the head of FIFO to the data registers. */
+static void load_frame(struct sim_device *dev)
+{
+    memcpy(&dev->regs[REG_HXL], dev->fifo[0], SIM_FRAME_SIZE);
+}
+
+static void ak099xx_reset(struct sim_device *dev)
+{
+    memset(dev->regs, 0, sizeof(dev->regs));
+    dev->regs[REG_WIA1] = 0x48;
+    dev->regs[REG_WIA2] = device_wia2(dev->dev);
+
+    if (dev->dev == AKM_MAGNETOMETER_AK09915D) {
+        dev->regs[REG_INFO2] = 0x02;
+    }
+
+    dev->irq = IRQ_MAG_1;
+    dev->period_ns = 0;
+    dev->next_ns = SIM_NEVER;
+    dev->next2_ns = SIM_NEVER;
+    dev->fifo_count = 0;
+}
+
+static uint8_t ak099xx_write(
+    struct sim_device *dev,
+    const uint8_t     reg,
+    const uint8_t     val)
+{
+    uint8_t mode;
+
+    switch (reg) {
+    case REG_CNTL1:
+        dev->regs[reg] = val;
+        break;
+
+    case REG_CNTL2:
+        dev->regs[reg] = val;
+        mode = val & MODE_MASK;
+        dev->fifo_count = 0;
+        dev->regs[REG_ST1] = 0;
+
+        if ((mode == MODE_SINGLE) || (mode == MODE_SELF_TEST)) {
+            dev->period_ns = 0;
+            dev->next_ns = sim_now() + MEASURE_NS;
+        } else {
+            dev->period_ns = mode_to_period(mode);
+            dev->next_ns = (dev->period_ns != 0) ?
+                           sim_now() + dev->period_ns : SIM_NEVER;
+        }
+        break;
+
+    case REG_CNTL3:
+        if ((val & 0x01) != 0) {
+            ak099xx_reset(dev);
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    return reg + 1;
+}
+
+static uint8_t ak099xx_read(
+    struct sim_device *dev,
+    const uint8_t     reg,
+    uint8_t           *val)
+{
+    bool fifo = (dev->regs[REG_CNTL2] & CNTL2_FIFO) != 0;
+
+    /* Fuse ROM is visible only in fuse access mode. */
+    if ((reg >= REG_ASAX) && (reg < REG_ASAX + 3)) {
+        *val = ((dev->regs[REG_CNTL2] & MODE_MASK) == MODE_FUSE) ? 128 : 0;
+        return reg + 1;
+    }
+
+    *val = dev->regs[reg];
+
+    if (reg != REG_ST2) {
+        return reg + 1;
+    }
+
+    if (!fifo) {
+        dev->regs[REG_ST1] &= ~(ST1_DRDY | ST1_DOR);
+        return reg + 1;
+    }
+
+    /* Pop one frame, and wrap around to read the next one. */
+    if (dev->fifo_count > 0) {
+        dev->fifo_count--;
+        memmove(dev->fifo[0], dev->fifo[1],
+                (size_t)dev->fifo_count * SIM_FRAME_SIZE);
+        load_frame(dev);
+    }
+
+    dev->regs[REG_ST1] = (uint8_t)(dev->fifo_count << ST1_FNUM_SHIFT);
+
+    if (dev->fifo_count > (dev->regs[REG_CNTL1] & 0x1F)) {
+        dev->regs[REG_ST1] |= ST1_DRDY;
+    }
+
+    return REG_HXL;
+}
+
+static void ak099xx_sample(struct sim_device *dev, const uint64_t now_ns)
+{
+    double  mag[3], acc[3], gyr[3];
+    double  lsb_per_ut;
+    double  val;
+    int32_t raw;
+    uint8_t frame[SIM_FRAME_SIZE];
+    uint8_t mode = dev->regs[REG_CNTL2] & MODE_MASK;
+    uint8_t bits;
+    uint8_t i;
+
+    /* AK09911 is 14-bit, 0.6 uT/LSB. Others are 16-bit, 0.15 uT/LSB. */
+    if (dev->dev == AKM_MAGNETOMETER_AK09911) {
+        lsb_per_ut = 1.0 / 0.6;
+        bits = 14;
+    } else {
+        lsb_per_ut = 1.0 / 0.15;
+        bits = 16;
+    }
+
+    sim_world(now_ns, mag, acc, gyr);
+
+    for (i = 0; i < 3; i++) {
+        if (mode == MODE_SELF_TEST) {
+            val = (i == 2) ?
+                  ((dev->dev == AKM_MAGNETOMETER_AK09911) ? -100 : -500) : 0;
+            val += sim_noise(NOISE_LSB);
+        } else {
+            val = mag[i] * lsb_per_ut + sim_noise(NOISE_LSB);
+        }
+
+        raw = sim_clamp(val, bits);
+
+        if (big_endian(dev->dev)) {
+            frame[i * 2 + 0] = (uint8_t)(raw >> 8);
+            frame[i * 2 + 1] = (uint8_t)raw;
+        } else {
+            frame[i * 2 + 0] = (uint8_t)raw;
+            frame[i * 2 + 1] = (uint8_t)(raw >> 8);
+        }
+    }
+
+    /* TMPS and ST2 */
+    frame[6] = 0x80;
+    frame[7] = 0x00;
+
+    if ((dev->regs[REG_CNTL2] & CNTL2_FIFO) != 0) {
+        if (dev->fifo_count >= FIFO_MAX) {
+            /* FIFO keeps old data, and new data is lost. */
+            dev->regs[REG_ST1] |= ST1_DOR;
+        } else {
+            memcpy(dev->fifo[dev->fifo_count], frame, SIM_FRAME_SIZE);
+            dev->fifo_count++;
+        }
+
+        load_frame(dev);
+        dev->regs[REG_ST1] = (uint8_t)((dev->regs[REG_ST1] & ST1_DOR) |
+                                       (dev->fifo_count << ST1_FNUM_SHIFT));
+
+        /* DRDY is asserted when the watermark is reached */
+        if (dev->fifo_count > (dev->regs[REG_CNTL1] & 0x1F)) {
+            dev->regs[REG_ST1] |= ST1_DRDY;
+        }
+    } else {
+        memcpy(&dev->regs[REG_HXL], frame, SIM_FRAME_SIZE);
+
+        if ((dev->regs[REG_ST1] & ST1_DRDY) != 0) {
+            dev->regs[REG_ST1] |= ST1_DOR;
+        }
+
+        dev->regs[REG_ST1] |= ST1_DRDY;
+    }
+
+    if (dev->period_ns != 0) {
+        dev->next_ns += dev->period_ns;
+    } else {
+        dev->regs[REG_CNTL2] &= ~MODE_MASK;
+        dev->next_ns = SIM_NEVER;
+    }
+
+    if ((dev->regs[REG_ST1] & ST1_DRDY) != 0) {
+        sim_raise_irq(dev->irq);
+    }
+}
+
+const struct sim_ops sim_ak099xx_ops = {
+    ak099xx_reset,
+    ak099xx_write,
+    ak099xx_read,
+    ak099xx_sample
+};
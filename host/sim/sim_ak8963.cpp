@@ -0,0 +1,183 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+#include <string.h>
+#include "sim.h"
+
+#define REG_WIA     0x00
+#define REG_INFO    0x01
+#define REG_ST1     0x02
+#define REG_HXL     0x03
+#define REG_ST2     0x09
+#define REG_CNTL1   0x0A
+#define REG_CNTL2   0x0B
+#define REG_ASTC    0x0C
+#define REG_I2CDIS  0x0F
+#define REG_ASAX    0x10
+
+#define ST1_DRDY    0x01
+#define ST1_DOR     0x02
+#define ST2_BITM    0x10
+#define CNTL1_BIT   0x10
+
+#define MODE_MASK       0x0F
+#define MODE_SINGLE     0x01
+#define MODE_SELF_TEST  0x08
+#define MODE_FUSE       0x0F
+
+#define MEASURE_NS  7200000ULL
+#define NOISE_LSB   1.0
+
+static uint64_t mode_to_period(const uint8_t mode)
+{
+    switch (mode) {
+    case 0x02: return SIM_HZ_TO_NS(8);
+    case 0x06: return SIM_HZ_TO_NS(100);
+    default:   return 0;
+    }
+}
+
+static void ak8963_reset(struct sim_device *dev)
+{
+    uint8_t i2cdis = dev->regs[REG_I2CDIS];
+
+    memset(dev->regs, 0, sizeof(dev->regs));
+    dev->regs[REG_WIA] = 0x48;
+    dev->regs[REG_INFO] = 0x9A;
+    /* I2CDIS is not initialized by soft reset */
+    dev->regs[REG_I2CDIS] = i2cdis;
+    dev->irq = IRQ_MAG_1;
+    dev->period_ns = 0;
+    dev->next_ns = SIM_NEVER;
+    dev->next2_ns = SIM_NEVER;
+}
+
+static uint8_t ak8963_write(
+    struct sim_device *dev,
+    const uint8_t     reg,
+    const uint8_t     val)
+{
+    uint8_t mode;
+
+    switch (reg) {
+    case REG_CNTL1:
+        dev->regs[reg] = val;
+        mode = val & MODE_MASK;
+
+        if ((mode == MODE_SINGLE) || (mode == MODE_SELF_TEST)) {
+            dev->period_ns = 0;
+            dev->next_ns = sim_now() + MEASURE_NS;
+        } else {
+            dev->period_ns = mode_to_period(mode);
+            dev->next_ns = (dev->period_ns != 0) ?
+                           sim_now() + dev->period_ns : SIM_NEVER;
+        }
+        break;
+
+    case REG_CNTL2:
+        if ((val & 0x01) != 0) {
+            ak8963_reset(dev);
+        }
+        break;
+
+    case REG_ASTC:
+        dev->regs[reg] = val & 0x40;
+        break;
+
+    case REG_I2CDIS:
+        dev->regs[reg] = (val == 0x1B) ? 1 : 0;
+        break;
+
+    default:
+        break;
+    }
+
+    return reg + 1;
+}
+
+static uint8_t ak8963_read(
+    struct sim_device *dev,
+    const uint8_t     reg,
+    uint8_t           *val)
+{
+    if ((reg >= REG_ASAX) && (reg < REG_ASAX + 3)) {
+        *val = ((dev->regs[REG_CNTL1] & MODE_MASK) == MODE_FUSE) ? 128 : 0;
+        return reg + 1;
+    }
+
+    *val = dev->regs[reg];
+
+    if (reg == REG_ST2) {
+        dev->regs[REG_ST1] &= ~(ST1_DRDY | ST1_DOR);
+    }
+
+    return reg + 1;
+}
+
+static void ak8963_sample(struct sim_device *dev, const uint64_t now_ns)
+{
+    double  mag[3], acc[3], gyr[3];
+    double  val;
+    double  lsb_per_ut;
+    int32_t raw;
+    uint8_t mode = dev->regs[REG_CNTL1] & MODE_MASK;
+    bool    bit16 = (dev->regs[REG_CNTL1] & CNTL1_BIT) != 0;
+    uint8_t i;
+
+    /* 0.6 uT/LSB in 14-bit output, 0.15 uT/LSB in 16-bit output */
+    lsb_per_ut = bit16 ? (1.0 / 0.15) : (1.0 / 0.6);
+
+    sim_world(now_ns, mag, acc, gyr);
+
+    for (i = 0; i < 3; i++) {
+        if ((mode == MODE_SELF_TEST) && (dev->regs[REG_ASTC] != 0)) {
+            val = (i == 2) ? (bit16 ? -2000 : -500) : 0;
+            val += sim_noise(NOISE_LSB);
+        } else {
+            val = mag[i] * lsb_per_ut + sim_noise(NOISE_LSB);
+        }
+
+        raw = sim_clamp(val, bit16 ? 16 : 14);
+        dev->regs[REG_HXL + i * 2 + 0] = (uint8_t)raw;
+        dev->regs[REG_HXL + i * 2 + 1] = (uint8_t)(raw >> 8);
+    }
+
+    dev->regs[REG_ST2] = bit16 ? ST2_BITM : 0;
+
+    if ((dev->regs[REG_ST1] & ST1_DRDY) != 0) {
+        dev->regs[REG_ST1] |= ST1_DOR;
+    }
+
+    dev->regs[REG_ST1] |= ST1_DRDY;
+
+    if (dev->period_ns != 0) {
+        dev->next_ns += dev->period_ns;
+    } else {
+        dev->regs[REG_CNTL1] &= ~MODE_MASK;
+        dev->next_ns = SIM_NEVER;
+    }
+
+    sim_raise_irq(dev->irq);
+}
+
+const struct sim_ops sim_ak8963_ops = {
+    ak8963_reset,
+    ak8963_write,
+    ak8963_read,
+    ak8963_sample
+};
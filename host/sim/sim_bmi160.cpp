@@ -0,0 +1,216 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+#include <math.h>
+#include <string.h>
+#include "sim.h"
+
+#define REG_CHIPID      0x00
+#define REG_ERR         0x02
+#define REG_PMU_STATUS  0x03
+#define REG_GYR_DATA    0x0C
+#define REG_ACC_DATA    0x12
+#define REG_STATUS      0x1B
+#define REG_ACC_CONF    0x40
+#define REG_ACC_RANGE   0x41
+#define REG_GYR_CONF    0x42
+#define REG_GYR_RANGE   0x43
+#define REG_CMD         0x7E
+
+#define STATUS_DRDY_ACC  0x80
+#define STATUS_DRDY_GYR  0x40
+
+#define PMU_ACC_NORMAL   0x10
+#define PMU_GYR_NORMAL   0x04
+
+#define CMD_ACC_SUSPEND  0x10
+#define CMD_ACC_NORMAL   0x11
+#define CMD_GYR_SUSPEND  0x14
+#define CMD_GYR_NORMAL   0x15
+#define CMD_SOFTRESET    0xB6
+
+#define ACC_NOISE_LSB    8.0
+#define GYR_NOISE_LSB    2.0
+
+/* ODR code 8 is 100 Hz, and each step doubles the rate. */
+static uint64_t odr_to_period(const uint8_t conf)
+{
+    uint8_t odr = conf & 0x0F;
+
+    if ((odr < 1) || (odr > 13)) {
+        return 0;
+    }
+
+    return (uint64_t)(SIM_NSEC_PER_SEC / (100.0 * ldexp(1.0, odr - 8)));
+}
+
+static double acc_lsb_per_g(const uint8_t range)
+{
+    switch (range & 0x0F) {
+    case 5:  return 8192.0;
+    case 8:  return 4096.0;
+    case 12: return 2048.0;
+    default: return 16384.0;
+    }
+}
+
+static double gyr_lsb_per_dps(const uint8_t range)
+{
+    return 16.4 * ldexp(1.0, range & 0x07);
+}
+
+static void put_vector(
+    uint8_t      *reg,
+    const double v[3],
+    const double scale,
+    const double noise)
+{
+    int32_t raw;
+    uint8_t i;
+
+    for (i = 0; i < 3; i++) {
+        raw = sim_clamp(v[i] * scale + sim_noise(noise), 16);
+        reg[i * 2 + 0] = (uint8_t)raw;
+        reg[i * 2 + 1] = (uint8_t)(raw >> 8);
+    }
+}
+
+static void bmi160_reset(struct sim_device *dev)
+{
+    memset(dev->regs, 0, sizeof(dev->regs));
+    dev->regs[REG_CHIPID] = 0xD1;
+    dev->regs[REG_ACC_CONF] = 0x28;
+    dev->regs[REG_ACC_RANGE] = 0x03;
+    dev->regs[REG_GYR_CONF] = 0x28;
+    dev->regs[REG_GYR_RANGE] = 0x00;
+    dev->irq = IRQ_ACC_1;
+    dev->irq2 = IRQ_GYR_1;
+    dev->period_ns = 0;
+    dev->next_ns = SIM_NEVER;
+    dev->period2_ns = 0;
+    dev->next2_ns = SIM_NEVER;
+}
+
+static uint8_t bmi160_write(
+    struct sim_device *dev,
+    const uint8_t     reg,
+    const uint8_t     val)
+{
+    uint8_t r = reg & 0x7F;
+
+    switch (r) {
+    case REG_ACC_CONF:
+    case REG_ACC_RANGE:
+    case REG_GYR_CONF:
+    case REG_GYR_RANGE:
+        dev->regs[r] = val;
+        break;
+
+    case REG_CMD:
+        switch (val) {
+        case CMD_ACC_NORMAL:
+            dev->regs[REG_PMU_STATUS] |= PMU_ACC_NORMAL;
+            dev->period_ns = odr_to_period(dev->regs[REG_ACC_CONF]);
+            dev->next_ns = (dev->period_ns != 0) ?
+                           sim_now() + dev->period_ns : SIM_NEVER;
+            break;
+
+        case CMD_ACC_SUSPEND:
+            dev->regs[REG_PMU_STATUS] &= ~PMU_ACC_NORMAL;
+            dev->period_ns = 0;
+            dev->next_ns = SIM_NEVER;
+            break;
+
+        case CMD_GYR_NORMAL:
+            dev->regs[REG_PMU_STATUS] |= PMU_GYR_NORMAL;
+            dev->period2_ns = odr_to_period(dev->regs[REG_GYR_CONF]);
+            dev->next2_ns = (dev->period2_ns != 0) ?
+                            sim_now() + dev->period2_ns : SIM_NEVER;
+            break;
+
+        case CMD_GYR_SUSPEND:
+            dev->regs[REG_PMU_STATUS] &= ~PMU_GYR_NORMAL;
+            dev->period2_ns = 0;
+            dev->next2_ns = SIM_NEVER;
+            break;
+
+        case CMD_SOFTRESET:
+            bmi160_reset(dev);
+            break;
+
+        default:
+            dev->regs[REG_ERR] = 0x02;
+            break;
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    return r + 1;
+}
+
+static uint8_t bmi160_read(
+    struct sim_device *dev,
+    const uint8_t     reg,
+    uint8_t           *val)
+{
+    uint8_t r = reg & 0x7F;
+
+    *val = dev->regs[r];
+
+    /* Data ready is cleared when the last byte of the data is read. */
+    if (r == REG_GYR_DATA + 5) {
+        dev->regs[REG_STATUS] &= ~STATUS_DRDY_GYR;
+    } else if (r == REG_ACC_DATA + 5) {
+        dev->regs[REG_STATUS] &= ~STATUS_DRDY_ACC;
+    }
+
+    return r + 1;
+}
+
+static void bmi160_sample(struct sim_device *dev, const uint64_t now_ns)
+{
+    double mag[3], acc[3], gyr[3];
+
+    sim_world(now_ns, mag, acc, gyr);
+
+    if (dev->next_ns <= now_ns) {
+        put_vector(&dev->regs[REG_ACC_DATA], acc,
+                   acc_lsb_per_g(dev->regs[REG_ACC_RANGE]), ACC_NOISE_LSB);
+        dev->regs[REG_STATUS] |= STATUS_DRDY_ACC;
+        dev->next_ns += dev->period_ns;
+        sim_raise_irq(dev->irq);
+    }
+
+    if (dev->next2_ns <= now_ns) {
+        put_vector(&dev->regs[REG_GYR_DATA], gyr,
+                   gyr_lsb_per_dps(dev->regs[REG_GYR_RANGE]), GYR_NOISE_LSB);
+        dev->regs[REG_STATUS] |= STATUS_DRDY_GYR;
+        dev->next2_ns += dev->period2_ns;
+        sim_raise_irq(dev->irq2);
+    }
+}
+
+const struct sim_ops sim_bmi160_ops = {
+    bmi160_reset,
+    bmi160_write,
+    bmi160_read,
+    bmi160_sample
+};
@@ -0,0 +1,160 @@
+/******************************************************************************
+ *
+ * COPYRIGHT 2017 ASAHI KASEI MICRODEVICES CORPORATION ("AKM")
+ * All Rights Reserved.
+ *
+ * This software is licensed to you under the Apache License, Version 2.0
+ * (http://www.apache.org/licenses/LICENSE-2.0) except for using, copying,
+ * modifying, merging, publishing and/or distributing in combination with
+ * AKM's Proprietary Software defined below. 
+ *
+ * "Proprietary Software" means the software and its related documentations
+ * which AKM will provide only to those who have entered into the commercial
+ * license agreement with AKM separately. If you wish to use, copy, modify,
+ * merge, publish and/or distribute this software in combination with AKM's
+ * Proprietary Software, you need to request AKM to enter into such agreement
+ * and grant commercial license to you.
+ *
+ ******************************************************************************/
+#include <string.h>
+#include "sim.h"
+
+#define REG_WHO_AM_I  0x0F
+#define REG_CTRL1     0x20
+#define REG_CTRL3     0x22
+#define REG_CTRL4     0x23
+#define REG_STATUS    0x27
+#define REG_OUT_X_L   0x28
+#define REG_OUT_Z_H   0x2D
+
+#define CTRL1_PD      0x08
+#define CTRL3_I2_DRDY 0x08
+#define CTRL4_BLE     0x40
+#define STATUS_ZYXDA  0x08
+#define STATUS_ZYXOR  0x80
+
+/* Address is incremented only when MSB of the sub address is set. */
+#define AUTO_INCREMENT  0x80
+
+#define NOISE_LSB     2.0
+
+static uint64_t ctrl1_to_period(const struct sim_device *dev)
+{
+    static const double l3g4200d_hz[4] = { 100, 200, 400, 800 };
+    static const double l3gd20_hz[4] = { 95, 190, 380, 760 };
+    uint8_t dr = (dev->regs[REG_CTRL1] >> 6) & 0x03;
+
+    if (dev->dev == AKM_GYROSCOPE_L3GD20) {
+        return SIM_HZ_TO_NS(l3gd20_hz[dr]);
+    }
+
+    return SIM_HZ_TO_NS(l3g4200d_hz[dr]);
+}
+
+static double fs_to_lsb_per_dps(const uint8_t ctrl4)
+{
+    switch ((ctrl4 >> 4) & 0x03) {
+    case 0:  return 1.0 / 0.00875;
+    case 1:  return 1.0 / 0.0175;
+    default: return 1.0 / 0.070;
+    }
+}
+
+static void l3g4200d_reset(struct sim_device *dev)
+{
+    memset(dev->regs, 0, sizeof(dev->regs));
+    dev->regs[REG_WHO_AM_I] =
+        (dev->dev == AKM_GYROSCOPE_L3GD20) ? 0xD4 : 0xD3;
+    dev->regs[REG_CTRL1] = 0x07;
+    dev->irq = IRQ_GYR_1;
+    dev->period_ns = 0;
+    dev->next_ns = SIM_NEVER;
+    dev->next2_ns = SIM_NEVER;
+}
+
+static uint8_t next_address(const uint8_t reg)
+{
+    if ((reg & AUTO_INCREMENT) == 0) {
+        return reg;
+    }
+
+    return (uint8_t)(AUTO_INCREMENT | ((reg + 1) & 0x7F));
+}
+
+static uint8_t l3g4200d_write(
+    struct sim_device *dev,
+    const uint8_t     reg,
+    const uint8_t     val)
+{
+    uint8_t r = reg & 0x7F;
+
+    if ((r >= REG_CTRL1) && (r <= 0x24)) {
+        dev->regs[r] = val;
+    }
+
+    if (r == REG_CTRL1) {
+        if ((val & CTRL1_PD) != 0) {
+            dev->period_ns = ctrl1_to_period(dev);
+
+            if (dev->next_ns == SIM_NEVER) {
+                dev->next_ns = sim_now() + dev->period_ns;
+            }
+        } else {
+            dev->period_ns = 0;
+            dev->next_ns = SIM_NEVER;
+        }
+    }
+
+    return next_address(reg);
+}
+
+static uint8_t l3g4200d_read(
+    struct sim_device *dev,
+    const uint8_t     reg,
+    uint8_t           *val)
+{
+    uint8_t r = reg & 0x7F;
+
+    *val = dev->regs[r];
+
+    if (r == REG_OUT_Z_H) {
+        dev->regs[REG_STATUS] &= ~(STATUS_ZYXDA | STATUS_ZYXOR);
+    }
+
+    return next_address(reg);
+}
+
+static void l3g4200d_sample(struct sim_device *dev, const uint64_t now_ns)
+{
+    double  mag[3], acc[3], gyr[3];
+    double  lsb_per_dps = fs_to_lsb_per_dps(dev->regs[REG_CTRL4]);
+    bool    ble = (dev->regs[REG_CTRL4] & CTRL4_BLE) != 0;
+    int32_t raw;
+    uint8_t i;
+
+    sim_world(now_ns, mag, acc, gyr);
+
+    for (i = 0; i < 3; i++) {
+        raw = sim_clamp(gyr[i] * lsb_per_dps + sim_noise(NOISE_LSB), 16);
+        dev->regs[REG_OUT_X_L + i * 2 + (ble ? 1 : 0)] = (uint8_t)raw;
+        dev->regs[REG_OUT_X_L + i * 2 + (ble ? 0 : 1)] = (uint8_t)(raw >> 8);
+    }
+
+    if ((dev->regs[REG_STATUS] & STATUS_ZYXDA) != 0) {
+        dev->regs[REG_STATUS] |= STATUS_ZYXOR;
+    }
+
+    dev->regs[REG_STATUS] |= STATUS_ZYXDA;
+    dev->next_ns += dev->period_ns;
+
+    if ((dev->regs[REG_CTRL3] & CTRL3_I2_DRDY) != 0) {
+        sim_raise_irq(dev->irq);
+    }
+}
+
+const struct sim_ops sim_l3g4200d_ops = {
+    l3g4200d_reset,
+    l3g4200d_write,
+    l3g4200d_read,
+    l3g4200d_sample
+};
@@ -21,19 +21,19 @@
 
 #include "AKL_APIs.h"
 
+/* measurement_loop returns this value when exit is requested by user. */
+#define LOOPER_EXIT  1
+
 /*!
  * \brief A main function of measurement sequence.
  *
  * \param prm A pointer to #AKL_SCL_PRMS struct.
  *
- * \return
+ * \return #AKM_SUCCESS or #LOOPER_EXIT when measurement is stopped,
+ * otherwise negative error code.
  */
 int16_t measurement_loop(
     struct AKL_SCL_PRMS *prm
 );
 
-void interrupt(
-    void
-);
-
 #endif /* INCLUDE_LOOPER_H */
@@ -41,12 +41,19 @@ static int16_t hw_init(void)
     int16_t fret;
     uint8_t axis_order[3];
     uint8_t axis_sign[3];
-    const AKM_DEVICES dev[] = {CONFIG_SLOT1, CONFIG_SLOT2, CONFIG_SLOT3};
+#ifndef CONFIG_AUTO_DETECT
+    const struct AKH_DEVICE_DESC devices[] = { CONFIG_DEVICES };
+#endif
 
     /* Initialize hardware */
     AKH_Init();
     
-    fret = AKS_Config(3, dev);
+#ifdef CONFIG_AUTO_DETECT
+    fret = AKS_ConfigDetect();
+#else
+    fret = AKS_ConfigDevices(
+            sizeof(devices) / sizeof(devices[0]), devices);
+#endif
 
     if (fret <= 0) {
         AKH_Print("AKS_Config failed...\n");
@@ -265,7 +272,7 @@ int main(void)
     int16_t fret;
     struct  AKL_SCL_PRMS *prm = NULL;
     int32_t test_result;
-    Ticker  one_milli_timer;
+    bool    quit;
 
     /* Initialize hardware */
     fret = hw_init();
@@ -275,9 +282,6 @@ int main(void)
         goto MAIN_QUIT;
     }
 
-    /* setup 1 millisecond timer */
-    one_milli_timer.attach(&interrupt, milliseconds(1));
-
     /* Execute self test */
     fret = AKS_SelfTest(AKM_ST_MAG, &test_result);
 
@@ -318,11 +322,13 @@ int main(void)
         /* start loop */
         fret = measurement_loop(prm);
 
-        if (fret != AKM_SUCCESS) {
+        if (fret < AKM_SUCCESS) {
             AKH_Print("looper failed.");
             break;
         }
 
+        quit = (fret == LOOPER_EXIT);
+
         /* finish measurement */
         fret = stop_and_save(prm);
 
@@ -330,6 +336,10 @@ int main(void)
             AKH_Print("stop_and_save failed.");
             break;
         }
+
+        if (quit) {
+            break;
+        }
     }
 
 MAIN_QUIT: